@@ -0,0 +1,214 @@
+#include "arrow_export.h"
+#include "mem_tablet_scan.h"
+
+namespace choco {
+
+static const char* ArrowFormat(Type type) {
+    switch (type) {
+    case Int8:
+        return "c";
+    case Int16:
+        return "s";
+    case Int32:
+        return "i";
+    case Int64:
+        return "l";
+    case Int128:
+        return "d:38,0";
+    case Float32:
+        return "f";
+    case Float64:
+        return "g";
+    case String:
+        return "u";
+    default:
+        return nullptr;
+    }
+}
+
+// private_data of exported schemas
+struct ExportedSchema {
+    string name;
+    vector<ArrowSchema> children;
+    vector<ArrowSchema*> child_ptrs;
+
+    ~ExportedSchema() {
+        // children moved by consumer are already marked released
+        for (auto& child : children) {
+            if (child.release) {
+                child.release(&child);
+            }
+        }
+    }
+};
+
+static void ReleaseSchema(ArrowSchema* schema) {
+    delete (ExportedSchema*)schema->private_data;
+    schema->release = nullptr;
+}
+
+static void InitSchema(ArrowSchema* schema, ExportedSchema* exported, const char* format) {
+    schema->format = format;
+    schema->name = exported->name.c_str();
+    schema->metadata = nullptr;
+    schema->flags = ARROW_FLAG_NULLABLE;
+    schema->n_children = exported->children.size();
+    schema->children = exported->child_ptrs.data();
+    schema->dictionary = nullptr;
+    schema->release = ReleaseSchema;
+    schema->private_data = exported;
+}
+
+Status ExportArrowSchema(const MemTabletScan& scan, ArrowSchema* schema) {
+    vector<std::pair<string, Type>> columns;
+    scan.block_schema(columns);
+    unique_ptr<ExportedSchema> exported(new ExportedSchema());
+    exported->children.resize(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        const char* format = ArrowFormat(columns[i].second);
+        if (!format) {
+            return Status::NotSupported(Format("arrow export of column %s not supported",
+                                               columns[i].first.c_str()));
+        }
+        ExportedSchema* child = new ExportedSchema();
+        child->name = columns[i].first;
+        InitSchema(&exported->children[i], child, format);
+        exported->child_ptrs.push_back(&exported->children[i]);
+    }
+    InitSchema(schema, exported.release(), "+s");
+    return Status::OK();
+}
+
+// private_data of exported arrays
+struct ExportedArray {
+    const void* buffers[3] = {nullptr, nullptr, nullptr};
+    // buffers copied into the array, as 64-bit words for alignment
+    vector<uint64_t> validity;
+    vector<uint64_t> data;
+    vector<uint64_t> bytes;
+    // page of zero-copy data and the tracker its buffers release to,
+    // so the array outlives the scan and tablet
+    RefPtr<MemTracker> tracker;
+    RefPtr<ColumnPage> page;
+    vector<ArrowArray> children;
+    vector<ArrowArray*> child_ptrs;
+
+    ~ExportedArray() {
+        for (auto& child : children) {
+            if (child.release) {
+                child.release(&child);
+            }
+        }
+    }
+};
+
+static void ReleaseArray(ArrowArray* array) {
+    delete (ExportedArray*)array->private_data;
+    array->release = nullptr;
+}
+
+static void InitArray(ArrowArray* array, ExportedArray* exported, size_t nrows, int64_t null_count,
+                      size_t nbuffers) {
+    array->length = nrows;
+    array->null_count = null_count;
+    array->offset = 0;
+    array->n_buffers = nbuffers;
+    array->n_children = exported->children.size();
+    array->buffers = exported->buffers;
+    array->children = exported->child_ptrs.data();
+    array->dictionary = nullptr;
+    array->release = ReleaseArray;
+    array->private_data = exported;
+}
+
+/**
+ * Arrow validity bitmap from null bitmap(or selection bitmap if invert
+ * is false) of nrows, nullptr if all rows are valid
+ */
+static const void* ExportValidity(const uint8_t* bitmap, bool invert, size_t nrows,
+                                  vector<uint64_t>& validity, int64_t& null_count) {
+    null_count = 0;
+    if (!bitmap) {
+        return nullptr;
+    }
+    size_t nset = BitmapCountSet(bitmap, nrows);
+    null_count = invert ? nset : nrows - nset;
+    if (null_count == 0) {
+        return nullptr;
+    }
+    validity.resize(BitmapSize64(nrows) / sizeof(uint64_t));
+    const uint64_t* src = (const uint64_t*)bitmap;
+    for (size_t i = 0; i < validity.size(); i++) {
+        validity[i] = invert ? ~src[i] : src[i];
+    }
+    return validity.data();
+}
+
+static Status ExportColumn(Type type, const ColumnBlock& cb, size_t nrows, ArrowArray* array) {
+    unique_ptr<ExportedArray> exported(new ExportedArray());
+    int64_t null_count = 0;
+    exported->buffers[0] = ExportValidity(cb.nulls(), true, nrows, exported->validity, null_count);
+    size_t nbuffers = 2;
+    if (type == String) {
+        // Slices in column blocks, gather them into int32 offsets and bytes
+        const Slice* ss = (const Slice*)cb.data();
+        size_t total = 0;
+        for (size_t i = 0; i < nrows; i++) {
+            total += cb.is_null(i) ? 0 : ss[i].size();
+        }
+        if (total > (size_t)INT32_MAX) {
+            return Status::NotSupported("arrow export of string column larger than 2GB");
+        }
+        exported->data.resize((nrows + 2) / 2);
+        exported->bytes.resize(total / sizeof(uint64_t) + 1);
+        int32_t* offsets = (int32_t*)exported->data.data();
+        uint8_t* bytes = (uint8_t*)exported->bytes.data();
+        offsets[0] = 0;
+        for (size_t i = 0; i < nrows; i++) {
+            size_t size = cb.is_null(i) ? 0 : ss[i].size();
+            memcpy(bytes + offsets[i], ss[i].data(), size);
+            offsets[i + 1] = offsets[i] + size;
+        }
+        exported->buffers[1] = offsets;
+        exported->buffers[2] = bytes;
+        nbuffers = 3;
+    } else if (cb.zero_copy()) {
+        exported->buffers[1] = cb.data();
+        exported->page = cb.page();
+        if (exported->page) {
+            exported->tracker = RefPtr<MemTracker>(exported->page->data().tracker());
+        }
+    } else {
+        size_t size = nrows * TypeInfo::get(type).size();
+        exported->data.resize(size / sizeof(uint64_t) + 1);
+        memcpy(exported->data.data(), cb.data(), size);
+        exported->buffers[1] = exported->data.data();
+    }
+    InitArray(array, exported.release(), nrows, null_count, nbuffers);
+    return Status::OK();
+}
+
+Status ExportArrowArray(const MemTabletScan& scan, const RowBlock& block, ArrowArray* array) {
+    vector<std::pair<string, Type>> columns;
+    scan.block_schema(columns);
+    DCHECK_EQ(columns.size(), block.num_columns());
+    size_t nrows = block.num_rows();
+    unique_ptr<ExportedArray> exported(new ExportedArray());
+    // released children are skipped when exported is destroyed on error
+    exported->children.resize(columns.size());
+    memset(exported->children.data(), 0, sizeof(ArrowArray) * columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (!ArrowFormat(columns[i].second)) {
+            return Status::NotSupported(Format("arrow export of column %s not supported",
+                                               columns[i].first.c_str()));
+        }
+        RETURN_NOT_OK(ExportColumn(columns[i].second, block.get_column(i), nrows, &exported->children[i]));
+        exported->child_ptrs.push_back(&exported->children[i]);
+    }
+    int64_t null_count = 0;
+    exported->buffers[0] = ExportValidity(block.selection(), false, nrows, exported->validity, null_count);
+    InitArray(array, exported.release(), nrows, null_count, 1);
+    return Status::OK();
+}
+
+} /* namespace choco */
@@ -0,0 +1,72 @@
+#ifndef CHOCO_ARROW_EXPORT_H_
+#define CHOCO_ARROW_EXPORT_H_
+
+#include "common.h"
+#include "row_block.h"
+
+// Arrow C data interface, ABI stable structs from
+// https://arrow.apache.org/docs/format/CDataInterface.html
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+}
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+namespace choco {
+
+class MemTabletScan;
+
+/**
+ * Arrow schema of blocks returned by scan: a struct with a nullable
+ * child per block column(MemTabletScan::block_schema), Int128 is
+ * exported as decimal128(38, 0)
+ */
+Status ExportArrowSchema(const MemTabletScan& scan, ArrowSchema* schema);
+
+/**
+ * export block returned by scan as an Arrow struct array, rows not in
+ * block's selection are null struct rows.
+ * Zero-copy column blocks(base pages without deltas) are exported
+ * without copying data, the array holds a reference to their column
+ * pages, so it stays valid after next_scan_block, and after the scan
+ * and tablet are destroyed. Other column blocks, string
+ * columns and null bitmaps(choco sets null bits, Arrow sets valid bits)
+ * are copied into the array.
+ */
+Status ExportArrowArray(const MemTabletScan& scan, const RowBlock& block, ArrowArray* array);
+
+} /* namespace choco */
+
+#endif /* CHOCO_ARROW_EXPORT_H_ */
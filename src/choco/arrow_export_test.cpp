@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+#include "arrow_export.h"
+#include "mem_tablet.h"
+#include "mem_tablet_scan.h"
+
+namespace choco {
+
+TEST(ArrowExport, row_block) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int64 id,int32 v null,float64 score", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const size_t N = 1000;
+    vector<int64_t> ids(N);
+    vector<int32_t> vs(N);
+    vector<double> scores(N);
+    vector<uint8_t> v_nulls(BitmapSize64(N), 0);
+    srand(1);
+    for (size_t i = 0; i < N; i++) {
+        ids[i] = i;
+        vs[i] = rand();
+        scores[i] = rand() / 3.0;
+        if (i % 7 == 0) {
+            BitmapSet(v_nulls.data(), i);
+        }
+    }
+    unique_ptr<WriteTx> wtx;
+    ASSERT_TRUE(tablet->create_writetx(wtx));
+    ColumnarBatch* cbatch = nullptr;
+    ASSERT_TRUE(wtx->new_columnar_batch({"id", "v", "score"}, cbatch));
+    ASSERT_TRUE(cbatch->append(N, {ids.data(), vs.data(), scores.data()}, {nullptr, v_nulls.data(), nullptr}));
+    ASSERT_TRUE(tablet->commit(wtx, 1));
+    // update v of some rows in version 2, its block gets a delta
+    ASSERT_TRUE(tablet->create_writetx(wtx));
+    ASSERT_TRUE(wtx->new_columnar_batch({"id", "v"}, cbatch));
+    vector<int64_t> uids = {3, 14, 700};
+    vector<int32_t> uvs = {-1, -2, -3};
+    ASSERT_TRUE(cbatch->append(uids.size(), {uids.data(), uvs.data()}, {}));
+    ASSERT_TRUE(tablet->commit(wtx, 2));
+    for (size_t i = 0; i < uids.size(); i++) {
+        vs[uids[i]] = uvs[i];
+        BitmapClear(v_nulls.data(), uids[i]);
+    }
+
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(2, "id,v,score", true, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(scanspec, scan));
+    ArrowSchema schema;
+    ASSERT_TRUE(ExportArrowSchema(*scan, &schema));
+    EXPECT_STREQ("+s", schema.format);
+    ASSERT_EQ(3, schema.n_children);
+    EXPECT_STREQ("id", schema.children[0]->name);
+    EXPECT_STREQ("l", schema.children[0]->format);
+    EXPECT_STREQ("i", schema.children[1]->format);
+    EXPECT_STREQ("g", schema.children[2]->format);
+    schema.release(&schema);
+    EXPECT_TRUE(schema.release == nullptr);
+
+    const RowBlock* block = nullptr;
+    ASSERT_TRUE(scan->next_scan_block(block));
+    ASSERT_TRUE(block != nullptr);
+    ASSERT_EQ(N, block->num_rows());
+    ArrowArray array;
+    ASSERT_TRUE(ExportArrowArray(*scan, *block, &array));
+    EXPECT_EQ((int64_t)N, array.length);
+    EXPECT_EQ(0, array.null_count);
+    ASSERT_EQ(3, array.n_children);
+    // base only blocks are not copied, v has a delta
+    const ColumnBlock& score_cb = block->get_column(2);
+    ASSERT_TRUE(score_cb.zero_copy());
+    EXPECT_EQ((const void*)score_cb.data(), array.children[2]->buffers[1]);
+    EXPECT_FALSE(block->get_column(1).zero_copy());
+    EXPECT_NE((const void*)block->get_column(1).data(), array.children[1]->buffers[1]);
+    EXPECT_TRUE(array.children[0]->buffers[0] == nullptr);
+    EXPECT_EQ((int64_t)BitmapCountSet(v_nulls.data(), N), array.children[1]->null_count);
+
+    // still valid after scan moves on
+    ASSERT_TRUE(scan->next_scan_block(block));
+    EXPECT_TRUE(block == nullptr);
+    // and after scan and tablet are destroyed, zero-copy pages are held
+    // by the array
+    scan.reset();
+    tablet.reset();
+    {
+        // reuse freed memory
+        ASSERT_TRUE(Schema::create("int64 id,int32 v null,float64 score", sc));
+        ASSERT_TRUE(MemTablet::create("", sc, tablet));
+        ASSERT_TRUE(tablet->create_writetx(wtx));
+        ASSERT_TRUE(wtx->new_columnar_batch({"id", "score"}, cbatch));
+        vector<double> zeros(N, 0);
+        ASSERT_TRUE(cbatch->append(N, {ids.data(), zeros.data()}, {}));
+        ASSERT_TRUE(tablet->commit(wtx, 1));
+    }
+    const int64_t* aids = (const int64_t*)array.children[0]->buffers[1];
+    const uint8_t* av_valid = (const uint8_t*)array.children[1]->buffers[0];
+    const int32_t* avs = (const int32_t*)array.children[1]->buffers[1];
+    const double* ascores = (const double*)array.children[2]->buffers[1];
+    for (size_t i = 0; i < N; i++) {
+        ASSERT_EQ(ids[i], aids[i]);
+        ASSERT_EQ(!BitmapTest(v_nulls.data(), i), BitmapTest(av_valid, i));
+        if (BitmapTest(av_valid, i)) {
+            ASSERT_EQ(vs[i], avs[i]);
+        }
+        ASSERT_EQ(scores[i], ascores[i]);
+    }
+    // consumer moves a child out and releases it separately
+    ArrowArray child = *array.children[0];
+    array.children[0]->release = nullptr;
+    array.release(&array);
+    EXPECT_TRUE(array.release == nullptr);
+    child.release(&child);
+}
+
+} /* namespace choco */
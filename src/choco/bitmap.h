@@ -14,6 +14,12 @@ inline size_t BitmapSize(size_t num_bits) {
   return (num_bits + 7) / 8;
 }
 
+// Return the number of bytes necessary to store the given number of bits,
+// padded to whole 64-bit words so the bitmap can be processed word-at-a-time.
+inline size_t BitmapSize64(size_t num_bits) {
+  return (num_bits + 63) / 64 * 8;
+}
+
 // Set the given bit.
 inline void BitmapSet(uint8_t *bitmap, size_t idx) {
   bitmap[idx >> 3] |= 1 << (idx & 7);
@@ -43,6 +49,43 @@ inline void BitmapMergeOr(uint8_t *dst, const uint8_t *src, size_t n_bits) {
   }
 }
 
+// dst &= src, 64 bits at a time. Both bitmaps should be allocated with
+// BitmapSize64(n_bits) bytes.
+inline void BitmapMergeAnd(uint8_t *dst, const uint8_t *src, size_t n_bits) {
+  size_t n_words = (n_bits + 63) / 64;
+  uint64_t* d = (uint64_t*)dst;
+  const uint64_t* s = (const uint64_t*)src;
+  for (size_t i = 0; i < n_words; i++) {
+    d[i] &= s[i];
+  }
+}
+
+// dst &= ~src, 64 bits at a time, e.g. remove null rows from a selection
+// bitmap. Both bitmaps should be allocated with BitmapSize64(n_bits) bytes.
+inline void BitmapMergeAndNot(uint8_t *dst, const uint8_t *src, size_t n_bits) {
+  size_t n_words = (n_bits + 63) / 64;
+  uint64_t* d = (uint64_t*)dst;
+  const uint64_t* s = (const uint64_t*)src;
+  for (size_t i = 0; i < n_words; i++) {
+    d[i] &= ~s[i];
+  }
+}
+
+// Count set bits in [0, n_bits), 64 bits at a time. The bitmap should be
+// allocated with BitmapSize64(n_bits) bytes.
+inline size_t BitmapCountSet(const uint8_t *bitmap, size_t n_bits) {
+  size_t n_full = n_bits / 64;
+  const uint64_t* w = (const uint64_t*)bitmap;
+  size_t ret = 0;
+  for (size_t i = 0; i < n_full; i++) {
+    ret += __builtin_popcountll(w[i]);
+  }
+  if (n_bits & 63) {
+    ret += __builtin_popcountll(w[n_full] & ((1ULL << (n_bits & 63)) - 1));
+  }
+  return ret;
+}
+
 // Set bits from offset to (offset + num_bits) to the specified value
 void BitmapChangeBits(uint8_t *bitmap, size_t offset, size_t num_bits, bool value);
 
@@ -0,0 +1,30 @@
+#include "gtest/gtest.h"
+#include "bitmap.h"
+
+namespace choco {
+
+TEST(Bitmap, merge) {
+    const size_t N = 1000;
+    vector<uint8_t> sel(BitmapSize64(N), 0);
+    vector<uint8_t> nulls(BitmapSize64(N), 0);
+    vector<uint8_t> mask(BitmapSize64(N), 0);
+    BitmapChangeBits(sel.data(), 0, N, true);
+    for (size_t i=0;i<N;i++) {
+        if (i % 3 == 0) {
+            BitmapSet(nulls.data(), i);
+        }
+        if (i % 2 == 0) {
+            BitmapSet(mask.data(), i);
+        }
+    }
+    EXPECT_EQ(BitmapCountSet(sel.data(), N), N);
+    BitmapMergeAndNot(sel.data(), nulls.data(), N);
+    EXPECT_EQ(BitmapCountSet(sel.data(), N), N - (N + 2) / 3);
+    BitmapMergeAnd(sel.data(), mask.data(), N);
+    for (size_t i=0;i<N;i++) {
+        EXPECT_EQ(BitmapTest(sel.data(), i), i % 3 != 0 && i % 2 == 0);
+    }
+    EXPECT_EQ(BitmapCountSet(sel.data(), 64), 21);
+}
+
+}
@@ -1,22 +1,59 @@
 #include "buffer.h"
+#include "mem_tracker.h"
+#include "page_pool.h"
 
 namespace choco {
 
-Status Buffer::alloc(size_t size, BufferTag tag) {
+static MemTracker::Kind TagKind(const BufferTag& tag) {
+    switch (tag.tag & 0xf) {
+    case 1:
+        return MemTracker::kNull;
+    case 2:
+        return MemTracker::kData;
+    case 4:
+        return MemTracker::kIndex;
+    case 8:
+        return MemTracker::kPool;
+    default:
+        return MemTracker::kOther;
+    }
+}
+
+Status Buffer::alloc(size_t size, BufferTag tag, bool zero) {
     if (size > 0) {
-        uint8_t* data = (uint8_t*)aligned_malloc(size, size>=4096?4096:64);
+        MemTracker::Kind kind = TagKind(tag);
+        if (tag.tracker && !tag.tracker->try_consume(size, kind)) {
+            const MemTracker* t = tag.tracker->find_limit_exceeded(size);
+            return Status::OOM(Format("alloc buffer size=%zu tag=%016lx exceeds memory limit of %s(%zd/%zd)",
+                                      size, tag.tag,
+                                      t ? t->label().c_str() : "",
+                                      t ? t->consumption() : 0,
+                                      t ? t->limit() : 0));
+        }
+        uint8_t* data = (uint8_t*)PagePool::global().alloc(size, zero);
         if (!data) {
+            if (tag.tracker) {
+                tag.tracker->release(size, kind);
+            }
             return Status::OOM(Format("alloc buffer size=%zu tag=%016lx failed", size, tag.tag));
         }
         _data = data;
         _bsize = size;
+        if (tag.tracker) {
+            _tracker = tag.tracker;
+            _kind = kind;
+        }
     }
     return Status::OK();
 }
 
 void Buffer::clear() {
     if (_data) {
-        aligned_free(_data);
+        PagePool::global().free(_data, _bsize);
+        if (_tracker) {
+            _tracker->release(_bsize, (MemTracker::Kind)_kind);
+            _tracker = nullptr;
+        }
         _data = nullptr;
         _bsize = 0;
     }
@@ -5,19 +5,34 @@
 
 namespace choco {
 
+class MemTracker;
+
+/**
+ * Identifies owner(column id, block id) and kind of a buffer, buffers
+ * allocated with a tracker are charged to it by kind
+ */
 struct BufferTag {
-    BufferTag(uint64_t tag) : tag(tag) {}
+    BufferTag(uint64_t tag, MemTracker* tracker=nullptr) : tag(tag), tracker(tracker) {}
+
+    static BufferTag base(uint32_t cid, uint32_t bid, MemTracker* tracker=nullptr) {
+        return  BufferTag( (((uint64_t)cid) << 32) | (((uint64_t)bid) << 16), tracker);
+    };
 
-    static BufferTag base(uint32_t cid, uint32_t bid) { return  BufferTag( (((uint64_t)cid) << 32) | (((uint64_t)bid) << 16)); };
+    static BufferTag delta(uint32_t cid, MemTracker* tracker=nullptr) {
+        return BufferTag( (((uint64_t)cid) << 32) | (((uint64_t)0xffff) << 16), tracker);
+    }
 
-    static BufferTag delta(uint32_t cid) { return BufferTag( (((uint64_t)cid) << 32) | (((uint64_t)0xffff) << 16) ); }
+    static BufferTag dict(uint32_t cid, MemTracker* tracker=nullptr) {
+        return BufferTag( (((uint64_t)cid) << 32) | (((uint64_t)0xfffe) << 16), tracker);
+    }
 
-    BufferTag null() { return BufferTag(tag | 1); }
-    BufferTag data() { return BufferTag(tag | 2); }
-    BufferTag index() { return BufferTag(tag | 4); }
-    BufferTag pool() { return BufferTag(tag | 8); }
+    BufferTag null() const { return BufferTag(tag | 1, tracker); }
+    BufferTag data() const { return BufferTag(tag | 2, tracker); }
+    BufferTag index() const { return BufferTag(tag | 4, tracker); }
+    BufferTag pool() const { return BufferTag(tag | 8, tracker); }
 
     uint64_t tag;
+    MemTracker* tracker;
 };
 
 
@@ -26,7 +41,12 @@ public:
     Buffer() = default;
     ~Buffer();
 
-    Status alloc(size_t size, BufferTag tag=0);
+    /**
+     * allocate from PagePool, memory is zeroed if zero is true,
+     * if tag has a tracker, it is charged until clear, so it must
+     * outlive this buffer
+     */
+    Status alloc(size_t size, BufferTag tag=0, bool zero=false);
     void clear();
 
     void set_zero();
@@ -35,6 +55,8 @@ public:
     const uint8_t* data() const {return _data;}
     uint8_t* data() {return _data;}
     size_t bsize() const {return _bsize;}
+    // tracker charged for this buffer, nullptr if none
+    MemTracker* tracker() const {return _tracker;}
 
     template <class T> T* as() { return (T*)_data; }
 
@@ -44,6 +66,8 @@ private:
 
     size_t _bsize = 0;
     uint8_t* _data = nullptr;
+    MemTracker* _tracker = nullptr;
+    uint32_t _kind = 0;
 };
 
 } /* namespace choco */
@@ -0,0 +1,614 @@
+#include <functional>
+#include "common.h"
+#include "hash_index.h"
+#include "column_delta.h"
+#include "column.h"
+#include "string_pool.h"
+#include "mem_tablet.h"
+#include "mem_tablet_scan.h"
+#include "page_pool.h"
+#include "simd.h"
+
+/**
+ * Benchmark suite: microbenchmarks of index/column/pool primitives and
+ * macro workloads over MemTablet, results are printed as JSON so runs can
+ * be compared across releases.
+ *
+ * usage: choco_bench [--filter=substr] [--json=path] [--scale=n] [--repeat=n]
+ */
+
+namespace choco {
+
+struct BenchOptions {
+    string filter;
+    string json;
+    // multiplies data sizes
+    double scale = 1;
+    // each measurement runs repeat times, best is reported
+    int repeat = 3;
+};
+
+struct BenchResult {
+    string name;
+    vector<std::pair<string, string>> params;
+    // operations/rows processed in one run
+    size_t items = 0;
+    double seconds = 0;
+    vector<std::pair<string, double>> counters;
+};
+
+static vector<BenchResult> g_results;
+
+static void Report(const string& name, const vector<std::pair<string, string>>& params, size_t items,
+                   double seconds, const vector<std::pair<string, double>>& counters = {}) {
+    BenchResult r;
+    r.name = name;
+    r.params = params;
+    r.items = items;
+    r.seconds = seconds;
+    r.counters = counters;
+    string ps;
+    for (auto& p : params) {
+        ps += Format(" %s=%s", p.first.c_str(), p.second.c_str());
+    }
+    LOG(INFO) << Format("%-24s%-32s %10zu items %9.4lfs %14.0lf items/s", name.c_str(), ps.c_str(),
+                        items, seconds, seconds > 0 ? items / seconds : 0.0);
+    g_results.emplace_back(std::move(r));
+}
+
+// run f repeat times, f returns seconds of its measured part, return best
+static double Best(const BenchOptions& opt, const std::function<double()>& f) {
+    double best = 0;
+    for (int i = 0; i < opt.repeat; i++) {
+        double t = f();
+        if (i == 0 || t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static size_t Scaled(const BenchOptions& opt, size_t n) {
+    return std::max((size_t)1, (size_t)(n * opt.scale));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// microbenchmarks
+
+static void BenchHashIndex(const BenchOptions& opt) {
+    size_t capacity = Scaled(opt, 4 << 20);
+    for (double lf : {0.25, 0.5, 0.75, 0.9}) {
+        size_t n = capacity * lf;
+        vector<uint64_t> hashes(n);
+        for (size_t i = 0; i < n; i++) {
+            hashes[i] = HashCode(i);
+        }
+        unique_ptr<HashIndex> index;
+        double tadd = Best(opt, [&]() {
+            index.reset(new HashIndex(capacity));
+            vector<HashIndex::Entry> entries;
+            double t0 = Time();
+            for (size_t i = 0; i < n; i++) {
+                entries.clear();
+                uint32_t slot = index->find(hashes[i], entries);
+                index->set(slot, hashes[i], i);
+            }
+            return Time() - t0;
+        });
+        vector<std::pair<string, string>> params = {{"load_factor", Format("%.2lf", lf)},
+                                                    {"capacity", std::to_string(capacity)}};
+        Report("hash_index_add", params, n, tadd);
+        // hits in random order
+        vector<uint64_t> probes(hashes);
+        std::random_shuffle(probes.begin(), probes.end());
+        size_t nentry = 0;
+        double tfind = Best(opt, [&]() {
+            vector<HashIndex::Entry> entries;
+            nentry = 0;
+            double t0 = Time();
+            for (size_t i = 0; i < n; i++) {
+                entries.clear();
+                index->find(probes[i], entries);
+                nentry += entries.size();
+            }
+            return Time() - t0;
+        });
+        Report("hash_index_find", params, n, tfind, {{"entries_per_find", (double)nentry / n}});
+    }
+}
+
+// random finds in a large index with and without huge pages
+static void BenchHashIndexHugePage(const BenchOptions& opt) {
+    size_t n = Scaled(opt, 4 << 20);
+    vector<uint64_t> probes(n);
+    for (size_t i = 0; i < n; i++) {
+        probes[i] = HashCode((i * 0x9e3779b97f4a7c15ULL) % n);
+    }
+    bool old = PagePool::global().use_huge_page();
+    for (int huge = 0; huge < 2; huge++) {
+        PagePool::global().set_use_huge_page(huge);
+        PagePool::Stats s0 = PagePool::global().stats();
+        HashIndex index(n);
+        PagePool::Stats s1 = PagePool::global().stats();
+        for (size_t i = 0; i < n; i++) {
+            index.add(HashCode(i), i);
+        }
+        double tfind = Best(opt, [&]() {
+            vector<HashIndex::Entry> entries;
+            double t0 = Time();
+            for (size_t i = 0; i < n; i++) {
+                entries.clear();
+                index.find(probes[i], entries);
+            }
+            return Time() - t0;
+        });
+        Report("hash_index_huge_page_find", {{"huge_page", std::to_string(huge)},
+                                             {"capacity", std::to_string(index.capacity())}},
+               n, tfind, {{"hugetlb", (double)(s1.hugetlb - s0.hugetlb)}, {"thp", (double)(s1.thp - s0.thp)}});
+    }
+    PagePool::global().set_use_huge_page(old);
+}
+
+static void BenchDeltaFind(const BenchOptions& opt) {
+    size_t nrows = Scaled(opt, 4 << 20);
+    size_t nblock = NBlock(nrows, Column::BLOCK_SIZE);
+    for (double density : {0.001, 0.01, 0.1}) {
+        // sorted distinct updated rids
+        vector<uint32_t> rids;
+        for (size_t i = 0; i < nrows; i++) {
+            if (rand() < density * RAND_MAX) {
+                rids.push_back(i);
+            }
+        }
+        RefPtr<ColumnDelta> delta = RefPtr<ColumnDelta>::create();
+        CHECK(delta->alloc(nblock, std::max((size_t)1, rids.size()), sizeof(uint32_t),
+                           BufferTag::delta(1), false));
+        DeltaIndex* index = delta->index();
+        uint16_t* idxdata = index->_data.as<uint16_t>();
+        size_t cidx = 0;
+        for (size_t bid = 0; bid < nblock; bid++) {
+            while (cidx < rids.size() && (rids[cidx] >> 16) == bid) {
+                idxdata[cidx] = rids[cidx] & 0xffff;
+                cidx++;
+            }
+            index->_block_ends[bid] = cidx;
+        }
+        vector<uint32_t> probes(Scaled(opt, 1 << 20));
+        for (auto& p : probes) {
+            p = rand() % nrows;
+        }
+        size_t found = 0;
+        double t = Best(opt, [&]() {
+            found = 0;
+            double t0 = Time();
+            for (auto rid : probes) {
+                found += index->find_idx(rid) != DeltaIndex::npos;
+            }
+            return Time() - t0;
+        });
+        Report("delta_find_idx", {{"density", Format("%.3lf", density)}}, probes.size(), t,
+               {{"hit_ratio", (double)found / probes.size()}});
+    }
+}
+
+static void BenchStringPool(const BenchOptions& opt) {
+    size_t n = Scaled(opt, 1 << 20);
+    for (size_t len : {8, 32, 128}) {
+        vector<string> strs(std::min(n, (size_t)65536));
+        for (auto& s : strs) {
+            s.resize(len);
+            for (auto& c : s) {
+                c = 'a' + rand() % 26;
+            }
+        }
+        double t = Best(opt, [&]() {
+            RefPtr<StringPool> pool;
+            CHECK(StringPool::create(pool));
+            uint32_t sid = 0;
+            double t0 = Time();
+            for (size_t i = 0; i < n; i++) {
+                CHECK(StringPool::add(pool, Slice(strs[i % strs.size()]), sid));
+            }
+            return Time() - t0;
+        });
+        Report("string_pool_add", {{"length", std::to_string(len)}}, n, t);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// tablet workloads
+
+static const char* kTabletSchema = "int32 id,int32 uv,int32 pv,int8 city null";
+
+static shared_ptr<MemTablet> CreateTablet() {
+    unique_ptr<Schema> sc;
+    CHECK(Schema::create(kTabletSchema, sc));
+    shared_ptr<MemTablet> tablet;
+    CHECK(MemTablet::create("", sc, tablet));
+    return tablet;
+}
+
+/**
+ * write rows with ids [start, end) in one commit, if nupdate > 0 write
+ * nupdate random ids in [0, end) instead(updating pv and city only),
+ * with WriteTx mode, return time of prepare(if prepare is true) and commit
+ */
+static double WriteRows(MemTablet& tablet, uint64_t version, int start, int end, int nupdate = 0,
+                        bool prepare = true, WriteMode mode = WriteUpsert) {
+    unique_ptr<WriteTx> wtx;
+    CHECK(tablet.create_writetx(wtx));
+    wtx->set_mode(mode);
+    PartialRowWriter writer(wtx->schema());
+    PartialRowBatch* batch = wtx->new_batch();
+    int n = nupdate > 0 ? nupdate : end - start;
+    for (int i = 0; i < n; i++) {
+        writer.start_row();
+        int32_t id = nupdate > 0 ? rand() % end : start + i;
+        int32_t uv = rand() % 10000;
+        int32_t pv = rand() % 10000;
+        int8_t city = rand() % 100;
+        CHECK(writer.set("id", &id));
+        if (nupdate == 0) {
+            CHECK(writer.set("uv", &uv));
+        }
+        CHECK(writer.set("pv", &pv));
+        CHECK(writer.set("city", city % 2 == 0 ? nullptr : &city));
+        if (!writer.write_row_to_batch(*batch)) {
+            batch = wtx->new_batch();
+            CHECK(writer.write_row_to_batch(*batch));
+        }
+    }
+    double t0 = Time();
+    if (prepare) {
+        CHECK(tablet.prepare_writetx(wtx));
+    }
+    CHECK(tablet.commit(wtx, version));
+    return Time() - t0;
+}
+
+// same rows as WriteRows(insert) with MemTablet::append_columns, return time of append
+static double AppendRows(MemTablet& tablet, uint64_t version, int start, int end) {
+    size_t n = end - start;
+    vector<int32_t> ids(n), uvs(n), pvs(n);
+    vector<int8_t> cities(n);
+    vector<uint8_t> city_nulls(BitmapSize64(n), 0);
+    for (size_t i = 0; i < n; i++) {
+        ids[i] = start + i;
+        uvs[i] = rand() % 10000;
+        pvs[i] = rand() % 10000;
+        cities[i] = rand() % 100;
+        if (cities[i] % 2 == 0) {
+            BitmapSet(city_nulls.data(), i);
+        }
+    }
+    vector<ColumnArray> columns = {
+        ColumnArray("id", ids.data()),
+        ColumnArray("uv", uvs.data()),
+        ColumnArray("pv", pvs.data()),
+        ColumnArray("city", cities.data(), city_nulls.data()),
+    };
+    double t0 = Time();
+    CHECK(tablet.append_columns(n, columns, version));
+    return Time() - t0;
+}
+
+// same rows as WriteRows in one ColumnarBatch, return time of commit
+static double WriteColumnar(MemTablet& tablet, uint64_t version, int start, int end, int nupdate = 0) {
+    size_t n = nupdate > 0 ? nupdate : end - start;
+    vector<int32_t> ids(n), uvs(n), pvs(n);
+    vector<int8_t> cities(n);
+    vector<uint8_t> city_nulls(BitmapSize64(n), 0);
+    for (size_t i = 0; i < n; i++) {
+        ids[i] = nupdate > 0 ? rand() % end : start + i;
+        uvs[i] = rand() % 10000;
+        pvs[i] = rand() % 10000;
+        cities[i] = rand() % 100;
+        if (cities[i] % 2 == 0) {
+            BitmapSet(city_nulls.data(), i);
+        }
+    }
+    unique_ptr<WriteTx> wtx;
+    CHECK(tablet.create_writetx(wtx));
+    ColumnarBatch* batch = nullptr;
+    if (nupdate > 0) {
+        CHECK(wtx->new_columnar_batch({"id", "pv", "city"}, batch));
+        CHECK(batch->append(n, {ids.data(), pvs.data(), cities.data()}, {nullptr, nullptr, city_nulls.data()}));
+    } else {
+        CHECK(wtx->new_columnar_batch({"id", "uv", "pv", "city"}, batch));
+        CHECK(batch->append(n, {ids.data(), uvs.data(), pvs.data(), cities.data()},
+                            {nullptr, nullptr, nullptr, city_nulls.data()}));
+    }
+    double t0 = Time();
+    CHECK(tablet.commit(wtx, version));
+    return Time() - t0;
+}
+
+static size_t ScanAll(MemTablet& tablet, uint64_t version, const char* columns) {
+    unique_ptr<ScanSpec> spec;
+    CHECK(ScanSpec::create(version, columns, false, spec));
+    unique_ptr<MemTabletScan> scan;
+    CHECK(tablet.scan(spec, scan));
+    const RowBlock* rb = nullptr;
+    size_t nrows = 0;
+    while (true) {
+        CHECK(scan->next_scan_block(rb));
+        if (!rb) {
+            break;
+        }
+        nrows += rb->num_rows();
+    }
+    return nrows;
+}
+
+static void BenchCommit(const BenchOptions& opt) {
+    int nrows = Scaled(opt, 1 << 20);
+    for (int rows_per_commit : {10000, 100000, 1000000}) {
+        rows_per_commit = std::min(rows_per_commit, nrows);
+        double tinsert = Best(opt, [&]() {
+            auto tablet = CreateTablet();
+            double t = 0;
+            uint64_t version = 0;
+            for (int start = 0; start < nrows; start += rows_per_commit) {
+                t += WriteRows(*tablet, ++version, start, std::min(start + rows_per_commit, nrows));
+            }
+            return t;
+        });
+        Report("commit_insert", {{"rows_per_commit", std::to_string(rows_per_commit)}}, nrows, tinsert);
+        double tappend = Best(opt, [&]() {
+            auto tablet = CreateTablet();
+            double t = 0;
+            uint64_t version = 0;
+            for (int start = 0; start < nrows; start += rows_per_commit) {
+                t += AppendRows(*tablet, ++version, start, std::min(start + rows_per_commit, nrows));
+            }
+            return t;
+        });
+        Report("append_columns", {{"rows_per_commit", std::to_string(rows_per_commit)}}, nrows, tappend);
+        double tcolumnar = Best(opt, [&]() {
+            auto tablet = CreateTablet();
+            double t = 0;
+            uint64_t version = 0;
+            for (int start = 0; start < nrows; start += rows_per_commit) {
+                t += WriteColumnar(*tablet, ++version, start, std::min(start + rows_per_commit, nrows));
+            }
+            return t;
+        });
+        Report("commit_columnar", {{"rows_per_commit", std::to_string(rows_per_commit)}}, nrows, tcolumnar);
+        for (WriteMode mode : {WriteInsertOnly, WriteInsertOnlyVerify}) {
+            double t = Best(opt, [&]() {
+                auto tablet = CreateTablet();
+                double t = 0;
+                uint64_t version = 0;
+                for (int start = 0; start < nrows; start += rows_per_commit) {
+                    t += WriteRows(*tablet, ++version, start, std::min(start + rows_per_commit, nrows), 0,
+                                   true, mode);
+                }
+                return t;
+            });
+            Report("commit_insert_only", {{"rows_per_commit", std::to_string(rows_per_commit)},
+                                          {"verify", std::to_string(mode == WriteInsertOnlyVerify)}},
+                   nrows, t);
+        }
+    }
+    auto tablet = CreateTablet();
+    WriteRows(*tablet, 1, 0, nrows);
+    uint64_t version = 1;
+    for (int nupdate : {1000, 10000, 100000}) {
+        double t = Best(opt, [&]() {
+            return WriteRows(*tablet, ++version, 0, nrows, nupdate);
+        });
+        Report("commit_update", {{"rows_per_commit", std::to_string(nupdate)},
+                                 {"tablet_rows", std::to_string(nrows)}}, nupdate, t);
+        t = Best(opt, [&]() {
+            return WriteColumnar(*tablet, ++version, 0, nrows, nupdate);
+        });
+        Report("commit_columnar_update", {{"rows_per_commit", std::to_string(nupdate)},
+                                          {"tablet_rows", std::to_string(nrows)}}, nupdate, t);
+    }
+    // updates concentrated on 1000 keys, collapsed by prepare_writetx
+    int nhot = std::min(1000, nrows);
+    for (bool prepare : {false, true}) {
+        double t = Best(opt, [&]() {
+            return WriteRows(*tablet, ++version, 0, nhot, 100000, prepare);
+        });
+        Report("commit_hot_keys", {{"keys", std::to_string(nhot)},
+                                   {"prepare", std::to_string(prepare)}}, 100000, t);
+    }
+}
+
+static void BenchScanDeltas(const BenchOptions& opt) {
+    int nrows = Scaled(opt, 1 << 20);
+    auto tablet = CreateTablet();
+    WriteRows(*tablet, 1, 0, nrows);
+    uint64_t version = 1;
+    int ndelta = 0;
+    for (int target : {0, 1, 4, 16}) {
+        // each update commit adds one delta to pv and city, 1% of rows
+        for (; ndelta < target; ndelta++) {
+            WriteRows(*tablet, ++version, 0, nrows, nrows / 100);
+        }
+        double t = Best(opt, [&]() {
+            double t0 = Time();
+            CHECK_EQ((size_t)nrows, ScanAll(*tablet, version, "id,pv,city"));
+            return Time() - t0;
+        });
+        Report("scan_get_block", {{"deltas", std::to_string(ndelta)}}, nrows, t);
+    }
+}
+
+static void BenchMultiGet(const BenchOptions& opt) {
+    int nrows = Scaled(opt, 1 << 20);
+    auto tablet = CreateTablet();
+    WriteRows(*tablet, 1, 0, nrows);
+    WriteRows(*tablet, 2, 0, nrows, nrows / 100);
+    size_t total = Scaled(opt, 1 << 20);
+    for (size_t batch : {1, 64, 4096}) {
+        vector<int32_t> keys(total);
+        for (auto& k : keys) {
+            // 10% misses
+            k = rand() % (nrows + nrows / 10);
+        }
+        double t = Best(opt, [&]() {
+            unique_ptr<ScanSpec> spec;
+            CHECK(ScanSpec::create(2, "id,uv,pv,city", true, spec));
+            unique_ptr<MemTabletScan> scan;
+            CHECK(tablet->scan(spec, scan));
+            MemTabletScan::GetResult result;
+            double t0 = Time();
+            for (size_t i = 0; i < total; i += batch) {
+                CHECK(scan->get(result, std::min(batch, total - i), keys.data() + i));
+            }
+            return Time() - t0;
+        });
+        Report("multi_get", {{"batch", std::to_string(batch)}}, total, t);
+    }
+}
+
+// ingest in commits with upserts mixed in, then filtered scan
+static void BenchMacroIngest(const BenchOptions& opt) {
+    int nrows = Scaled(opt, 4 << 20);
+    int ncommit = 20;
+    double twrite = 0;
+    double tscan = 0;
+    size_t nwrite = 0;
+    auto tablet = CreateTablet();
+    uint64_t version = 0;
+    int per_commit = std::max(1, nrows / ncommit);
+    for (int start = 0; start < nrows; start += per_commit) {
+        int end = std::min(start + per_commit, nrows);
+        twrite += WriteRows(*tablet, ++version, start, end);
+        nwrite += end - start;
+        int nupdate = std::max(1, (end - start) / 10);
+        twrite += WriteRows(*tablet, ++version, 0, end, nupdate);
+        nwrite += nupdate;
+    }
+    Report("macro_ingest", {{"rows", std::to_string(nrows)}, {"commits", std::to_string(version)}},
+           nwrite, twrite, {{"memory_bytes", (double)tablet->mem_tracker()->consumption()}});
+    tscan = Best(opt, [&]() {
+        unique_ptr<ScanSpec> spec;
+        CHECK(ScanSpec::create(version, "id,uv,pv,city", false, spec));
+        int32_t threshold = 5000;
+        unique_ptr<Expr> filter = Expr::binary(ExprGT, Expr::column("pv"),
+                                               Expr::literal(Variant(Int32, &threshold)));
+        spec->set_filter(filter);
+        unique_ptr<Expr> sum = Expr::binary(ExprAdd, Expr::column("uv"), Expr::column("pv"));
+        spec->add_expr(sum);
+        unique_ptr<MemTabletScan> scan;
+        CHECK(tablet->scan(spec, scan));
+        const RowBlock* rb = nullptr;
+        double t0 = Time();
+        while (true) {
+            CHECK(scan->next_scan_block(rb));
+            if (!rb) {
+                break;
+            }
+        }
+        return Time() - t0;
+    });
+    Report("macro_filter_scan", {{"rows", std::to_string(nrows)}}, nrows, tscan);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+struct BenchEntry {
+    const char* name;
+    void (*func)(const BenchOptions& opt);
+};
+
+static const BenchEntry kBenches[] = {
+    {"hash_index", BenchHashIndex},
+    {"hash_index_huge_page", BenchHashIndexHugePage},
+    {"delta_find_idx", BenchDeltaFind},
+    {"string_pool_add", BenchStringPool},
+    {"commit", BenchCommit},
+    {"scan_get_block", BenchScanDeltas},
+    {"multi_get", BenchMultiGet},
+    {"macro", BenchMacroIngest},
+};
+
+static string JsonEscape(const string& s) {
+    string ret;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+        }
+        ret += c;
+    }
+    return ret;
+}
+
+static string ToJson(const BenchOptions& opt) {
+    string ret = "{\n";
+    ret += Format("  \"context\": {\"simd\": \"%s\", \"scale\": %g, \"repeat\": %d, \"time\": %.0lf},\n",
+                  SimdLevelName(Simd().level), opt.scale, opt.repeat, Time());
+    ret += "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < g_results.size(); i++) {
+        auto& r = g_results[i];
+        ret += Format("    {\"name\": \"%s\", \"params\": {", JsonEscape(r.name).c_str());
+        for (size_t j = 0; j < r.params.size(); j++) {
+            ret += Format("%s\"%s\": \"%s\"", j > 0 ? ", " : "", JsonEscape(r.params[j].first).c_str(),
+                          JsonEscape(r.params[j].second).c_str());
+        }
+        ret += Format("}, \"items\": %zu, \"seconds\": %.6lf, \"items_per_second\": %.1lf",
+                      r.items, r.seconds, r.seconds > 0 ? r.items / r.seconds : 0.0);
+        for (auto& c : r.counters) {
+            ret += Format(", \"%s\": %g", JsonEscape(c.first).c_str(), c.second);
+        }
+        ret += i + 1 < g_results.size() ? "},\n" : "}\n";
+    }
+    ret += "  ]\n}\n";
+    return ret;
+}
+
+static bool ParseArgs(int argc, char** argv, BenchOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--filter") {
+            opt.filter = value;
+        } else if (key == "--json") {
+            opt.json = value;
+        } else if (key == "--scale") {
+            opt.scale = atof(value.c_str());
+        } else if (key == "--repeat") {
+            opt.repeat = std::max(1, atoi(value.c_str()));
+        } else {
+            fprintf(stderr, "usage: %s [--filter=substr] [--json=path] [--scale=n] [--repeat=n]\n", argv[0]);
+            return false;
+        }
+    }
+    return opt.scale > 0;
+}
+
+} /* namespace choco */
+
+int main(int argc, char** argv) {
+    using namespace choco;
+    google::InitGoogleLogging(argv[0]);
+    google::LogToStderr();
+    BenchOptions opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        return 1;
+    }
+    srand(1);
+    for (auto& b : kBenches) {
+        if (opt.filter.empty() || string(b.name).find(opt.filter) != string::npos) {
+            b.func(opt);
+        }
+    }
+    string json = ToJson(opt);
+    if (opt.json.empty()) {
+        fputs(json.c_str(), stdout);
+    } else {
+        FILE* fp = fopen(opt.json.c_str(), "w");
+        if (!fp) {
+            LOG(ERROR) << "failed to open " << opt.json;
+            return 1;
+        }
+        fputs(json.c_str(), fp);
+        fclose(fp);
+    }
+    return 0;
+}
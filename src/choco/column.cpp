@@ -1,7 +1,7 @@
 #include <type_traits>
-#include <map>
 #include "column.h"
 #include "row_block.h"
+#include "encoding.h"
 
 namespace choco {
 
@@ -13,31 +13,102 @@ Status ColumnPage::alloc(size_t size, size_t esize, BufferTag tag) {
     if (_data || _nulls) {
         LOG(FATAL) << "reinit column page";
     }
-    Status ret = _data.alloc(size * esize, tag.data());
+    Status ret = _data.alloc(size * esize, tag.data(), true);
     if (!ret) {
         return ret;
     }
-    _data.set_zero();
     _tag = tag;
     _size = size;
+    _esize = esize;
+    return Status::OK();
+}
+
+Status ColumnPage::widen(size_t new_esize, RefPtr<ColumnPage>& ret) const {
+    DCHECK_GT(new_esize, _esize);
+    DCHECK(!_packed);
+    RefPtr<ColumnPage> page = RefPtr<ColumnPage>::create();
+    RETURN_NOT_OK(page->alloc(_size, new_esize, _tag));
+    ConvertIntWidth(page->_data.data(), new_esize, _data.data(), _esize, _size);
+    if (_nulls) {
+        RETURN_NOT_OK(page->_nulls.alloc(_nulls.bsize(), _tag.null()));
+        memcpy(page->_nulls.data(), _nulls.data(), _nulls.bsize());
+    }
+    ret.swap(page);
+    return Status::OK();
+}
+
+Status ColumnPage::pack(RefPtr<ColumnPage>& ret) const {
+    DCHECK(!_packed);
+    ForEncoding encoding;
+    encoding.analyze(_data.data(), _esize, _size);
+    size_t packed_size = encoding.packed_size(_size);
+    // not worth it if less than 1/4 memory is saved
+    if (packed_size * 4 > _data.bsize() * 3) {
+        return Status::OK();
+    }
+    RefPtr<ColumnPage> page = RefPtr<ColumnPage>::create();
+    RETURN_NOT_OK(page->_data.alloc(packed_size, _tag.data(), true));
+    encoding.encode(_data.data(), _esize, _size, page->_data.data());
+    if (_nulls) {
+        RETURN_NOT_OK(page->_nulls.alloc(_nulls.bsize(), _tag.null()));
+        memcpy(page->_nulls.data(), _nulls.data(), _nulls.bsize());
+    }
+    page->_tag = _tag;
+    page->_size = _size;
+    page->_esize = _esize;
+    page->_packed = true;
+    page->_encoding = encoding;
+    ret.swap(page);
+    return Status::OK();
+}
+
+Status ColumnPage::pack_float(RefPtr<ColumnPage>& ret) const {
+    DCHECK(!_packed);
+    AlpEncoding alp;
+    bool ok;
+    if (_esize == sizeof(float)) {
+        ok = alp.analyze((const float*)_data.data(), _size);
+    } else {
+        ok = alp.analyze((const double*)_data.data(), _size);
+    }
+    // not worth it if less than 1/4 memory is saved
+    if (!ok || alp.packed_size * 4 > _data.bsize() * 3) {
+        return Status::OK();
+    }
+    RefPtr<ColumnPage> page = RefPtr<ColumnPage>::create();
+    RETURN_NOT_OK(page->_data.alloc(alp.packed_size, _tag.data(), true));
+    if (_esize == sizeof(float)) {
+        alp.encode((const float*)_data.data(), _size, page->_data.data());
+    } else {
+        alp.encode((const double*)_data.data(), _size, page->_data.data());
+    }
+    if (_nulls) {
+        RETURN_NOT_OK(page->_nulls.alloc(_nulls.bsize(), _tag.null()));
+        memcpy(page->_nulls.data(), _nulls.data(), _nulls.bsize());
+    }
+    page->_tag = _tag;
+    page->_size = _size;
+    page->_esize = _esize;
+    page->_packed = true;
+    page->_alp = alp;
+    ret.swap(page);
     return Status::OK();
 }
 
 Status ColumnPage::set_null(uint32_t idx) {
     if (!_nulls) {
-        Status ret = _nulls.alloc(_size, _tag.null());
+        Status ret = _nulls.alloc(BitmapSize64(_size), _tag.null(), true);
         if (!ret) {
             return ret;
         }
-        _nulls.set_zero();
     }
-    _nulls.as<bool>()[idx] = true;
+    BitmapSet(_nulls.data(), idx);
     return Status::OK();
 }
 
 Status ColumnPage::set_not_null(uint32_t idx) {
     if (_nulls) {
-        _nulls.as<bool>()[idx] = false;
+        BitmapClear(_nulls.data(), idx);
     }
     return Status::OK();
 }
@@ -45,6 +116,102 @@ Status ColumnPage::set_not_null(uint32_t idx) {
 //////////////////////////////////////////////////////////////////////////////
 
 
+// how base values of ST are stored in pages
+struct PlainPage {};
+// adaptive width, may be FOR packed
+struct IntPage {};
+// may be ALP packed
+struct FloatPage {};
+
+template <class ST>
+struct PageKind {
+    typedef typename std::conditional<AdaptiveStorage<ST>::value, IntPage,
+            typename std::conditional<std::is_floating_point<ST>::value, FloatPage, PlainPage>::type>::type type;
+};
+
+template <class ST>
+inline const ST* PageValue(ColumnPage& page, uint32_t idx, ST& buff, IntPage) {
+    if (page.packed()) {
+        buff = (ST)page.encoding().get(page.data().data(), idx);
+        return &buff;
+    } else if (page.esize() != sizeof(ST)) {
+        buff = (ST)ReadIntN(page.data().data(), page.esize(), idx);
+        return &buff;
+    }
+    return &(page.data().as<ST>()[idx]);
+}
+
+template <class ST>
+inline const ST* PageValue(ColumnPage& page, uint32_t idx, ST& buff, FloatPage) {
+    if (page.packed()) {
+        buff = page.alp().get<ST>(page.data().data(), idx);
+        return &buff;
+    }
+    return &(page.data().as<ST>()[idx]);
+}
+
+template <class ST>
+inline const ST* PageValue(ColumnPage& page, uint32_t idx, ST& buff, PlainPage) {
+    return &(page.data().as<ST>()[idx]);
+}
+
+/**
+ * get pointer to the base value at idx of page, if page uses narrower
+ * adaptive storage or is packed, value is decoded into buff
+ */
+template <class ST>
+inline const ST* PageValue(ColumnPage& page, uint32_t idx, ST& buff) {
+    return PageValue(page, idx, buff, typename PageKind<ST>::type());
+}
+
+template <class ST>
+inline Status DecodePage(ColumnPage& page, size_t nrows, ColumnBlock& cb, IntPage) {
+    return cb.decode_from(nrows, sizeof(ST), page.encoding(), page.data(), page.nulls());
+}
+
+template <class ST>
+inline Status DecodePage(ColumnPage& page, size_t nrows, ColumnBlock& cb, FloatPage) {
+    return cb.decode_from(nrows, sizeof(ST), page.alp(), page.data(), page.nulls());
+}
+
+template <class ST>
+inline Status DecodePage(ColumnPage& page, size_t nrows, ColumnBlock& cb, PlainPage) {
+    return Status::NotSupported("page type can't be packed");
+}
+
+/**
+ * filter integer page values by range, on packed values for FOR packed
+ * pages, or on stored width for narrow pages
+ */
+template <class ST>
+inline Status FilterPage(ColumnPage& page, size_t nrows, int64_t lo, int64_t hi, uint8_t* selection) {
+    if (!std::is_integral<ST>::value || sizeof(ST) > sizeof(int64_t)) {
+        return Status::NotSupported("filter_range only supports integer pages");
+    }
+    if (page.packed()) {
+        page.encoding().filter_range(page.data().data(), nrows, lo, hi, selection);
+    } else {
+        FilterIntRange(page.data().data(), page.esize(), nrows, lo, hi, selection);
+    }
+    return Status::OK();
+}
+
+template <class ST>
+inline Status AggregatePage(ColumnPage& page, size_t nrows, const uint8_t* nulls, const uint8_t* selection,
+                            FloatAggregate& agg, FloatPage) {
+    if (!page.packed()) {
+        return Status::NotSupported("aggregate_block on unpacked page");
+    }
+    page.alp().aggregate<ST>(page.data().data(), nrows, nulls, selection, agg);
+    return Status::OK();
+}
+
+template <class ST, class Kind>
+inline Status AggregatePage(ColumnPage& page, size_t nrows, const uint8_t* nulls, const uint8_t* selection,
+                            FloatAggregate& agg, Kind) {
+    return Status::NotSupported("aggregate_block only supports float pages");
+}
+
 // works for int8/int16/int32/int64/float/double
 // TODO: add string support
 template <class T, bool Nullable=false, class ST=T>
@@ -66,7 +233,7 @@ public:
             uint32_t pos = pdelta->find_idx(rid);
             if (pos != DeltaIndex::npos) {
                 if (Nullable) {
-                    bool isnull = pdelta->nulls() && pdelta->nulls().as<bool>()[pos];
+                    bool isnull = pdelta->is_null(pos);
                     if (isnull) {
                         return nullptr;
                     } else {
@@ -80,31 +247,27 @@ public:
         uint32_t bid = rid >> 16;
         DCHECK(bid < _base->size());
         uint32_t idx = rid & 0xffff;
-        DCHECK(idx * sizeof(ST) < (*_base)[bid]->data().bsize());
+        DCHECK_LT(idx, (*_base)[bid]->size());
         if (Nullable) {
             bool isnull = (*_base)[bid]->is_null(idx);
             if (isnull) {
                 return nullptr;
             } else {
-                return &((*_base)[bid]->data().as<ST>()[idx]);
+                return PageValue(*(*_base)[bid], idx, _value_buff);
             }
         } else {
-            return &((*_base)[bid]->data().as<ST>()[idx]);
+            return PageValue(*(*_base)[bid], idx, _value_buff);
         }
     }
 
     virtual Status get_block(size_t nrows, size_t block, ColumnBlock& cb) const {
-        bool base_only = true;
-        for (size_t i = 0; i < _deltas.size(); ++i) {
-            if (_deltas[i]->contains_block(block)) {
-                base_only = false;
-                break;
-            }
-        }
+        bool base_only = this->base_only(block);
         auto& page = (*_base)[block];
-        if (base_only) {
+        bool narrow = AdaptiveStorage<ST>::value && page->esize() != sizeof(ST);
+        if (base_only && !narrow && !page->packed()) {
             cb.clear();
             cb._data = page->data().data();
+            cb._page = page;
             if (Nullable) {
                 cb._nulls = page->nulls().data();
             } else {
@@ -113,7 +276,13 @@ public:
             return Status::OK();
         }
         // copy buffer
-        RETURN_NOT_OK(cb.copy_from(nrows, sizeof(ST), page->data(), page->nulls()));
+        if (page->packed()) {
+            RETURN_NOT_OK(DecodePage<ST>(*page, nrows, cb, typename PageKind<ST>::type()));
+        } else if (narrow) {
+            RETURN_NOT_OK(cb.widen_from(nrows, sizeof(ST), page->esize(), page->data(), page->nulls()));
+        } else {
+            RETURN_NOT_OK(cb.copy_from(nrows, sizeof(ST), page->data(), page->nulls()));
+        }
         for (auto delta : _deltas) {
             uint32_t start, end;
             delta->index()->block_range(block, start, end);
@@ -125,21 +294,19 @@ public:
             const ST * data = delta->data().as<ST>();
             if (Nullable) {
                 if (delta->nulls()) {
-                    const bool * nulls = delta->nulls().as<bool>();
+                    const uint8_t * nulls = delta->nulls().data();
                     for (uint32_t i = start; i < end; i++) {
                         uint16_t pos = poses[i];
-                        bool isnull = nulls[i];
-                        if (isnull) {
-                            ((bool*)cb._nulls)[pos] = true;
-                        } else {
-                            ((bool*)cb._nulls)[pos] = false;
+                        bool isnull = BitmapTest(nulls, i);
+                        BitmapChange(cb._nulls, pos, isnull);
+                        if (!isnull) {
                             ((ST*)cb._data)[pos] = data[i];
                         }
                     }
                 } else {
                     for (uint32_t i = start; i < end; i++) {
                         uint16_t pos = poses[i];
-                        ((bool*)cb._nulls)[pos] = false;
+                        BitmapClear(cb._nulls, pos);
                         ((ST*)cb._data)[pos] = data[i];
                     }
                 }
@@ -152,16 +319,51 @@ public:
         return Status::OK();
     }
 
+    virtual Status filter_range(size_t nrows, size_t block, int64_t lo, int64_t hi,
+                                uint8_t* selection) const {
+        if (!base_only(block)) {
+            return Status::NotSupported("filter_range on block with deltas");
+        }
+        ColumnPage& page = *(*_base)[block];
+        RETURN_NOT_OK(FilterPage<ST>(page, nrows, lo, hi, selection));
+        if (Nullable && page.nulls()) {
+            BitmapMergeAndNot(selection, page.nulls().data(), nrows);
+        }
+        return Status::OK();
+    }
+
+    virtual Status aggregate_block(size_t nrows, size_t block, const uint8_t* selection,
+                                   FloatAggregate& agg) const {
+        if (!base_only(block)) {
+            return Status::NotSupported("aggregate_block on block with deltas");
+        }
+        ColumnPage& page = *(*_base)[block];
+        const uint8_t* nulls = Nullable && page.nulls() ? page.nulls().data() : nullptr;
+        return AggregatePage<ST>(page, nrows, nulls, selection, agg, typename PageKind<ST>::type());
+    }
+
+    virtual size_t delta_entries(size_t block) const {
+        size_t ret = 0;
+        for (auto delta : _deltas) {
+            if (delta->contains_block(block)) {
+                uint32_t start, end;
+                delta->index()->block_range(block, start, end);
+                ret += end - start;
+            }
+        }
+        return ret;
+    }
+
     virtual Status get_by_rids(const vector<uint32_t>& rid, ColumnBlock& cb) const {
         RETURN_NOT_OK(cb.alloc(rid.size(), sizeof(T)));
-        memset(cb._nulls, 0, sizeof(T)*rid.size());
+        memset(cb._nulls, 0, BitmapSize64(rid.size()));
         for (size_t i=0;i<rid.size();i++) {
             const T * v = (const T*)get(rid[i]);
             if (Nullable) {
                 if (v) {
                     ((T*)cb.data())[i] = *v;
                 } else {
-                    ((bool*)cb._nulls)[i] = true;
+                    BitmapSet(cb._nulls, i);
                 }
             } else {
                 ((T*)cb.data())[i] = *v;
@@ -197,13 +399,14 @@ public:
         uint32_t bid = rid >> 16;
         DCHECK(bid < _base->size());
         uint32_t idx = rid & 0xffff;
-        DCHECK(idx * sizeof(ST) < (*_base)[bid]->data().bsize());
+        DCHECK_LT(idx, (*_base)[bid]->size());
         if (Nullable) {
             CHECK(false) << "only used for key column";
             return false;
         } else {
             DCHECK_NOTNULL(rhs);
-            return ((*_base)[bid]->data().as<T>()[idx]) == rhs_value;
+            T buff;
+            return *PageValue(*(*_base)[bid], idx, buff) == rhs_value;
         }
     }
 
@@ -216,11 +419,23 @@ public:
     }
 
 private:
+    // no delta of this reader has rows in block
+    bool base_only(size_t block) const {
+        for (size_t i = 0; i < _deltas.size(); ++i) {
+            if (_deltas[i]->contains_block(block)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     RefPtr<Column> _column;
     uint64_t _version;
     uint64_t _real_version;
     vector<RefPtr<ColumnPage>>* _base;
     vector<ColumnDelta*> _deltas;
+    // holds value returned by get when stored narrower than ST
+    mutable ST _value_buff;
 };
 
 
@@ -247,14 +462,83 @@ private:
 };
 
 
+/**
+ * Stable LSD radix sort of rids, 16 bits per pass.
+ * Output is the permutation of indexes into rids, equal rids keep their
+ * original (append) order, so the last entry of a run is the latest write.
+ */
+static void RadixSortRids(const vector<uint32_t>& rids, vector<uint32_t>& order) {
+    size_t n = rids.size();
+    order.resize(n);
+    if (n < 256) {
+        for (size_t i=0;i<n;i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&rids](uint32_t a, uint32_t b) {
+            return rids[a] < rids[b];
+        });
+        return;
+    }
+    // pack (rid, idx) so each pass scans memory sequentially
+    vector<uint64_t> keys(n);
+    vector<uint64_t> tmp(n);
+    uint32_t rid_bits = 0;
+    for (size_t i=0;i<n;i++) {
+        keys[i] = (((uint64_t)rids[i]) << 32) | i;
+        rid_bits |= rids[i];
+    }
+    vector<uint32_t> counts(1<<16);
+    for (uint32_t shift = 32; shift < 64; shift += 16) {
+        if (((rid_bits >> (shift - 32)) & 0xffff) == 0) {
+            // all digits are 0, order unchanged
+            continue;
+        }
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t i=0;i<n;i++) {
+            counts[(keys[i] >> shift) & 0xffff]++;
+        }
+        uint32_t sum = 0;
+        for (size_t d=0;d<counts.size();d++) {
+            uint32_t c = counts[d];
+            counts[d] = sum;
+            sum += c;
+        }
+        for (size_t i=0;i<n;i++) {
+            tmp[counts[(keys[i] >> shift) & 0xffff]++] = keys[i];
+        }
+        keys.swap(tmp);
+    }
+    for (size_t i=0;i<n;i++) {
+        order[i] = (uint32_t)keys[i];
+    }
+}
+
+
 template <class T, bool Nullable=false, class ST=T, class UT=T>
 class TypedColumnWriter : public ColumnWriter {
 public:
     TypedColumnWriter(RefPtr<Column>& column) :
         _column(std::move(column)),
         _base(&_column->_base),
+        _num_visible_page(_base->size()),
+        _page_esize(sizeof(ST)),
+        _pack_pages(false),
+        _aggregation(_column->schema().aggregation),
         _update_has_null(false) {
         _column->capture_latest(_deltas);
+        _origin = _column;
+        _origin_num_page = _base->size();
+        _origin_num_version = _column->_versions.size();
+        size_t storage_esize = TypeInfo::get(_column->_storage_type).size();
+        if (AdaptiveStorage<ST>::value && storage_esize < sizeof(ST)) {
+            // adaptive storage, new pages start with the narrowest width,
+            // full pages get bit-packed
+            _page_esize = storage_esize;
+            _pack_pages = true;
+        } else if (std::is_floating_point<ST>::value && !_column->schema().plain) {
+            // full float pages get ALP encoded
+            _pack_pages = true;
+        }
     }
 
     virtual ~TypedColumnWriter() {}
@@ -268,12 +552,12 @@ public:
         }
         auto& page = (*_base)[bid];
         uint32_t idx = rid & 0xffff;
-        DCHECK(idx * sizeof(T) < page->data().bsize());
+        DCHECK_LT(idx, page->size());
         if (Nullable) {
             if (value) {
                 if (std::is_same<T, ST>::value) {
                     page->set_not_null(idx);
-                    page->data().as<ST>()[idx] = *static_cast<const ST*>(value);
+                    RETURN_NOT_OK(set_base(bid, idx, *static_cast<const ST*>(value)));
                 } else {
                     // TODO: string support
                 }
@@ -286,7 +570,7 @@ public:
             }
             DCHECK_NOTNULL(value);
             if (std::is_same<T, ST>::value) {
-                page->data().as<ST>()[idx] = *static_cast<const ST*>(value);
+                RETURN_NOT_OK(set_base(bid, idx, *static_cast<const ST*>(value)));
             } else {
                 // TODO: string support
             }
@@ -295,10 +579,45 @@ public:
         return Status::OK();
     }
 
+    virtual Status insert_batch(uint32_t rid, size_t n, const void * values,
+                                const uint8_t * nulls, size_t nulls_offset) {
+        if (!std::is_same<T, ST>::value) {
+            // string values are Slices, stored as codes
+            return Status::NotSupported("insert_batch of string column not supported");
+        }
+        const ST* data = (const ST*)values;
+        size_t i = 0;
+        while (i < n) {
+            uint32_t bid = (rid + i) >> 16;
+            if (bid >= _base->size()) {
+                RETURN_NOT_OK(add_page());
+                // add one page should be enough
+                CHECK(bid < _base->size());
+            }
+            uint32_t idx = (rid + i) & 0xffff;
+            size_t cnt = std::min(n - i, (size_t)Column::BLOCK_SIZE - idx);
+            RETURN_NOT_OK(set_base_range(bid, idx, cnt, data + i));
+            size_t first_null;
+            if (nulls && BitmapFindFirstSet(nulls, nulls_offset + i, nulls_offset + i + cnt, &first_null)) {
+                RETURN_NOT_OK(set_base_nulls(bid, idx, cnt, nulls, nulls_offset + i, first_null));
+            }
+            i += cnt;
+        }
+        _num_insert += n;
+        return Status::OK();
+    }
+
     virtual Status update(uint32_t rid, const void * value) {
         DCHECK_LT(rid, _base->size() * Column::BLOCK_SIZE);
+        if (!value && _aggregation != AggReplace) {
+            // null doesn't change value
+            _num_update++;
+            return Status::OK();
+        }
+        _update_rids.push_back(rid);
+        _update_values.emplace_back();
+        auto& uv = _update_values.back();
         if (Nullable) {
-            auto& uv = _updates[rid];
             if (value) {
                 uv.isnull() = false;
                 if (std::is_same<T, ST>::value) {
@@ -316,7 +635,6 @@ public:
                 }
             }
         } else {
-            auto& uv = _updates[rid];
             if (!value) {
                 value = _column->schema().default_value_ptr();
             }
@@ -332,50 +650,66 @@ public:
     }
 
     virtual Status finalize(uint64_t version) {
-        if (_updates.size() == 0) {
+        if (_update_rids.size() == 0) {
             // insert(append) only
             return Status::OK();
         }
+        // resolve update log: sort by rid, last write of each rid wins,
+        // or all writes of a rid are folded into the last for sum/max/min
+        vector<uint32_t> order;
+        RadixSortRids(_update_rids, order);
+        bool fold = _aggregation >= AggSum;
+        size_t nupdate = 0;
+        size_t run_start = 0;
+        for (size_t i=0;i<order.size();i++) {
+            if (i+1 == order.size() || _update_rids[order[i]] != _update_rids[order[i+1]]) {
+                if (fold) {
+                    fold_updates(order, run_start, i);
+                }
+                order[nupdate++] = order[i];
+                run_start = i + 1;
+            }
+        }
+        order.resize(nupdate);
         // prepare delta
         size_t nblock = _base->size();
         RefPtr<ColumnDelta> delta = RefPtr<ColumnDelta>::create();
         RETURN_NOT_OK(delta->alloc(
                 nblock,
-                _updates.size(),
+                nupdate,
                 sizeof(ST),
-                BufferTag::delta(_column->schema().cid), _update_has_null));
+                BufferTag::delta(_column->schema().cid, _column->mem_tracker()), _update_has_null));
         DeltaIndex* index = delta->index();
         vector<uint32_t>& block_ends = index->_block_ends;
-        Buffer& idxdata = index->_data;
-        Buffer& data = delta->data();
-        Buffer& nulls = delta->nulls();
-        uint32_t cidx = 0;
+        uint16_t* poses = index->_data.as<uint16_t>();
+        ST* data = delta->data().as<ST>();
+        uint8_t* nulls = delta->nulls().data();
         uint32_t curbid = 0;
-        for (auto& e : _updates) {
-            uint32_t rid = e.first;
+        for (uint32_t cidx = 0; cidx < nupdate; cidx++) {
+            uint32_t rid = _update_rids[order[cidx]];
+            auto& uv = _update_values[order[cidx]];
             uint32_t bid = rid >> 16;
             while (curbid < bid) {
                 block_ends[curbid] = cidx;
                 curbid++;
             }
-            idxdata.as<uint16_t>()[cidx] = rid & 0xffff;
+            poses[cidx] = rid & 0xffff;
             if (Nullable) {
-                bool isnull = e.second.isnull();
-                if (isnull) {
-                    nulls.as<bool>()[cidx] = true;
+                if (uv.isnull()) {
+                    BitmapSet(nulls, cidx);
                 } else {
-                    data.as<ST>()[cidx] = e.second.value();
+                    data[cidx] = uv.value();
                 }
             } else {
-                data.as<ST>()[cidx] = e.second.value();
+                data[cidx] = uv.value();
             }
-            cidx++;
         }
         while (curbid < nblock) {
-            block_ends[curbid] = cidx;
+            block_ends[curbid] = nupdate;
             curbid++;
         }
-        _updates.clear();
+        _update_rids.clear();
+        _update_values.clear();
         RETURN_NOT_OK(add_delta(delta, version));
         return Status::OK();
     }
@@ -389,13 +723,31 @@ public:
         return Status::OK();
     }
 
+    virtual void abort(size_t num_rows) {
+        // copies made by COW are dropped with this writer, only the
+        // column being written needs rollback, readers capture under the
+        // same lock, and never see pages or versions of this write
+        Column& column = *_origin;
+        std::lock_guard<mutex> lg(column._lock);
+        column._versions.resize(_origin_num_version);
+        column._base.resize(std::min(column._base.size(), _origin_num_page));
+        uint32_t bid = num_rows >> 16;
+        uint32_t idx = num_rows & 0xffff;
+        if (Nullable && idx > 0 && bid < column._base.size()) {
+            ColumnPage& page = *column._base[bid];
+            if (page.nulls()) {
+                BitmapChangeBits(page.nulls().data(), idx, page.size() - idx, false);
+            }
+        }
+    }
+
     virtual const void * get(const uint32_t rid) const {
         for (ssize_t i=_deltas.size()-1;i>=0;i--) {
             ColumnDelta* pdelta = _deltas[i];
             uint32_t pos = pdelta->find_idx(rid);
             if (pos != DeltaIndex::npos) {
                 if (Nullable) {
-                    bool isnull = pdelta->nulls() && pdelta->nulls().as<bool>()[pos];
+                    bool isnull = pdelta->is_null(pos);
                     if (isnull) {
                         return nullptr;
                     } else {
@@ -409,16 +761,16 @@ public:
         uint32_t bid = rid >> 16;
         DCHECK(bid < _base->size());
         uint32_t idx = rid & 0xffff;
-        DCHECK(idx * sizeof(ST) < (*_base)[bid]->data().bsize());
+        DCHECK_LT(idx, (*_base)[bid]->size());
         if (Nullable) {
             bool isnull = (*_base)[bid]->is_null(idx);
             if (isnull) {
                 return nullptr;
             } else {
-                return &((*_base)[bid]->data().as<ST>()[idx]);
+                return PageValue(*(*_base)[bid], idx, _value_buff);
             }
         } else {
-            return &((*_base)[bid]->data().as<ST>()[idx]);
+            return PageValue(*(*_base)[bid], idx, _value_buff);
         }
     }
 
@@ -438,7 +790,7 @@ public:
             uint32_t pos = pdelta->find_idx(rid);
             if (pos != DeltaIndex::npos) {
                 if (Nullable) {
-                    bool isnull = pdelta->nulls() && pdelta->nulls().as<bool>()[pos];
+                    bool isnull = pdelta->is_null(pos);
                     if (isnull) {
                         return rhs == nullptr;
                     } else {
@@ -452,17 +804,18 @@ public:
         uint32_t bid = rid >> 16;
         DCHECK(bid < _base->size());
         uint32_t idx = rid & 0xffff;
-        DCHECK(idx * sizeof(ST) < (*_base)[bid]->data().bsize());
+        DCHECK_LT(idx, (*_base)[bid]->size());
+        T buff;
         if (Nullable) {
             bool isnull = (*_base)[bid]->is_null(idx);
             if (isnull) {
                 return rhs == nullptr;
             } else {
-                return ((*_base)[bid]->data().as<T>()[idx]) == *(const T*)rhs;
+                return *PageValue(*(*_base)[bid], idx, buff) == *(const T*)rhs;
             }
         } else {
             DCHECK_NOTNULL(rhs);
-            return ((*_base)[bid]->data().as<T>()[idx]) == *(const T*)rhs;
+            return *PageValue(*(*_base)[bid], idx, buff) == *(const T*)rhs;
         }
     }
 
@@ -474,6 +827,139 @@ public:
     }
 
 private:
+    // set cnt values of page bid starting at idx
+    Status set_base_range(uint32_t bid, uint32_t idx, size_t cnt, const ST* values) {
+        return set_base_range(bid, idx, cnt, values, std::integral_constant<bool, AdaptiveStorage<ST>::value>());
+    }
+
+    Status set_base_range(uint32_t bid, uint32_t idx, size_t cnt, const ST* values, std::false_type) {
+        DCHECK(!(*_base)[bid]->packed());
+        memcpy((*_base)[bid]->data().template as<ST>() + idx, values, cnt * sizeof(ST));
+        return Status::OK();
+    }
+
+    Status set_base_range(uint32_t bid, uint32_t idx, size_t cnt, const ST* values, std::true_type) {
+        ColumnPage* page = (*_base)[bid].get();
+        DCHECK(!page->packed());
+        size_t need = page->esize();
+        for (size_t i = 0; i < cnt && need < sizeof(ST); i++) {
+            need = std::max(need, IntStorageSize(values[i]));
+        }
+        if (need > page->esize()) {
+            RETURN_NOT_OK(widen_page(bid, need));
+            page = (*_base)[bid].get();
+        }
+        ConvertIntWidth(page->data().data() + idx * page->esize(), page->esize(), values, sizeof(ST), cnt);
+        return Status::OK();
+    }
+
+    // apply null rows [offset, offset+cnt) of nulls to page bid starting
+    // at idx, first_null is the first null row
+    Status set_base_nulls(uint32_t bid, uint32_t idx, size_t cnt, const uint8_t* nulls, size_t offset,
+                          size_t first_null) {
+        auto& page = (*_base)[bid];
+        if (Nullable) {
+            // allocates null bitmap
+            RETURN_NOT_OK(page->set_null(idx + (first_null - offset)));
+            BitmapCopy(page->nulls().data(), idx, nulls, offset, cnt);
+            return Status::OK();
+        }
+        const void* dv = _column->schema().default_value_ptr();
+        if (!dv) {
+            return Status::InvalidArgument("null value for not null column without default value");
+        }
+        for (size_t i = first_null - offset; i < cnt; i++) {
+            if (BitmapTest(nulls, offset + i)) {
+                RETURN_NOT_OK(set_base(bid, idx + i, *static_cast<const ST*>(dv)));
+            }
+        }
+        return Status::OK();
+    }
+
+private:
+    // fold updates order[start, last] of a rid, in write order, with its
+    // value before this write into update order[last]
+    void fold_updates(const vector<uint32_t>& order, size_t start, size_t last) {
+        const ST* cur = (const ST*)get(_update_rids[order[last]]);
+        size_t i = start;
+        UT acc = cur ? (UT)*cur : _update_values[order[i++]].value();
+        for (; i <= last; i++) {
+            acc = AggregateValue<UT>(_aggregation, acc, _update_values[order[i]].value());
+        }
+        _update_values[order[last]].value() = acc;
+    }
+
+private:
+    Status set_base(uint32_t bid, uint32_t idx, const ST& v) {
+        return set_base(bid, idx, v, std::integral_constant<bool, AdaptiveStorage<ST>::value>());
+    }
+
+    Status set_base(uint32_t bid, uint32_t idx, const ST& v, std::false_type) {
+        DCHECK(!(*_base)[bid]->packed());
+        (*_base)[bid]->data().as<ST>()[idx] = v;
+        return Status::OK();
+    }
+
+    Status set_base(uint32_t bid, uint32_t idx, const ST& v, std::true_type) {
+        ColumnPage* page = (*_base)[bid].get();
+        DCHECK(!page->packed());
+        if (page->esize() == sizeof(ST)) {
+            page->data().as<ST>()[idx] = v;
+            return Status::OK();
+        }
+        size_t need = IntStorageSize(v);
+        if (need > page->esize()) {
+            RETURN_NOT_OK(widen_page(bid, need));
+            page = (*_base)[bid].get();
+        }
+        WriteIntN(page->data().data(), page->esize(), idx, v);
+        return Status::OK();
+    }
+
+    // rewrite a page with wider storage because a value overflows current width
+    Status widen_page(uint32_t bid, size_t new_esize) {
+        RefPtr<ColumnPage> page;
+        RETURN_NOT_OK((*_base)[bid]->widen(new_esize, page));
+        DLOG(INFO) << Format("%s widen page %u from %zu to %zu bytes",
+                             _column->schema().to_string().c_str(),
+                             bid,
+                             (*_base)[bid]->esize(),
+                             new_esize);
+        replace_page(bid, page);
+        return Status::OK();
+    }
+
+    // compress a full page which won't receive inserts anymore
+    Status pack_page(uint32_t bid) {
+        RefPtr<ColumnPage> page;
+        if (std::is_floating_point<ST>::value) {
+            RETURN_NOT_OK((*_base)[bid]->pack_float(page));
+        } else {
+            RETURN_NOT_OK((*_base)[bid]->pack(page));
+        }
+        if (!page) {
+            return Status::OK();
+        }
+        DLOG(INFO) << Format("%s pack page %u %zu -> %zu bytes",
+                             _column->schema().to_string().c_str(),
+                             bid,
+                             (*_base)[bid]->data().bsize(),
+                             page->data().bsize());
+        replace_page(bid, page);
+        return Status::OK();
+    }
+
+    void replace_page(uint32_t bid, RefPtr<ColumnPage>& page) {
+        if (bid < _num_visible_page) {
+            // readers may be reading this page, replace it in a copy of column
+            RefPtr<Column> cow(new Column(*_column, 0, 0), false);
+            cow.swap(_column);
+            _base = &(_column->_base);
+            _num_visible_page = 0;
+        }
+        (*_base)[bid].swap(page);
+    }
+
     Status expand_base() {
         size_t added = std::min((size_t)256, _base->capacity());
         size_t new_base_capacity = Padding(_base->capacity() + added, 8);
@@ -493,6 +979,8 @@ private:
         RefPtr<Column> cow(new Column(*_column, new_base_capacity, new_version_capacity), false);
         cow.swap(_column);
         _base = &(_column->_base);
+        // pages of the new copy are not visible to readers until committed
+        _num_visible_page = 0;
         return Status::OK();
     }
 
@@ -501,10 +989,15 @@ private:
             RETURN_NOT_OK(expand_base());
         }
         CHECK_LT(_base->size(), _base->capacity());
+        uint32_t bid = _base->size();
+        if (_pack_pages && bid > 0) {
+            // inserts are appended, previous page is full and frozen
+            RETURN_NOT_OK(pack_page(bid - 1));
+        }
         RefPtr<ColumnPage> page = RefPtr<ColumnPage>::create();
         uint32_t cid = _column->schema().cid;
-        uint32_t bid = _base->size();
-        RETURN_NOT_OK(page->alloc(Column::BLOCK_SIZE, sizeof(ST), BufferTag::base(cid, bid)));
+        RETURN_NOT_OK(page->alloc(Column::BLOCK_SIZE, _page_esize, BufferTag::base(cid, bid, _column->mem_tracker())));
+        std::lock_guard<mutex> lg(_column->_lock);
         _base->emplace_back(std::move(page));
         if (_column->schema().cid == 1) {
             // only log when first column add page
@@ -531,6 +1024,7 @@ private:
         }
         DLOG(INFO) << Format("%s add version %zu update: %zu", _column->to_string().c_str(), version, delta->size());
         CHECK_LT(_column->_versions.size(), _column->_versions.capacity());
+        std::lock_guard<mutex> lg(_column->_lock);
         _column->_versions.emplace_back();
         Column::VersionInfo& vinfo = _column->_versions.back();
         vinfo.version = version;
@@ -540,30 +1034,286 @@ private:
 
     RefPtr<Column> _column;
     vector<RefPtr<ColumnPage>>* _base;
+    // column when write began, and its sizes to roll back to on abort
+    RefPtr<Column> _origin;
+    size_t _origin_num_page = 0;
+    size_t _origin_num_version = 0;
+    // pages [0, _num_visible_page) may be read concurrently, need COW to replace
+    size_t _num_visible_page;
+    // storage byte width of new pages
+    size_t _page_esize;
+    bool _pack_pages;
+    AggregationType _aggregation;
     vector<ColumnDelta*> _deltas;
+    // holds value returned by get when stored narrower than ST
+    mutable ST _value_buff;
 
     size_t _num_insert = 0;
     size_t _num_update = 0;
     bool _update_has_null = false;
-    typedef typename std::conditional<Nullable, NullableUpdateType<UT>, UpdateType<UT>>::type UpdateMapType;
-    std::map<uint32_t, UpdateMapType> _updates;
+    typedef typename std::conditional<Nullable, NullableUpdateType<UT>, UpdateType<UT>>::type UpdateLogType;
+    // append only update log, resolved by finalize
+    vector<uint32_t> _update_rids;
+    vector<UpdateLogType> _update_values;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Reader of dictionary encoded column, int32 codes are read by a
+ * TypedColumnReader and decoded through the column's dictionary
+ */
+template <class T, bool Nullable>
+class DictColumnReader : public ColumnReader {
+public:
+    DictColumnReader(RefPtr<Column>& column, uint64_t version, uint64_t real_version, vector<ColumnDelta*>& deltas) :
+        _dict(column->_dict),
+        _codes(column, version, real_version, deltas) {
+    }
+
+    virtual ~DictColumnReader() {}
+
+    virtual const void * get(const uint32_t rid) const {
+        const int32_t* code = (const int32_t*)_codes.get(rid);
+        if (Nullable && !code) {
+            return nullptr;
+        }
+        return _dict->get(*code);
+    }
+
+    virtual Status get_block(size_t nrows, size_t block, ColumnBlock& cb) const {
+        RETURN_NOT_OK(_codes.get_block(nrows, block, _code_block));
+        RETURN_NOT_OK(cb.alloc(nrows, sizeof(T)));
+        const int32_t* codes = (const int32_t*)_code_block.data();
+        T* data = (T*)cb._data;
+        if (Nullable && _code_block.nulls()) {
+            memcpy(cb._nulls, _code_block.nulls(), BitmapSize64(nrows));
+            for (size_t i = 0; i < nrows; i++) {
+                if (!BitmapTest(cb._nulls, i)) {
+                    data[i] = *(const T*)_dict->get(codes[i]);
+                }
+            }
+        } else {
+            memset(cb._nulls, 0, BitmapSize64(nrows));
+            for (size_t i = 0; i < nrows; i++) {
+                data[i] = *(const T*)_dict->get(codes[i]);
+            }
+        }
+        return Status::OK();
+    }
+
+    virtual Status filter_range(size_t nrows, size_t block, int64_t lo, int64_t hi,
+                                uint8_t* selection) const {
+        if (!std::is_integral<T>::value || sizeof(T) > sizeof(int64_t)) {
+            return Status::NotSupported("filter_range only supports integer dictionaries");
+        }
+        // match each distinct value once, then filter rows by code
+        RETURN_NOT_OK(_codes.get_block(nrows, block, _code_block));
+        _dict->match<T>(_dict->size(), [=](T v) { return (int64_t)v >= lo && (int64_t)v <= hi; },
+                        _code_match);
+        // null rows store code 0, which may not be in an empty dictionary
+        _code_block.filter_not_null(selection, nrows);
+        const int32_t* codes = (const int32_t*)_code_block.data();
+        const uint8_t* match = _code_match.data();
+        for (size_t i = 0; i < nrows; i++) {
+            if (BitmapTest(selection, i) && !BitmapTest(match, codes[i])) {
+                BitmapClear(selection, i);
+            }
+        }
+        return Status::OK();
+    }
+
+    virtual size_t delta_entries(size_t block) const {
+        return _codes.delta_entries(block);
+    }
+
+    virtual Status get_by_rids(const vector<uint32_t>& rid, ColumnBlock& cb) const {
+        RETURN_NOT_OK(cb.alloc(rid.size(), sizeof(T)));
+        memset(cb._nulls, 0, BitmapSize64(rid.size()));
+        for (size_t i=0;i<rid.size();i++) {
+            const T * v = (const T*)get(rid[i]);
+            if (v) {
+                ((T*)cb._data)[i] = *v;
+            } else {
+                BitmapSet(cb._nulls, i);
+            }
+        }
+        return Status::OK();
+    }
+
+    virtual bool equals(const uint32_t rid, const void * rhs, size_t rhs_idx) const {
+        const void* v = get(rid);
+        return v && memcmp(v, &((const T*)rhs)[rhs_idx], sizeof(T)) == 0;
+    }
+
+    virtual uint64_t hashcode(const void * rhs, size_t rhs_idx) const {
+        return HashCode(((const T*)rhs)[rhs_idx]);
+    }
+
+    virtual const ColumnDict* dict() const {
+        return _dict.get();
+    }
+
+    virtual Status get_code_block(size_t nrows, size_t block, ColumnBlock& cb) const {
+        return _codes.get_block(nrows, block, cb);
+    }
+
+    virtual string to_string() const {
+        return Format("%s dict=%u", _codes.to_string().c_str(), _dict->size());
+    }
+
+private:
+    RefPtr<ColumnDict> _dict;
+    TypedColumnReader<int32_t, Nullable> _codes;
+    mutable ColumnBlock _code_block;
+    // filter_range result of each code
+    mutable vector<uint8_t> _code_match;
+};
+
+
+/**
+ * Writer of dictionary encoded column, values are added to the column's
+ * dictionary and their int32 codes written by a TypedColumnWriter
+ */
+template <class T, bool Nullable>
+class DictColumnWriter : public ColumnWriter {
+public:
+    DictColumnWriter(RefPtr<Column>& column) :
+        _dict(column->_dict),
+        _default_value(column->schema().default_value_ptr()),
+        _aggregation(column->schema().aggregation),
+        _codes(column) {
+    }
+
+    virtual ~DictColumnWriter() {}
+
+    virtual Status insert(uint32_t rid, const void * value) {
+        int32_t code;
+        RETURN_NOT_OK(encode(value, code));
+        return _codes.insert(rid, (Nullable && !value) ? nullptr : &code);
+    }
+
+    virtual Status insert_batch(uint32_t rid, size_t n, const void * values,
+                                const uint8_t * nulls, size_t nulls_offset) {
+        // codes are encoded one by one
+        for (size_t i = 0; i < n; i++) {
+            bool isnull = nulls && BitmapTest(nulls, nulls_offset + i);
+            RETURN_NOT_OK(insert(rid + i, isnull ? nullptr : (const T*)values + i));
+        }
+        return Status::OK();
+    }
+
+    virtual Status update(uint32_t rid, const void * value) {
+        if (!value && _aggregation != AggReplace) {
+            // ignored by codes writer, don't encode default value
+            return _codes.update(rid, nullptr);
+        }
+        int32_t code;
+        RETURN_NOT_OK(encode(value, code));
+        return _codes.update(rid, (Nullable && !value) ? nullptr : &code);
+    }
+
+    virtual Status finalize(uint64_t version) {
+        return _codes.finalize(version);
+    }
+
+    virtual Status get_new_column(RefPtr<Column>& ret) {
+        return _codes.get_new_column(ret);
+    }
+
+    virtual void abort(size_t num_rows) {
+        // values added to the shared dictionary are kept, they are just
+        // not referenced by any code
+        _codes.abort(num_rows);
+    }
+
+    virtual string to_string() const {
+        return Format("%s dict=%u", _codes.to_string().c_str(), _dict->size());
+    }
+
+    virtual const void * get(const uint32_t rid) const {
+        const int32_t* code = (const int32_t*)_codes.get(rid);
+        if (Nullable && !code) {
+            return nullptr;
+        }
+        return _dict->get(*code);
+    }
+
+    virtual bool equals(const uint32_t rid, const void * rhs) const {
+        const void* v = get(rid);
+        if (!v || !rhs) {
+            return v == rhs;
+        }
+        return memcmp(v, rhs, sizeof(T)) == 0;
+    }
+
+    virtual uint64_t hashcode(const void * data) const {
+        return HashCode(*(const T*)data);
+    }
+
+private:
+    Status encode(const void*& value, int32_t& code) {
+        code = 0;
+        if (!Nullable && !value) {
+            value = _default_value;
+        }
+        if (!value) {
+            DCHECK(Nullable);
+            return Status::OK();
+        }
+        uint32_t ucode;
+        RETURN_NOT_OK(_dict->add(value, ucode));
+        code = (int32_t)ucode;
+        return Status::OK();
+    }
+
+    RefPtr<ColumnDict> _dict;
+    const void* _default_value;
+    AggregationType _aggregation;
+    TypedColumnWriter<int32_t, Nullable> _codes;
 };
 
+template <class T>
+static ColumnReader* NewDictColumnReader(bool nullable, RefPtr<Column>& column, uint64_t version,
+        uint64_t real_version, vector<ColumnDelta*>& deltas) {
+    if (nullable) {
+        return new DictColumnReader<T, true>(column, version, real_version, deltas);
+    } else {
+        return new DictColumnReader<T, false>(column, version, real_version, deltas);
+    }
+}
+
+template <class T>
+static ColumnWriter* NewDictColumnWriter(bool nullable, RefPtr<Column>& column) {
+    if (nullable) {
+        return new DictColumnWriter<T, true>(column);
+    } else {
+        return new DictColumnWriter<T, false>(column);
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
-Column::Column(const ColumnSchema& cs, Type storage_type, uint64_t version) :
+Column::Column(const ColumnSchema& cs, Type storage_type, uint64_t version, MemTracker* parent_tracker) :
         _cs(cs),
         _storage_type(storage_type),
+        _mem_tracker(new MemTracker(Format("column %s(cid=%u)", cs.name.c_str(), cs.cid), parent_tracker), false),
         _base_idx(0) {
     _base.reserve(64);
     _versions.reserve(64);
     _versions.emplace_back(version);
+    if (cs.dict) {
+        _dict = RefPtr<ColumnDict>(new ColumnDict(TypeInfo::get(cs.type).size(),
+                                                  BufferTag::dict(cs.cid, _mem_tracker.get())), false);
+    }
     DLOG(INFO) << Format("create %s", to_string().c_str());
 }
 
 Column::Column(const Column& rhs, size_t new_base_capacity, size_t new_version_capacity) :
     _cs(rhs._cs),
     _storage_type(rhs._storage_type),
+    _mem_tracker(rhs._mem_tracker),
+    _dict(rhs._dict),
     _base_idx(rhs._base_idx) {
     _base.reserve(std::max(new_base_capacity, rhs._base.capacity()));
     _base.resize(rhs._base.size());
@@ -578,32 +1328,21 @@ Column::Column(const Column& rhs, size_t new_base_capacity, size_t new_version_c
 }
 
 size_t Column::memory() const {
-    size_t bs = _base.size();
-    size_t ds = _versions.size();
-    size_t base_memory = 0;
-    for (size_t i=0;i<bs;i++) {
-        base_memory += _base[i]->memory();
-    }
-    size_t delta_memory = 0;
-    for (size_t i=0;i<ds;i++) {
-        if (_versions[i].delta) {
-            delta_memory += _versions[i].delta->memory();
-        }
-    }
-    return base_memory + delta_memory;
+    return _mem_tracker->consumption();
 }
 
 string Column::to_string() const {
     string storage_info;
     if (_storage_type != _cs.type) {
-        storage_info = Format(" storage:%s", TypeInfo::get(_cs.type).name().c_str());
+        storage_info = Format(" storage:%s", TypeInfo::get(_storage_type).name().c_str());
     }
-    return Format("Column(%s cid=%u version=%zu %s%s%s)",
+    return Format("Column(%s cid=%u version=%zu %s%s%s%s)",
             _cs.name.c_str(),
             _cs.cid,
             _versions.back().version,
             TypeInfo::get(_cs.type).name().c_str(),
             _cs.nullable?" null":"",
+            _cs.dict?" dict":"",
             storage_info.c_str());
 }
 
@@ -663,8 +1402,39 @@ Status Column::read(uint64_t version, unique_ptr<ColumnReader>& cr) {
     bool nullable = schema().nullable;
     vector<ColumnDelta*> deltas;
     uint64_t real_version;
-    RETURN_NOT_OK(capture_version(version, deltas, real_version));
+    {
+        std::lock_guard<mutex> lg(_lock);
+        RETURN_NOT_OK(capture_version(version, deltas, real_version));
+    }
     RefPtr<Column> pcol(this);
+    if (schema().dict) {
+        switch (type) {
+        case Int8:
+            cr.reset(NewDictColumnReader<int8_t>(nullable, pcol, version, real_version, deltas));
+            break;
+        case Int16:
+            cr.reset(NewDictColumnReader<int16_t>(nullable, pcol, version, real_version, deltas));
+            break;
+        case Int32:
+            cr.reset(NewDictColumnReader<int32_t>(nullable, pcol, version, real_version, deltas));
+            break;
+        case Int64:
+            cr.reset(NewDictColumnReader<int64_t>(nullable, pcol, version, real_version, deltas));
+            break;
+        case Int128:
+            cr.reset(NewDictColumnReader<int128_t>(nullable, pcol, version, real_version, deltas));
+            break;
+        case Float32:
+            cr.reset(NewDictColumnReader<float>(nullable, pcol, version, real_version, deltas));
+            break;
+        case Float64:
+            cr.reset(NewDictColumnReader<double>(nullable, pcol, version, real_version, deltas));
+            break;
+        default:
+            return Status::NotSupported("unsupported type for dictionary encoding");
+        }
+        return Status::OK();
+    }
     switch (type) {
     case Int8:
         if (nullable) {
@@ -732,6 +1502,34 @@ Status Column::write(unique_ptr<ColumnWriter>& cw) {
     Type type = schema().type;
     bool nullable = schema().nullable;
     RefPtr<Column> pcol(this);
+    if (schema().dict) {
+        switch (type) {
+        case Int8:
+            cw.reset(NewDictColumnWriter<int8_t>(nullable, pcol));
+            break;
+        case Int16:
+            cw.reset(NewDictColumnWriter<int16_t>(nullable, pcol));
+            break;
+        case Int32:
+            cw.reset(NewDictColumnWriter<int32_t>(nullable, pcol));
+            break;
+        case Int64:
+            cw.reset(NewDictColumnWriter<int64_t>(nullable, pcol));
+            break;
+        case Int128:
+            cw.reset(NewDictColumnWriter<int128_t>(nullable, pcol));
+            break;
+        case Float32:
+            cw.reset(NewDictColumnWriter<float>(nullable, pcol));
+            break;
+        case Float64:
+            cw.reset(NewDictColumnWriter<double>(nullable, pcol));
+            break;
+        default:
+            return Status::NotSupported("unsupported type for dictionary encoding");
+        }
+        return Status::OK();
+    }
     switch (type) {
     case Int8:
         if (nullable) {
@@ -2,8 +2,12 @@
 #define CHOCO_COLUMN_H_
 
 #include "common.h"
+#include "bitmap.h"
 #include "schema.h"
 #include "column_delta.h"
+#include "column_dict.h"
+#include "encoding.h"
+#include "mem_tracker.h"
 
 namespace choco {
 
@@ -15,12 +19,47 @@ public:
 
     Buffer& data() { return _data; }
 
+    // null bitmap, 1 bit per row, empty if page has no null
     Buffer& nulls() { return _nulls; }
 
     Status alloc(size_t size, size_t esize, BufferTag tag);
 
+    // number of rows
+    size_t size() const { return _size; }
+
+    /**
+     * byte width of stored elements, may be narrower than column type
+     * for integer columns using adaptive storage
+     */
+    size_t esize() const { return _esize; }
+
+    /**
+     * copy this page to a new page storing signed integers in a wider byte width
+     */
+    Status widen(size_t new_esize, RefPtr<ColumnPage>& ret) const;
+
+    /**
+     * frozen integer pages may be compressed with FOR + bit-packing,
+     * float pages with ALP, data() then holds packed values and esize()
+     * is the width before packing
+     */
+    bool packed() const { return _packed; }
+
+    const ForEncoding& encoding() const { return _encoding; }
+
+    const AlpEncoding& alp() const { return _alp; }
+
+    /**
+     * copy this page to a new packed page, ret is left null if packing
+     * doesn't save enough memory
+     */
+    Status pack(RefPtr<ColumnPage>& ret) const;
+
+    // same as pack, for float(esize 4) or double(esize 8) pages
+    Status pack_float(RefPtr<ColumnPage>& ret) const;
+
     bool is_null(uint32_t idx) {
-        return _nulls && _nulls.as<bool>()[idx];
+        return _nulls && BitmapTest(_nulls.data(), idx);
     }
 
     Status set_null(uint32_t idx);
@@ -30,6 +69,10 @@ public:
 private:
     uint64_t _pid = 0;
     size_t   _size = 0;
+    size_t   _esize = 0;
+    bool     _packed = false;
+    ForEncoding _encoding;
+    AlpEncoding _alp;
     BufferTag _tag = 0;
     Buffer   _nulls;
     Buffer   _data;
@@ -40,6 +83,8 @@ class ColumnReader;
 class ColumnWriter;
 template<class, bool, class> class TypedColumnReader;
 template<class, bool, class, class> class TypedColumnWriter;
+template<class, bool> class DictColumnReader;
+template<class, bool> class DictColumnWriter;
 
 
 class Column : public RefCounted {
@@ -47,13 +92,30 @@ public:
     static const uint32_t BLOCK_SIZE = 1<<16;
     static const uint32_t BLOCK_MASK = 0xffff;
 
-    Column(const ColumnSchema& cs, Type storage_type, uint64_t version);
+    /**
+     * storage_type != cs.type enables adaptive storage for int16/int32/int64
+     * columns: pages start with storage_type's width and get rewritten to a
+     * wider width when a value overflows, full pages are compressed with
+     * FOR + bit-packing.
+     * for dictionary encoded columns, it's the storage type of codes.
+     * full float/double pages are compressed with ALP when it saves
+     * memory, unless cs.plain.
+     * buffers are charged to a column MemTracker, child of parent_tracker
+     * (process tracker if nullptr)
+     */
+    Column(const ColumnSchema& cs, Type storage_type, uint64_t version, MemTracker* parent_tracker=nullptr);
     Column(const Column& rhs, size_t new_base_capacity, size_t new_version_capacity);
 
     const ColumnSchema& schema() { return _cs; }
 
+    /**
+     * memory of buffers allocated by all versions(COW copies) of this column
+     * which are still alive, O(1)
+     */
     size_t memory() const;
 
+    MemTracker* mem_tracker() const { return _mem_tracker.get(); }
+
     Status read(uint64_t version, unique_ptr<ColumnReader>& cr);
 
     Status write(unique_ptr<ColumnWriter>& cw);
@@ -67,13 +129,21 @@ private:
 
     template<class, bool, class> friend class TypedColumnReader;
     template<class, bool, class, class> friend class TypedColumnWriter;
+    template<class, bool> friend class DictColumnReader;
+    template<class, bool> friend class DictColumnWriter;
 
     Status capture_version(uint64_t version, vector<ColumnDelta*>& deltas, uint64_t& real_version) const;
     void capture_latest(vector<ColumnDelta*>& deltas) const;
 
+    // guards appending to and truncating _base and _versions against
+    // readers capturing versions
     mutex _lock;
     ColumnSchema _cs;
     Type _storage_type;
+    // shared by all COW copies, outlives all buffers of this column
+    RefPtr<MemTracker> _mem_tracker;
+    // shared by all COW copies, null if column is not dictionary encoded
+    RefPtr<ColumnDict> _dict;
     ssize_t _base_idx;
     // TODO: not strictly thread-safe, use a thread-safe append only vector instead
     vector<RefPtr<ColumnPage>> _base;
@@ -98,11 +168,19 @@ public:
     /**
      * get cell by rid, caller need to make sure rid is in range
      * otherwise undefined behavior
+     * returned pointer is valid until next call to get: values of
+     * narrow(adaptive width) or packed pages are decoded into a buffer
+     * of this reader, which is overwritten by the next get. Only
+     * plain(ColumnSchema::plain) and delta values point into column
+     * buffers, and stay valid while the reader lives.
      */
     virtual const void * get(const uint32_t rid) const = 0;
 
     virtual Status get_block(size_t nrows, size_t block, ColumnBlock& cb) const = 0;
 
+    // number of delta entries get_block applies to block
+    virtual size_t delta_entries(size_t block) const { return 0; }
+
     virtual Status get_by_rids(const vector<uint32_t>& rid, ColumnBlock& cb) const = 0;
 
     // only used for not-null key columns
@@ -110,6 +188,41 @@ public:
 
     virtual uint64_t hashcode(const void * rhs, size_t rhs_idx) const = 0;
 
+    /**
+     * clear bits in selection of rows of block which are null or whose
+     * value is not in [lo, hi], evaluated on stored data without
+     * decoding the block(packed or narrow integer pages, dictionary
+     * codes), NotSupported if block can't be filtered this way(deltas,
+     * non integer values)
+     */
+    virtual Status filter_range(size_t nrows, size_t block, int64_t lo, int64_t hi,
+                                uint8_t* selection) const {
+        return Status::NotSupported("filter_range not supported");
+    }
+
+    /**
+     * aggregate non-null values of rows of block set in selection(all
+     * rows if nullptr) into agg, evaluated on ALP packed float pages
+     * without decoding the block, NotSupported for other blocks
+     */
+    virtual Status aggregate_block(size_t nrows, size_t block, const uint8_t* selection,
+                                   FloatAggregate& agg) const {
+        return Status::NotSupported("aggregate_block not supported");
+    }
+
+    /**
+     * dictionary of dictionary encoded column, nullptr for other columns
+     */
+    virtual const ColumnDict* dict() const { return nullptr; }
+
+    /**
+     * for dictionary encoded column, get int32 codes of a block, so
+     * predicates can work on codes directly
+     */
+    virtual Status get_code_block(size_t nrows, size_t block, ColumnBlock& cb) const {
+        return Status::NotSupported("column is not dictionary encoded");
+    }
+
     /**
      * get basic info about this reader
      */
@@ -126,11 +239,26 @@ class ColumnWriter {
 public:
     virtual ~ColumnWriter() {}
     virtual Status insert(uint32_t rid, const void * value) = 0;
+    /**
+     * insert n rows starting at rid, values are an array of column type,
+     * row i is null if bit nulls_offset+i of nulls is set(nulls may be
+     * nullptr), values of null rows are ignored
+     */
+    virtual Status insert_batch(uint32_t rid, size_t n, const void * values,
+                                const uint8_t * nulls, size_t nulls_offset) = 0;
     virtual Status update(uint32_t rid, const void * value) = 0;
     virtual Status finalize(uint64_t version) = 0;
     virtual Status get_new_column(RefPtr<Column>& ret) = 0;
+    /**
+     * undo a write which won't be published: pages and delta versions it
+     * appended to the column in place(when no COW copy was made) are
+     * removed, and null bits of rows [num_rows, ...) of the last page,
+     * which are not visible yet, are cleared
+     */
+    virtual void abort(size_t num_rows) = 0;
     virtual string to_string() const = 0;
 
+    // returned pointer is valid until next call to get
     virtual const void * get(const uint32_t rid) const = 0;
     // get then check equality for fast key lookup
     virtual bool equals(const uint32_t rid, const void * rhs) const = 0;
@@ -1,4 +1,5 @@
 #include "column_delta.h"
+#include "simd.h"
 
 namespace choco {
 
@@ -14,7 +15,6 @@ uint32_t DeltaIndex::find_idx(uint32_t rid) {
     if (bid >= _block_ends.size()) {
         return npos;
     }
-    // TODO: use SIMD
     uint32_t start = bid > 0 ? _block_ends[bid-1]:0;
     uint32_t end = _block_ends[bid];
     if (start == end) {
@@ -23,7 +23,7 @@ uint32_t DeltaIndex::find_idx(uint32_t rid) {
     uint16_t * astart = _data.as<uint16_t>() + start;
     uint16_t * aend = _data.as<uint16_t>() + end;
     uint32_t bidx = rid & 0xffff;
-    uint16_t* pos = std::lower_bound(astart, aend, bidx);
+    const uint16_t* pos = Simd().lower_bound16(astart, aend, bidx);
     if ((pos != aend) && (*pos == bidx)) {
         return pos - _data.as<uint16_t>();
     } else {
@@ -47,19 +47,17 @@ Status ColumnDelta::alloc(size_t nblock, size_t size, size_t esize, BufferTag ta
     if (!ret) {
         return ret;
     }
-    ret = _data.alloc(size * esize, tag.data());
+    ret = _data.alloc(size * esize, tag.data(), true);
     if (!ret) {
         return ret;
     }
     if (has_null) {
-        ret = _nulls.alloc(size, tag.null());
+        ret = _nulls.alloc(BitmapSize64(size), tag.null(), true);
         if (!ret) {
             _data.clear();
             return Status::OOM("init column delta nulls");
         }
-        _nulls.set_zero();
     }
-    _data.set_zero();
     _tag = tag;
     _size = size;
     return Status::OK();
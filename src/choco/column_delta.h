@@ -4,6 +4,7 @@
 #include "common.h"
 #include "type.h"
 #include "buffer.h"
+#include "bitmap.h"
 
 namespace choco {
 
@@ -57,10 +58,15 @@ public:
 
     size_t size() const { return _size; }
 
+    // null bitmap, 1 bit per delta entry, empty if delta has no null
     Buffer& nulls() {
         return _nulls;
     }
 
+    bool is_null(uint32_t idx) const {
+        return _nulls && BitmapTest(_nulls.data(), idx);
+    }
+
     Buffer& data() {
         return _data;
     }
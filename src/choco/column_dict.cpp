@@ -0,0 +1,108 @@
+#include "column_dict.h"
+
+namespace choco {
+
+const uint32_t ColumnDict::kSegmentBits;
+const uint32_t ColumnDict::kSegmentSize;
+const uint32_t ColumnDict::kMaxSegment;
+const uint32_t ColumnDict::kMaxSize;
+const uint32_t ColumnDict::NOCODE;
+
+ColumnDict::ColumnDict(size_t esize, BufferTag tag) :
+        _esize(esize),
+        _tag(tag),
+        _tracker(tag.tracker),
+        _size(0) {
+    // never resized, so readers can access segments while writer adds values
+    _segments.resize(kMaxSegment);
+}
+
+ColumnDict::~ColumnDict() {
+    if (_tracker) {
+        _tracker->release(_table.size() * sizeof(uint32_t), MemTracker::kIndex);
+    }
+}
+
+size_t ColumnDict::memory() const {
+    size_t ret = _table.size() * sizeof(uint32_t);
+    for (uint32_t i = 0; i < kMaxSegment && _segments[i]; i++) {
+        ret += _segments[i].bsize();
+    }
+    return ret;
+}
+
+uint64_t ColumnDict::hash(const void* value) const {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+    memcpy(&lo, value, std::min(_esize, sizeof(uint64_t)));
+    if (_esize > sizeof(uint64_t)) {
+        memcpy(&hi, (const uint8_t*)value + sizeof(uint64_t), _esize - sizeof(uint64_t));
+    }
+    return HashCode(lo ^ (hi * 0x9e3779b97f4a7c15ULL));
+}
+
+uint32_t ColumnDict::find(const void* value) const {
+    if (_table.empty()) {
+        return NOCODE;
+    }
+    size_t mask = _table.size() - 1;
+    size_t pos = hash(value) & mask;
+    while (true) {
+        uint32_t code = _table[pos];
+        if (code == NOCODE) {
+            return NOCODE;
+        }
+        if (memcmp(get(code), value, _esize) == 0) {
+            return code;
+        }
+        pos = (pos + 1) & mask;
+    }
+}
+
+void ColumnDict::rehash(size_t capacity, uint32_t size) {
+    if (_tracker) {
+        _tracker->consume((capacity - _table.size()) * sizeof(uint32_t), MemTracker::kIndex);
+    }
+    _table.assign(capacity, NOCODE);
+    size_t mask = capacity - 1;
+    for (uint32_t code = 0; code < size; code++) {
+        size_t pos = hash(get(code)) & mask;
+        while (_table[pos] != NOCODE) {
+            pos = (pos + 1) & mask;
+        }
+        _table[pos] = code;
+    }
+}
+
+Status ColumnDict::add(const void* value, uint32_t& code) {
+    code = find(value);
+    if (code != NOCODE) {
+        return Status::OK();
+    }
+    uint32_t sz = _size.load(std::memory_order_relaxed);
+    if (sz >= kMaxSize) {
+        return Status::NotSupported(Format("dictionary size exceeds %u", kMaxSize));
+    }
+    Buffer& seg = _segments[sz >> kSegmentBits];
+    if (!seg) {
+        RETURN_NOT_OK(seg.alloc(kSegmentSize * _esize, _tag.data()));
+    }
+    memcpy(seg.data() + (sz & (kSegmentSize - 1)) * _esize, value, _esize);
+    // keep load factor <= 0.5
+    if ((sz + 1) * 2 > _table.size()) {
+        rehash(std::max((size_t)64, _table.size() * 2), sz + 1);
+    } else {
+        size_t mask = _table.size() - 1;
+        size_t pos = hash(value) & mask;
+        while (_table[pos] != NOCODE) {
+            pos = (pos + 1) & mask;
+        }
+        _table[pos] = sz;
+    }
+    // publish value to readers
+    _size.store(sz + 1, std::memory_order_release);
+    code = sz;
+    return Status::OK();
+}
+
+} /* namespace choco */
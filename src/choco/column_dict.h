@@ -0,0 +1,84 @@
+#ifndef CHOCO_COLUMN_DICT_H_
+#define CHOCO_COLUMN_DICT_H_
+
+#include "common.h"
+#include "buffer.h"
+#include "mem_tracker.h"
+
+namespace choco {
+
+/**
+ * Append only dictionary of fixed size values for dictionary encoded
+ * columns, values are identified by code(0, 1, 2 ...) and compared bitwise.
+ *
+ * Values are stored in fixed size segments which never move, so readers
+ * can lookup codes they have seen while the (single) writer adds values,
+ * the Column and all its COW copies share one dictionary.
+ */
+class ColumnDict : public RefCounted {
+public:
+    static const uint32_t kSegmentBits = 12;
+    static const uint32_t kSegmentSize = 1 << kSegmentBits;
+    static const uint32_t kMaxSegment = 1024;
+    static const uint32_t kMaxSize = kSegmentSize * kMaxSegment;
+    static const uint32_t NOCODE = (uint32_t)-1;
+
+    ColumnDict(size_t esize, BufferTag tag);
+    ~ColumnDict();
+
+    size_t esize() const { return _esize; }
+
+    // number of values, codes in [0, size()) are valid
+    uint32_t size() const { return _size.load(std::memory_order_acquire); }
+
+    size_t memory() const;
+
+    const void* get(uint32_t code) const {
+        DCHECK_LT(code, kMaxSize);
+        return _segments[code >> kSegmentBits].data() + (code & (kSegmentSize - 1)) * _esize;
+    }
+
+    /**
+     * find code of value, return NOCODE if not found
+     * only used by writer, readers should use match
+     */
+    uint32_t find(const void* value) const;
+
+    // add value if not exists, return its code, only used by writer
+    Status add(const void* value, uint32_t& code);
+
+    /**
+     * evaluate predicate once per distinct value, set bit code of
+     * result bitmap if pred(value) is true, so row predicates can be
+     * evaluated on codes
+     */
+    template <class T, class Pred>
+    void match(uint32_t size, Pred pred, vector<uint8_t>& result) const {
+        result.assign((size + 7) / 8, 0);
+        for (uint32_t code = 0; code < size; code++) {
+            if (pred(*(const T*)get(code))) {
+                result[code >> 3] |= 1 << (code & 7);
+            }
+        }
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ColumnDict);
+
+    uint64_t hash(const void* value) const;
+    // rebuild hash table with capacity slots for codes [0, size)
+    void rehash(size_t capacity, uint32_t size);
+
+    size_t _esize;
+    BufferTag _tag;
+    // keeps tag's tracker alive, readers may hold the dictionary longer than the column
+    RefPtr<MemTracker> _tracker;
+    std::atomic<uint32_t> _size;
+    vector<Buffer> _segments;
+    // writer only open addressing hash table of codes, NOCODE means empty
+    vector<uint32_t> _table;
+};
+
+} /* namespace choco */
+
+#endif /* CHOCO_COLUMN_DICT_H_ */
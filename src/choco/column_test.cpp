@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "choco/column.h"
+#include "choco/row_block.h"
 
 namespace choco {
 
@@ -202,4 +203,342 @@ TEST(Column, update) {
     ColumnTest<Float64>::test_update();
 }
 
+TEST(Column, update_last_writer_wins) {
+    const size_t N = 200000;
+    ColumnSchema cs("int32", 1, Int32, true);
+    RefPtr<Column> c(new Column(cs, Int32, 1), false);
+    unique_ptr<ColumnWriter> writer;
+    ASSERT_TRUE(c->write(writer));
+    vector<int32_t> values(N);
+    for (size_t i=0;i<N;i++) {
+        values[i] = i;
+        EXPECT_TRUE(writer->insert(i, &values[i]));
+    }
+    ASSERT_TRUE(writer->finalize(2));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    // write every updated rid several times in one version, including nulls
+    srand(1);
+    ASSERT_TRUE(c->write(writer));
+    vector<bool> nulls(N, false);
+    for (size_t i=0;i<5000;i++) {
+        uint32_t rid = rand() % N;
+        for (int j=0;j<3;j++) {
+            int32_t v = rand();
+            if (v % 7 == 0) {
+                EXPECT_TRUE(writer->update(rid, nullptr));
+                nulls[rid] = true;
+            } else {
+                EXPECT_TRUE(writer->update(rid, &v));
+                values[rid] = v;
+                nulls[rid] = false;
+            }
+        }
+    }
+    ASSERT_TRUE(writer->finalize(3));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    unique_ptr<ColumnReader> readc;
+    ASSERT_TRUE(c->read(3, readc));
+    for (uint32_t i=0;i<N;i++) {
+        const int32_t* v = (const int32_t*)readc->get(i);
+        if (nulls[i]) {
+            EXPECT_TRUE(v == nullptr) << Format("rid %u", i);
+        } else {
+            ASSERT_TRUE(v != nullptr) << Format("rid %u", i);
+            EXPECT_EQ(*v, values[i]) << Format("rid %u", i);
+        }
+    }
+}
+
+TEST(Column, aggregate) {
+    const size_t N = 100000;
+    for (AggregationType agg : {AggReplaceIfNotNull, AggSum, AggMax, AggMin}) {
+        SCOPED_TRACE(AggregationTypeName(agg));
+        ColumnSchema cs("int64", 1, Int64, true, false, agg);
+        RefPtr<Column> c(new Column(cs, Int64, 1), false);
+        unique_ptr<ColumnWriter> writer;
+        ASSERT_TRUE(c->write(writer));
+        vector<int64_t> values(N);
+        vector<bool> nulls(N, false);
+        for (size_t i=0;i<N;i++) {
+            values[i] = i;
+            nulls[i] = i % 10 == 0;
+            EXPECT_TRUE(writer->insert(i, nulls[i] ? nullptr : &values[i]));
+        }
+        ASSERT_TRUE(writer->finalize(1));
+        ASSERT_TRUE(writer->get_new_column(c));
+        writer.reset();
+        // several writes per rid in each version, folded into one delta entry
+        srand(1);
+        for (uint64_t version = 2; version <= 3; version++) {
+            ASSERT_TRUE(c->write(writer));
+            vector<bool> updated(N, false);
+            size_t nupdated = 0;
+            for (size_t i=0;i<20000;i++) {
+                uint32_t rid = rand() % N;
+                int64_t v = rand() % 1000 - 500;
+                if (rand() % 5 == 0) {
+                    EXPECT_TRUE(writer->update(rid, nullptr));
+                    continue;
+                }
+                EXPECT_TRUE(writer->update(rid, &v));
+                nupdated += !updated[rid];
+                updated[rid] = true;
+                if (nulls[rid] || agg == AggReplaceIfNotNull) {
+                    values[rid] = v;
+                } else if (agg == AggSum) {
+                    values[rid] += v;
+                } else if (agg == AggMax) {
+                    values[rid] = std::max(values[rid], v);
+                } else {
+                    values[rid] = std::min(values[rid], v);
+                }
+                nulls[rid] = false;
+            }
+            ASSERT_TRUE(writer->finalize(version));
+            ASSERT_TRUE(writer->get_new_column(c));
+            writer.reset();
+            unique_ptr<ColumnReader> readc;
+            ASSERT_TRUE(c->read(version, readc));
+            if (version == 2) {
+                // one delta entry per updated rid
+                size_t nentry = 0;
+                for (size_t bid = 0; bid < NBlock(N, Column::BLOCK_SIZE); bid++) {
+                    nentry += readc->delta_entries(bid);
+                }
+                EXPECT_EQ(nupdated, nentry);
+            }
+            for (uint32_t i=0;i<N;i++) {
+                const int64_t* v = (const int64_t*)readc->get(i);
+                if (nulls[i]) {
+                    ASSERT_TRUE(v == nullptr) << Format("rid %u", i);
+                } else {
+                    ASSERT_TRUE(v != nullptr) << Format("rid %u", i);
+                    ASSERT_EQ(*v, values[i]) << Format("rid %u", i);
+                }
+            }
+        }
+    }
+}
+
+TEST(Column, adaptive_storage) {
+    const size_t N = Column::BLOCK_SIZE * 4;
+    ColumnSchema cs("int64", 1, Int64, true);
+    RefPtr<Column> c(new Column(cs, Int8, 1), false);
+    unique_ptr<ColumnWriter> writer;
+    ASSERT_TRUE(c->write(writer));
+    vector<int64_t> values(N);
+    for (size_t i=0;i<N;i++) {
+        switch (i / Column::BLOCK_SIZE) {
+        case 0: values[i] = (int64_t)(i % 100) - 50; break;
+        case 1: values[i] = -(int64_t)i; break;
+        // overflow at the end of page, page gets rewritten
+        case 2: values[i] = i == N/2 + 1000 ? (1LL<<40) : (int64_t)i; break;
+        default: values[i] = i % 7; break;
+        }
+        EXPECT_TRUE(writer->insert(i, i % 11 == 0 ? nullptr : &values[i]));
+    }
+    ASSERT_TRUE(writer->finalize(2));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    // 1+4+8+1 bytes per row, plus null bitmaps
+    EXPECT_LT(c->memory(), Column::BLOCK_SIZE * 15);
+    // update with values wider than page storage
+    ASSERT_TRUE(c->write(writer));
+    for (size_t i=0;i<N;i+=997) {
+        values[i] = (int64_t)i << 33;
+        EXPECT_TRUE(writer->update(i, &values[i]));
+    }
+    ASSERT_TRUE(writer->finalize(3));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    unique_ptr<ColumnReader> readc;
+    ASSERT_TRUE(c->read(3, readc));
+    for (uint32_t i=0;i<N;i++) {
+        const int64_t* v = (const int64_t*)readc->get(i);
+        if (i % 11 == 0 && i % 997 != 0) {
+            EXPECT_TRUE(v == nullptr);
+        } else {
+            ASSERT_TRUE(v != nullptr);
+            EXPECT_EQ(*v, values[i]);
+        }
+    }
+    ColumnBlock cb;
+    for (uint32_t b=0;b<4;b++) {
+        ASSERT_TRUE(readc->get_block(Column::BLOCK_SIZE, b, cb));
+        for (uint32_t i=0;i<Column::BLOCK_SIZE;i++) {
+            uint32_t rid = b * Column::BLOCK_SIZE + i;
+            if (rid % 11 == 0 && rid % 997 != 0) {
+                EXPECT_TRUE(cb.is_null(i));
+            } else {
+                EXPECT_FALSE(cb.is_null(i));
+                EXPECT_EQ(((const int64_t*)cb.data())[i], values[rid]);
+            }
+        }
+    }
+}
+
+
+TEST(Column, dict) {
+    const size_t N = Column::BLOCK_SIZE * 2 + 1000;
+    ColumnSchema cs("city", 1, Int64, true, true);
+    RefPtr<Column> c(new Column(cs, Int8, 1), false);
+    unique_ptr<ColumnWriter> writer;
+    ASSERT_TRUE(c->write(writer));
+    vector<int64_t> values(N);
+    for (size_t i=0;i<N;i++) {
+        values[i] = ((int64_t)(i % 300) << 40) + 7;
+        EXPECT_TRUE(writer->insert(i, i % 11 == 0 ? nullptr : &values[i]));
+    }
+    ASSERT_TRUE(writer->finalize(2));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    ASSERT_TRUE(c->write(writer));
+    for (size_t i=0;i<N;i+=997) {
+        values[i] = 1000;
+        EXPECT_TRUE(writer->update(i, &values[i]));
+    }
+    ASSERT_TRUE(writer->finalize(3));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    // 3 pages with 2 byte codes instead of 8 byte values
+    EXPECT_LT(c->memory(), Column::BLOCK_SIZE * 3 * 3);
+    unique_ptr<ColumnReader> readc;
+    ASSERT_TRUE(c->read(3, readc));
+    const ColumnDict* dict = readc->dict();
+    ASSERT_TRUE(dict != nullptr);
+    EXPECT_EQ(dict->size(), 301);
+    auto is_null = [](uint32_t rid) {
+        return rid % 11 == 0 && rid % 997 != 0;
+    };
+    for (uint32_t i=0;i<N;i++) {
+        const int64_t* v = (const int64_t*)readc->get(i);
+        if (is_null(i)) {
+            EXPECT_TRUE(v == nullptr);
+        } else {
+            ASSERT_TRUE(v != nullptr);
+            EXPECT_EQ(*v, values[i]);
+        }
+    }
+    // predicate evaluated once per distinct value, then on codes
+    vector<uint8_t> match;
+    dict->match<int64_t>(dict->size(), [](int64_t v) {
+        return v < (100LL << 40);
+    }, match);
+    ColumnBlock cb;
+    ColumnBlock codes;
+    for (uint32_t b=0;b<3;b++) {
+        size_t nrows = std::min((size_t)Column::BLOCK_SIZE, N - b * Column::BLOCK_SIZE);
+        ASSERT_TRUE(readc->get_block(nrows, b, cb));
+        ASSERT_TRUE(readc->get_code_block(nrows, b, codes));
+        for (uint32_t i=0;i<nrows;i++) {
+            uint32_t rid = b * Column::BLOCK_SIZE + i;
+            if (is_null(rid)) {
+                EXPECT_TRUE(cb.is_null(i));
+                EXPECT_TRUE(codes.is_null(i));
+            } else {
+                int64_t v = ((const int64_t*)cb.data())[i];
+                EXPECT_EQ(v, values[rid]);
+                int32_t code = ((const int32_t*)codes.data())[i];
+                EXPECT_EQ(*(const int64_t*)dict->get(code), v);
+                EXPECT_EQ(BitmapTest(match.data(), code), v < (100LL << 40));
+            }
+        }
+    }
+}
+
+
+TEST(Column, packed_pages) {
+    const size_t N = Column::BLOCK_SIZE * 3 + 100;
+    ColumnSchema cs("ts", 1, Int64, false);
+    RefPtr<Column> c(new Column(cs, Int8, 1), false);
+    unique_ptr<ColumnWriter> writer;
+    ASSERT_TRUE(c->write(writer));
+    vector<int64_t> values(N);
+    for (size_t i=0;i<N;i++) {
+        values[i] = 1600000000000LL + i * 1000 + (i * 31) % 17;
+        EXPECT_TRUE(writer->insert(i, &values[i]));
+        if (i == Column::BLOCK_SIZE + 10) {
+            // page 1 becomes visible before it is full, packing needs COW
+            ASSERT_TRUE(writer->finalize(2));
+            ASSERT_TRUE(writer->get_new_column(c));
+            ASSERT_TRUE(c->write(writer));
+        }
+    }
+    ASSERT_TRUE(writer->finalize(3));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    // 3 pages packed to 5 bits per row, last page stores 8 byte values
+    EXPECT_LT(c->memory(), Column::BLOCK_SIZE * 12);
+    ASSERT_TRUE(c->write(writer));
+    for (size_t i=0;i<N;i+=997) {
+        values[i] = -(int64_t)i;
+        EXPECT_TRUE(writer->update(i, &values[i]));
+    }
+    ASSERT_TRUE(writer->finalize(4));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    unique_ptr<ColumnReader> readc;
+    ASSERT_TRUE(c->read(4, readc));
+    for (uint32_t i=0;i<N;i++) {
+        const int64_t* v = (const int64_t*)readc->get(i);
+        ASSERT_TRUE(v != nullptr);
+        EXPECT_EQ(*v, values[i]);
+        EXPECT_TRUE(readc->equals(i, values.data(), i));
+    }
+    ColumnBlock cb;
+    for (uint32_t b=0;b<4;b++) {
+        size_t nrows = std::min((size_t)Column::BLOCK_SIZE, N - b * Column::BLOCK_SIZE);
+        ASSERT_TRUE(readc->get_block(nrows, b, cb));
+        for (uint32_t i=0;i<nrows;i++) {
+            EXPECT_EQ(((const int64_t*)cb.data())[i], values[b * Column::BLOCK_SIZE + i]);
+        }
+    }
+}
+
+
+TEST(Column, packed_float_pages) {
+    const size_t N = Column::BLOCK_SIZE * 2 + 100;
+    ColumnSchema cs("price", 1, Float64, true);
+    RefPtr<Column> c(new Column(cs, Float64, 1), false);
+    unique_ptr<ColumnWriter> writer;
+    ASSERT_TRUE(c->write(writer));
+    vector<double> values(N);
+    for (size_t i=0;i<N;i++) {
+        values[i] = (double)((i * 7919) % 100000) / 100;
+        EXPECT_TRUE(writer->insert(i, i % 13 == 0 ? nullptr : &values[i]));
+    }
+    values[N-1] = 3.141592653589793;
+    EXPECT_TRUE(writer->update(N-1, &values[N-1]));
+    ASSERT_TRUE(writer->finalize(2));
+    ASSERT_TRUE(writer->get_new_column(c));
+    writer.reset();
+    // 2 pages packed to ~17 bits per row, last page stores 8 byte values
+    EXPECT_LT(c->memory(), Column::BLOCK_SIZE * 14);
+    unique_ptr<ColumnReader> readc;
+    ASSERT_TRUE(c->read(2, readc));
+    for (uint32_t i=0;i<N;i++) {
+        const double* v = (const double*)readc->get(i);
+        if (i % 13 == 0) {
+            EXPECT_TRUE(v == nullptr);
+        } else {
+            ASSERT_TRUE(v != nullptr);
+            EXPECT_EQ(*v, values[i]);
+        }
+    }
+    ColumnBlock cb;
+    for (uint32_t b=0;b<3;b++) {
+        size_t nrows = std::min((size_t)Column::BLOCK_SIZE, N - b * Column::BLOCK_SIZE);
+        ASSERT_TRUE(readc->get_block(nrows, b, cb));
+        for (uint32_t i=0;i<nrows;i++) {
+            uint32_t rid = b * Column::BLOCK_SIZE + i;
+            EXPECT_EQ(cb.is_null(i), rid % 13 == 0);
+            if (rid % 13 != 0) {
+                EXPECT_EQ(((const double*)cb.data())[i], values[rid]);
+            }
+        }
+    }
+}
+
 }
@@ -0,0 +1,147 @@
+#include "columnar_batch.h"
+
+namespace choco {
+
+Status ColumnarBatch::create(const Schema& schema, const vector<string>& columns,
+                             unique_ptr<ColumnarBatch>& ret) {
+    unique_ptr<ColumnarBatch> batch(new ColumnarBatch(schema));
+    vector<bool> added(schema.cid_size(), false);
+    for (auto& name : columns) {
+        const ColumnSchema* cs = batch->_schema.get(name);
+        if (!cs) {
+            return Status::NotFound(Format("columnar batch column %s not found", name.c_str()));
+        }
+        if (added[cs->cid]) {
+            return Status::InvalidArgument(Format("columnar batch column %s duplicated", name.c_str()));
+        }
+        added[cs->cid] = true;
+        ColumnVector cv;
+        cv.cs = cs;
+        if (cs->type == String) {
+            cv.esize = sizeof(uint32_t);
+            cv.data.resize(sizeof(uint32_t), 0);
+        } else {
+            cv.esize = TypeInfo::get(cs->type).size();
+        }
+        batch->_columns.emplace_back(std::move(cv));
+    }
+    if (schema.num_key_column() != 1 || !added[1]) {
+        return Status::InvalidArgument("columnar batch without key column");
+    }
+    // move key column first, other columns keep their order
+    for (size_t i = 0; i < batch->_columns.size(); i++) {
+        if (batch->_columns[i].cs->cid == 1) {
+            std::rotate(batch->_columns.begin(), batch->_columns.begin() + i, batch->_columns.begin() + i + 1);
+            break;
+        }
+    }
+    ret.swap(batch);
+    return Status::OK();
+}
+
+Status ColumnarBatch::wrap(const Schema& schema, const vector<string>& columns, size_t nrows,
+                           const vector<const void*>& data, const vector<const uint8_t*>& nulls,
+                           const vector<const uint8_t*>& bytes, unique_ptr<ColumnarBatch>& ret) {
+    if (data.size() != columns.size() || nulls.size() != columns.size() || bytes.size() != columns.size()) {
+        return Status::InvalidArgument("columnar batch wrap with wrong number of columns");
+    }
+    if (nrows > UINT32_MAX) {
+        return Status::InvalidArgument("columnar batch too large");
+    }
+    unique_ptr<ColumnarBatch> batch;
+    RETURN_NOT_OK(create(schema, columns, batch));
+    // columns may be reordered by create
+    for (auto& cv : batch->_columns) {
+        size_t i = std::find(columns.begin(), columns.end(), cv.cs->name) - columns.begin();
+        if (!data[i] || (cv.cs->type == String && !bytes[i])) {
+            return Status::InvalidArgument(Format("columnar batch wrap column %s without data",
+                                                  cv.cs->name.c_str()));
+        }
+        cv.ext_data = (const uint8_t*)data[i];
+        cv.ext_nulls = nulls[i];
+        cv.ext_bytes = bytes[i];
+        cv.has_null = nulls[i] != nullptr;
+    }
+    if (batch->_columns[0].ext_nulls && !BitmapIsAllZero(batch->_columns[0].ext_nulls, 0, nrows)) {
+        return Status::InvalidArgument("columnar batch wrap null key");
+    }
+    batch->_wrapped = true;
+    batch->_row_size = nrows;
+    ret.swap(batch);
+    return Status::OK();
+}
+
+ColumnarBatch::ColumnarBatch(const Schema& schema) : _schema(schema) {
+}
+
+Status ColumnarBatch::append(size_t n, const vector<const void*>& values, const vector<const uint8_t*>& nulls) {
+    if (_wrapped) {
+        return Status::NotSupported("append to wrapped columnar batch");
+    }
+    if (values.size() != _columns.size() || (!nulls.empty() && nulls.size() != _columns.size())) {
+        return Status::InvalidArgument("columnar batch append with wrong number of columns");
+    }
+    if (_row_size + n > UINT32_MAX) {
+        return Status::InvalidArgument("columnar batch too large");
+    }
+    const uint8_t* key_nulls = nulls.empty() ? nullptr : nulls[0];
+    if (key_nulls && !BitmapIsAllZero(key_nulls, 0, n)) {
+        return Status::InvalidArgument("columnar batch append null key");
+    }
+    // check before changing any column, so a failed append leaves batch unchanged
+    for (size_t i = 0; i < _columns.size(); i++) {
+        if (_columns[i].cs->type != String) {
+            continue;
+        }
+        const Slice* ss = (const Slice*)values[i];
+        size_t total = _columns[i].bytes.size();
+        for (size_t j = 0; j < n; j++) {
+            total += ss[j].size();
+        }
+        if (total > UINT32_MAX) {
+            return Status::InvalidArgument("columnar batch string data too large");
+        }
+    }
+    for (size_t i = 0; i < _columns.size(); i++) {
+        ColumnVector& cv = _columns[i];
+        const uint8_t* cnulls = nulls.empty() ? nullptr : nulls[i];
+        if (cnulls && !BitmapIsAllZero(cnulls, 0, n)) {
+            if (!cv.has_null) {
+                cv.has_null = true;
+                cv.nulls.resize(BitmapSize64(_row_size), 0);
+            }
+            cv.nulls.resize(BitmapSize64(_row_size + n), 0);
+            BitmapCopy(cv.nulls.data(), _row_size, cnulls, 0, n);
+        } else if (cv.has_null) {
+            // new bits are zero
+            cv.nulls.resize(BitmapSize64(_row_size + n), 0);
+        }
+        if (cv.cs->type != String) {
+            size_t old = cv.data.size();
+            cv.data.resize(old + n * cv.esize);
+            memcpy(cv.data.data() + old, values[i], n * cv.esize);
+            continue;
+        }
+        const Slice* ss = (const Slice*)values[i];
+        size_t old = cv.data.size();
+        cv.data.resize(old + n * sizeof(uint32_t));
+        uint32_t* offsets = (uint32_t*)cv.data.data();
+        for (size_t j = 0; j < n; j++) {
+            size_t row = _row_size + j;
+            if (!(cnulls && BitmapTest(cnulls, j))) {
+                cv.bytes.insert(cv.bytes.end(), ss[j].data(), ss[j].data() + ss[j].size());
+            }
+            offsets[row + 1] = cv.bytes.size();
+        }
+    }
+    _row_size += n;
+    return Status::OK();
+}
+
+Slice ColumnarBatch::get_string(size_t idx, size_t row) const {
+    DCHECK_EQ(_columns[idx].cs->type, String);
+    const uint32_t* offsets = (const uint32_t*)column_data(idx);
+    return Slice(string_data(idx) + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+} /* namespace choco */
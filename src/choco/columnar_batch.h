@@ -0,0 +1,103 @@
+#ifndef CHOCO_COLUMNAR_BATCH_H_
+#define CHOCO_COLUMNAR_BATCH_H_
+
+#include "common.h"
+#include "schema.h"
+#include "bitmap.h"
+
+namespace choco {
+
+/**
+ * Rows of a write which all set the same columns, stored by column: the
+ * column set is kept once for the batch, each column is a typed vector
+ * plus a null bitmap, strings are uint32 offsets into a byte buffer.
+ * Commit applies it a column at a time, without decoding per row
+ * bitmaps like PartialRowBatch, which stays the format for sparse
+ * partial updates.
+ */
+class ColumnarBatch {
+public:
+    /**
+     * every row of the batch sets columns(by name), which must include
+     * the key column, key column is moved to column 0 of the batch,
+     * other columns keep their order
+     */
+    static Status create(const Schema& schema, const vector<string>& columns,
+                         unique_ptr<ColumnarBatch>& ret);
+
+    /**
+     * batch of nrows rows referencing column arrays in another buffer
+     * (e.g. a wire::WriteRequest) which must outlive it, data[i], nulls[i]
+     * (nullptr if no null) and bytes[i](strings only) of columns[i] are
+     * in the layout of column_data, column_nulls and string_data, data
+     * should be aligned to its type. Wrapped batches can't be appended.
+     */
+    static Status wrap(const Schema& schema, const vector<string>& columns, size_t nrows,
+                       const vector<const void*>& data, const vector<const uint8_t*>& nulls,
+                       const vector<const uint8_t*>& bytes, unique_ptr<ColumnarBatch>& ret);
+
+    const Schema& schema() const { return _schema; }
+
+    size_t row_size() const { return _row_size; }
+    size_t num_columns() const { return _columns.size(); }
+    const ColumnSchema* column_schema(size_t idx) const { return _columns[idx].cs; }
+
+    /**
+     * append n rows, values[i] is an array of n values of column i(Slice
+     * for string columns, bytes are copied), row j of column i is null
+     * if bit j of nulls[i] is set, nulls can be empty or have nullptrs
+     */
+    Status append(size_t n, const vector<const void*>& values, const vector<const uint8_t*>& nulls);
+
+    /**
+     * values of column idx, an array of its type, for string columns
+     * row_size()+1 uint32 offsets into string_data(idx)
+     */
+    const void* column_data(size_t idx) const {
+        return _wrapped ? _columns[idx].ext_data : _columns[idx].data.data();
+    }
+    // null bitmap of column idx, nullptr if no row of it is null
+    const uint8_t* column_nulls(size_t idx) const {
+        if (_wrapped) {
+            return _columns[idx].ext_nulls;
+        }
+        return _columns[idx].has_null ? _columns[idx].nulls.data() : nullptr;
+    }
+    const uint8_t* string_data(size_t idx) const {
+        return _wrapped ? _columns[idx].ext_bytes : _columns[idx].bytes.data();
+    }
+
+    bool is_null(size_t idx, size_t row) const {
+        const uint8_t* nulls = column_nulls(idx);
+        return nulls && BitmapTest(nulls, row);
+    }
+    // value of a string column
+    Slice get_string(size_t idx, size_t row) const;
+
+private:
+    ColumnarBatch(const Schema& schema);
+
+    Schema _schema;
+    size_t _row_size = 0;
+    // columns reference external arrays
+    bool _wrapped = false;
+    struct ColumnVector {
+        const ColumnSchema* cs = nullptr;
+        size_t esize = 0;
+        vector<uint8_t> data;
+        // allocated on first null
+        vector<uint8_t> nulls;
+        bool has_null = false;
+        // string bytes
+        vector<uint8_t> bytes;
+        // arrays of wrapped batch
+        const uint8_t* ext_data = nullptr;
+        const uint8_t* ext_nulls = nullptr;
+        const uint8_t* ext_bytes = nullptr;
+    };
+    vector<ColumnVector> _columns;
+};
+
+} /* namespace choco */
+
+#endif /* CHOCO_COLUMNAR_BATCH_H_ */
@@ -0,0 +1,88 @@
+#include "gtest/gtest.h"
+#include "columnar_batch.h"
+#include "bitmap.h"
+
+namespace choco {
+
+TEST(ColumnarBatch, create) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int32 uv,int8 city null,string ss null", sc));
+    unique_ptr<ColumnarBatch> batch;
+    EXPECT_FALSE(ColumnarBatch::create(*sc, {"uv", "city"}, batch));
+    EXPECT_FALSE(ColumnarBatch::create(*sc, {"id", "nothere"}, batch));
+    EXPECT_FALSE(ColumnarBatch::create(*sc, {"id", "uv", "uv"}, batch));
+    ASSERT_TRUE(ColumnarBatch::create(*sc, {"city", "id"}, batch));
+    // key column first
+    ASSERT_EQ(2U, batch->num_columns());
+    EXPECT_EQ("id", batch->column_schema(0)->name);
+    EXPECT_EQ("city", batch->column_schema(1)->name);
+    EXPECT_EQ(0U, batch->row_size());
+}
+
+TEST(ColumnarBatch, append) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int32 uv,int8 city null,string ss null", sc));
+    unique_ptr<ColumnarBatch> batch;
+    ASSERT_TRUE(ColumnarBatch::create(*sc, {"id", "uv", "city", "ss"}, batch));
+    srand(1);
+    const size_t N = 1000;
+    vector<int32_t> ids(N);
+    vector<int32_t> uvs(N);
+    vector<int8_t> cities(N);
+    vector<string> strs(N);
+    vector<Slice> ss(N);
+    vector<uint8_t> city_nulls(BitmapSize64(N), 0);
+    vector<uint8_t> ss_nulls(BitmapSize64(N), 0);
+    for (size_t i = 0; i < N; i++) {
+        ids[i] = i;
+        uvs[i] = rand() % 10000;
+        cities[i] = rand() % 100;
+        strs[i] = Format("ss%zu", i * 7);
+        ss[i] = Slice(strs[i]);
+        if (i % 3 == 0) {
+            BitmapSet(city_nulls.data(), i);
+        }
+        if (i % 11 == 0) {
+            BitmapSet(ss_nulls.data(), i);
+        }
+    }
+    // first part has no null, second part starts at unaligned row
+    const size_t n1 = 300;
+    ASSERT_TRUE(batch->append(n1, {&ids[0], &uvs[0], &cities[0], &ss[0]}, {}));
+    size_t n2 = N - n1;
+    vector<uint8_t> cn(BitmapSize64(n2), 0);
+    vector<uint8_t> sn(BitmapSize64(n2), 0);
+    BitmapCopy(cn.data(), 0, city_nulls.data(), n1, n2);
+    BitmapCopy(sn.data(), 0, ss_nulls.data(), n1, n2);
+    ASSERT_TRUE(batch->append(n2, {&ids[n1], &uvs[n1], &cities[n1], &ss[n1]},
+                              {nullptr, nullptr, cn.data(), sn.data()}));
+    ASSERT_EQ(N, batch->row_size());
+    EXPECT_TRUE(batch->column_nulls(0) == nullptr);
+    EXPECT_TRUE(batch->column_nulls(1) == nullptr);
+    ASSERT_TRUE(batch->column_nulls(2) != nullptr);
+    const int32_t* bids = (const int32_t*)batch->column_data(0);
+    const int32_t* buvs = (const int32_t*)batch->column_data(1);
+    const int8_t* bcities = (const int8_t*)batch->column_data(2);
+    for (size_t i = 0; i < N; i++) {
+        ASSERT_EQ(ids[i], bids[i]);
+        ASSERT_EQ(uvs[i], buvs[i]);
+        bool city_null = i >= n1 && BitmapTest(city_nulls.data(), i);
+        ASSERT_EQ(city_null, batch->is_null(2, i));
+        ASSERT_EQ(cities[i], bcities[i]);
+        bool ss_null = i >= n1 && BitmapTest(ss_nulls.data(), i);
+        ASSERT_EQ(ss_null, batch->is_null(3, i));
+        if (!ss_null) {
+            ASSERT_EQ(ss[i], batch->get_string(3, i));
+        } else {
+            ASSERT_EQ(0U, batch->get_string(3, i).size());
+        }
+    }
+    // rejected appends leave batch unchanged
+    vector<uint8_t> key_nulls(BitmapSize64(N), 0xff);
+    EXPECT_FALSE(batch->append(N, {&ids[0], &uvs[0], &cities[0], &ss[0]},
+                               {key_nulls.data(), nullptr, nullptr, nullptr}));
+    EXPECT_FALSE(batch->append(N, {&ids[0], &uvs[0]}, {}));
+    EXPECT_EQ(N, batch->row_size());
+}
+
+} /* namespace choco */
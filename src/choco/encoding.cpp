@@ -0,0 +1,463 @@
+#include "encoding.h"
+#include "bitmap.h"
+
+namespace choco {
+
+template <class DT, class ST>
+static void ConvertInt(void* __restrict dst, const void* __restrict src, size_t n) {
+    DT* d = (DT*)dst;
+    const ST* s = (const ST*)src;
+    for (size_t i = 0; i < n; i++) {
+        d[i] = (DT)s[i];
+    }
+}
+
+template <class DT>
+static void ConvertIntTo(void* dst, const void* src, size_t src_esize, size_t n) {
+    switch (src_esize) {
+    case 1:
+        ConvertInt<DT, int8_t>(dst, src, n);
+        break;
+    case 2:
+        ConvertInt<DT, int16_t>(dst, src, n);
+        break;
+    case 4:
+        ConvertInt<DT, int32_t>(dst, src, n);
+        break;
+    default:
+        ConvertInt<DT, int64_t>(dst, src, n);
+        break;
+    }
+}
+
+void ConvertIntWidth(void* dst, size_t dst_esize, const void* src, size_t src_esize, size_t n) {
+    if (dst_esize == src_esize) {
+        memcpy(dst, src, n * dst_esize);
+        return;
+    }
+    switch (dst_esize) {
+    case 1:
+        ConvertIntTo<int8_t>(dst, src, src_esize, n);
+        break;
+    case 2:
+        ConvertIntTo<int16_t>(dst, src, src_esize, n);
+        break;
+    case 4:
+        ConvertIntTo<int32_t>(dst, src, src_esize, n);
+        break;
+    default:
+        ConvertIntTo<int64_t>(dst, src, src_esize, n);
+        break;
+    }
+}
+
+template <class T>
+static void FilterIntRangeT(const T* __restrict data, size_t n, int64_t lo, int64_t hi,
+                            uint8_t* __restrict selection) {
+    // v in [lo, hi] as a single unsigned compare, 64 rows per selection word
+    uint64_t ulo = (uint64_t)lo;
+    uint64_t range = (uint64_t)hi - ulo;
+    uint64_t* words = (uint64_t*)selection;
+    for (size_t start = 0; start < n; start += 64) {
+        size_t cnt = std::min((size_t)64, n - start);
+        uint64_t keep = 0;
+        for (size_t i = 0; i < cnt; i++) {
+            keep |= (uint64_t)((uint64_t)(int64_t)data[start + i] - ulo <= range) << i;
+        }
+        if (cnt < 64) {
+            keep |= ~(uint64_t)0 << cnt;
+        }
+        words[start / 64] &= keep;
+    }
+}
+
+void FilterIntRange(const void* data, size_t esize, size_t n, int64_t lo, int64_t hi, uint8_t* selection) {
+    if (lo > hi) {
+        BitmapChangeBits(selection, 0, n, false);
+        return;
+    }
+    switch (esize) {
+    case 1:
+        FilterIntRangeT((const int8_t*)data, n, lo, hi, selection);
+        break;
+    case 2:
+        FilterIntRangeT((const int16_t*)data, n, lo, hi, selection);
+        break;
+    case 4:
+        FilterIntRangeT((const int32_t*)data, n, lo, hi, selection);
+        break;
+    default:
+        FilterIntRangeT((const int64_t*)data, n, lo, hi, selection);
+        break;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// number of bits needed to store range (max - min) of residuals
+static uint32_t RangeBits(__int128 min, __int128 max) {
+    unsigned __int128 range = (unsigned __int128)(max - min);
+    if (range >> 64) {
+        return 65;
+    }
+    uint64_t r = (uint64_t)range;
+    return r == 0 ? 0 : 64 - __builtin_clzll(r);
+}
+
+void ForEncoding::analyze(const void* data, size_t esize, size_t n) {
+    base = 0;
+    step = 0;
+    bits = 64;
+    if (n == 0) {
+        return;
+    }
+    int64_t first = ReadIntN(data, esize, 0);
+    int64_t last = ReadIntN(data, esize, n - 1);
+    // try plain FOR and FOR on residuals of the line through first and last
+    int64_t steps[2] = {0, n > 1 ? (int64_t)(((__int128)last - first) / (__int128)(n - 1)) : 0};
+    for (int64_t s : steps) {
+        __int128 min = first;
+        __int128 max = first;
+        for (size_t i = 1; i < n; i++) {
+            __int128 r = (__int128)ReadIntN(data, esize, i) - (__int128)s * i;
+            min = std::min(min, r);
+            max = std::max(max, r);
+        }
+        uint32_t b = RangeBits(min, max);
+        if (b < bits) {
+            bits = b;
+            step = s;
+            base = (int64_t)(uint64_t)(unsigned __int128)min;
+        }
+    }
+}
+
+void ForEncoding::encode(const void* data, size_t esize, size_t n, uint8_t* dst) const {
+    if (bits == 0) {
+        return;
+    }
+    uint64_t* words = (uint64_t*)dst;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v = (uint64_t)ReadIntN(data, esize, i) - (uint64_t)base - (uint64_t)step * i;
+        size_t bitpos = i * bits;
+        size_t w = bitpos >> 6;
+        size_t off = bitpos & 63;
+        words[w] |= v << off;
+        if (off + bits > 64) {
+            words[w + 1] |= v >> (64 - off);
+        }
+    }
+}
+
+template <class DT>
+static void ForDecode(const ForEncoding& e, const uint8_t* packed, size_t start, size_t n, DT* __restrict dst) {
+    if (e.bits == 0) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = (DT)((uint64_t)e.base + (uint64_t)e.step * (start + i));
+        }
+        return;
+    }
+    // branch free unpack, simple enough for the compiler to vectorize
+    const uint64_t* __restrict words = (const uint64_t*)packed;
+    const uint64_t mask = e.mask();
+    const uint32_t bits = e.bits;
+    for (size_t i = 0; i < n; i++) {
+        size_t bitpos = (start + i) * bits;
+        size_t w = bitpos >> 6;
+        size_t off = bitpos & 63;
+        uint64_t v = ((words[w] >> off) | ((words[w+1] << 1) << (63 - off))) & mask;
+        dst[i] = (DT)((uint64_t)e.base + (uint64_t)e.step * (start + i) + v);
+    }
+}
+
+void ForEncoding::decode(const uint8_t* packed, size_t start, size_t n, void* dst, size_t dst_esize) const {
+    switch (dst_esize) {
+    case 1:
+        ForDecode(*this, packed, start, n, (int8_t*)dst);
+        break;
+    case 2:
+        ForDecode(*this, packed, start, n, (int16_t*)dst);
+        break;
+    case 4:
+        ForDecode(*this, packed, start, n, (int32_t*)dst);
+        break;
+    default:
+        ForDecode(*this, packed, start, n, (int64_t*)dst);
+        break;
+    }
+}
+
+void ForEncoding::filter_range(const uint8_t* packed, size_t n, int64_t lo, int64_t hi, uint8_t* selection) const {
+    if (step != 0) {
+        for (size_t i = 0; i < n; i++) {
+            int64_t v = get(packed, i);
+            if (v < lo || v > hi) {
+                BitmapClear(selection, i);
+            }
+        }
+        return;
+    }
+    // values are in [base, base + mask], map [lo, hi] to packed domain
+    __int128 plo = std::max((__int128)lo - base, (__int128)0);
+    __int128 phi = std::min((__int128)hi - base, (__int128)mask());
+    if (plo > phi) {
+        for (size_t i = 0; i < n; i++) {
+            BitmapClear(selection, i);
+        }
+        return;
+    }
+    uint64_t ulo = (uint64_t)plo;
+    uint64_t uhi = (uint64_t)phi;
+    if (ulo == 0 && uhi == mask()) {
+        return;
+    }
+    const uint64_t* words = (const uint64_t*)packed;
+    const uint64_t m = mask();
+    for (size_t i = 0; i < n; i++) {
+        size_t bitpos = i * bits;
+        size_t w = bitpos >> 6;
+        size_t off = bitpos & 63;
+        uint64_t v = ((words[w] >> off) | ((words[w+1] << 1) << (63 - off))) & m;
+        // single unsigned compare for v in [ulo, uhi]
+        if (v - ulo > uhi - ulo) {
+            BitmapClear(selection, i);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <class T>
+struct AlpConstants {
+};
+
+template <>
+struct AlpConstants<double> {
+    static const int kMaxExponent = 18;
+    static const double F10[kMaxExponent + 1];
+    static const double IF10[kMaxExponent + 1];
+};
+
+const double AlpConstants<double>::F10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+const double AlpConstants<double>::IF10[] = {
+    1e0, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9,
+    1e-10, 1e-11, 1e-12, 1e-13, 1e-14, 1e-15, 1e-16, 1e-17, 1e-18
+};
+
+template <>
+struct AlpConstants<float> {
+    static const int kMaxExponent = 10;
+    static const float F10[kMaxExponent + 1];
+    static const float IF10[kMaxExponent + 1];
+};
+
+const float AlpConstants<float>::F10[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+const float AlpConstants<float>::IF10[] = {
+    1e0f, 1e-1f, 1e-2f, 1e-3f, 1e-4f, 1e-5f, 1e-6f, 1e-7f, 1e-8f, 1e-9f, 1e-10f
+};
+
+static const size_t kAlpSampleSize = 1024;
+static const size_t kAlpChunkSize = 1024;
+
+// division (instead of multiplying by 10^-e) is correctly rounded, so
+// decimals like 12.3 parsed from text decode to the same bits
+template <class T>
+static inline T AlpDecodeValue(int64_t d, int e, int f) {
+    typedef AlpConstants<T> C;
+    return (T)d * C::F10[f] / C::F10[e];
+}
+
+// return false if v can't be encoded losslessly with exponent e and factor f
+template <class T>
+static inline bool AlpEncodeValue(T v, int e, int f, int64_t& d) {
+    typedef AlpConstants<T> C;
+    T x = v * C::F10[e] * C::IF10[f];
+    // also rejects NaN and inf
+    if (!(x > (T)-4e18 && x < (T)4e18)) {
+        return false;
+    }
+    d = (int64_t)(x + (x >= 0 ? (T)0.5 : (T)-0.5));
+    T back = AlpDecodeValue<T>(d, e, f);
+    return memcmp(&back, &v, sizeof(T)) == 0;
+}
+
+template <class T>
+bool AlpEncoding::analyze(const T* values, size_t n) {
+    typedef AlpConstants<T> C;
+    DCHECK_LE(n, 65536);
+    num_exceptions = 0;
+    packed_size = 0;
+    if (n == 0) {
+        return false;
+    }
+    // choose exponent/factor with minimal estimated size on a sample,
+    // sample positions are pseudo random to avoid aliasing with periodic data
+    size_t nsample = std::min(n, kAlpSampleSize);
+    vector<T> sample(nsample);
+    for (size_t i = 0; i < nsample; i++) {
+        sample[i] = values[nsample == n ? i : HashCode(i) % n];
+    }
+    size_t best_cost = (size_t)-1;
+    for (int e = C::kMaxExponent; e >= 0; e--) {
+        for (int f = 0; f <= e; f++) {
+            int64_t min = std::numeric_limits<int64_t>::max();
+            int64_t max = std::numeric_limits<int64_t>::min();
+            size_t nexception = 0;
+            for (size_t i = 0; i < nsample; i++) {
+                int64_t d;
+                if (AlpEncodeValue(sample[i], e, f, d)) {
+                    min = std::min(min, d);
+                    max = std::max(max, d);
+                } else {
+                    nexception++;
+                }
+            }
+            size_t bits = min > max ? 0 : (size_t)(64 - __builtin_clzll((uint64_t)(max - min) | 1));
+            size_t cost = nsample * bits + nexception * (16 + sizeof(T) * 8);
+            if (cost < best_cost) {
+                best_cost = cost;
+                exponent = e;
+                factor = f;
+            }
+        }
+    }
+    if (best_cost >= nsample * sizeof(T) * 8) {
+        return false;
+    }
+    // encode all values, exceptions use first encodable digit to keep range small
+    vector<int64_t> ds(n);
+    int64_t fill = 0;
+    bool has_fill = false;
+    for (size_t i = 0; i < n; i++) {
+        if (AlpEncodeValue(values[i], exponent, factor, ds[i])) {
+            if (!has_fill) {
+                fill = ds[i];
+                has_fill = true;
+            }
+        } else {
+            ds[i] = INT64_MIN;
+            num_exceptions++;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (ds[i] == INT64_MIN) {
+            ds[i] = fill;
+        }
+    }
+    digits.analyze(ds.data(), sizeof(int64_t), n);
+    exceptions_offset = digits.packed_size(n);
+    packed_size = exceptions_offset + Padding(num_exceptions * sizeof(uint16_t), 8) + num_exceptions * sizeof(T);
+    return packed_size < n * sizeof(T);
+}
+
+template <class T>
+void AlpEncoding::encode(const T* values, size_t n, uint8_t* dst) const {
+    vector<int64_t> ds(n);
+    uint16_t* poses = (uint16_t*)(dst + exceptions_offset);
+    T* exceptions = (T*)(dst + exceptions_offset + Padding(num_exceptions * sizeof(uint16_t), 8));
+    uint32_t nexception = 0;
+    int64_t fill = 0;
+    bool has_fill = false;
+    for (size_t i = 0; i < n; i++) {
+        if (AlpEncodeValue(values[i], exponent, factor, ds[i])) {
+            if (!has_fill) {
+                fill = ds[i];
+                has_fill = true;
+            }
+        } else {
+            poses[nexception] = (uint16_t)i;
+            exceptions[nexception] = values[i];
+            nexception++;
+            ds[i] = INT64_MIN;
+        }
+    }
+    DCHECK_EQ(nexception, num_exceptions);
+    for (uint32_t i = 0; i < nexception; i++) {
+        ds[poses[i]] = fill;
+    }
+    digits.encode(ds.data(), sizeof(int64_t), n, dst);
+}
+
+template <class T>
+T AlpEncoding::get(const uint8_t* packed, size_t idx) const {
+    if (num_exceptions > 0) {
+        const uint16_t* poses = (const uint16_t*)(packed + exceptions_offset);
+        const uint16_t* end = poses + num_exceptions;
+        const uint16_t* p = std::lower_bound(poses, end, (uint16_t)idx);
+        if (p != end && *p == idx) {
+            const T* exceptions = (const T*)(packed + exceptions_offset + Padding(num_exceptions * sizeof(uint16_t), 8));
+            return exceptions[p - poses];
+        }
+    }
+    return AlpDecodeValue<T>(digits.get(packed, idx), exponent, factor);
+}
+
+template <class T>
+void AlpEncoding::decode(const uint8_t* packed, size_t n, T* __restrict dst) const {
+    int64_t ds[kAlpChunkSize];
+    for (size_t start = 0; start < n; start += kAlpChunkSize) {
+        size_t cnt = std::min(kAlpChunkSize, n - start);
+        digits.decode(packed, start, cnt, ds, sizeof(int64_t));
+        for (size_t i = 0; i < cnt; i++) {
+            dst[start + i] = AlpDecodeValue<T>(ds[i], exponent, factor);
+        }
+    }
+    const uint16_t* poses = (const uint16_t*)(packed + exceptions_offset);
+    const T* exceptions = (const T*)(packed + exceptions_offset + Padding(num_exceptions * sizeof(uint16_t), 8));
+    for (uint32_t i = 0; i < num_exceptions && poses[i] < n; i++) {
+        dst[poses[i]] = exceptions[i];
+    }
+}
+
+template <class T>
+void AlpEncoding::aggregate(const uint8_t* packed, size_t n, const uint8_t* nulls, const uint8_t* selection,
+                            FloatAggregate& agg) const {
+    T vs[kAlpChunkSize];
+    int64_t ds[kAlpChunkSize];
+    const uint16_t* poses = (const uint16_t*)(packed + exceptions_offset);
+    const T* exceptions = (const T*)(packed + exceptions_offset + Padding(num_exceptions * sizeof(uint16_t), 8));
+    uint32_t ei = 0;
+    for (size_t start = 0; start < n; start += kAlpChunkSize) {
+        size_t cnt = std::min(kAlpChunkSize, n - start);
+        digits.decode(packed, start, cnt, ds, sizeof(int64_t));
+        for (size_t i = 0; i < cnt; i++) {
+            vs[i] = AlpDecodeValue<T>(ds[i], exponent, factor);
+        }
+        for (; ei < num_exceptions && poses[ei] < start + cnt; ei++) {
+            vs[poses[ei] - start] = exceptions[ei];
+        }
+        for (size_t i = 0; i < cnt; i++) {
+            if ((nulls && BitmapTest(nulls, start + i)) ||
+                (selection && !BitmapTest(selection, start + i))) {
+                continue;
+            }
+            double v = vs[i];
+            agg.count++;
+            agg.sum += v;
+            agg.min = std::min(agg.min, v);
+            agg.max = std::max(agg.max, v);
+        }
+    }
+}
+
+template bool AlpEncoding::analyze<float>(const float* values, size_t n);
+template bool AlpEncoding::analyze<double>(const double* values, size_t n);
+template void AlpEncoding::encode<float>(const float* values, size_t n, uint8_t* dst) const;
+template void AlpEncoding::encode<double>(const double* values, size_t n, uint8_t* dst) const;
+template float AlpEncoding::get<float>(const uint8_t* packed, size_t idx) const;
+template double AlpEncoding::get<double>(const uint8_t* packed, size_t idx) const;
+template void AlpEncoding::decode<float>(const uint8_t* packed, size_t n, float* dst) const;
+template void AlpEncoding::decode<double>(const uint8_t* packed, size_t n, double* dst) const;
+template void AlpEncoding::aggregate<float>(const uint8_t* packed, size_t n, const uint8_t* nulls,
+                                         const uint8_t* selection, FloatAggregate& agg) const;
+template void AlpEncoding::aggregate<double>(const uint8_t* packed, size_t n, const uint8_t* nulls,
+                                         const uint8_t* selection, FloatAggregate& agg) const;
+
+} /* namespace choco */
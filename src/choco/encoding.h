@@ -0,0 +1,203 @@
+#ifndef CHOCO_ENCODING_H_
+#define CHOCO_ENCODING_H_
+
+#include <limits>
+#include <type_traits>
+#include "common.h"
+
+namespace choco {
+
+/**
+ * Integer column types which can use adaptive (narrower) storage width:
+ * int16/int32/int64 values are stored as int8/int16/int32 when they fit
+ */
+template <class T>
+struct AdaptiveStorage {
+    static const bool value = std::is_integral<T>::value && std::is_signed<T>::value &&
+            sizeof(T) > 1 && sizeof(T) <= 8;
+};
+
+// minimum byte width(1/2/4/8) needed to store a signed integer
+inline size_t IntStorageSize(int64_t v) {
+    if (v == (int8_t)v) {
+        return 1;
+    } else if (v == (int16_t)v) {
+        return 2;
+    } else if (v == (int32_t)v) {
+        return 4;
+    }
+    return 8;
+}
+
+// read idx-th value of a signed integer array with byte width esize
+inline int64_t ReadIntN(const void* data, size_t esize, size_t idx) {
+    switch (esize) {
+    case 1:
+        return ((const int8_t*)data)[idx];
+    case 2:
+        return ((const int16_t*)data)[idx];
+    case 4:
+        return ((const int32_t*)data)[idx];
+    default:
+        return ((const int64_t*)data)[idx];
+    }
+}
+
+// write idx-th value of a signed integer array with byte width esize,
+// caller should make sure the value fits
+inline void WriteIntN(void* data, size_t esize, size_t idx, int64_t v) {
+    switch (esize) {
+    case 1:
+        ((int8_t*)data)[idx] = (int8_t)v;
+        break;
+    case 2:
+        ((int16_t*)data)[idx] = (int16_t)v;
+        break;
+    case 4:
+        ((int32_t*)data)[idx] = (int32_t)v;
+        break;
+    default:
+        ((int64_t*)data)[idx] = v;
+        break;
+    }
+}
+
+/**
+ * Convert n signed integers from byte width src_esize to dst_esize,
+ * sign-extending when widening. Loops are simple enough for the
+ * compiler to vectorize.
+ */
+void ConvertIntWidth(void* dst, size_t dst_esize, const void* src, size_t src_esize, size_t n);
+
+/**
+ * clear bits of rows whose value is not in [lo, hi] in selection bitmap
+ * (allocated with BitmapSize64(n) bytes), for n signed integers with byte
+ * width esize
+ */
+void FilterIntRange(const void* data, size_t esize, size_t n, int64_t lo, int64_t hi, uint8_t* selection);
+
+/**
+ * Frame-of-reference + bit-packing of signed integers:
+ *
+ *   v[i] = base + step * i + packed[i]
+ *
+ * packed values are unsigned, `bits` wide, stored LSB first in 64-bit
+ * words. step is 0 for plain FOR, or the average slope of the values for
+ * monotonic columns like auto-increment ids and timestamps, which works
+ * like delta encoding but keeps O(1) random access. All arithmetic is
+ * modulo 2^64, so any int64 values round trip.
+ */
+struct ForEncoding {
+    int64_t base = 0;
+    int64_t step = 0;
+    uint32_t bits = 64;
+
+    /**
+     * choose parameters with minimal bits for n values stored in
+     * byte width esize
+     */
+    void analyze(const void* data, size_t esize, size_t n);
+
+    // bytes needed to pack n values, padded so get can always read 2 words
+    size_t packed_size(size_t n) const {
+        return (n * bits / 64 + 2) * sizeof(uint64_t);
+    }
+
+    // pack n values, dst should be zeroed and have packed_size(n) bytes
+    void encode(const void* data, size_t esize, size_t n, uint8_t* dst) const;
+
+    int64_t get(const uint8_t* packed, size_t idx) const {
+        const uint64_t* words = (const uint64_t*)packed;
+        size_t bitpos = idx * bits;
+        size_t w = bitpos >> 6;
+        size_t off = bitpos & 63;
+        // padding word makes reading words[w+1] always safe
+        uint64_t v = (words[w] >> off) | ((words[w+1] << 1) << (63 - off));
+        return (int64_t)((uint64_t)base + (uint64_t)step * idx + (v & mask()));
+    }
+
+    /**
+     * unpack n values starting from idx start, into dst as signed integers
+     * with byte width dst_esize
+     */
+    void decode(const uint8_t* packed, size_t start, size_t n, void* dst, size_t dst_esize) const;
+
+    void decode(const uint8_t* packed, size_t n, void* dst, size_t dst_esize) const {
+        decode(packed, 0, n, dst, dst_esize);
+    }
+
+    /**
+     * clear bits of rows whose value is not in [lo, hi] in selection
+     * bitmap, for plain FOR the comparison runs on packed values without
+     * decoding
+     */
+    void filter_range(const uint8_t* packed, size_t n, int64_t lo, int64_t hi, uint8_t* selection) const;
+
+    uint64_t mask() const {
+        return bits == 64 ? ~(uint64_t)0 : (((uint64_t)1 << bits) - 1);
+    }
+};
+
+/**
+ * sum/min/max/count of non-null values, computed while decoding
+ */
+struct FloatAggregate {
+    size_t count = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+};
+
+/**
+ * ALP style encoding of float/double values (Adaptive Lossless floating
+ * Point): values which are decimals with few digits are stored as
+ *
+ *   v[i] = digits[i] * 10^factor / 10^exponent
+ *
+ * with digits compressed by ForEncoding, values which don't round trip
+ * bitwise (NaN, -0.0, high precision) are stored raw as exceptions.
+ *
+ * Packed data layout:
+ *   digits packed by ForEncoding
+ *   exception positions, uint16_t[num_exceptions], padded to 8 bytes
+ *   exception values, T[num_exceptions]
+ * so pages(up to 65536 values) can be encoded.
+ */
+struct AlpEncoding {
+    uint8_t exponent = 0;
+    uint8_t factor = 0;
+    uint32_t num_exceptions = 0;
+    size_t exceptions_offset = 0;
+    size_t packed_size = 0;
+    ForEncoding digits;
+
+    /**
+     * choose exponent/factor with a sample of the values, then compute
+     * digit encoding and exceptions of all n values, return false if
+     * packed size is not smaller than raw size
+     */
+    template <class T>
+    bool analyze(const T* values, size_t n);
+
+    // pack n values, dst should be zeroed and have packed_size bytes
+    template <class T>
+    void encode(const T* values, size_t n, uint8_t* dst) const;
+
+    template <class T>
+    T get(const uint8_t* packed, size_t idx) const;
+
+    template <class T>
+    void decode(const uint8_t* packed, size_t n, T* dst) const;
+
+    /**
+     * aggregate n values without materializing them, rows set in nulls
+     * or not set in selection(both may be nullptr) are skipped
+     */
+    template <class T>
+    void aggregate(const uint8_t* packed, size_t n, const uint8_t* nulls, const uint8_t* selection,
+                   FloatAggregate& agg) const;
+};
+
+} /* namespace choco */
+
+#endif /* CHOCO_ENCODING_H_ */
@@ -0,0 +1,159 @@
+#include "gtest/gtest.h"
+#include "encoding.h"
+#include "bitmap.h"
+
+namespace choco {
+
+static void CheckRoundTrip(const vector<int64_t>& values, uint32_t expect_bits) {
+    size_t n = values.size();
+    ForEncoding e;
+    e.analyze(values.data(), sizeof(int64_t), n);
+    EXPECT_EQ(e.bits, expect_bits);
+    vector<uint8_t> packed(e.packed_size(n), 0);
+    e.encode(values.data(), sizeof(int64_t), n, packed.data());
+    vector<int64_t> decoded(n);
+    e.decode(packed.data(), n, decoded.data(), sizeof(int64_t));
+    for (size_t i=0;i<n;i++) {
+        EXPECT_EQ(e.get(packed.data(), i), values[i]);
+        EXPECT_EQ(decoded[i], values[i]);
+    }
+}
+
+TEST(Encoding, for_bitpacking) {
+    const size_t N = 10000;
+    vector<int64_t> values(N);
+    // constant
+    for (size_t i=0;i<N;i++) {
+        values[i] = -12345;
+    }
+    CheckRoundTrip(values, 0);
+    // small range around a large base
+    for (size_t i=0;i<N;i++) {
+        values[i] = (1LL << 50) + (int64_t)((i * 7919) % 1000);
+    }
+    CheckRoundTrip(values, 10);
+    // auto-increment ids
+    for (size_t i=0;i<N;i++) {
+        values[i] = 1000000 + i;
+    }
+    CheckRoundTrip(values, 0);
+    // timestamps with jitter
+    for (size_t i=0;i<N;i++) {
+        values[i] = 1600000000000LL + i * 1000 + (i * 31) % 17;
+    }
+    CheckRoundTrip(values, 5);
+    // full int64 range
+    values[0] = INT64_MIN;
+    values[1] = INT64_MAX;
+    CheckRoundTrip(values, 64);
+}
+
+TEST(Encoding, filter_range) {
+    const size_t N = 1000;
+    vector<int32_t> values(N);
+    for (size_t i=0;i<N;i++) {
+        values[i] = 500 + (int32_t)((i * 37) % 200);
+    }
+    ForEncoding e;
+    e.analyze(values.data(), sizeof(int32_t), N);
+    EXPECT_EQ(e.step, 0);
+    vector<uint8_t> packed(e.packed_size(N), 0);
+    e.encode(values.data(), sizeof(int32_t), N, packed.data());
+    int64_t ranges[][2] = {{550, 600}, {0, 510}, {0, 100}, {690, 10000}, {0, 10000}};
+    for (auto& r : ranges) {
+        vector<uint8_t> selection(BitmapSize64(N), 0xff);
+        e.filter_range(packed.data(), N, r[0], r[1], selection.data());
+        for (size_t i=0;i<N;i++) {
+            EXPECT_EQ(BitmapTest(selection.data(), i), values[i] >= r[0] && values[i] <= r[1]);
+        }
+        // same on unpacked values
+        selection.assign(BitmapSize64(N), 0xff);
+        FilterIntRange(values.data(), sizeof(int32_t), N, r[0], r[1], selection.data());
+        for (size_t i=0;i<N;i++) {
+            EXPECT_EQ(BitmapTest(selection.data(), i), values[i] >= r[0] && values[i] <= r[1]);
+        }
+    }
+}
+
+template <class T>
+static void CheckAlp(const vector<T>& values, bool expect_packed) {
+    size_t n = values.size();
+    AlpEncoding e;
+    ASSERT_EQ(e.analyze(values.data(), n), expect_packed);
+    if (!expect_packed) {
+        return;
+    }
+    EXPECT_LT(e.packed_size, n * sizeof(T) / 2);
+    vector<uint8_t> packed(e.packed_size, 0);
+    e.encode(values.data(), n, packed.data());
+    vector<T> decoded(n);
+    e.decode(packed.data(), n, decoded.data());
+    FloatAggregate expect;
+    FloatAggregate expect_selected;
+    for (size_t i=0;i<n;i++) {
+        T v = e.template get<T>(packed.data(), i);
+        EXPECT_EQ(memcmp(&v, &values[i], sizeof(T)), 0);
+        EXPECT_EQ(memcmp(&decoded[i], &values[i], sizeof(T)), 0);
+        if (i % 3 != 0) {
+            expect.count++;
+            expect.sum += values[i];
+            expect.min = std::min(expect.min, (double)values[i]);
+            expect.max = std::max(expect.max, (double)values[i]);
+            if (i % 2 == 0) {
+                expect_selected.count++;
+                expect_selected.sum += values[i];
+                expect_selected.min = std::min(expect_selected.min, (double)values[i]);
+                expect_selected.max = std::max(expect_selected.max, (double)values[i]);
+            }
+        }
+    }
+    // skip every 3rd row as null
+    vector<uint8_t> nulls(BitmapSize64(n), 0);
+    for (size_t i=0;i<n;i+=3) {
+        BitmapSet(nulls.data(), i);
+    }
+    FloatAggregate agg;
+    e.template aggregate<T>(packed.data(), n, nulls.data(), nullptr, agg);
+    EXPECT_EQ(agg.count, expect.count);
+    EXPECT_EQ(agg.sum, expect.sum);
+    EXPECT_EQ(agg.min, expect.min);
+    EXPECT_EQ(agg.max, expect.max);
+    // select even rows
+    vector<uint8_t> selection(BitmapSize64(n), 0);
+    for (size_t i=0;i<n;i+=2) {
+        BitmapSet(selection.data(), i);
+    }
+    FloatAggregate sagg;
+    e.template aggregate<T>(packed.data(), n, nulls.data(), selection.data(), sagg);
+    EXPECT_EQ(sagg.count, expect_selected.count);
+    EXPECT_EQ(sagg.sum, expect_selected.sum);
+    EXPECT_EQ(sagg.min, expect_selected.min);
+    EXPECT_EQ(sagg.max, expect_selected.max);
+}
+
+TEST(Encoding, alp) {
+    const size_t N = 65536;
+    vector<double> dvalues(N);
+    vector<float> fvalues(N);
+    for (size_t i=0;i<N;i++) {
+        // metrics with 2 decimal digits
+        dvalues[i] = (double)((i * 7919) % 100000) / 100;
+        fvalues[i] = (float)((i * 7919) % 10000) / 10;
+    }
+    // exceptions
+    dvalues[6] = std::numeric_limits<double>::quiet_NaN();
+    dvalues[100] = -0.0;
+    dvalues[N-1] = 3.141592653589793;
+    fvalues[7] = std::numeric_limits<float>::infinity();
+    fvalues[N-1] = 2.7182817f;
+    CheckAlp(dvalues, true);
+    CheckAlp(fvalues, true);
+    // random doubles are not compressible
+    for (size_t i=0;i<N;i++) {
+        uint64_t bits = HashCode(i) | 0x3ff0000000000000ULL;
+        memcpy(&dvalues[i], &bits, sizeof(double));
+    }
+    CheckAlp(dvalues, false);
+}
+
+}
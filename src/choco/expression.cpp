@@ -0,0 +1,738 @@
+#include <cmath>
+#include <type_traits>
+#include "expression.h"
+#include "schema.h"
+#include "simd.h"
+
+namespace choco {
+
+//////////////////////////////////////////////////////////////////////////////
+// typed kernels
+
+template <template <class> class F, class... Args>
+static void DispatchNumeric(Type type, Args&&... args) {
+    switch (type) {
+    case Int8:
+        F<int8_t>::run(std::forward<Args>(args)...);
+        break;
+    case Int16:
+        F<int16_t>::run(std::forward<Args>(args)...);
+        break;
+    case Int32:
+        F<int32_t>::run(std::forward<Args>(args)...);
+        break;
+    case Int64:
+        F<int64_t>::run(std::forward<Args>(args)...);
+        break;
+    case Int128:
+        F<int128_t>::run(std::forward<Args>(args)...);
+        break;
+    case Float32:
+        F<float>::run(std::forward<Args>(args)...);
+        break;
+    case Float64:
+        F<double>::run(std::forward<Args>(args)...);
+        break;
+    default:
+        LOG(FATAL) << Format("expression doesn't support type %d", (int)type);
+    }
+}
+
+struct AddOp {
+    template <class T> static T apply(T a, T b) { return (T)(a + b); }
+};
+
+struct SubOp {
+    template <class T> static T apply(T a, T b) { return (T)(a - b); }
+};
+
+struct MulOp {
+    template <class T> static T apply(T a, T b) { return (T)(a * b); }
+};
+
+struct EQOp {
+    template <class T> static bool apply(T a, T b) { return a == b; }
+};
+
+struct NEOp {
+    template <class T> static bool apply(T a, T b) { return a != b; }
+};
+
+struct LTOp {
+    template <class T> static bool apply(T a, T b) { return a < b; }
+};
+
+struct LEOp {
+    template <class T> static bool apply(T a, T b) { return a <= b; }
+};
+
+struct GTOp {
+    template <class T> static bool apply(T a, T b) { return a > b; }
+};
+
+struct GEOp {
+    template <class T> static bool apply(T a, T b) { return a >= b; }
+};
+
+template <class Op>
+struct ArithKernel {
+    template <class T>
+    struct F {
+        static void run(const void* lhs, const void* rhs, void* dst, size_t n) {
+            const T* l = (const T*)lhs;
+            const T* r = (const T*)rhs;
+            T* out = (T*)dst;
+            for (size_t i = 0; i < n; i++) {
+                out[i] = Op::apply(l[i], r[i]);
+            }
+        }
+    };
+};
+
+template <class Op>
+struct CompareKernel {
+    template <class T>
+    struct F {
+        static void run(const void* lhs, const void* rhs, void* dst, size_t n) {
+            const T* l = (const T*)lhs;
+            const T* r = (const T*)rhs;
+            int8_t* out = (int8_t*)dst;
+            for (size_t i = 0; i < n; i++) {
+                out[i] = Op::apply(l[i], r[i]);
+            }
+        }
+    };
+};
+
+// integer division and modulo by zero are null, float follows IEEE
+template <class T, bool IsFloat = std::is_floating_point<T>::value>
+struct DivLoop {
+    static void run(const T* l, const T* r, T* out, uint8_t* nulls, size_t n, bool mod) {
+        for (size_t i = 0; i < n; i++) {
+            if (r[i] == 0) {
+                out[i] = 0;
+                BitmapSet(nulls, i);
+            } else if (r[i] == -1) {
+                // avoid overflow trap of MIN / -1
+                out[i] = mod ? 0 : (T)(0 - l[i]);
+            } else {
+                out[i] = mod ? (T)(l[i] % r[i]) : (T)(l[i] / r[i]);
+            }
+        }
+    }
+};
+
+template <class T>
+struct DivLoop<T, true> {
+    static void run(const T* l, const T* r, T* out, uint8_t* nulls, size_t n, bool mod) {
+        if (mod) {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = std::fmod(l[i], r[i]);
+            }
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = l[i] / r[i];
+            }
+        }
+    }
+};
+
+template <class T>
+struct DivKernel {
+    static void run(const void* lhs, const void* rhs, void* dst, uint8_t* nulls, size_t n, bool mod) {
+        DivLoop<T>::run((const T*)lhs, (const T*)rhs, (T*)dst, nulls, n, mod);
+    }
+};
+
+template <class From>
+struct CastKernel {
+    template <class To>
+    struct F {
+        static void run(const void* src, void* dst, size_t n) {
+            const From* s = (const From*)src;
+            To* d = (To*)dst;
+            for (size_t i = 0; i < n; i++) {
+                d[i] = (To)s[i];
+            }
+        }
+    };
+};
+
+template <class From>
+struct CastFromKernel {
+    static void run(Type to, const void* src, void* dst, size_t n) {
+        DispatchNumeric<CastKernel<From>::template F>(to, src, dst, n);
+    }
+};
+
+template <class T>
+struct FillKernel {
+    static void run(const void* value, void* dst, size_t n) {
+        T v = *(const T*)value;
+        T* d = (T*)dst;
+        for (size_t i = 0; i < n; i++) {
+            d[i] = v;
+        }
+    }
+};
+
+// out[i] = v[i] for rows set in take
+template <class T>
+struct SelectKernel {
+    static void run(const uint8_t* take, const void* src, void* dst, size_t n) {
+        const T* v = (const T*)src;
+        T* out = (T*)dst;
+        for (size_t i = 0; i < n; i++) {
+            if (BitmapTest(take, i)) {
+                out[i] = v[i];
+            }
+        }
+    }
+};
+
+template <class T>
+struct AggregateKernel {
+    static void run(const void* src, const uint8_t* nulls, const uint8_t* selection, size_t n,
+                    FloatAggregate& agg) {
+        const T* v = (const T*)src;
+        for (size_t i = 0; i < n; i++) {
+            if ((nulls && BitmapTest(nulls, i)) || (selection && !BitmapTest(selection, i))) {
+                continue;
+            }
+            double d = (double)v[i];
+            agg.count++;
+            agg.sum += d;
+            agg.min = std::min(agg.min, d);
+            agg.max = std::max(agg.max, d);
+        }
+    }
+};
+
+template <>
+struct AggregateKernel<double> {
+    static void run(const void* src, const uint8_t* nulls, const uint8_t* selection, size_t n,
+                    FloatAggregate& agg) {
+        Simd().aggregate_f64((const double*)src, n, nulls, selection, agg);
+    }
+};
+
+static bool IsFloat(Type type) {
+    return type == Float32 || type == Float64;
+}
+
+// type both sides of a binary operator are cast to
+static Type CommonType(Type a, Type b) {
+    if (a == Nothing) {
+        return b;
+    }
+    if (b == Nothing || a == b) {
+        return a;
+    }
+    if (IsFloat(a) && IsFloat(b)) {
+        return Float64;
+    }
+    if (IsFloat(a) || IsFloat(b)) {
+        // float32 is exact for int8/int16 only
+        Type f = IsFloat(a) ? a : b;
+        Type other = IsFloat(a) ? b : a;
+        return (f == Float32 && (other == Int8 || other == Int16)) ? Float32 : Float64;
+    }
+    // integer types are ordered by width
+    return std::max(a, b);
+}
+
+// nulls of an input block, nullptr if it has no nulls
+static const uint8_t* InputNulls(const ColumnBlock* cb) {
+    return cb->nulls();
+}
+
+static bool IsTrue(const ColumnBlock* cb, size_t idx) {
+    return !cb->is_null(idx) && ((const int8_t*)cb->data())[idx] != 0;
+}
+
+static bool IsFalse(const ColumnBlock* cb, size_t idx) {
+    return !cb->is_null(idx) && ((const int8_t*)cb->data())[idx] == 0;
+}
+
+static const char* OpName(ExprOp op) {
+    switch (op) {
+    case ExprAdd:
+        return "+";
+    case ExprSub:
+        return "-";
+    case ExprMul:
+        return "*";
+    case ExprDiv:
+        return "/";
+    case ExprMod:
+        return "%";
+    case ExprEQ:
+        return "=";
+    case ExprNE:
+        return "!=";
+    case ExprLT:
+        return "<";
+    case ExprLE:
+        return "<=";
+    case ExprGT:
+        return ">";
+    case ExprGE:
+        return ">=";
+    case ExprAnd:
+        return "and";
+    case ExprOr:
+        return "or";
+    default:
+        return "?";
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+unique_ptr<Expr> Expr::column(const string& name) {
+    unique_ptr<Expr> ret(new Expr(ExprColumn));
+    ret->_name = name;
+    return ret;
+}
+
+unique_ptr<Expr> Expr::literal(const Variant& value) {
+    unique_ptr<Expr> ret(new Expr(ExprLiteral));
+    ret->_value.reset(new Variant(value));
+    ret->_type = value.type();
+    return ret;
+}
+
+unique_ptr<Expr> Expr::null_literal() {
+    return unique_ptr<Expr>(new Expr(ExprLiteral));
+}
+
+unique_ptr<Expr> Expr::binary(ExprOp op, unique_ptr<Expr> lhs, unique_ptr<Expr> rhs) {
+    DCHECK(op >= ExprAdd && op <= ExprOr);
+    unique_ptr<Expr> ret(new Expr(op));
+    ret->_children.emplace_back(std::move(lhs));
+    ret->_children.emplace_back(std::move(rhs));
+    return ret;
+}
+
+unique_ptr<Expr> Expr::unary(ExprOp op, unique_ptr<Expr> child) {
+    DCHECK(op == ExprNot || op == ExprIsNull);
+    unique_ptr<Expr> ret(new Expr(op));
+    ret->_children.emplace_back(std::move(child));
+    return ret;
+}
+
+unique_ptr<Expr> Expr::cast(unique_ptr<Expr> child, Type type) {
+    unique_ptr<Expr> ret(new Expr(ExprCast));
+    ret->_type = type;
+    ret->_children.emplace_back(std::move(child));
+    return ret;
+}
+
+unique_ptr<Expr> Expr::case_when(vector<unique_ptr<Expr>>& conds,
+                                 vector<unique_ptr<Expr>>& values,
+                                 unique_ptr<Expr> else_value) {
+    DCHECK_EQ(conds.size(), values.size());
+    unique_ptr<Expr> ret(new Expr(ExprCase));
+    // children: cond0, value0, cond1, value1, ..., else
+    for (size_t i = 0; i < conds.size(); i++) {
+        ret->_children.emplace_back(std::move(conds[i]));
+        ret->_children.emplace_back(std::move(values[i]));
+    }
+    ret->_children.emplace_back(else_value ? std::move(else_value) : null_literal());
+    return ret;
+}
+
+void Expr::cast_child(size_t idx, Type type) {
+    unique_ptr<Expr>& child = _children[idx];
+    if (child->_type == type) {
+        return;
+    }
+    if (child->_op == ExprLiteral && !child->_value) {
+        // NULL takes any type
+        child->_type = type;
+        return;
+    }
+    child = cast(std::move(child), type);
+}
+
+Status Expr::bind(const Schema& schema, const vector<string>& columns) {
+    for (auto& child : _children) {
+        RETURN_NOT_OK(child->bind(schema, columns));
+    }
+    switch (_op) {
+    case ExprColumn: {
+        auto itr = std::find(columns.begin(), columns.end(), _name);
+        if (itr == columns.end()) {
+            return Status::NotFound(Format("column %s not found for expression", _name.c_str()));
+        }
+        _index = itr - columns.begin();
+        const ColumnSchema* cs = schema.get(_name);
+        if (!cs) {
+            return Status::NotFound(Format("column %s not found in schema", _name.c_str()));
+        }
+        _type = cs->type;
+        break;
+    }
+    case ExprLiteral:
+        break;
+    case ExprAdd:
+    case ExprSub:
+    case ExprMul:
+    case ExprDiv:
+    case ExprMod:
+    case ExprEQ:
+    case ExprNE:
+    case ExprLT:
+    case ExprLE:
+    case ExprGT:
+    case ExprGE: {
+        Type t = CommonType(_children[0]->_type, _children[1]->_type);
+        if (t == Nothing) {
+            t = Int32;
+        }
+        cast_child(0, t);
+        cast_child(1, t);
+        _type = _op <= ExprMod ? t : Int8;
+        break;
+    }
+    case ExprAnd:
+    case ExprOr:
+    case ExprNot:
+        for (size_t i = 0; i < _children.size(); i++) {
+            cast_child(i, _children[i]->_type == Nothing ? Int8 : _children[i]->_type);
+            if (_children[i]->_type != Int8) {
+                return Status::InvalidArgument(Format("logical operator needs int8 operand: %s",
+                                                      _children[i]->to_string().c_str()));
+            }
+        }
+        _type = Int8;
+        break;
+    case ExprIsNull:
+        _type = Int8;
+        break;
+    case ExprCast:
+        cast_child(0, _children[0]->_type == Nothing ? _type : _children[0]->_type);
+        break;
+    case ExprCase: {
+        Type t = Nothing;
+        for (size_t i = 0; i + 1 < _children.size(); i += 2) {
+            cast_child(i, _children[i]->_type == Nothing ? Int8 : _children[i]->_type);
+            if (_children[i]->_type != Int8) {
+                return Status::InvalidArgument(Format("case condition should be int8: %s",
+                                                      _children[i]->to_string().c_str()));
+            }
+            t = CommonType(t, _children[i + 1]->_type);
+        }
+        t = CommonType(t, _children.back()->_type);
+        if (t == Nothing) {
+            t = Int32;
+        }
+        for (size_t i = 1; i < _children.size(); i += 2) {
+            cast_child(i, t);
+        }
+        cast_child(_children.size() - 1, t);
+        _type = t;
+        break;
+    }
+    }
+    if (_type == String) {
+        return Status::NotSupported(Format("expression doesn't support string: %s", to_string().c_str()));
+    }
+    return Status::OK();
+}
+
+Status Expr::evaluate_children(const RowBlock& block, vector<const ColumnBlock*>& inputs) {
+    inputs.resize(_children.size());
+    for (size_t i = 0; i < _children.size(); i++) {
+        RETURN_NOT_OK(_children[i]->evaluate(block, inputs[i]));
+    }
+    return Status::OK();
+}
+
+Status Expr::evaluate(const RowBlock& block, const ColumnBlock*& result) {
+    size_t nrows = block.num_rows();
+    if (_op == ExprColumn) {
+        result = &block.get_column(_index);
+        return Status::OK();
+    }
+    result = &_result;
+    size_t esize = TypeInfo::get(_type).size();
+    if (_op == ExprLiteral) {
+        // constant, only refill when block size changes
+        if (_literal_rows != nrows) {
+            RETURN_NOT_OK(_result.alloc(nrows, esize));
+            if (_value) {
+                memset(_result._nulls, 0, BitmapSize64(nrows));
+                DispatchNumeric<FillKernel>(_type, _value->value(), _result._data, nrows);
+            } else {
+                memset(_result._nulls, 0xff, BitmapSize64(nrows));
+                memset(_result._data, 0, nrows * esize);
+            }
+            _literal_rows = nrows;
+        }
+        return Status::OK();
+    }
+    vector<const ColumnBlock*> in;
+    RETURN_NOT_OK(evaluate_children(block, in));
+    RETURN_NOT_OK(_result.alloc(nrows, esize));
+    uint8_t* nulls = _result._nulls;
+    memset(nulls, 0, BitmapSize64(nrows));
+    // null if any input is null, except for operators handling nulls
+    if (_op != ExprAnd && _op != ExprOr && _op != ExprIsNull && _op != ExprCase) {
+        for (auto cb : in) {
+            if (InputNulls(cb)) {
+                BitmapMergeOr(nulls, InputNulls(cb), nrows);
+            }
+        }
+    }
+    Type input_type = in.empty() ? Nothing : _children[0]->_type;
+    void* out = _result._data;
+    switch (_op) {
+    case ExprAdd:
+        DispatchNumeric<ArithKernel<AddOp>::F>(_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprSub:
+        DispatchNumeric<ArithKernel<SubOp>::F>(_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprMul:
+        DispatchNumeric<ArithKernel<MulOp>::F>(_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprDiv:
+    case ExprMod:
+        DispatchNumeric<DivKernel>(_type, in[0]->data(), in[1]->data(), out, nulls, nrows, _op == ExprMod);
+        break;
+    case ExprEQ:
+        DispatchNumeric<CompareKernel<EQOp>::F>(input_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprNE:
+        DispatchNumeric<CompareKernel<NEOp>::F>(input_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprLT:
+        DispatchNumeric<CompareKernel<LTOp>::F>(input_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprLE:
+        DispatchNumeric<CompareKernel<LEOp>::F>(input_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprGT:
+        DispatchNumeric<CompareKernel<GTOp>::F>(input_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprGE:
+        DispatchNumeric<CompareKernel<GEOp>::F>(input_type, in[0]->data(), in[1]->data(), out, nrows);
+        break;
+    case ExprAnd:
+    case ExprOr: {
+        // three-valued logic: false and null = false, true or null = true
+        int8_t* o = (int8_t*)out;
+        bool is_and = _op == ExprAnd;
+        for (size_t i = 0; i < nrows; i++) {
+            bool decided = is_and ? (IsFalse(in[0], i) || IsFalse(in[1], i))
+                                  : (IsTrue(in[0], i) || IsTrue(in[1], i));
+            if (decided) {
+                o[i] = is_and ? 0 : 1;
+            } else if (in[0]->is_null(i) || in[1]->is_null(i)) {
+                o[i] = 0;
+                BitmapSet(nulls, i);
+            } else {
+                o[i] = is_and ? 1 : 0;
+            }
+        }
+        break;
+    }
+    case ExprNot: {
+        const int8_t* a = (const int8_t*)in[0]->data();
+        int8_t* o = (int8_t*)out;
+        for (size_t i = 0; i < nrows; i++) {
+            o[i] = a[i] == 0;
+        }
+        break;
+    }
+    case ExprIsNull: {
+        int8_t* o = (int8_t*)out;
+        for (size_t i = 0; i < nrows; i++) {
+            o[i] = in[0]->is_null(i);
+        }
+        break;
+    }
+    case ExprCast:
+        DispatchNumeric<CastFromKernel>(input_type, _type, in[0]->data(), out, nrows);
+        break;
+    case ExprCase: {
+        // start from else, then apply branches from last to first, so the
+        // first true condition wins
+        const ColumnBlock* else_value = in.back();
+        memcpy(out, else_value->data(), nrows * esize);
+        if (InputNulls(else_value)) {
+            memcpy(nulls, InputNulls(else_value), BitmapSize64(nrows));
+        }
+        vector<uint8_t> take(BitmapSize64(nrows));
+        for (ssize_t b = (ssize_t)in.size() - 3; b >= 0; b -= 2) {
+            const ColumnBlock* cond = in[b];
+            const ColumnBlock* value = in[b + 1];
+            for (size_t i = 0; i < nrows; i++) {
+                bool t = IsTrue(cond, i);
+                BitmapChange(take.data(), i, t);
+                if (t) {
+                    BitmapChange(nulls, i, value->is_null(i));
+                }
+            }
+            DispatchNumeric<SelectKernel>(_type, take.data(), value->data(), out, nrows);
+        }
+        break;
+    }
+    default:
+        return Status::NotSupported(Format("unsupported expression op %d", (int)_op));
+    }
+    return Status::OK();
+}
+
+Status Expr::evaluate_filter(const RowBlock& block, vector<uint8_t>& selection) {
+    if (_type != Int8) {
+        return Status::InvalidArgument(Format("filter should be int8: %s", to_string().c_str()));
+    }
+    const ColumnBlock* result = nullptr;
+    RETURN_NOT_OK(evaluate(block, result));
+    size_t nrows = block.num_rows();
+    selection.resize(BitmapSize64(nrows));
+    Simd().int8_to_bitmap((const int8_t*)result->data(), nrows, selection.data());
+    result->filter_not_null(selection.data(), nrows);
+    return Status::OK();
+}
+
+void AggregateColumnBlock(Type type, const ColumnBlock& cb, size_t nrows, const uint8_t* selection,
+                          FloatAggregate& agg) {
+    DispatchNumeric<AggregateKernel>(type, cb.data(), cb.nulls(), selection, nrows, agg);
+}
+
+Status Expr::aggregate(const RowBlock& block, const uint8_t* selection, FloatAggregate& agg) {
+    const ColumnBlock* result = nullptr;
+    RETURN_NOT_OK(evaluate(block, result));
+    AggregateColumnBlock(_type, *result, block.num_rows(), selection, agg);
+    return Status::OK();
+}
+
+void Expr::conjuncts(vector<const Expr*>& ret) const {
+    if (_op == ExprAnd) {
+        _children[0]->conjuncts(ret);
+        _children[1]->conjuncts(ret);
+    } else {
+        ret.push_back(this);
+    }
+}
+
+static bool IsInt64Type(Type type) {
+    return type == Int8 || type == Int16 || type == Int32 || type == Int64;
+}
+
+bool Expr::int_range(size_t& index, int64_t& lo, int64_t& hi) const {
+    if (_op < ExprEQ || _op > ExprGE || _op == ExprNE) {
+        return false;
+    }
+    // widening casts between integer types keep values, narrowing casts
+    // wrap them, so only widening ones can be skipped
+    const Expr* operands[2];
+    for (size_t i = 0; i < 2; i++) {
+        const Expr* e = _children[i].get();
+        while (e->_op == ExprCast && IsInt64Type(e->_type) && IsInt64Type(e->_children[0]->_type) &&
+               TypeInfo::get(e->_type).size() >= TypeInfo::get(e->_children[0]->_type).size()) {
+            e = e->_children[0].get();
+        }
+        operands[i] = e;
+    }
+    ExprOp op = _op;
+    if (operands[0]->_op == ExprLiteral) {
+        // literal op column, flip to column op literal
+        std::swap(operands[0], operands[1]);
+        switch (op) {
+        case ExprLT:
+            op = ExprGT;
+            break;
+        case ExprLE:
+            op = ExprGE;
+            break;
+        case ExprGT:
+            op = ExprLT;
+            break;
+        case ExprGE:
+            op = ExprLE;
+            break;
+        default:
+            break;
+        }
+    }
+    const Expr* col = operands[0];
+    const Expr* lit = operands[1];
+    if (col->_op != ExprColumn || !IsInt64Type(col->_type) || lit->_op != ExprLiteral ||
+        !lit->_value || !IsInt64Type(lit->_value->type())) {
+        return false;
+    }
+    int64_t v = ReadIntN(lit->_value->value(), TypeInfo::get(lit->_value->type()).size(), 0);
+    const int64_t kMin = std::numeric_limits<int64_t>::min();
+    const int64_t kMax = std::numeric_limits<int64_t>::max();
+    index = col->_index;
+    lo = kMin;
+    hi = kMax;
+    switch (op) {
+    case ExprEQ:
+        lo = hi = v;
+        break;
+    case ExprLT:
+        if (v == kMin) {
+            lo = 1;
+            hi = 0;
+        } else {
+            hi = v - 1;
+        }
+        break;
+    case ExprLE:
+        hi = v;
+        break;
+    case ExprGT:
+        if (v == kMax) {
+            lo = 1;
+            hi = 0;
+        } else {
+            lo = v + 1;
+        }
+        break;
+    default:
+        lo = v;
+        break;
+    }
+    return true;
+}
+
+string Expr::to_string() const {
+    switch (_op) {
+    case ExprColumn:
+        return _name;
+    case ExprLiteral: {
+        if (!_value) {
+            return "null";
+        }
+        string ret;
+        TypeInfo::get(_value->type()).print(_value->value(), &ret);
+        return ret;
+    }
+    case ExprNot:
+        return Format("(not %s)", _children[0]->to_string().c_str());
+    case ExprIsNull:
+        return Format("(%s is null)", _children[0]->to_string().c_str());
+    case ExprCast:
+        return Format("cast(%s as %s)", _children[0]->to_string().c_str(),
+                      TypeInfo::get(_type).name().c_str());
+    case ExprCase: {
+        string ret = "case";
+        for (size_t i = 0; i + 1 < _children.size(); i += 2) {
+            ret += Format(" when %s then %s", _children[i]->to_string().c_str(),
+                          _children[i + 1]->to_string().c_str());
+        }
+        ret += Format(" else %s end", _children.back()->to_string().c_str());
+        return ret;
+    }
+    default:
+        return Format("(%s %s %s)", _children[0]->to_string().c_str(), OpName(_op),
+                      _children[1]->to_string().c_str());
+    }
+}
+
+} /* namespace choco */
@@ -0,0 +1,145 @@
+#ifndef CHOCO_EXPRESSION_H_
+#define CHOCO_EXPRESSION_H_
+
+#include "common.h"
+#include "type.h"
+#include "row_block.h"
+#include "encoding.h"
+
+namespace choco {
+
+class Schema;
+
+/**
+ * aggregate non-null values of rows set in selection(all rows if
+ * nullptr) of a numeric column block
+ */
+void AggregateColumnBlock(Type type, const ColumnBlock& cb, size_t nrows, const uint8_t* selection,
+                          FloatAggregate& agg);
+
+enum ExprOp {
+    ExprColumn = 0,
+    ExprLiteral,
+    // arithmetic
+    ExprAdd,
+    ExprSub,
+    ExprMul,
+    ExprDiv,
+    ExprMod,
+    // comparison, result is Int8 0/1
+    ExprEQ,
+    ExprNE,
+    ExprLT,
+    ExprLE,
+    ExprGT,
+    ExprGE,
+    // logical on Int8, three-valued with nulls
+    ExprAnd,
+    ExprOr,
+    ExprNot,
+    ExprIsNull,
+    ExprCast,
+    ExprCase,
+};
+
+/**
+ * Vectorized expression over the columns of a RowBlock.
+ *
+ * An expression tree is built with the factory functions, then bound to
+ * the columns of a RowBlock(bind resolves column names, infers result
+ * types and inserts casts so both sides of an operator have the same
+ * type), then evaluated once per RowBlock. Each operator runs a typed
+ * template kernel over the whole block, loops are simple enough for the
+ * compiler to vectorize.
+ *
+ * Nulls propagate: result is null if any input is null, integer
+ * division/modulo by zero is also null. Comparisons and logical
+ * operators return Int8 0/1. String columns are not supported.
+ */
+class Expr {
+public:
+    static unique_ptr<Expr> column(const string& name);
+    static unique_ptr<Expr> literal(const Variant& value);
+    // NULL, takes type from context
+    static unique_ptr<Expr> null_literal();
+    static unique_ptr<Expr> binary(ExprOp op, unique_ptr<Expr> lhs, unique_ptr<Expr> rhs);
+    // ExprNot or ExprIsNull
+    static unique_ptr<Expr> unary(ExprOp op, unique_ptr<Expr> child);
+    static unique_ptr<Expr> cast(unique_ptr<Expr> child, Type type);
+    /**
+     * CASE WHEN conds[0] THEN values[0] ... ELSE else_value END, first
+     * true condition wins, else_value may be nullptr(NULL)
+     */
+    static unique_ptr<Expr> case_when(vector<unique_ptr<Expr>>& conds,
+                                      vector<unique_ptr<Expr>>& values,
+                                      unique_ptr<Expr> else_value);
+
+    ExprOp op() const { return _op; }
+
+    // result type, valid after bind
+    Type type() const { return _type; }
+
+    /**
+     * resolve column names to RowBlock column index(position in
+     * columns), column types are from schema
+     */
+    Status bind(const Schema& schema, const vector<string>& columns);
+
+    /**
+     * evaluate on all rows of block, result is the input column for
+     * column references, otherwise owned by this expression and valid
+     * until next evaluate
+     */
+    Status evaluate(const RowBlock& block, const ColumnBlock*& result);
+
+    /**
+     * evaluate Int8 expression into a selection bitmap, bits of rows
+     * which are true(not null and not 0) are set
+     */
+    Status evaluate_filter(const RowBlock& block, vector<uint8_t>& selection);
+
+    /**
+     * evaluate and aggregate non-null values of rows set in selection
+     * (all rows if nullptr)
+     */
+    Status aggregate(const RowBlock& block, const uint8_t* selection, FloatAggregate& agg);
+
+    // append operands of this AND tree(this if it's not ExprAnd) to ret
+    void conjuncts(vector<const Expr*>& ret) const;
+
+    /**
+     * if this is a comparison(except !=) of an integer column with a
+     * non-null integer literal, get the column's index and the range
+     * [lo, hi] of column values which make it true(lo > hi if none), so
+     * it can be evaluated on stored data(ColumnReader::filter_range),
+     * valid after bind
+     */
+    bool int_range(size_t& index, int64_t& lo, int64_t& hi) const;
+
+    string to_string() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Expr);
+
+    Expr(ExprOp op) : _op(op) {}
+
+    // wrap child idx in a cast if its type is not type
+    void cast_child(size_t idx, Type type);
+    Status evaluate_children(const RowBlock& block, vector<const ColumnBlock*>& inputs);
+
+    ExprOp _op;
+    Type _type = Nothing;
+    vector<unique_ptr<Expr>> _children;
+    // column
+    string _name;
+    size_t _index = 0;
+    // literal, nullptr for NULL
+    unique_ptr<Variant> _value;
+    size_t _literal_rows = 0;
+    // owned result
+    ColumnBlock _result;
+};
+
+} /* namespace choco */
+
+#endif /* CHOCO_EXPRESSION_H_ */
@@ -0,0 +1,422 @@
+#include "gtest/gtest.h"
+#include "expression.h"
+#include "mem_tablet.h"
+#include "mem_tablet_scan.h"
+
+namespace choco {
+
+static const int kNumRows = 100000;
+
+// id = i, a = i % 100 (null if i % 7 == 0), b = i % 5, f = i / 2.0
+static shared_ptr<MemTablet> CreateTablet() {
+    unique_ptr<Schema> sc;
+    EXPECT_TRUE(Schema::create("int32 id,int32 a null,int16 b,float64 f", sc));
+    shared_ptr<MemTablet> tablet;
+    EXPECT_TRUE(MemTablet::create("", sc, tablet));
+    unique_ptr<WriteTx> wtx;
+    EXPECT_TRUE(tablet->create_writetx(wtx));
+    PartialRowWriter writer(wtx->schema());
+    PartialRowBatch* batch = wtx->new_batch();
+    for (int i = 0; i < kNumRows; i++) {
+        writer.start_row();
+        int32_t a = i % 100;
+        int16_t b = i % 5;
+        double f = i / 2.0;
+        EXPECT_TRUE(writer.set("id", &i));
+        EXPECT_TRUE(writer.set("a", i % 7 == 0 ? nullptr : &a));
+        EXPECT_TRUE(writer.set("b", &b));
+        EXPECT_TRUE(writer.set("f", &f));
+        if (!writer.write_row_to_batch(*batch)) {
+            batch = wtx->new_batch();
+            EXPECT_TRUE(writer.write_row_to_batch(*batch));
+        }
+    }
+    EXPECT_TRUE(tablet->prepare_writetx(wtx));
+    EXPECT_TRUE(tablet->commit(wtx, 1));
+    return tablet;
+}
+
+static unique_ptr<Expr> Col(const char* name) {
+    return Expr::column(name);
+}
+
+static unique_ptr<Expr> Lit(int32_t v) {
+    return Expr::literal(Variant(Int32, &v));
+}
+
+static unique_ptr<Expr> Bin(ExprOp op, unique_ptr<Expr> lhs, unique_ptr<Expr> rhs) {
+    return Expr::binary(op, std::move(lhs), std::move(rhs));
+}
+
+template <class T>
+static T Value(const RowBlock& rb, size_t col, size_t idx) {
+    return ((const T*)rb.get_column(col).data())[idx];
+}
+
+TEST(Expr, arithmetic) {
+    auto tablet = CreateTablet();
+    unique_ptr<ScanSpec> spec;
+    ASSERT_TRUE(ScanSpec::create(1, "id,a,b,f", false, spec));
+    // a + b * 2
+    auto e0 = Bin(ExprAdd, Col("a"), Bin(ExprMul, Col("b"), Lit(2)));
+    // id / b, b = 0 is null
+    auto e1 = Bin(ExprDiv, Col("id"), Col("b"));
+    // f - b, promoted to float64
+    auto e2 = Bin(ExprSub, Col("f"), Col("b"));
+    // id % null
+    auto e3 = Bin(ExprMod, Col("id"), Expr::null_literal());
+    Expr* e0p = e0.get();
+    spec->add_expr(e0);
+    spec->add_expr(e1);
+    spec->add_expr(e2);
+    spec->add_expr(e3);
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(spec, scan));
+    EXPECT_EQ(Int32, e0p->type());
+    const RowBlock* rb = nullptr;
+    size_t nrows = 0;
+    while (true) {
+        ASSERT_TRUE(scan->next_scan_block(rb));
+        if (!rb) {
+            break;
+        }
+        ASSERT_EQ(8U, rb->num_columns());
+        EXPECT_EQ(nullptr, rb->selection());
+        for (size_t i = 0; i < rb->num_rows(); i++) {
+            int32_t id = Value<int32_t>(*rb, 0, i);
+            int32_t b = id % 5;
+            EXPECT_EQ(id % 7 == 0, rb->get_column(4).is_null(i));
+            if (id % 7 != 0) {
+                EXPECT_EQ(id % 100 + b * 2, Value<int32_t>(*rb, 4, i));
+            }
+            EXPECT_EQ(b == 0, rb->get_column(5).is_null(i));
+            if (b != 0) {
+                EXPECT_EQ(id / b, Value<int32_t>(*rb, 5, i));
+            }
+            EXPECT_EQ(id / 2.0 - b, Value<double>(*rb, 6, i));
+            EXPECT_TRUE(rb->get_column(7).is_null(i));
+        }
+        nrows += rb->num_rows();
+    }
+    EXPECT_EQ((size_t)kNumRows, nrows);
+}
+
+TEST(Expr, compare_case_cast) {
+    auto tablet = CreateTablet();
+    unique_ptr<ScanSpec> spec;
+    ASSERT_TRUE(ScanSpec::create(1, "id,a,b", false, spec));
+    // case when a < 10 then 1 when b = 3 then 2 else cast(id as int64) end
+    vector<unique_ptr<Expr>> conds;
+    vector<unique_ptr<Expr>> values;
+    conds.emplace_back(Bin(ExprLT, Col("a"), Lit(10)));
+    values.emplace_back(Lit(1));
+    conds.emplace_back(Bin(ExprEQ, Col("b"), Lit(3)));
+    values.emplace_back(Lit(2));
+    auto e0 = Expr::case_when(conds, values, Expr::cast(Col("id"), Int64));
+    // a is null or not (b >= 2)
+    auto e1 = Bin(ExprOr, Expr::unary(ExprIsNull, Col("a")),
+                  Expr::unary(ExprNot, Bin(ExprGE, Col("b"), Lit(2))));
+    // cast(b as float32)
+    auto e2 = Expr::cast(Col("b"), Float32);
+    Expr* e0p = e0.get();
+    spec->add_expr(e0);
+    spec->add_expr(e1);
+    spec->add_expr(e2);
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(spec, scan));
+    EXPECT_EQ(Int64, e0p->type());
+    LOG(INFO) << e0p->to_string();
+    const RowBlock* rb = nullptr;
+    while (true) {
+        ASSERT_TRUE(scan->next_scan_block(rb));
+        if (!rb) {
+            break;
+        }
+        for (size_t i = 0; i < rb->num_rows(); i++) {
+            int32_t id = Value<int32_t>(*rb, 0, i);
+            bool anull = id % 7 == 0;
+            int32_t a = id % 100;
+            int32_t b = id % 5;
+            // null condition is false
+            int64_t expect = (!anull && a < 10) ? 1 : (b == 3 ? 2 : id);
+            EXPECT_FALSE(rb->get_column(3).is_null(i));
+            EXPECT_EQ(expect, Value<int64_t>(*rb, 3, i));
+            EXPECT_FALSE(rb->get_column(4).is_null(i));
+            EXPECT_EQ(anull || b < 2, Value<int8_t>(*rb, 4, i) != 0);
+            EXPECT_EQ((float)b, Value<float>(*rb, 5, i));
+        }
+    }
+}
+
+TEST(Expr, filter_aggregate) {
+    auto tablet = CreateTablet();
+    unique_ptr<ScanSpec> spec;
+    ASSERT_TRUE(ScanSpec::create(1, "id,a,f", false, spec));
+    // a > 50 and id < 50000, null a is filtered out
+    auto filter = Bin(ExprAnd, Bin(ExprGT, Col("a"), Lit(50)), Bin(ExprLT, Col("id"), Lit(50000)));
+    spec->set_filter(filter);
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(spec, scan));
+    vector<string> names = {"id", "a", "f"};
+    auto sum = Bin(ExprAdd, Col("f"), Col("a"));
+    ASSERT_TRUE(sum->bind(tablet->latest_schema(), names));
+    FloatAggregate agg;
+    const RowBlock* rb = nullptr;
+    while (true) {
+        ASSERT_TRUE(scan->next_scan_block(rb));
+        if (!rb) {
+            break;
+        }
+        ASSERT_NE(nullptr, rb->selection());
+        ASSERT_TRUE(sum->aggregate(*rb, rb->selection(), agg));
+    }
+    FloatAggregate expect;
+    for (int i = 0; i < 50000; i++) {
+        if (i % 7 == 0 || i % 100 <= 50) {
+            continue;
+        }
+        double v = i / 2.0 + i % 100;
+        expect.count++;
+        expect.sum += v;
+        expect.min = std::min(expect.min, v);
+        expect.max = std::max(expect.max, v);
+    }
+    EXPECT_EQ(expect.count, agg.count);
+    EXPECT_DOUBLE_EQ(expect.sum, agg.sum);
+    EXPECT_EQ(expect.min, agg.min);
+    EXPECT_EQ(expect.max, agg.max);
+}
+
+// run scan of columns(id first) with filter, check rows in selection
+// are rows where expect(id) is true
+static void CheckFilter(MemTablet& tablet, uint64_t version, const char* columns, unique_ptr<Expr> filter,
+                        std::function<bool(int)> expect, ScanStats& stats) {
+    unique_ptr<ScanSpec> spec;
+    ASSERT_TRUE(ScanSpec::create(version, columns, false, spec));
+    spec->set_filter(filter);
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet.scan(spec, scan));
+    vector<bool> selected(kNumRows, false);
+    const RowBlock* rb = nullptr;
+    while (true) {
+        ASSERT_TRUE(scan->next_scan_block(rb));
+        if (!rb) {
+            break;
+        }
+        ASSERT_NE(nullptr, rb->selection());
+        for (size_t i = 0; i < rb->num_rows(); i++) {
+            if (BitmapTest(rb->selection(), i)) {
+                selected[Value<int32_t>(*rb, 0, i)] = true;
+            }
+        }
+    }
+    for (int i = 0; i < kNumRows; i++) {
+        ASSERT_EQ(expect(i), selected[i]) << "id " << i;
+    }
+    stats = scan->stats();
+}
+
+TEST(Expr, filter_pushdown) {
+    auto tablet = CreateTablet();
+    ScanStats stats;
+    // all range conjuncts, evaluated on packed(block 0) and narrow
+    // (block 1) pages, block 0 has no id in range
+    CheckFilter(*tablet, 1, "id,a,b", Bin(ExprAnd, Bin(ExprGE, Col("id"), Lit(70000)), Bin(ExprGT, Lit(50), Col("a"))),
+                [](int i) { return i >= 70000 && i % 7 != 0 && i % 100 < 50; }, stats);
+    EXPECT_EQ(1U, stats.skipped_blocks);
+    EXPECT_EQ(1U, stats.blocks);
+    EXPECT_EQ(4U, stats.pushdown_blocks);
+    // range conjunct plus one evaluated on decoded block
+    CheckFilter(*tablet, 1, "id,a,b", Bin(ExprAnd, Bin(ExprEQ, Col("b"), Lit(3)),
+                                Bin(ExprOr, Bin(ExprLT, Col("a"), Lit(10)), Bin(ExprGT, Col("id"), Lit(99990)))),
+                [](int i) { return i % 5 == 3 && ((i % 7 != 0 && i % 100 < 10) || i > 99990); }, stats);
+    EXPECT_EQ(2U, stats.pushdown_blocks);
+    EXPECT_EQ(2U, stats.blocks);
+    // empty ranges
+    CheckFilter(*tablet, 1, "id,a,b", Bin(ExprLT, Col("b"), Lit(0)), [](int i) { return false; }, stats);
+    EXPECT_EQ(2U, stats.skipped_blocks);
+    // narrowing casts wrap values, they are evaluated on decoded blocks
+    CheckFilter(*tablet, 1, "id,a,b", Bin(ExprEQ, Expr::cast(Col("id"), Int8), Lit(1)),
+                [](int i) { return (int8_t)i == 1; }, stats);
+    EXPECT_EQ(0U, stats.pushdown_blocks);
+    EXPECT_EQ(2U, stats.blocks);
+    // blocks with deltas are filtered after decoding
+    unique_ptr<WriteTx> wtx;
+    ASSERT_TRUE(tablet->create_writetx(wtx));
+    PartialRowWriter writer(wtx->schema());
+    PartialRowBatch* batch = wtx->new_batch();
+    for (int i = 0; i < kNumRows; i += 1000) {
+        int16_t b = 4;
+        writer.start_row();
+        EXPECT_TRUE(writer.set("id", &i));
+        EXPECT_TRUE(writer.set("b", &b));
+        ASSERT_TRUE(writer.write_row_to_batch(*batch));
+    }
+    ASSERT_TRUE(tablet->commit(wtx, 2));
+    CheckFilter(*tablet, 2, "id,a,b", Bin(ExprLE, Col("b"), Lit(0)), [](int i) { return i % 1000 != 0 && i % 5 == 0; },
+                stats);
+    EXPECT_EQ(0U, stats.pushdown_blocks);
+    EXPECT_EQ(2U, stats.blocks);
+}
+
+TEST(Expr, filter_pushdown_dict) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int64 region null dict", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const int64_t kStep = 1000000007;
+    unique_ptr<WriteTx> wtx;
+    ASSERT_TRUE(tablet->create_writetx(wtx));
+    ColumnarBatch* batch = nullptr;
+    ASSERT_TRUE(wtx->new_columnar_batch({"id", "region"}, batch));
+    vector<int32_t> ids(kNumRows);
+    vector<int64_t> regions(kNumRows);
+    vector<uint8_t> nulls(BitmapSize64(kNumRows), 0);
+    for (int i = 0; i < kNumRows; i++) {
+        ids[i] = i;
+        regions[i] = (i % 13) * kStep;
+        if (i % 11 == 0) {
+            BitmapSet(nulls.data(), i);
+        }
+    }
+    ASSERT_TRUE(batch->append(kNumRows, {ids.data(), regions.data()}, {nullptr, nulls.data()}));
+    ASSERT_TRUE(tablet->commit(wtx, 1));
+    // region in [3 * kStep, 8 * kStep), evaluated on codes
+    int64_t lo = 3 * kStep;
+    int64_t hi = 8 * kStep;
+    ScanStats stats;
+    CheckFilter(*tablet, 1, "id,region",
+                Bin(ExprAnd, Bin(ExprGE, Col("region"), Expr::literal(Variant(Int64, &lo))),
+                    Bin(ExprLT, Col("region"), Expr::literal(Variant(Int64, &hi)))),
+                [](int i) { return i % 11 != 0 && i % 13 >= 3 && i % 13 < 8; }, stats);
+    EXPECT_EQ(4U, stats.pushdown_blocks);
+    // all null rows, the dictionary is empty
+    ASSERT_TRUE(Schema::create("int32 id,int64 region null dict", sc));
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    ASSERT_TRUE(tablet->create_writetx(wtx));
+    ASSERT_TRUE(wtx->new_columnar_batch({"id", "region"}, batch));
+    std::fill(nulls.begin(), nulls.end(), 0xff);
+    ASSERT_TRUE(batch->append(100, {ids.data(), regions.data()}, {nullptr, nulls.data()}));
+    ASSERT_TRUE(tablet->commit(wtx, 1));
+    CheckFilter(*tablet, 1, "id,region", Bin(ExprGE, Col("region"), Lit(0)), [](int i) { return false; }, stats);
+    EXPECT_EQ(1U, stats.pushdown_blocks);
+}
+
+// aggregate f over rows of scan where expect(id) is true
+static void CheckAggregate(MemTablet& tablet, unique_ptr<Expr> filter, std::function<bool(int)> expect,
+                           ScanStats& stats) {
+    unique_ptr<ScanSpec> spec;
+    ASSERT_TRUE(ScanSpec::create(1, "id,a,f", false, spec));
+    if (filter) {
+        spec->set_filter(filter);
+    }
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet.scan(spec, scan));
+    FloatAggregate agg;
+    ASSERT_TRUE(scan->aggregate(2, agg));
+    FloatAggregate expect_agg;
+    for (int i = 0; i < kNumRows; i++) {
+        if (expect(i)) {
+            expect_agg.count++;
+            expect_agg.sum += i / 2.0;
+            expect_agg.min = std::min(expect_agg.min, i / 2.0);
+            expect_agg.max = std::max(expect_agg.max, i / 2.0);
+        }
+    }
+    EXPECT_EQ(expect_agg.count, agg.count);
+    EXPECT_EQ(expect_agg.sum, agg.sum);
+    EXPECT_EQ(expect_agg.min, agg.min);
+    EXPECT_EQ(expect_agg.max, agg.max);
+    // scan is consumed
+    const RowBlock* rb = nullptr;
+    ASSERT_TRUE(scan->next_scan_block(rb));
+    EXPECT_EQ(nullptr, rb);
+    stats = scan->stats();
+}
+
+TEST(Expr, aggregate_pushdown) {
+    auto tablet = CreateTablet();
+    ScanStats stats;
+    // f of the full first block is ALP packed
+    CheckAggregate(*tablet, nullptr, [](int i) { return true; }, stats);
+    EXPECT_EQ(2U, stats.blocks);
+    EXPECT_EQ(1U, stats.pushdown_blocks);
+    EXPECT_EQ(1U, stats.zero_copy_blocks + stats.copied_blocks);
+    // range filters only, f is still aggregated without decoding
+    CheckAggregate(*tablet, Bin(ExprAnd, Bin(ExprGT, Col("a"), Lit(50)), Bin(ExprLT, Col("id"), Lit(50000))),
+                   [](int i) { return i < 50000 && i % 7 != 0 && i % 100 > 50; }, stats);
+    EXPECT_EQ(1U, stats.blocks);
+    EXPECT_EQ(1U, stats.skipped_blocks);
+    // 2 range filters of each block, f of block 0
+    EXPECT_EQ(5U, stats.pushdown_blocks);
+    EXPECT_EQ(0U, stats.zero_copy_blocks + stats.copied_blocks);
+    // residual filter is evaluated on decoded columns first
+    CheckAggregate(*tablet, Bin(ExprOr, Bin(ExprLT, Col("a"), Lit(3)), Bin(ExprGT, Col("id"), Lit(99990))),
+                   [](int i) { return (i % 7 != 0 && i % 100 < 3) || i > 99990; }, stats);
+    EXPECT_EQ(2U, stats.blocks);
+    EXPECT_EQ(1U, stats.pushdown_blocks);
+}
+
+TEST(Expr, get_exprs) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int32 a null", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    tablet->set_sub_tablet_max_rows(50);
+    // a = id * 3, null if id % 10 == 0
+    const int N = 120;
+    vector<int32_t> ids(N);
+    vector<int32_t> as(N);
+    vector<uint8_t> a_nulls(BitmapSize64(N), 0);
+    for (int i = 0; i < N; i++) {
+        ids[i] = i;
+        as[i] = i * 3;
+        if (i % 10 == 0) {
+            BitmapSet(a_nulls.data(), i);
+        }
+    }
+    ASSERT_TRUE(tablet->append_columns(N, {ColumnArray("id", ids.data()), ColumnArray("a", as.data(), a_nulls.data())},
+                                       1));
+    ASSERT_EQ(3U, tablet->num_sub_tablets());
+    unique_ptr<ScanSpec> spec;
+    ASSERT_TRUE(ScanSpec::create(1, "id,a", true, spec));
+    auto filter = Bin(ExprGE, Col("a"), Lit(30));
+    spec->set_filter(filter);
+    auto expr = Bin(ExprAdd, Col("a"), Col("id"));
+    spec->add_expr(expr);
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(spec, scan));
+    // keys in one sub-tablet, then in all of them
+    for (auto keys : {vector<int32_t>{5, 21}, vector<int32_t>{21, 72, 110, 200}}) {
+        MemTabletScan::GetResult result;
+        ASSERT_TRUE(scan->get(result, keys.size(), keys.data()));
+        const RowBlock& rb = *result.block;
+        ASSERT_EQ(3U, rb.num_columns());
+        ASSERT_NE(nullptr, rb.selection());
+        for (size_t k = 0; k < keys.size(); k++) {
+            int32_t id = keys[k];
+            if (id >= N) {
+                EXPECT_EQ(-1, result.offsets[k]);
+                continue;
+            }
+            size_t row = result.offsets[k];
+            bool null = id % 10 == 0;
+            EXPECT_EQ(!null && id >= 10, BitmapTest(rb.selection(), row)) << "id " << id;
+            EXPECT_EQ(null, rb.get_column(2).is_null(row)) << "id " << id;
+            if (!null) {
+                EXPECT_EQ(id * 4, Value<int32_t>(rb, 2, row)) << "id " << id;
+            }
+        }
+    }
+}
+
+TEST(Expr, bind_error) {
+    auto tablet = CreateTablet();
+    vector<string> names = {"id", "a"};
+    auto e0 = Bin(ExprAdd, Col("id"), Col("b"));
+    EXPECT_TRUE(e0->bind(tablet->latest_schema(), names).IsNotFound());
+    auto e1 = Bin(ExprAnd, Col("id"), Col("a"));
+    EXPECT_TRUE(e1->bind(tablet->latest_schema(), names).IsInvalidArgument());
+}
+
+} /* namespace choco */
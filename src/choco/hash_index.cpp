@@ -1,23 +1,20 @@
-#include <emmintrin.h>
 #include <stdio.h>
 #include <algorithm>
 #include "hash_index.h"
 #include "common.h"
+#include "page_pool.h"
+#include "simd.h"
 
 namespace choco {
 
-using TagVector = __m128i;
-
-static const bool kHashIndexStats = true;
-
 struct alignas(64) HashChunk {
     static const uint32_t CAPACITY = 12;
     uint8_t tags[12];
     std::atomic<uint32_t> size;
     uint32_t values[12];
 
-    TagVector* tagVector() {
-        return (TagVector*)tags;
+    const uint8_t* tagVector() const {
+        return tags;
     }
 
     void dump() {
@@ -30,31 +27,52 @@ struct alignas(64) HashChunk {
 };
 
 
-HashIndex::HashIndex(size_t capacity) :
+HashIndex::HashIndex(size_t capacity, MemTracker* tracker, bool full_hash) :
         _size(0), _max_size(0), _num_chunks(0), _chunk_mask(0),
-        _nfind(0), _nentry(0), _nprobe(0), _nset(0),
-        _chunks(NULL) {
+        _chunks(NULL), _hashes(NULL), _full_hash(full_hash), _tracker(tracker) {
     size_t min_chunk = (capacity * 14 / 12 + HashChunk::CAPACITY - 1) / HashChunk::CAPACITY;
     if (min_chunk == 0) {
         return;
     }
     size_t nc = 1;
-    while (nc < min_chunk) {
+    while (nc < min_chunk && nc < kMaxChunks) {
         nc *= 2;
     }
-    _chunks = (HashChunk*)aligned_malloc(nc*64, 64);
+    size_t hsize = _full_hash ? nc * HashChunk::CAPACITY * sizeof(uint32_t) : 0;
+    if (_tracker && !_tracker->try_consume(nc*64 + hsize, MemTracker::kIndex)) {
+        // over memory limit, capacity() is 0
+        return;
+    }
+    // chunks are probed randomly, large indexes benefit from huge pages
+    _chunks = (HashChunk*)PagePool::global().alloc(nc*64, true);
+    if (_chunks && _full_hash) {
+        _hashes = (uint32_t*)PagePool::global().alloc(hsize, true);
+        if (!_hashes) {
+            PagePool::global().free(_chunks, nc*64);
+            _chunks = NULL;
+        }
+    }
     if (_chunks) {
         _num_chunks = nc;
         _chunk_mask = nc - 1;
-        memset(_chunks, 0, _num_chunks*64);
         _max_size = this->capacity() * 12 / 14;
+    } else if (_tracker) {
+        _tracker->release(nc*64 + hsize, MemTracker::kIndex);
     }
 }
 
 HashIndex::~HashIndex() {
     if (_chunks) {
-        aligned_free(_chunks);
+        size_t hsize = _hashes ? _num_chunks * HashChunk::CAPACITY * sizeof(uint32_t) : 0;
+        PagePool::global().free(_chunks, _num_chunks*64);
+        if (_hashes) {
+            PagePool::global().free(_hashes, hsize);
+        }
+        if (_tracker) {
+            _tracker->release(_num_chunks*64 + hsize, MemTracker::kIndex);
+        }
         _chunks = 0;
+        _hashes = 0;
         _size = 0;
         _max_size = 0;
         _num_chunks = 0;
@@ -66,42 +84,60 @@ size_t HashIndex::capacity() {
     return _num_chunks * HashChunk::CAPACITY;
 }
 
-uint32_t HashIndex::find(uint64_t keyHash, std::vector<Entry> &entries) {
-    if (kHashIndexStats) _nfind++;
+void HashIndex::prefetch(uint64_t keyHash) const {
+    uint64_t pos = (keyHash >> 8) & _chunk_mask;
+    __builtin_prefetch(&_chunks[pos]);
+    if (_hashes) {
+        __builtin_prefetch(&_hashes[pos * HashChunk::CAPACITY]);
+    }
+}
+
+uint32_t HashIndex::find(uint64_t keyHash, std::vector<Entry> &entries, FindStats* stats) {
     uint64_t tag = keyHash & 0xff;
     if (tag == 0) {
         tag = 1;
     }
     uint64_t pos = (keyHash >> 8) & _chunk_mask;
     uint64_t orig_pos = pos;
-    auto tests = _mm_set1_epi8(static_cast<uint8_t>(tag));
+    size_t nprobe = 0;
+    size_t nfalse = 0;
+    size_t nentry = entries.size();
     while (true) {
-        if (kHashIndexStats) _nprobe++;
+        nprobe++;
         HashChunk& chunk = _chunks[pos];
         uint32_t sz = chunk.size.load(std::memory_order_acquire);
-        auto tags = _mm_load_si128(chunk.tagVector());
-        auto eqs = _mm_cmpeq_epi8(tags, tests);
-        uint32_t mask = _mm_movemask_epi8(eqs) & 0xfff;
+        uint32_t mask = MatchTag16(chunk.tagVector(), (uint8_t)tag) & 0xfff;
         while (mask != 0) {
             uint32_t i = __builtin_ctz(mask);
             mask &= (mask -1);
+            if (_hashes && _hashes[pos * HashChunk::CAPACITY + i] != (uint32_t)(keyHash >> 8)) {
+                // tag false positive
+                nfalse++;
+                continue;
+            }
             entries.emplace_back((pos << 4) | i, chunk.values[i]);
-            if (kHashIndexStats) _nentry++;
         }
+        uint32_t ret;
         if (sz == HashChunk::CAPACITY) {
             uint64_t step =  tag*2+1; // 1;
             pos = (pos + step) & _chunk_mask;
-            if (pos == orig_pos) {
-                return NOSLOT;
+            if (pos != orig_pos) {
+                continue;
             }
+            ret = NOSLOT;
         } else {
-            return (pos << 4) | sz;
+            ret = (pos << 4) | sz;
+        }
+        if (stats) {
+            stats->probes += nprobe;
+            stats->entries += entries.size() - nentry;
+            stats->tag_false_positives += nfalse;
         }
+        return ret;
     }
 }
 
 void HashIndex::set(uint32_t slot, uint64_t keyHash, uint32_t value) {
-    if (kHashIndexStats) _nset++;
     uint32_t pos = slot >> 4;
     uint32_t tpos = slot & 0xf;
     HashChunk& chunk = _chunks[pos];
@@ -111,6 +147,9 @@ void HashIndex::set(uint32_t slot, uint64_t keyHash, uint32_t value) {
     }
     chunk.tags[tpos] = tag;
     chunk.values[tpos] = value;
+    if (_hashes) {
+        _hashes[pos * HashChunk::CAPACITY + tpos] = (uint32_t)(keyHash >> 8);
+    }
     if (tpos == chunk.size) {
         chunk.size.store(tpos+1, std::memory_order_release);
         _size++;
@@ -118,7 +157,6 @@ void HashIndex::set(uint32_t slot, uint64_t keyHash, uint32_t value) {
 }
 
 bool HashIndex::add(uint64_t keyHash, uint32_t value) {
-    if (kHashIndexStats) _nfind++;
     uint64_t tag = keyHash & 0xff;
     if (tag == 0) {
         tag = 1;
@@ -126,7 +164,6 @@ bool HashIndex::add(uint64_t keyHash, uint32_t value) {
     uint64_t pos = (keyHash >> 8) & _chunk_mask;
     uint64_t orig_pos = pos;
     while (true) {
-        if (kHashIndexStats) _nprobe++;
         HashChunk& chunk = _chunks[pos];
         if (chunk.size == HashChunk::CAPACITY) {
             uint64_t step =  tag*2+1; // 1;
@@ -137,6 +174,9 @@ bool HashIndex::add(uint64_t keyHash, uint32_t value) {
         } else {
             chunk.tags[chunk.size] = tag;
             chunk.values[chunk.size] = value;
+            if (_hashes) {
+                _hashes[pos * HashChunk::CAPACITY + chunk.size] = (uint32_t)(keyHash >> 8);
+            }
             chunk.size++;
             _size++;
             return true;
@@ -145,11 +185,25 @@ bool HashIndex::add(uint64_t keyHash, uint32_t value) {
 }
 
 
-void HashIndex::clear_stats() {
-    _nfind = 0;
-    _nentry = 0;
-    _nprobe = 0;
-    _nset = 0;
+bool HashIndex::add_all(const HashIndex& src, uint32_t max_value) {
+    DCHECK(src.full_hash());
+    for (size_t pos = 0; pos < src._num_chunks; pos++) {
+        const HashChunk& chunk = src._chunks[pos];
+        uint32_t sz = std::min(chunk.size.load(std::memory_order_acquire), (uint32_t)HashChunk::CAPACITY);
+        for (uint32_t i = 0; i < sz; i++) {
+            uint32_t value = chunk.values[i];
+            if (value >= max_value) {
+                continue;
+            }
+            // tag is the low 8 bits, hashes keep the next 32 bits which
+            // decide chunk position
+            uint64_t keyHash = ((uint64_t)src._hashes[pos * HashChunk::CAPACITY + i] << 8) | chunk.tags[i];
+            if (!add(keyHash, value)) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 void HashIndex::dump() {
@@ -163,9 +217,6 @@ void HashIndex::dump() {
     Log("chunk: %zu %.1fM capacity: %zu/%zu slot util: %.3f",
         _num_chunks, _num_chunks*64.0f/(1024*1024), size(), max_size(),
         size() / (_num_chunks*12.0f));
-    if (kHashIndexStats) {
-        Log("find: %zu entry: %zu(%.3f) probe: %zu(%.3f)", _nfind, _nentry, (float)_nentry/_nfind, _nprobe, (float)_nprobe/_nfind);
-    }
 }
 
 
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "common.h"
+#include "mem_tracker.h"
 
 namespace choco {
 
@@ -16,13 +17,34 @@ struct HashChunk;
 class HashIndex : public RefCounted {
 public:
     static const uint32_t NOSLOT = (uint32_t)-1;
+    // slot is (chunk << 4) | idx in uint32, larger capacity is clamped
+    static const size_t kMaxChunks = (size_t)1 << 28;
     struct Entry {
         Entry(uint32_t slot, uint32_t value) : slot(slot), value(value) {}
         uint32_t slot;
         uint32_t value;
     };
 
-    HashIndex(size_t capacity);
+    // work done by find calls, accumulated by caller
+    struct FindStats {
+        // chunks visited
+        size_t probes = 0;
+        // entries returned
+        size_t entries = 0;
+        // entries with matching tag but different full hash
+        size_t tag_false_positives = 0;
+    };
+
+    /**
+     * chunks are charged to tracker as index memory if not nullptr,
+     * capacity() is 0 if allocation fails or exceeds memory limit.
+     *
+     * Each entry keeps an 8-bit tag of its hash, with full_hash a parallel
+     * array keeps 32 more hash bits per entry(48 bytes per 64 byte
+     * chunk), so find returns fewer false positives and add_all can
+     * rebuild an index without recomputing hashes from keys.
+     */
+    HashIndex(size_t capacity, MemTracker* tracker=nullptr, bool full_hash=false);
     ~HashIndex();
 
     size_t size() { return _size; }
@@ -31,18 +53,32 @@ public:
 
     size_t capacity();
 
-    uint32_t find(uint64_t keyHash, std::vector<Entry> &entries);
+    /**
+     * append entries which may match keyHash, return the free slot of
+     * keyHash, or NOSLOT if index is full. if stats is not nullptr, add
+     * probes and entries of this call to it
+     */
+    uint32_t find(uint64_t keyHash, std::vector<Entry> &entries, FindStats* stats=nullptr);
+
+    // prefetch the first chunk find(keyHash) visits, for batched finds
+    void prefetch(uint64_t keyHash) const;
 
     void set(uint32_t entry, uint64_t keyHash, uint32_t value);
 
     bool add(uint64_t keyHash, uint32_t value);
 
+    bool full_hash() const { return _full_hash; }
+
+    /**
+     * add all entries of src(which should have full_hash) whose value
+     * is less than max_value, return false if this index is full
+     */
+    bool add_all(const HashIndex& src, uint32_t max_value);
+
     bool need_rehash() {
         return _size >= _max_size;
     }
 
-    void clear_stats();
-
     void dump();
 
 private:
@@ -51,11 +87,11 @@ private:
     size_t _max_size;
     size_t _num_chunks;
     size_t _chunk_mask;
-    size_t _nfind;
-    size_t _nentry;
-    size_t _nprobe;
-    size_t _nset;
     HashChunk* _chunks;
+    // hash bits 8~40 of entries, CAPACITY per chunk, only with full_hash
+    uint32_t* _hashes;
+    bool _full_hash;
+    RefPtr<MemTracker> _tracker;
 };
 
 }
@@ -33,12 +33,12 @@ TEST(HashIndex, findset) {
     }
     hi.dump();
     // search
-    hi.clear_stats();
+    HashIndex::FindStats stats;
     Log("search %zu values, start", sz);
     for (size_t i=0;i<sz*2;i+=2) {
         uint64_t keyHash = HashCode(i);
         entries.clear();
-        uint32_t slot = hi.find(keyHash, entries);
+        hi.find(keyHash, entries, &stats);
         uint32_t fslot = HashIndex::NOSLOT;
         for (auto& e : entries) {
             //printf("check entry: %u %u", e.slot, e.value);
@@ -58,6 +58,11 @@ TEST(HashIndex, findset) {
         }
     }
     hi.dump();
+    Log("find: %zu entry: %zu(%.3f) probe: %zu(%.3f)", sz, stats.entries, (float)stats.entries/sz,
+        stats.probes, (float)stats.probes/sz);
+    EXPECT_GE(stats.probes, sz);
+    EXPECT_GE(stats.entries, sz);
+    EXPECT_EQ(0U, stats.tag_false_positives);
 }
 
 TEST(HashIndex, add) {
@@ -87,5 +92,49 @@ TEST(HashIndex, add) {
     }
 }
 
+TEST(HashIndex, full_hash) {
+    size_t N = 100000;
+    HashIndex tagged(N);
+    HashIndex hi(N, nullptr, true);
+    EXPECT_TRUE(hi.full_hash());
+    for (size_t i = 0; i < N; ++i) {
+        EXPECT_TRUE(tagged.add(HashCode(i), i));
+        EXPECT_TRUE(hi.add(HashCode(i), i));
+    }
+    std::vector<HashIndex::Entry> entries;
+    size_t ntagged = 0;
+    size_t nfull = 0;
+    HashIndex::FindStats stats;
+    for (size_t i = 0; i < N; ++i) {
+        entries.clear();
+        tagged.find(HashCode(i), entries);
+        ntagged += entries.size();
+        entries.clear();
+        hi.find(HashCode(i), entries, &stats);
+        nfull += entries.size();
+        ASSERT_EQ(entries.size(), 1);
+        EXPECT_EQ(entries[0].value, i);
+    }
+    LOG(INFO) << Format("find entries per key: tag only %.4lf full hash %.4lf",
+                        (double)ntagged / N, (double)nfull / N);
+    EXPECT_LT(nfull, ntagged);
+    // same layout, tag only index returns the false positives as entries
+    EXPECT_EQ(nfull, stats.entries);
+    EXPECT_EQ(ntagged - nfull, stats.tag_false_positives);
+    // rebuild without hashing keys, drop values >= N/2
+    HashIndex larger(N * 2, nullptr, true);
+    ASSERT_TRUE(larger.add_all(hi, N / 2));
+    EXPECT_EQ(larger.size(), N / 2);
+    for (size_t i = 0; i < N; ++i) {
+        entries.clear();
+        larger.find(HashCode(i), entries);
+        if (i < N / 2) {
+            ASSERT_EQ(entries.size(), 1);
+            EXPECT_EQ(entries[0].value, i);
+        } else {
+            EXPECT_EQ(entries.size(), 0);
+        }
+    }
 }
 
+}
@@ -1,24 +1,42 @@
 #include "mem_sub_tablet.h"
 #include "partial_row_batch.h"
+#include "bitmap.h"
+#include "thread_pool.h"
 
 namespace choco {
 
-Status MemSubTablet::create(uint64_t version, const Schema& schema, unique_ptr<MemSubTablet>& ret) {
-	unique_ptr<MemSubTablet> tmp(new MemSubTablet());
+Status MemSubTablet::create(uint64_t version, const Schema& schema, MemTracker* tracker,
+                            uint64_t base_rid, size_t max_rows, unique_ptr<MemSubTablet>& ret) {
+	if (max_rows == 0 || max_rows > kMaxRows) {
+		return Status::InvalidArgument(Format("invalid sub-tablet max rows %zu", max_rows));
+	}
+	unique_ptr<MemSubTablet> tmp(new MemSubTablet(tracker ? tracker : MemTracker::process(),
+	                                              base_rid, max_rows));
+	if (tmp->_index->capacity() == 0) {
+		return Status::OOM("create hash index exceeds memory limit");
+	}
 	tmp->_versions.reserve(64);
 	tmp->_versions.emplace_back(version, 0);
 	tmp->_columns.resize(schema.cid_size());
 	for (auto& c : schema.columns()) {
-		// TODO: support storage_type != c.type
-		RefPtr<Column> column(new Column(c, c.type, version), false);
+		// integer columns and dictionary codes use adaptive storage width,
+		// starting from 1 byte, unless column is plain
+		Type storage_type = c.type;
+		if (c.dict || (!c.plain && (c.type == Int16 || c.type == Int32 || c.type == Int64))) {
+			storage_type = Int8;
+		}
+		RefPtr<Column> column(new Column(c, storage_type, version, tmp->_mem_tracker.get()), false);
 		tmp->_columns[c.cid].swap(column);
 	}
 	tmp.swap(ret);
 	return Status::OK();
 }
 
-MemSubTablet::MemSubTablet() :
-	_index(new HashIndex(1<<16), false) {
+MemSubTablet::MemSubTablet(MemTracker* tracker, uint64_t base_rid, size_t max_rows) :
+	_base_rid(base_rid),
+	_max_rows(max_rows),
+	_mem_tracker(tracker),
+	_index(new HashIndex(1<<16, tracker, kFullHashIndex), false) {
 }
 
 MemSubTablet::~MemSubTablet() {
@@ -90,28 +108,64 @@ Status MemSubTablet::begin_write(const Schema& schema) {
     _num_insert = 0;
     _num_update = 0;
     _num_update_cell = 0;
+    _num_apply = 0;
+    _timing.clear();
     return Status::OK();
 }
 
-Status MemSubTablet::apply_partial_row(const PartialRowReader& row) {
+static uint64_t RowHashCode(const PartialRowReader& row, ColumnWriter* keyw, const void* key) {
+    return keyw->hashcode(key);
+}
+
+static uint64_t RowHashCode(const PreparedRowReader& row, ColumnWriter* keyw, const void* key) {
+    return row.hashcode();
+}
+
+Status MemSubTablet::apply_partial_row(const PartialRowReader& row, bool& applied) {
+    return apply_row(row, applied);
+}
+
+Status MemSubTablet::apply_prepared_row(const PreparedRowReader& row, bool& applied) {
+    return apply_row(row, applied);
+}
+
+template <class RowReader>
+Status MemSubTablet::apply_row(const RowReader& row, bool& applied) {
     DCHECK(row.cell_size() >= 1);
     const ColumnSchema* dsc;
     const void * key;
     // get key column
     row.get_cell(0, dsc, key);
     ColumnWriter* keyw = _writers[1].get();
-    uint64_t hashcode = keyw->hashcode(key);
+    bool sample = CommitTiming::sample_row(_num_apply++);
+    int64_t t0 = sample ? CycleClock::Now() : 0;
+    uint64_t hashcode = RowHashCode(row, keyw, key);
     _temp_hash_entries.clear();
     uint32_t newslot = _write_index->find(hashcode, _temp_hash_entries);
+    int64_t t1 = 0;
+    if (sample) {
+        t1 = CycleClock::Now();
+        _timing.add_sampled(CommitHashProbe, t1 - t0);
+    }
     uint32_t rid = -1;
     for (size_t i=0;i<_temp_hash_entries.size();i++) {
         uint32_t test_rid = _temp_hash_entries[i].value;
-        if (keyw->equals(test_rid, key)) {
+        // entries added by aborted writes may point beyond current rows
+        if (test_rid < _row_size && keyw->equals(test_rid, key)) {
             rid = test_rid;
             break;
         }
     }
+    int64_t t2 = 0;
+    if (sample) {
+        t2 = CycleClock::Now();
+        _timing.add_sampled(CommitKeyCompare, t2 - t1);
+    }
     if (rid == -1) {
+        if (_row_size >= max_rows()) {
+            applied = false;
+            return Status::OK();
+        }
         // insert
         _num_insert++;
         rid = _row_size;
@@ -141,29 +195,281 @@ Status MemSubTablet::apply_partial_row(const PartialRowReader& row) {
             }
         }
     }
+    applied = true;
+    if (sample) {
+        _timing.add_sampled(CommitColumnInsert, CycleClock::Now() - t2);
+    }
+    if (_write_index->need_rehash()) {
+        RETURN_NOT_OK(expand_index(_row_size * 2));
+    }
+    return Status::OK();
+}
+
+Status MemSubTablet::insert_partial_row(const PartialRowReader& row, bool verify, bool& applied) {
+    DCHECK(row.cell_size() >= 1);
+    const ColumnSchema* dsc;
+    const void * key;
+    row.get_cell(0, dsc, key);
+    ColumnWriter* keyw = _writers[1].get();
+    bool sample = CommitTiming::sample_row(_num_apply++);
+    int64_t t0 = sample ? CycleClock::Now() : 0;
+    uint64_t hashcode = keyw->hashcode(key);
+    uint32_t slot = HashIndex::NOSLOT;
+    if (verify) {
+        if (find_key(hashcode, key, _row_size, slot) != (uint32_t)-1) {
+            return Status::InvalidArgument("insert only write with existing key");
+        }
+    }
+    int64_t t1 = 0;
+    if (sample) {
+        t1 = CycleClock::Now();
+        _timing.add_sampled(CommitHashProbe, t1 - t0);
+    }
+    if (_row_size >= max_rows()) {
+        applied = false;
+        return Status::OK();
+    }
+    _num_insert++;
+    uint32_t rid = _row_size;
+    for (size_t i=0;i<row.cell_size();i++) {
+        const void * data;
+        RETURN_NOT_OK(row.get_cell(i, dsc, data));
+        uint32_t cid = dsc->cid;
+        RETURN_NOT_OK(prepare_writer_for_column(cid));
+        RETURN_NOT_OK(_writers[cid]->insert(rid, data));
+    }
+    if (verify) {
+        _write_index->set(slot, hashcode, rid);
+    } else if (!_write_index->add(hashcode, rid)) {
+        // probe sequence is full, need_rehash may not be reached yet
+        RETURN_NOT_OK(expand_index(_row_size * 2));
+        CHECK(_write_index->add(hashcode, rid));
+    }
+    _row_size++;
+    applied = true;
+    if (sample) {
+        _timing.add_sampled(CommitColumnInsert, CycleClock::Now() - t1);
+    }
     if (_write_index->need_rehash()) {
-        RefPtr<HashIndex> new_index;
-        // TODO: trace and limit memory usage
-        size_t new_capacity = _row_size * 2;
-        while (true) {
-            new_index = rebuild_hash_index(new_capacity);
-            if (new_index) {
-                break;
-            } else {
-                new_capacity += 1<<16;
+        RETURN_NOT_OK(expand_index(_row_size * 2));
+    }
+    return Status::OK();
+}
+
+void MemSubTablet::hash_keys(const ColumnarBatch& batch, vector<uint64_t>& hashcodes) {
+    ColumnWriter* keyw = _writers[1].get();
+    const uint8_t* keys = (const uint8_t*)batch.column_data(0);
+    size_t esize = TypeInfo::get(batch.column_schema(0)->type).size();
+    hashcodes.resize(batch.row_size());
+    for (size_t i = 0; i < hashcodes.size(); i++) {
+        hashcodes[i] = keyw->hashcode(keys + i * esize);
+    }
+}
+
+Status MemSubTablet::apply_columnar_batch(const ColumnarBatch& batch, const vector<uint64_t>& hashcodes,
+                                          WriteMode mode, vector<uint8_t>& applied, size_t& napplied) {
+    size_t nrow = batch.row_size();
+    if (napplied == nrow) {
+        return Status::OK();
+    }
+    int64_t t0 = CycleClock::Now();
+    ColumnWriter* keyw = _writers[1].get();
+    const uint8_t* keys = (const uint8_t*)batch.column_data(0);
+    size_t key_esize = TypeInfo::get(batch.column_schema(0)->type).size();
+    // (row, rid) of inserted and updated rows, in row order
+    vector<std::pair<uint32_t, uint32_t>> inserts;
+    vector<std::pair<uint32_t, uint32_t>> updates;
+    for (size_t row = 0; row < nrow; row++) {
+        if (row + kAppendPrefetchDistance < nrow) {
+            _write_index->prefetch(hashcodes[row + kAppendPrefetchDistance]);
+        }
+        if (applied[row]) {
+            continue;
+        }
+        const void* key = keys + row * key_esize;
+        uint32_t slot = HashIndex::NOSLOT;
+        if (mode != WriteInsertOnly) {
+            uint32_t rid = find_key(hashcodes[row], key, _row_size, slot);
+            if (rid != (uint32_t)-1) {
+                if (mode == WriteInsertOnlyVerify) {
+                    return Status::InvalidArgument("insert only write with existing key");
+                }
+                updates.emplace_back(row, rid);
+                applied[row] = 1;
+                napplied++;
+                continue;
+            }
+        }
+        if (_row_size >= max_rows()) {
+            continue;
+        }
+        uint32_t rid = _row_size;
+        // key is written here, so later rows of the batch can compare it
+        RETURN_NOT_OK(keyw->insert(rid, key));
+        if (mode != WriteInsertOnly) {
+            _write_index->set(slot, hashcodes[row], rid);
+        } else if (!_write_index->add(hashcodes[row], rid)) {
+            RETURN_NOT_OK(expand_index(_row_size * 2));
+            CHECK(_write_index->add(hashcodes[row], rid));
+        }
+        _row_size++;
+        inserts.emplace_back(row, rid);
+        applied[row] = 1;
+        napplied++;
+        if (_write_index->need_rehash()) {
+            RETURN_NOT_OK(expand_index(_row_size * 2));
+        }
+    }
+    int64_t t1 = CycleClock::Now();
+    _timing.add(CommitHashProbe, t1 - t0);
+    for (size_t idx = 1; idx < batch.num_columns(); idx++) {
+        uint32_t cid = batch.column_schema(idx)->cid;
+        RETURN_NOT_OK(prepare_writer_for_column(cid));
+        ColumnWriter* w = _writers[cid].get();
+        const uint8_t* data = (const uint8_t*)batch.column_data(idx);
+        const uint8_t* nulls = batch.column_nulls(idx);
+        size_t esize = TypeInfo::get(batch.column_schema(idx)->type).size();
+        // rids of inserts are consecutive, runs of consecutive rows are
+        // inserted at once
+        for (size_t i = 0; i < inserts.size();) {
+            size_t j = i + 1;
+            while (j < inserts.size() && inserts[j].first == inserts[j - 1].first + 1) {
+                j++;
             }
+            uint32_t row = inserts[i].first;
+            RETURN_NOT_OK(w->insert_batch(inserts[i].second, j - i, data + row * esize, nulls, row));
+            i = j;
+        }
+        // after inserts, a row may update a key inserted by an earlier row
+        for (auto& e : updates) {
+            bool isnull = nulls && BitmapTest(nulls, e.first);
+            RETURN_NOT_OK(w->update(e.second, isnull ? nullptr : data + e.first * esize));
         }
-        _write_index = new_index;
     }
+    _timing.add(CommitColumnInsert, CycleClock::Now() - t1);
+    _num_apply += inserts.size() + updates.size();
+    _num_insert += inserts.size();
+    _num_update += updates.size();
+    _num_update_cell += updates.size() * (batch.num_columns() - 1);
     return Status::OK();
 }
 
-Status MemSubTablet::commit_write(uint64_t version) {
+uint32_t MemSubTablet::find_key(uint64_t hashcode, const void* key, uint32_t limit, uint32_t& slot) {
+    ColumnWriter* keyw = _writers[1].get();
+    _temp_hash_entries.clear();
+    slot = _write_index->find(hashcode, _temp_hash_entries);
+    for (size_t i=0;i<_temp_hash_entries.size();i++) {
+        uint32_t test_rid = _temp_hash_entries[i].value;
+        if (test_rid < limit && keyw->equals(test_rid, key)) {
+            return test_rid;
+        }
+    }
+    return -1;
+}
+
+Status MemSubTablet::check_keys_absent(const ColumnArray& keys, size_t offset, size_t n) {
+    ColumnWriter* keyw = _writers[1].get();
+    size_t esize = TypeInfo::get(_schema->get(1)->type).size();
+    for (size_t i = offset; i < offset + n; i++) {
+        const void* key = (const uint8_t*)keys.data + i * esize;
+        uint32_t slot;
+        if (find_key(keyw->hashcode(key), key, _row_size, slot) != (uint32_t)-1) {
+            return Status::InvalidArgument(Format("append key of row %zu already exists", i));
+        }
+    }
+    return Status::OK();
+}
+
+Status MemSubTablet::append_columns(const vector<const ColumnArray*>& columns, size_t offset, size_t n,
+                                    size_t& appended) {
+    appended = 0;
+    size_t limit = max_rows();
+    n = std::min(n, limit - std::min(limit, _row_size));
+    if (n == 0) {
+        return Status::OK();
+    }
+    // make room for all keys first, so index isn't rebuilt in the middle
+    if (_write_index->size() + n > _write_index->max_size()) {
+        RETURN_NOT_OK(expand_index((_row_size + n) * 2));
+    }
+    int64_t t0 = CycleClock::Now();
+    uint32_t rid = _row_size;
+    for (uint32_t cid = 1; cid < columns.size(); cid++) {
+        const ColumnArray* col = columns[cid];
+        if (!col) {
+            continue;
+        }
+        size_t esize = TypeInfo::get(_schema->get(cid)->type).size();
+        RETURN_NOT_OK(prepare_writer_for_column(cid));
+        RETURN_NOT_OK(_writers[cid]->insert_batch(rid, n, (const uint8_t*)col->data + offset * esize,
+                                                  col->nulls, offset));
+    }
+    int64_t t1 = CycleClock::Now();
+    _timing.add(CommitColumnInsert, t1 - t0);
+    // key column is written, keys are compared against earlier rows of
+    // this append too. Hashes of a block are computed first, so index
+    // chunks can be prefetched ahead of finds
+    ColumnWriter* keyw = _writers[1].get();
+    size_t key_esize = TypeInfo::get(_schema->get(1)->type).size();
+    const uint8_t* keys = (const uint8_t*)columns[1]->data + offset * key_esize;
+    vector<uint64_t> hashcodes(std::min(n, (size_t)Column::BLOCK_SIZE));
+    for (size_t start = 0; start < n; start += hashcodes.size()) {
+        size_t cnt = std::min(n - start, hashcodes.size());
+        for (size_t i = 0; i < cnt; i++) {
+            hashcodes[i] = keyw->hashcode(keys + (start + i) * key_esize);
+        }
+        for (size_t i = 0; i < cnt; i++) {
+            if (i + kAppendPrefetchDistance < cnt) {
+                _write_index->prefetch(hashcodes[i + kAppendPrefetchDistance]);
+            }
+            uint32_t slot;
+            if (find_key(hashcodes[i], keys + (start + i) * key_esize, rid + start + i, slot) != (uint32_t)-1) {
+                return Status::InvalidArgument(Format("append key of row %zu already exists", offset + start + i));
+            }
+            _write_index->set(slot, hashcodes[i], rid + start + i);
+        }
+    }
+    _timing.add(CommitHashProbe, CycleClock::Now() - t1);
+    _row_size += n;
+    _num_insert += n;
+    appended = n;
+    return Status::OK();
+}
+
+Status MemSubTablet::finalize_writers(uint64_t version) {
+    vector<ColumnWriter*> writers;
+    writers.reserve(_writers.size());
     for (size_t cid=0;cid<_writers.size();cid++) {
         if (_writers[cid]) {
-            _writers[cid]->finalize(version);
+            writers.push_back(_writers[cid].get());
         }
     }
+    if (writers.size() < kParallelFinalizeMinColumns) {
+        for (auto w : writers) {
+            RETURN_NOT_OK(w->finalize(version));
+        }
+        return Status::OK();
+    }
+    // column writers are independent, finalize them in parallel
+    vector<Status> rets(writers.size());
+    ThreadPool::global().parallel_for(writers.size(), [&](size_t i) {
+        rets[i] = writers[i]->finalize(version);
+    });
+    for (auto& ret : rets) {
+        RETURN_NOT_OK(ret);
+    }
+    return Status::OK();
+}
+
+Status MemSubTablet::finalize_write(uint64_t version) {
+    int64_t t0 = CycleClock::Now();
+    RETURN_NOT_OK(finalize_writers(version));
+    _timing.add(CommitDeltaFinalize, CycleClock::Now() - t0);
+    return Status::OK();
+}
+
+void MemSubTablet::publish_write(uint64_t version) {
+    int64_t t0 = CycleClock::Now();
     {
         std::lock_guard<mutex> lg(_lock);
         if (_index != _write_index) {
@@ -176,20 +482,71 @@ Status MemSubTablet::commit_write(uint64_t version) {
         }
         _versions.emplace_back(version, _row_size);
     }
+    _timing.add(CommitPublish, CycleClock::Now() - t0);
+    _write_index.reset();
+    _writers.clear();
+    _schema = nullptr;
+    LOG(INFO) << Format("commit writex(insert=%zu update=%zu update_cell=%zu) %.3lfs %s",
+            _num_insert,
+            _num_update,
+            _num_update_cell,
+            Time() - _write_start,
+            _timing.to_string().c_str());
+}
+
+void MemSubTablet::abort_write() {
+    // writers append pages and deltas to live columns unless they made a
+    // COW copy, roll them back to the committed state. Entries added to a
+    // shared index are skipped by rid check in apply_partial_row
+    for (auto& w : _writers) {
+        if (w) {
+            w->abort(latest_size());
+        }
+    }
     _write_index.reset();
     _writers.clear();
-    LOG(INFO) << Format("commit writex(insert=%zu update=%zu update_cell=%zu) %.3lfs",
+    _schema = nullptr;
+    LOG(INFO) << Format("abort writetx(insert=%zu update=%zu update_cell=%zu) %.3lfs",
             _num_insert,
             _num_update,
             _num_update_cell,
             Time() - _write_start);
+}
+
+Status MemSubTablet::expand_index(size_t new_capacity) {
+    int64_t t0 = CycleClock::Now();
+    RefPtr<HashIndex> new_index;
+    for (size_t i = 0; !new_index; i++) {
+        if (i == kMaxRebuildIndexRetry) {
+            return Status::RuntimeError(Format("rebuild hash index failed, capacity=%zu", new_capacity));
+        }
+        RETURN_NOT_OK(rebuild_hash_index(new_capacity, new_index));
+        new_capacity *= 2;
+    }
+    _write_index = new_index;
+    _timing.add(CommitIndexRehash, CycleClock::Now() - t0);
     return Status::OK();
 }
 
-RefPtr<HashIndex> MemSubTablet::rebuild_hash_index(size_t new_capacity) {
+// return OK with null ret if capacity is too small
+Status MemSubTablet::rebuild_hash_index(size_t new_capacity, RefPtr<HashIndex>& ret) {
     double t0 = Time();
     ColumnWriter* keyw = _writers[1].get();
-    RefPtr<HashIndex> hi(new HashIndex(new_capacity), false);
+    RefPtr<HashIndex> hi(new HashIndex(new_capacity, _mem_tracker.get(), kFullHashIndex), false);
+    if (hi->capacity() == 0) {
+        return Status::OOM(Format("rebuild hash index %zu exceeds memory limit", new_capacity));
+    }
+    if (_write_index->full_hash()) {
+        // in memory reshuffle, also drops entries left by aborted writes
+        if (!hi->add_all(*_write_index, _row_size)) {
+            LOG(INFO) << Format("Rebuild hash index %zu failed time: %.3lfs, expand", new_capacity, Time()-t0);
+            ret.reset();
+            return Status::OK();
+        }
+        ret = hi;
+        LOG(INFO) << Format("Rebuild hash index %zu from hashes time: %.3lfs", new_capacity, Time()-t0);
+        return Status::OK();
+    }
     for (size_t i=0;i<_row_size;i++) {
         const void * data = keyw->get(i);
         DCHECK_NOTNULL(data);
@@ -197,13 +554,14 @@ RefPtr<HashIndex> MemSubTablet::rebuild_hash_index(size_t new_capacity) {
         if (!hi->add(hashcode, i)) {
             double t1 = Time();
             LOG(INFO) << Format("Rebuild hash index %zu failed time: %.3lfs, expand", new_capacity, t1-t0);
-            return RefPtr<HashIndex>();
+            ret.reset();
+            return Status::OK();
         }
     }
     double t1 = Time();
     LOG(INFO) << Format("Rebuild hash index %zu time: %.3lfs", new_capacity, t1-t0);
-    return hi;
+    ret = hi;
+    return Status::OK();
 }
 
-
 } /* namespace choco */
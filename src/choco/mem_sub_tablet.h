@@ -4,18 +4,40 @@
 #include "common.h"
 #include "hash_index.h"
 #include "column.h"
+#include "metrics.h"
+#include "write_tx.h"
 
 namespace choco {
 
-class PartialRowReader;
-
+/**
+ * Row ids inside a sub-tablet are uint32, a tablet scales beyond 4B rows
+ * by adding sub-tablets, the tablet wide(64-bit) row id of a row is
+ * base_rid() + its rid in sub-tablet.
+ */
 class MemSubTablet {
 public:
-	static Status create(uint64_t version, const Schema& schema, unique_ptr<MemSubTablet>& ret);
+	// default max rows of a sub-tablet, keeps hash index slots in uint32
+	static const size_t kMaxRows = (size_t)1 << 30;
+
+	// columns and index are charged to tracker(process tracker if nullptr)
+	static Status create(uint64_t version, const Schema& schema, MemTracker* tracker,
+	                     uint64_t base_rid, size_t max_rows, unique_ptr<MemSubTablet>& ret);
 
 	~MemSubTablet();
 
+    uint64_t base_rid() const { return _base_rid; }
+    // version this sub-tablet is created at
+    uint64_t first_version() const { return _versions[0].version; }
+
+    size_t max_rows() const { return _max_rows.load(std::memory_order_relaxed); }
+    // only affects later inserts, may be called during a write
+    void set_max_rows(size_t max_rows) { _max_rows.store(max_rows, std::memory_order_relaxed); }
+
     size_t latest_size() const { return _versions.back().size; }
+    // version of the last published write
+    uint64_t latest_version() const { return _versions.back().version; }
+    // number of rows including rows inserted by current write
+    size_t write_size() const { return _row_size; }
     Status get_size(uint64_t version, size_t& size) const;
     Status read_column(uint64_t version, uint32_t cid, unique_ptr<ColumnReader>& reader);
     Status read_index(RefPtr<HashIndex>& index);
@@ -24,17 +46,81 @@ public:
      * caller should make sure schema valid during write
      */
     Status begin_write(const Schema& schema);
-    Status apply_partial_row(const PartialRowReader& row);
-    Status commit_write(uint64_t version);
+    /**
+     * update row if its key exists, otherwise insert it if there are less
+     * than max_rows rows, applied is false if row is neither updated nor
+     * inserted(sub-tablet is full)
+     */
+    Status apply_partial_row(const PartialRowReader& row, bool& applied);
+    // same as apply_partial_row, with key hash computed by prepare
+    Status apply_prepared_row(const PreparedRowReader& row, bool& applied);
+    /**
+     * insert rows [offset, offset+n) of columns(indexed by cid, nullptr
+     * if not written), at most until max_rows, keys must not exist,
+     * appended is number of rows inserted
+     */
+    Status append_columns(const vector<const ColumnArray*>& columns, size_t offset, size_t n,
+                          size_t& appended);
+    // InvalidArgument if any of keys[offset, offset+n) exists
+    Status check_keys_absent(const ColumnArray& keys, size_t offset, size_t n);
+    /**
+     * insert row if there are less than max_rows rows, without checking
+     * whether its key exists(see WriteInsertOnly), with verify key is
+     * looked up and InvalidArgument is returned if it exists
+     */
+    Status insert_partial_row(const PartialRowReader& row, bool verify, bool& applied);
+    // hashes of keys of all rows of batch
+    void hash_keys(const ColumnarBatch& batch, vector<uint64_t>& hashcodes);
+    /**
+     * apply rows of batch not applied yet(applied[row] is 0) by column,
+     * hashcodes are their key hashes. Rows whose key exists update it
+     * (or fail for WriteInsertOnlyVerify), others are inserted in order
+     * until max_rows, without key lookup for WriteInsertOnly. Applied
+     * rows are marked in applied and counted in napplied
+     */
+    Status apply_columnar_batch(const ColumnarBatch& batch, const vector<uint64_t>& hashcodes, WriteMode mode,
+                                vector<uint8_t>& applied, size_t& napplied);
+    /**
+     * commit is two phases so a write spanning sub-tablets is all or
+     * nothing: finalize_write does everything which may fail(e.g. OOM),
+     * after it succeeds on all sub-tablets publish_write makes the write
+     * visible to readers and can't fail
+     */
+    Status finalize_write(uint64_t version);
+    void publish_write(uint64_t version);
+    // discard current write, e.g. when apply_partial_row or
+    // finalize_write fails with OOM, not allowed after publish_write
+    void abort_write();
+    // phase timing of current(or last) write
+    const CommitTiming& write_timing() const { return _timing; }
 
 private:
     DISALLOW_COPY_AND_ASSIGN(MemSubTablet);
 
-    MemSubTablet();
+    // finalize in parallel only when there are enough column writers
+    static const size_t kParallelFinalizeMinColumns = 8;
+    // keep full hash bits in index, so rebuild doesn't read key column
+    static const bool kFullHashIndex = true;
+    // max times to expand capacity when rebuilding hash index
+    static const size_t kMaxRebuildIndexRetry = 4;
+    // rows ahead to prefetch index chunks when appending keys
+    static const size_t kAppendPrefetchDistance = 16;
+
+    MemSubTablet(MemTracker* tracker, uint64_t base_rid, size_t max_rows);
     Status prepare_writer_for_column(uint32_t cid);
-    RefPtr<HashIndex> rebuild_hash_index(size_t new_capacity);
+    template <class RowReader>
+    Status apply_row(const RowReader& row, bool& applied);
+    Status finalize_writers(uint64_t version);
+    Status rebuild_hash_index(size_t new_capacity, RefPtr<HashIndex>& ret);
+    // replace write index with a rebuilt one of at least new_capacity
+    Status expand_index(size_t new_capacity);
+    // rid of key among rows [0, limit), -1 if not found
+    uint32_t find_key(uint64_t hashcode, const void* key, uint32_t limit, uint32_t& slot);
 
     mutable mutex _lock;
+    uint64_t _base_rid = 0;
+    std::atomic<size_t> _max_rows;
+    RefPtr<MemTracker> _mem_tracker;
     RefPtr<HashIndex> _index;
     struct VersionInfo {
     	VersionInfo(uint64_t version, uint64_t size) : version(version), size(size) {}
@@ -58,6 +144,8 @@ private:
     size_t _num_insert = 0;
     size_t _num_update = 0;
     size_t _num_update_cell = 0;
+    size_t _num_apply = 0;
+    CommitTiming _timing;
 };
 
 
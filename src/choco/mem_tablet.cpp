@@ -1,6 +1,7 @@
 #include "mem_tablet.h"
 #include "mem_tablet_scan.h"
 #include "mem_tablet_get.h"
+#include "bitmap.h"
 
 namespace choco {
 
@@ -12,17 +13,19 @@ Status MemTablet::create(const string& dir, unique_ptr<Schema>& schema, shared_p
     uint64_t version = 0;
     unique_ptr<MemSubTablet> st;
     unordered_map<uint32_t, RefPtr<Column>> columns;
-    RETURN_NOT_OK(MemSubTablet::create(version, *schema, st));
-    ret.reset(new MemTablet());
+    shared_ptr<MemTablet> tablet(new MemTablet(dir));
+    RETURN_NOT_OK(MemSubTablet::create(version, *schema, tablet->mem_tracker(), 0,
+                                       tablet->_sub_tablet_max_rows, st));
+    ret.swap(tablet);
     ret->_versions.reserve(8);
     ret->_versions.emplace_back(version, schema);
-    ret->_sub_tablet.swap(st);
+    ret->_sub_tablets.emplace_back(std::move(st));
     //tablet.swap(ret);
     return Status::OK();
 }
 
-MemTablet::MemTablet() {
-
+MemTablet::MemTablet(const string& dir) :
+        _mem_tracker(new MemTracker(Format("tablet %s", dir.c_str()), nullptr), false) {
 }
 
 MemTablet::~MemTablet() {
@@ -73,20 +76,272 @@ Status MemTablet::create_writetx(unique_ptr<WriteTx>& wtx) const {
 }
 
 Status MemTablet::prepare_writetx(unique_ptr<WriteTx>& wtx) {
-    return Status::OK();
+    return wtx->prepare();
+}
+
+void MemTablet::set_sub_tablet_max_rows(size_t max_rows) {
+    std::lock_guard<mutex> lg(_sub_tablets_lock);
+    _sub_tablet_max_rows = max_rows;
+    _sub_tablets.back()->set_max_rows(max_rows);
+}
+
+size_t MemTablet::num_sub_tablets() const {
+    std::lock_guard<mutex> lg(_sub_tablets_lock);
+    return _sub_tablets.size();
+}
+
+void MemTablet::get_sub_tablets(vector<MemSubTablet*>& sub_tablets) const {
+    std::lock_guard<mutex> lg(_sub_tablets_lock);
+    sub_tablets.clear();
+    for (auto& st : _sub_tablets) {
+        sub_tablets.push_back(st.get());
+    }
 }
 
 Status MemTablet::commit(unique_ptr<WriteTx>& wtx, uint64_t version) {
-    _sub_tablet->begin_write(latest_schema());
-    for (size_t i = 0; i< wtx->batch_size(); i++) {
-        auto batch = wtx->get_batch(i);
+    return write(version, [&](vector<MemSubTablet*>& sub_tablets,
+                              vector<unique_ptr<MemSubTablet>>& new_sub_tablets,
+                              CommitTiming& timing) {
+        return apply_writetx(*wtx, version, sub_tablets, new_sub_tablets, timing);
+    });
+}
+
+Status MemTablet::append_columns(size_t nrows, const vector<ColumnArray>& columns, uint64_t version) {
+    const Schema& schema = latest_schema();
+    // cid -> array
+    vector<const ColumnArray*> arrays(schema.cid_size(), nullptr);
+    for (auto& c : columns) {
+        const ColumnSchema* cs = schema.get(c.name);
+        if (!cs) {
+            return Status::NotFound(Format("append column %s not found", c.name.c_str()));
+        }
+        if (cs->type == String) {
+            return Status::NotSupported(Format("append string column %s not supported", c.name.c_str()));
+        }
+        if (arrays[cs->cid]) {
+            return Status::InvalidArgument(Format("append column %s duplicated", c.name.c_str()));
+        }
+        if (!c.data) {
+            return Status::InvalidArgument(Format("append column %s without data", c.name.c_str()));
+        }
+        arrays[cs->cid] = &c;
+    }
+    if (!arrays[1]) {
+        return Status::InvalidArgument("append without key column");
+    }
+    if (arrays[1]->nulls && !BitmapIsAllZero(arrays[1]->nulls, 0, nrows)) {
+        return Status::InvalidArgument("append null key");
+    }
+    return write(version, [&](vector<MemSubTablet*>& sub_tablets,
+                              vector<unique_ptr<MemSubTablet>>& new_sub_tablets,
+                              CommitTiming& timing) {
+        return apply_columns(nrows, arrays, version, sub_tablets, new_sub_tablets);
+    });
+}
+
+Status MemTablet::write(uint64_t version, const ApplyFunc& apply) {
+    // reject early instead of failing in the middle of a write
+    const MemTracker* exceeded = _mem_tracker->find_limit_exceeded();
+    if (exceeded) {
+        LOG(WARNING) << Format("reject commit version=%zu, memory limit exceeded:\n%s",
+                               version, exceeded->to_string(2).c_str());
+        return Status::OOM(Format("commit rejected, %s memory %zd exceeds limit %zd",
+                                  exceeded->label().c_str(),
+                                  exceeded->consumption(),
+                                  exceeded->limit()));
+    }
+    const Schema& schema = latest_schema();
+    vector<MemSubTablet*> sub_tablets;
+    get_sub_tablets(sub_tablets);
+    for (auto st : sub_tablets) {
+        RETURN_NOT_OK(st->begin_write(schema));
+    }
+    // not visible to readers until commit succeeds
+    vector<unique_ptr<MemSubTablet>> new_sub_tablets;
+    CommitTiming timing;
+    Status st = apply(sub_tablets, new_sub_tablets, timing);
+    // finalize all sub-tablets before publishing any, so a failure
+    // leaves none of the write visible
+    for (size_t i = 0; st && i < sub_tablets.size(); i++) {
+        st = sub_tablets[i]->finalize_write(version);
+    }
+    if (!st) {
+        for (auto sub_tablet : sub_tablets) {
+            sub_tablet->abort_write();
+        }
+        return st;
+    }
+    int64_t t0 = CycleClock::Now();
+    {
+        // scans set up under the same lock, so they see all sub-tablets
+        // of a commit or none
+        std::lock_guard<mutex> lg(_sub_tablets_lock);
+        for (auto sub_tablet : sub_tablets) {
+            sub_tablet->publish_write(version);
+        }
+        for (auto& sub_tablet : new_sub_tablets) {
+            _sub_tablets.emplace_back(std::move(sub_tablet));
+        }
+    }
+    timing.add(CommitPublish, CycleClock::Now() - t0);
+    for (auto sub_tablet : sub_tablets) {
+        timing.merge(sub_tablet->write_timing());
+    }
+    timing.record(MetricsRegistry::global());
+    return Status::OK();
+}
+
+static Status ApplyRow(MemSubTablet* sub_tablet, const PartialRowReader& reader, bool& applied) {
+    return sub_tablet->apply_partial_row(reader, applied);
+}
+
+static Status ApplyRow(MemSubTablet* sub_tablet, const PreparedRowReader& reader, bool& applied) {
+    return sub_tablet->apply_prepared_row(reader, applied);
+}
+
+Status MemTablet::apply_writetx(WriteTx& wtx, uint64_t version, vector<MemSubTablet*>& sub_tablets,
+                                vector<unique_ptr<MemSubTablet>>& new_sub_tablets,
+                                CommitTiming& timing) {
+    if (wtx.prepared()) {
+        PreparedRowReader reader(*wtx.prepared());
+        for (size_t j = 0; j < reader.size(); j++) {
+            if (CommitTiming::sample_row(j)) {
+                int64_t t0 = CycleClock::Now();
+                RETURN_NOT_OK(reader.read(j));
+                timing.add_sampled(CommitDecode, CycleClock::Now() - t0);
+            } else {
+                RETURN_NOT_OK(reader.read(j));
+            }
+            RETURN_NOT_OK(apply_row(reader, version, sub_tablets, new_sub_tablets));
+        }
+    }
+    for (size_t i = 0; !wtx.prepared() && i < wtx.batch_size(); i++) {
+        auto batch = wtx.get_batch(i);
         PartialRowReader reader(*batch);
         for (size_t j = 0; j<reader.size(); j++) {
-            RETURN_NOT_OK(reader.read(j));
-            RETURN_NOT_OK(_sub_tablet->apply_partial_row(reader));
+            if (CommitTiming::sample_row(j)) {
+                int64_t t0 = CycleClock::Now();
+                RETURN_NOT_OK(reader.read(j));
+                timing.add_sampled(CommitDecode, CycleClock::Now() - t0);
+            } else {
+                RETURN_NOT_OK(reader.read(j));
+            }
+            if (wtx.mode() == WriteUpsert) {
+                RETURN_NOT_OK(apply_row(reader, version, sub_tablets, new_sub_tablets));
+            } else {
+                RETURN_NOT_OK(insert_row(reader, wtx.mode() == WriteInsertOnlyVerify, version,
+                                         sub_tablets, new_sub_tablets));
+            }
+        }
+    }
+    for (size_t i = 0; i < wtx.columnar_batch_size(); i++) {
+        RETURN_NOT_OK(apply_columnar_batch(*wtx.get_columnar_batch(i), wtx.mode(), version,
+                                           sub_tablets, new_sub_tablets));
+    }
+    return Status::OK();
+}
+
+Status MemTablet::apply_columnar_batch(const ColumnarBatch& batch, WriteMode mode, uint64_t version,
+                                       vector<MemSubTablet*>& sub_tablets,
+                                       vector<unique_ptr<MemSubTablet>>& new_sub_tablets) {
+    for (size_t i = 0; i < batch.num_columns(); i++) {
+        if (batch.column_schema(i)->type == String) {
+            // same as the row path
+            return Status::NotSupported(Format("commit string column %s not supported",
+                                               batch.column_schema(i)->name.c_str()));
+        }
+    }
+    vector<uint64_t> hashcodes;
+    sub_tablets.back()->hash_keys(batch, hashcodes);
+    vector<uint8_t> applied(batch.row_size(), 0);
+    size_t napplied = 0;
+    // full sub-tablets only take updates, they are skipped if keys are new
+    for (size_t i = mode == WriteInsertOnly ? sub_tablets.size() - 1 : 0; i < sub_tablets.size(); i++) {
+        RETURN_NOT_OK(sub_tablets[i]->apply_columnar_batch(batch, hashcodes, mode, applied, napplied));
+    }
+    while (napplied < batch.row_size()) {
+        RETURN_NOT_OK(add_sub_tablet(version, sub_tablets, new_sub_tablets));
+        RETURN_NOT_OK(sub_tablets.back()->apply_columnar_batch(batch, hashcodes, mode, applied, napplied));
+    }
+    return Status::OK();
+}
+
+template <class RowReader>
+Status MemTablet::apply_row(const RowReader& reader, uint64_t version, vector<MemSubTablet*>& sub_tablets,
+                            vector<unique_ptr<MemSubTablet>>& new_sub_tablets) {
+    // full sub-tablets only take updates of their existing keys
+    bool applied = false;
+    for (auto sub_tablet : sub_tablets) {
+        RETURN_NOT_OK(ApplyRow(sub_tablet, reader, applied));
+        if (applied) {
+            return Status::OK();
         }
     }
-    return _sub_tablet->commit_write(version);
+    RETURN_NOT_OK(add_sub_tablet(version, sub_tablets, new_sub_tablets));
+    RETURN_NOT_OK(ApplyRow(sub_tablets.back(), reader, applied));
+    DCHECK(applied);
+    return Status::OK();
+}
+
+Status MemTablet::insert_row(const PartialRowReader& reader, bool verify, uint64_t version,
+                             vector<MemSubTablet*>& sub_tablets,
+                             vector<unique_ptr<MemSubTablet>>& new_sub_tablets) {
+    // only the last sub-tablet takes inserts, full ones are visited to
+    // verify their keys
+    bool applied = false;
+    for (size_t i = verify ? 0 : sub_tablets.size() - 1; i < sub_tablets.size(); i++) {
+        RETURN_NOT_OK(sub_tablets[i]->insert_partial_row(reader, verify, applied));
+        if (applied) {
+            return Status::OK();
+        }
+    }
+    RETURN_NOT_OK(add_sub_tablet(version, sub_tablets, new_sub_tablets));
+    RETURN_NOT_OK(sub_tablets.back()->insert_partial_row(reader, verify, applied));
+    DCHECK(applied);
+    return Status::OK();
+}
+
+Status MemTablet::apply_columns(size_t nrows, const vector<const ColumnArray*>& columns, uint64_t version,
+                                vector<MemSubTablet*>& sub_tablets,
+                                vector<unique_ptr<MemSubTablet>>& new_sub_tablets) {
+    // only the last sub-tablet takes inserts, keys may still exist in
+    // earlier full ones
+    for (size_t i = 0; i + 1 < sub_tablets.size(); i++) {
+        RETURN_NOT_OK(sub_tablets[i]->check_keys_absent(*columns[1], 0, nrows));
+    }
+    size_t offset = 0;
+    while (true) {
+        size_t appended = 0;
+        RETURN_NOT_OK(sub_tablets.back()->append_columns(columns, offset, nrows - offset, appended));
+        offset += appended;
+        if (offset == nrows) {
+            break;
+        }
+        // rows left go to a new sub-tablet, check them against the full
+        // one, whose rows include the ones just appended from columns
+        RETURN_NOT_OK(sub_tablets.back()->check_keys_absent(*columns[1], offset, nrows - offset));
+        RETURN_NOT_OK(add_sub_tablet(version, sub_tablets, new_sub_tablets));
+    }
+    return Status::OK();
+}
+
+Status MemTablet::add_sub_tablet(uint64_t version, vector<MemSubTablet*>& sub_tablets,
+                                 vector<unique_ptr<MemSubTablet>>& new_sub_tablets) {
+    MemSubTablet* last = sub_tablets.back();
+    size_t max_rows;
+    {
+        std::lock_guard<mutex> lg(_sub_tablets_lock);
+        max_rows = _sub_tablet_max_rows;
+    }
+    unique_ptr<MemSubTablet> st;
+    RETURN_NOT_OK(MemSubTablet::create(version, latest_schema(), _mem_tracker.get(),
+                                       last->base_rid() + last->write_size(),
+                                       max_rows, st));
+    RETURN_NOT_OK(st->begin_write(latest_schema()));
+    LOG(INFO) << Format("add sub-tablet base_rid=%zu version=%zu", st->base_rid(), version);
+    sub_tablets.push_back(st.get());
+    new_sub_tablets.emplace_back(std::move(st));
+    return Status::OK();
 }
 
 } /* namespace choco */
@@ -1,6 +1,7 @@
 #ifndef CHOCO_MEM_TABLET_H_
 #define CHOCO_MEM_TABLET_H_
 
+#include <functional>
 #include "common.h"
 #include "mem_sub_tablet.h"
 #include "write_tx.h"
@@ -23,14 +24,74 @@ public:
     Status scan(unique_ptr<ScanSpec>& spec, unique_ptr<MemTabletScan>& scan);
 
     Status create_writetx(unique_ptr<WriteTx>& wtx) const;
+    /**
+     * optional, group rows by key and collapse duplicate keys outside of
+     * commit, so commit applies each key once
+     */
     Status prepare_writetx(unique_ptr<WriteTx>& wtx);
     Status commit(unique_ptr<WriteTx>& wtx, uint64_t version);
 
+    /**
+     * bulk insert nrows rows as a new version without going through
+     * WriteTx, each array holds nrows values of a column, key column is
+     * required, keys must be new to the tablet and unique in the arrays.
+     * Columns not given are not set, same as unset cells of a row.
+     * Values are copied into column pages a page at a time, and keys are
+     * added to hash index without per row decoding.
+     */
+    Status append_columns(size_t nrows, const vector<ColumnArray>& columns, uint64_t version);
+
+    // tracks memory of all columns and indexes of this tablet
+    MemTracker* mem_tracker() const { return _mem_tracker.get(); }
+
+    /**
+     * limit memory of this tablet, -1 means no limit(process limit still
+     * applies), commits are rejected with Status::OOM when over limit
+     */
+    void set_memory_limit(int64_t limit) { _mem_tracker->set_limit(limit); }
+
+    /**
+     * rows are stored in sub-tablets of at most max_rows rows(default
+     * MemSubTablet::kMaxRows), applies to current and later sub-tablets
+     */
+    void set_sub_tablet_max_rows(size_t max_rows);
+
+    size_t num_sub_tablets() const;
+
 private:
     friend class MemTabletScan;
     DISALLOW_COPY_AND_ASSIGN(MemTablet);
 
-    MemTablet();
+    MemTablet(const string& dir);
+
+    typedef std::function<Status(vector<MemSubTablet*>& sub_tablets,
+                                 vector<unique_ptr<MemSubTablet>>& new_sub_tablets,
+                                 CommitTiming& timing)> ApplyFunc;
+    // write version with apply, and publish it if all sub-tablets commit
+    Status write(uint64_t version, const ApplyFunc& apply);
+    // write to sub_tablets, new sub-tablets are appended when last is full
+    Status apply_writetx(WriteTx& wtx, uint64_t version, vector<MemSubTablet*>& sub_tablets,
+                         vector<unique_ptr<MemSubTablet>>& new_sub_tablets, CommitTiming& timing);
+    // apply current row of reader to the sub-tablet holding its key
+    template <class RowReader>
+    Status apply_row(const RowReader& reader, uint64_t version, vector<MemSubTablet*>& sub_tablets,
+                     vector<unique_ptr<MemSubTablet>>& new_sub_tablets);
+    // insert current row of reader to last sub-tablet(WriteInsertOnly modes)
+    Status insert_row(const PartialRowReader& reader, bool verify, uint64_t version,
+                      vector<MemSubTablet*>& sub_tablets,
+                      vector<unique_ptr<MemSubTablet>>& new_sub_tablets);
+    // apply rows of batch by column, new sub-tablets are appended when last is full
+    Status apply_columnar_batch(const ColumnarBatch& batch, WriteMode mode, uint64_t version,
+                                vector<MemSubTablet*>& sub_tablets,
+                                vector<unique_ptr<MemSubTablet>>& new_sub_tablets);
+    // rows of columns are appended to last sub-tablet and new sub-tablets
+    Status apply_columns(size_t nrows, const vector<const ColumnArray*>& columns, uint64_t version,
+                         vector<MemSubTablet*>& sub_tablets,
+                         vector<unique_ptr<MemSubTablet>>& new_sub_tablets);
+    // create a sub-tablet after last one of sub_tablets, and begin write
+    Status add_sub_tablet(uint64_t version, vector<MemSubTablet*>& sub_tablets,
+                          vector<unique_ptr<MemSubTablet>>& new_sub_tablets);
+    void get_sub_tablets(vector<MemSubTablet*>& sub_tablets) const;
 
     mutable mutex _vesions_lock;
     struct VersionInfo {
@@ -41,8 +102,13 @@ private:
         unique_ptr<Schema> schema;
     };
     vector<VersionInfo> _versions;
-    // TODO: support multiple subtablet in future
-    unique_ptr<MemSubTablet> _sub_tablet;
+    RefPtr<MemTracker> _mem_tracker;
+    // ordered by base rid, only the last one takes inserts,
+    // sub-tablets are never removed once added. The lock also guards
+    // _sub_tablet_max_rows, and commits publish under it
+    mutable mutex _sub_tablets_lock;
+    vector<unique_ptr<MemSubTablet>> _sub_tablets;
+    size_t _sub_tablet_max_rows = MemSubTablet::kMaxRows;
 };
 
 
@@ -24,98 +24,339 @@ Status ScanSpec::create(uint64_t version, const string &specstr,
 
 
 MemTabletScan::~MemTabletScan() {
+    _stats.record(MetricsRegistry::global());
 }
 
 Status MemTabletScan::setup() {
+    {
+        // commits publish all their sub-tablets under this lock, so the
+        // scan doesn't see part of a commit
+        std::lock_guard<mutex> lg(_tablet->_sub_tablets_lock);
+        if (_spec->version() == (uint64_t)-1) {
+            // latest, columns may already have deltas of a commit being
+            // published, so pin the last published version
+            _spec->_version = _tablet->_sub_tablets.back()->latest_version();
+        }
+        for (auto& sub_tablet : _tablet->_sub_tablets) {
+            if (sub_tablet->first_version() > _spec->version()) {
+                // added after scan version
+                break;
+            }
+            _parts.emplace_back(new SubTabletScan());
+            RETURN_NOT_OK(setup_sub_tablet(sub_tablet.get(), *_parts.back()));
+        }
+    }
+    // bind expressions to scan columns
+    vector<string> names;
+    for (auto& col : _spec->columns()) {
+        names.emplace_back(col->name);
+    }
+    if (_spec->filter()) {
+        RETURN_NOT_OK(_spec->filter()->bind(*_schema, names));
+        if (_spec->filter()->type() != Int8) {
+            return Status::InvalidArgument("scan filter should be int8");
+        }
+        vector<const Expr*> conjuncts;
+        _spec->filter()->conjuncts(conjuncts);
+        for (auto conjunct : conjuncts) {
+            RangeFilter rf;
+            if (conjunct->int_range(rf.column, rf.lo, rf.hi)) {
+                _range_filters.push_back(rf);
+            } else {
+                _residual_filter = true;
+            }
+        }
+    }
+    for (auto& expr : _spec->exprs()) {
+        RETURN_NOT_OK(expr->bind(*_schema, names));
+    }
+    // setup row block for full scan by default
+    _row_block.reset(new RowBlock());
+    _row_block->_columns.resize(_spec->columns().size() + _spec->exprs().size());
+    setup_full_scan();
+    return Status::OK();
+}
+
+Status MemTabletScan::setup_sub_tablet(MemSubTablet* sub_tablet, SubTabletScan& part) {
+    part.sub_tablet = sub_tablet;
     // setup num_rows
-    RETURN_NOT_OK(_tablet->_sub_tablet->get_size(_spec->version(), _num_rows));
+    RETURN_NOT_OK(sub_tablet->get_size(_spec->version(), part.num_rows));
+    part.num_blocks = NBlock(part.num_rows, Column::BLOCK_SIZE);
     // setup full scan readers
     auto& columns = _spec->columns();
-    _readers.resize(columns.size());
+    part.readers.resize(columns.size());
     for (size_t i = 0; i < columns.size(); ++i) {
         const ColumnSchema* cs = _schema->get(columns[i]->name);
         if (!cs) {
             return Status::NotFound("column not found for scan");
         }
-        RETURN_NOT_OK(_tablet->_sub_tablet->read_column(_spec->version(), cs->cid, _readers[i]));
+        RETURN_NOT_OK(sub_tablet->read_column(_spec->version(), cs->cid, part.readers[i]));
     }
     // setup read by row_key
     if (_spec->support_get()) {
-        _key_readers.resize(_schema->num_key_column());
+        part.key_readers.resize(_schema->num_key_column());
         for (size_t i = 0; i < _schema->num_key_column(); ++i) {
-            RETURN_NOT_OK(_tablet->_sub_tablet->read_column(_spec->version(), i+1, _key_readers[i]));
+            RETURN_NOT_OK(sub_tablet->read_column(_spec->version(), i+1, part.key_readers[i]));
         }
-        RETURN_NOT_OK(_tablet->_sub_tablet->read_index(_read_index));
+        RETURN_NOT_OK(sub_tablet->read_index(part.read_index));
     }
-    // setup row block for full scan by default
-    _row_block.reset(new RowBlock());
-    _row_block->_columns.resize(columns.size());
-    setup_full_scan();
     return Status::OK();
 }
 
 void MemTabletScan::setup_full_scan() {
+    _next_part = 0;
     _next_block = 0;
-    _num_blocks = NBlock(_num_rows, Column::BLOCK_SIZE);
 }
 
 
 Status MemTabletScan::get(GetResult& result, size_t nkey, const void * keys) {
     result.offsets.resize(nkey);
     size_t next_offset = 0;
-    vector<uint32_t> rids;
-    rids.reserve(nkey);
+    vector<vector<uint32_t>> rids(_parts.size());
+    // (part, rid) in offset order
+    vector<std::pair<uint32_t, uint32_t>> hits;
+    size_t nhit_part = 0;
 
     std::vector<HashIndex::Entry> entries;
     entries.reserve(8);
+    HashIndex::FindStats find_stats;
+    size_t ncompare = 0;
     for (size_t i=0;i<nkey;i++) {
-        uint64_t keyhash = _key_readers[0]->hashcode(keys, i);
-        entries.clear();
-        _read_index->find(keyhash, entries);
         bool found = false;
-        for (auto& e : entries) {
-            uint32_t rid = e.value;
-            if (rid >= _num_rows) {
-                // future rows
-                continue;
-            }
-            if (_key_readers[0]->equals(rid, keys, i)) {
-                rids.emplace_back(rid);
-                result.offsets[i] = next_offset++;
-                found = true;
+        // a key is in at most one sub-tablet
+        for (size_t p=0;p<_parts.size() && !found;p++) {
+            SubTabletScan& part = *_parts[p];
+            uint64_t keyhash = part.key_readers[0]->hashcode(keys, i);
+            entries.clear();
+            part.read_index->find(keyhash, entries, &find_stats);
+            for (auto& e : entries) {
+                uint32_t rid = e.value;
+                if (rid >= part.num_rows) {
+                    // future rows
+                    continue;
+                }
+                ncompare++;
+                if (part.key_readers[0]->equals(rid, keys, i)) {
+                    if (rids[p].empty()) {
+                        nhit_part++;
+                    }
+                    rids[p].emplace_back(rid);
+                    hits.emplace_back(p, rid);
+                    result.offsets[i] = next_offset++;
+                    found = true;
+                    break;
+                }
             }
         }
         if (!found) {
             result.offsets[i] = -1;
         }
     }
-    return setup_get_by_rids(rids);
+    _stats.get_keys += nkey;
+    _stats.get_rows += next_offset;
+    _stats.hash_probes += find_stats.probes;
+    _stats.hash_entries += find_stats.entries;
+    _stats.tag_false_positives += find_stats.tag_false_positives;
+    _stats.key_compares += ncompare;
+    result.block = _row_block.get();
+    if (nhit_part <= 1) {
+        for (size_t p=0;p<_parts.size();p++) {
+            if (!rids[p].empty() || p + 1 == _parts.size()) {
+                return setup_get_by_rids(*_parts[p], rids[p]);
+            }
+        }
+        return Status::OK();
+    }
+    return setup_get_by_rids(hits);
 }
 
 Status MemTabletScan::get(GetResult& result, size_t nkey, const void * key0s, const void * key1s) {
     return Status::NotSupported("get by multi-column row key not supported");
 }
 
-Status MemTabletScan::setup_get_by_rids(vector<uint32_t>& rids) {
-    for (size_t i = 0; i < _readers.size(); ++i) {
-        RETURN_NOT_OK(_readers[i]->get_by_rids(rids, _row_block->_columns[i]));
+Status MemTabletScan::setup_get_by_rids(SubTabletScan& part, vector<uint32_t>& rids) {
+    for (size_t i = 0; i < part.readers.size(); ++i) {
+        RETURN_NOT_OK(part.readers[i]->get_by_rids(rids, _row_block->_columns[i]));
     }
-    return Status::OK();
+    _row_block->_nrows = rids.size();
+    _row_block->_selection.clear();
+    return evaluate_exprs(_spec->filter() != nullptr);
+}
+
+Status MemTabletScan::setup_get_by_rids(const vector<std::pair<uint32_t, uint32_t>>& hits) {
+    // keys of different sub-tablets interleave, copy cells one by one
+    size_t nrows = hits.size();
+    auto& columns = _spec->columns();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const ColumnSchema* cs = _schema->get(columns[i]->name);
+        size_t esize = TypeInfo::get(cs->type).size();
+        ColumnBlock& cb = _row_block->_columns[i];
+        RETURN_NOT_OK(cb.alloc(nrows, esize));
+        memset(cb._nulls, 0, BitmapSize64(nrows));
+        for (size_t idx = 0; idx < nrows; idx++) {
+            const void* v = _parts[hits[idx].first]->readers[i]->get(hits[idx].second);
+            if (v) {
+                memcpy(cb._data + idx * esize, v, esize);
+            } else {
+                BitmapSet(cb._nulls, idx);
+            }
+        }
+    }
+    _row_block->_nrows = nrows;
+    _row_block->_selection.clear();
+    return evaluate_exprs(_spec->filter() != nullptr);
+}
+
+bool MemTabletScan::next_block(SubTabletScan*& part, size_t& block) {
+    while (_next_part < _parts.size() && _next_block >= _parts[_next_part]->num_blocks) {
+        _next_part++;
+        _next_block = 0;
+    }
+    if (_next_part >= _parts.size()) {
+        return false;
+    }
+    part = _parts[_next_part].get();
+    block = _next_block++;
+    _row_block->_nrows = std::min((size_t)Column::BLOCK_SIZE, part->num_rows - block*Column::BLOCK_SIZE);
+    return true;
 }
 
 Status MemTabletScan::next_scan_block(const RowBlock*& block) {
-    if (_next_block >= _num_blocks) {
-        block = nullptr;
+    SubTabletScan* part = nullptr;
+    size_t bid = 0;
+    while (next_block(part, bid)) {
+        bool filtered = false;
+        if (_spec->filter()) {
+            RETURN_NOT_OK(filter_block(*part, bid, filtered));
+            if (BitmapIsAllZero(_row_block->_selection.data(), 0, _row_block->_nrows)) {
+                _stats.skipped_blocks++;
+                continue;
+            }
+        }
+        for (size_t i = 0; i < part->readers.size(); ++i) {
+            RETURN_NOT_OK(read_column(*part, bid, i));
+        }
+        RETURN_NOT_OK(evaluate_exprs(_spec->filter() && !filtered));
+        _stats.blocks++;
+        _stats.rows += _row_block->_nrows;
+        block = _row_block.get();
         return Status::OK();
     }
-    size_t rows_in_block = std::min((size_t)Column::BLOCK_SIZE,
-            _num_rows - _next_block*Column::BLOCK_SIZE);
-    _row_block->_nrows = rows_in_block;
-    for (size_t i = 0; i < _readers.size(); ++i) {
-        RETURN_NOT_OK(_readers[i]->get_block(rows_in_block, _next_block, _row_block->_columns[i]));
+    block = nullptr;
+    return Status::OK();
+}
+
+Status MemTabletScan::aggregate(size_t column, FloatAggregate& agg) {
+    auto& columns = _spec->columns();
+    if (column >= columns.size()) {
+        return Status::InvalidArgument("aggregate column out of range");
+    }
+    Type type = _schema->get(columns[column]->name)->type;
+    if (type == String) {
+        return Status::NotSupported("aggregate of string column not supported");
+    }
+    RowBlock& rb = *_row_block;
+    SubTabletScan* part = nullptr;
+    size_t bid = 0;
+    while (next_block(part, bid)) {
+        const uint8_t* selection = nullptr;
+        bool read = false;
+        if (_spec->filter()) {
+            bool filtered = false;
+            RETURN_NOT_OK(filter_block(*part, bid, filtered));
+            if (BitmapIsAllZero(rb._selection.data(), 0, rb._nrows)) {
+                _stats.skipped_blocks++;
+                continue;
+            }
+            if (!filtered) {
+                for (size_t i = 0; i < part->readers.size(); ++i) {
+                    RETURN_NOT_OK(read_column(*part, bid, i));
+                }
+                RETURN_NOT_OK(_spec->filter()->evaluate_filter(rb, rb._selection));
+                read = true;
+            }
+            selection = rb._selection.data();
+        }
+        _stats.blocks++;
+        _stats.rows += rb._nrows;
+        Status st = part->readers[column]->aggregate_block(rb._nrows, bid, selection, agg);
+        if (st) {
+            _stats.pushdown_blocks++;
+            continue;
+        }
+        if (!st.IsNotSupported()) {
+            return st;
+        }
+        if (!read) {
+            RETURN_NOT_OK(read_column(*part, bid, column));
+        }
+        AggregateColumnBlock(type, rb._columns[column], rb._nrows, selection, agg);
+    }
+    return Status::OK();
+}
+
+Status MemTabletScan::read_column(SubTabletScan& part, size_t block, size_t column) {
+    ColumnBlock& cb = _row_block->_columns[column];
+    RETURN_NOT_OK(part.readers[column]->get_block(_row_block->_nrows, block, cb));
+    if (cb.zero_copy()) {
+        _stats.zero_copy_blocks++;
+    } else {
+        _stats.copied_blocks++;
+        _stats.delta_entries += part.readers[column]->delta_entries(block);
+    }
+    return Status::OK();
+}
+
+Status MemTabletScan::filter_block(SubTabletScan& part, size_t block, bool& filtered) {
+    RowBlock& rb = *_row_block;
+    rb._selection.assign(BitmapSize64(rb._nrows), 0);
+    BitmapChangeBits(rb._selection.data(), 0, rb._nrows, true);
+    filtered = !_residual_filter;
+    for (auto& rf : _range_filters) {
+        Status st = part.readers[rf.column]->filter_range(rb._nrows, block, rf.lo, rf.hi,
+                                                          rb._selection.data());
+        if (st.IsNotSupported()) {
+            filtered = false;
+            continue;
+        }
+        RETURN_NOT_OK(st);
+        _stats.pushdown_blocks++;
+    }
+    return Status::OK();
+}
+
+void MemTabletScan::block_schema(vector<std::pair<string, Type>>& columns) const {
+    columns.clear();
+    for (auto& c : _spec->columns()) {
+        columns.emplace_back(c->name, _schema->get(c->name)->type);
+    }
+    for (size_t i = 0; i < _spec->exprs().size(); i++) {
+        columns.emplace_back(Format("expr%zu", i), _spec->exprs()[i]->type());
+    }
+}
+
+Status MemTabletScan::evaluate_exprs(bool evaluate_filter) {
+    RowBlock& rb = *_row_block;
+    if (evaluate_filter) {
+        // full filter, range filters included
+        RETURN_NOT_OK(_spec->filter()->evaluate_filter(rb, rb._selection));
+    }
+    size_t ncol = _spec->columns().size();
+    for (size_t i = 0; i < _spec->exprs().size(); i++) {
+        Expr* expr = _spec->exprs()[i].get();
+        const ColumnBlock* result = nullptr;
+        RETURN_NOT_OK(expr->evaluate(rb, result));
+        // result is owned by expr or is a scan column, copy into row block
+        size_t esize = TypeInfo::get(expr->type()).size();
+        ColumnBlock& cb = rb._columns[ncol + i];
+        RETURN_NOT_OK(cb.alloc(rb._nrows, esize));
+        memcpy(cb._data, result->data(), rb._nrows * esize);
+        if (result->nulls()) {
+            memcpy(cb._nulls, result->nulls(), BitmapSize64(rb._nrows));
+        } else {
+            memset(cb._nulls, 0, BitmapSize64(rb._nrows));
+        }
     }
-    _next_block++;
-    block = _row_block.get();
     return Status::OK();
 }
 
@@ -4,6 +4,8 @@
 #include "common.h"
 #include "type.h"
 #include "row_block.h"
+#include "expression.h"
+#include "metrics.h"
 
 namespace choco {
 
@@ -68,15 +70,44 @@ public:
         return _support_get;
     }
 
+    /**
+     * Int8 expression over scan columns, full scan sets
+     * RowBlock::selection to rows where it's true
+     */
+    void set_filter(unique_ptr<Expr>& filter) {
+        _filter.swap(filter);
+    }
+
+    Expr* filter() const {
+        return _filter.get();
+    }
+
+    /**
+     * expression over scan columns, full scan appends its result to
+     * RowBlock after scan columns, in the order added
+     */
+    void add_expr(unique_ptr<Expr>& expr) {
+        _exprs.emplace_back(std::move(expr));
+    }
+
+    const vector<unique_ptr<Expr>>& exprs() const {
+        return _exprs;
+    }
+
 private:
+    friend class MemTabletScan;
+
     uint64_t _version;
     uint64_t _limit;
     vector<unique_ptr<ColumnScan>> _columns;
     bool _support_get;
+    unique_ptr<Expr> _filter;
+    vector<unique_ptr<Expr>> _exprs;
 };
 
 class HashIndex;
 class MemTablet;
+class MemSubTablet;
 class ColumnReader;
 
 class MemTabletScan {
@@ -89,16 +120,40 @@ public:
     };
 
     /**
-     * keys must be valid until all blocks are returned
+     * keys must be valid until all blocks are returned, result block has
+     * the columns of scan blocks(expressions evaluated on found rows),
+     * its selection is set by the filter if there is one
      */
     Status get(GetResult& result, size_t nkey, const void * keys);
     Status get(GetResult& result, size_t nkey, const void * key0s, const void * key1s);
 
     /**
-     * block content valid until next call to next_block
+     * block content valid until next call to next_block, blocks without
+     * any row passing the filter are skipped
      */
     Status next_scan_block(const RowBlock*& block);
 
+    /**
+     * aggregate non-null values of scan column(index into scan columns)
+     * over rows passing the filter, consuming remaining blocks of full
+     * scan. ALP packed float blocks are aggregated without decoding.
+     */
+    Status aggregate(size_t column, FloatAggregate& agg);
+
+    /**
+     * name and type of each column of returned blocks, scan columns
+     * then expression columns(named expr0, expr1...)
+     */
+    void block_schema(vector<std::pair<string, Type>>& columns) const;
+
+    /**
+     * work done by this scan so far, added to the global
+     * MetricsRegistry's "scan.*" histograms when scan is destroyed
+     */
+    const ScanStats& stats() const {
+        return _stats;
+    }
+
 private:
     DISALLOW_COPY_AND_ASSIGN(MemTabletScan);
     MemTabletScan() = default;
@@ -107,23 +162,52 @@ private:
 
     Status setup();
     void setup_full_scan();
-    Status setup_get_by_rids(vector<uint32_t>& rids);
+    Status evaluate_exprs(bool evaluate_filter);
+
+    // scan state of a sub-tablet
+    struct SubTabletScan {
+        MemSubTablet* sub_tablet = nullptr;
+        size_t num_rows = 0;
+        size_t num_blocks = 0;
+        // full scan support
+        vector<unique_ptr<ColumnReader>> readers;
+        // get by row_key support
+        vector<unique_ptr<ColumnReader>> key_readers;
+        RefPtr<HashIndex> read_index;
+    };
+    Status setup_sub_tablet(MemSubTablet* sub_tablet, SubTabletScan& part);
+    // advance to next block of full scan and set row block's nrows
+    bool next_block(SubTabletScan*& part, size_t& block);
+    Status read_column(SubTabletScan& part, size_t block, size_t column);
+    // evaluate range filters, filtered is false if filter needs evaluate_exprs
+    Status filter_block(SubTabletScan& part, size_t block, bool& filtered);
+    Status setup_get_by_rids(SubTabletScan& part, vector<uint32_t>& rids);
+    // get rows from multiple sub-tablets by (part index, rid)
+    Status setup_get_by_rids(const vector<std::pair<uint32_t, uint32_t>>& hits);
 
     unique_ptr<ScanSpec> _spec;
     shared_ptr<MemTablet> _tablet;
     const Schema* _schema = nullptr;
 
-    size_t _num_rows = 0;
-    size_t _num_blocks = 0;
-    // full scan support
-    vector<unique_ptr<ColumnReader>> _readers;
-    // get by row_key support
-    vector<unique_ptr<ColumnReader>> _key_readers;
-    RefPtr<HashIndex> _read_index;
+    // conjuncts of filter evaluated by ColumnReader::filter_range
+    struct RangeFilter {
+        size_t column = 0;
+        int64_t lo = 0;
+        int64_t hi = 0;
+    };
+    vector<RangeFilter> _range_filters;
+    // filter has other conjuncts
+    bool _residual_filter = false;
+
+    // sub-tablets visible at scan version, ordered by base rid
+    vector<unique_ptr<SubTabletScan>> _parts;
+    size_t _next_part = 0;
 
     // returned block
     unique_ptr<RowBlock> _row_block;
     size_t _next_block = 0;
+
+    ScanStats _stats;
 };
 
 
@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <functional>
+#include <thread>
 #include "gtest/gtest.h"
 #include "mem_tablet.h"
 #include "mem_tablet_scan.h"
+#include "bitmap.h"
 
 namespace choco {
 
@@ -11,6 +15,120 @@ struct TData {
     int8_t city;
 };
 
+/**
+ * n rows of columns names, values[c] is an array of n values of column c,
+ * row i of column c is null if bit i of nulls[c] is set(nulls may be
+ * shorter than names, and nulls[c] may be nullptr)
+ */
+struct TestRows {
+    vector<string> names;
+    size_t n;
+    vector<const void*> values;
+    vector<const uint8_t*> nulls;
+};
+
+// WriteTx of rows, by PartialRowBatches, or a ColumnarBatch if columnar
+static void NewWriteTx(MemTablet& tablet, const TestRows& rows, bool columnar, unique_ptr<WriteTx>& wtx) {
+    ASSERT_TRUE(tablet.create_writetx(wtx));
+    auto nulls = [&](size_t c) -> const uint8_t* {
+        return c < rows.nulls.size() ? rows.nulls[c] : nullptr;
+    };
+    if (columnar) {
+        ColumnarBatch* batch = nullptr;
+        ASSERT_TRUE(wtx->new_columnar_batch(rows.names, batch));
+        // arrays in the order of batch columns, the key is moved first
+        vector<const void*> values;
+        vector<const uint8_t*> bnulls;
+        for (size_t bc = 0; bc < batch->num_columns(); bc++) {
+            auto it = std::find(rows.names.begin(), rows.names.end(), batch->column_schema(bc)->name);
+            ASSERT_TRUE(it != rows.names.end());
+            size_t c = it - rows.names.begin();
+            values.push_back(rows.values[c]);
+            bnulls.push_back(nulls(c));
+        }
+        ASSERT_TRUE(batch->append(rows.n, values, bnulls));
+        return;
+    }
+    vector<size_t> esizes;
+    for (auto& name : rows.names) {
+        const ColumnSchema* cs = wtx->schema().get(name);
+        ASSERT_TRUE(cs != nullptr) << name;
+        esizes.push_back(TypeInfo::get(cs->type).size());
+    }
+    PartialRowWriter writer(wtx->schema());
+    PartialRowBatch* batch = wtx->new_batch();
+    for (size_t i = 0; i < rows.n; i++) {
+        writer.start_row();
+        for (size_t c = 0; c < rows.names.size(); c++) {
+            const uint8_t* v = (const uint8_t*)rows.values[c] + i * esizes[c];
+            if (nulls(c) && BitmapTest(nulls(c), i)) {
+                v = nullptr;
+            }
+            ASSERT_TRUE(writer.set(rows.names[c], (void*)v));
+        }
+        if (!writer.write_row_to_batch(*batch)) {
+            batch = wtx->new_batch();
+            ASSERT_TRUE(writer.write_row_to_batch(*batch));
+        }
+    }
+}
+
+// write rows in mode and commit them as version
+static Status WriteRows(MemTablet& tablet, uint64_t version, const TestRows& rows, bool columnar = false,
+                        WriteMode mode = WriteUpsert) {
+    unique_ptr<WriteTx> wtx;
+    NewWriteTx(tablet, rows, columnar, wtx);
+    if (::testing::Test::HasFatalFailure()) {
+        return Status::InvalidArgument("failed to write test rows");
+    }
+    wtx->set_mode(mode);
+    return tablet.commit(wtx, version);
+}
+
+// check(block, i, row) on row i of each block, row counts from the first block
+typedef std::function<void(const RowBlock& block, size_t i, size_t row)> RowCheck;
+
+// full scan of columns at version, nrow is set to rows scanned
+static void ScanRows(MemTablet& tablet, uint64_t version, const char* columns, size_t& nrow,
+                     const RowCheck& check, ScanStats* stats = nullptr) {
+    nrow = 0;
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(version, columns, false, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet.scan(scanspec, scan));
+    while (true) {
+        const RowBlock* rblock = nullptr;
+        ASSERT_TRUE(scan->next_scan_block(rblock));
+        if (!rblock) {
+            break;
+        }
+        for (size_t i = 0; check && i < rblock->num_rows(); i++) {
+            check(*rblock, i, nrow + i);
+            if (::testing::Test::HasFatalFailure()) {
+                return;
+            }
+        }
+        nrow += rblock->num_rows();
+    }
+    if (stats) {
+        *stats = scan->stats();
+    }
+}
+
+template <class T>
+static T Value(const RowBlock& block, size_t col, size_t idx) {
+    return ((const T*)block.get_column(col).data())[idx];
+}
+
+// bytes of each cell of row i, esizes[c] is the value size of column c, empty if null
+static vector<string> RowCells(const RowBlock& block, size_t i, const vector<size_t>& esizes) {
+    vector<string> ret;
+    for (size_t c = 0; c < esizes.size(); c++) {
+        const ColumnBlock& cb = block.get_column(c);
+        ret.push_back(cb.is_null(i) ? string() : string((const char*)cb.data() + i * esizes[c], esizes[c]));
+    }
+    return ret;
+}
 TEST(MemTablet, writescan) {
     const int num_insert = 2000000;
     const int insert_per_write = 500000;
@@ -87,6 +205,8 @@ TEST(MemTablet, writescan) {
 	    EXPECT_TRUE(tablet->commit(wtx, ++cur_version));
 	    wtx.reset();
 	}
+	EXPECT_GT(tablet->mem_tracker()->consumption(), 0);
+	LOG(INFO) << "memory usage:\n" << tablet->mem_tracker()->to_string();
 
 	{
 	    double t0 = Time();
@@ -131,6 +251,851 @@ TEST(MemTablet, writescan) {
         EXPECT_EQ(curidx, num_insert);
         scan.reset();
     }
+    {
+        unique_ptr<ScanSpec> scanspec;
+        ASSERT_TRUE(ScanSpec::create(cur_version, "city", false, scanspec));
+        unique_ptr<MemTabletScan> scan;
+        ASSERT_TRUE(tablet->scan(scanspec, scan));
+        const RowBlock* rblock = nullptr;
+        size_t curidx = 0;
+        while (true) {
+            EXPECT_TRUE(scan->next_scan_block(rblock));
+            if (!rblock) {
+                break;
+            }
+            size_t nrows = rblock->num_rows();
+            const ColumnBlock& cb = rblock->get_column(0);
+            for (size_t i=0;i<nrows;i++) {
+                int8_t city = alldata[curidx].city;
+                if (city % 2 == 0) {
+                    EXPECT_TRUE(cb.is_null(i));
+                } else {
+                    EXPECT_FALSE(cb.is_null(i));
+                    EXPECT_EQ(((const int8_t*)cb.data())[i], city);
+                }
+                curidx++;
+            }
+        }
+        EXPECT_EQ(curidx, num_insert);
+        scan.reset();
+    }
+}
+
+TEST(MemTablet, wide_table_update) {
+    const int num_column = 32;
+    const int num_insert = 100000;
+    const int num_update = 20000;
+    string desc = "int32 id";
+    for (int c=1;c<num_column;c++) {
+        desc += Format(",int32 c%d", c);
+    }
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create(desc, sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    uint64_t cur_version = 0;
+    vector<vector<int32_t>> alldata(num_column, vector<int32_t>(num_insert));
+
+    srand(1);
+    for (int round=0;round<2;round++) {
+        unique_ptr<WriteTx> wtx;
+        EXPECT_TRUE(tablet->create_writetx(wtx));
+        PartialRowWriter writer(wtx->schema());
+        PartialRowBatch* batch = wtx->new_batch();
+        int nrow = round == 0 ? num_insert : num_update;
+        for (int i=0;i<nrow;i++) {
+            writer.start_row();
+            int32_t id = round == 0 ? i : rand() % num_insert;
+            alldata[0][id] = id;
+            EXPECT_TRUE(writer.set(1, &alldata[0][id]));
+            for (int c=1;c<num_column;c++) {
+                alldata[c][id] = rand();
+                EXPECT_TRUE(writer.set(c+1, &alldata[c][id]));
+            }
+            if (!writer.write_row_to_batch(*batch)) {
+                batch = wtx->new_batch();
+                EXPECT_TRUE(writer.write_row_to_batch(*batch));
+            }
+        }
+        EXPECT_TRUE(tablet->prepare_writetx(wtx));
+        EXPECT_TRUE(tablet->commit(wtx, ++cur_version));
+    }
+
+    string cols = "id";
+    for (int c=1;c<num_column;c++) {
+        cols += Format(",c%d", c);
+    }
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(cur_version, cols, false, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(scanspec, scan));
+    const RowBlock* rblock = nullptr;
+    size_t curidx = 0;
+    while (true) {
+        EXPECT_TRUE(scan->next_scan_block(rblock));
+        if (!rblock) {
+            break;
+        }
+        for (int c=0;c<num_column;c++) {
+            const int32_t* data = (const int32_t*)rblock->get_column(c).data();
+            for (size_t i=0;i<rblock->num_rows();i++) {
+                ASSERT_EQ(data[i], alldata[c][curidx+i]);
+            }
+        }
+        curidx += rblock->num_rows();
+    }
+    EXPECT_EQ(curidx, num_insert);
+}
+
+TEST(MemTablet, memory_limit) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int32 v", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const int N = 100000;
+    vector<int32_t> ids(N * 2);
+    vector<int32_t> vs(N * 2);
+    for (int i = 0; i < N * 2; i++) {
+        ids[i] = i;
+        vs[i] = i * 3;
+    }
+    // rows [start, end)
+    auto rows = [&](int start, int end) {
+        return TestRows{{"id", "v"}, (size_t)(end - start), {&ids[start], &vs[start]}};
+    };
+    ASSERT_TRUE(WriteRows(*tablet, 1, rows(0, N)));
+    int64_t used = tablet->mem_tracker()->consumption();
+    // too small to add more pages
+    tablet->set_memory_limit(used + 1000);
+    Status st = WriteRows(*tablet, 2, rows(N, N * 2));
+    EXPECT_TRUE(st.IsOOM());
+    // already over limit, rejected before writing
+    tablet->set_memory_limit(used / 2);
+    st = WriteRows(*tablet, 2, rows(N, N * 2));
+    EXPECT_TRUE(st.IsOOM());
+    LOG(INFO) << st.ToString();
+    // aborted writes leave no visible rows and don't break later writes
+    tablet->set_memory_limit(-1);
+    ASSERT_TRUE(WriteRows(*tablet, 2, rows(N / 2, N * 2)));
+    size_t nrow = 0;
+    ScanRows(*tablet, 2, "id,v", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        ASSERT_EQ((int32_t)row, Value<int32_t>(block, 0, i));
+        ASSERT_EQ((int32_t)row * 3, Value<int32_t>(block, 1, i));
+    });
+    EXPECT_EQ((size_t)N * 2, nrow);
+}
+
+TEST(MemTablet, abort_in_finalize) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int16 a,int64 b null", sc));
+    // tablets[1] is a twin to measure memory of the failing write
+    shared_ptr<MemTablet> tablets[2];
+    for (auto& tablet : tablets) {
+        unique_ptr<Schema> tsc(new Schema(*sc));
+        ASSERT_TRUE(MemTablet::create("", tsc, tablet));
+    }
+    const int N = 20000;
+    const int M = 100;
+    vector<int32_t> ids;
+    vector<int16_t> as;
+    vector<int64_t> bs;
+    vector<uint8_t> b_nulls;
+    // rows [start, end) of a and b, b is null if b_null or id % 10 == 0
+    auto rows = [&](int start, int end, int16_t a, int64_t b, bool b_null) {
+        size_t n = end - start;
+        ids.resize(n);
+        as.assign(n, a);
+        bs.assign(n, b);
+        b_nulls.assign(BitmapSize64(n), 0);
+        for (size_t i = 0; i < n; i++) {
+            ids[i] = start + i;
+            if (b_null || ids[i] % 10 == 0) {
+                BitmapSet(b_nulls.data(), i);
+            }
+        }
+        return TestRows{{"id", "a", "b"}, n, {ids.data(), as.data(), bs.data()}, {nullptr, nullptr, b_nulls.data()}};
+    };
+    for (auto& tablet : tablets) {
+        ASSERT_TRUE(WriteRows(*tablet, 1, rows(0, N, 1, 2, false), true));
+    }
+    int64_t used = tablets[0]->mem_tracker()->consumption();
+    // update all rows(deltas of a then b are allocated in finalize) and
+    // insert M rows with null b into the last page
+    ASSERT_TRUE(WriteRows(*tablets[1], 2, rows(0, N + M, 3, 4, true), true));
+    int64_t delta_size = tablets[1]->mem_tracker()->consumption() - used;
+    // delta of a fits, delta of b doesn't
+    tablets[0]->set_memory_limit(used + delta_size / 2);
+    Status st = WriteRows(*tablets[0], 2, rows(0, N + M, 3, 4, true), true);
+    ASSERT_TRUE(st.IsOOM()) << st.ToString();
+    tablets[0]->set_memory_limit(-1);
+    // inserts without nulls, version 2 has no delta of a and no null b
+    ASSERT_TRUE(WriteRows(*tablets[0], 2, rows(N, N + M, 5, 6, false), true));
+    size_t nrow = 0;
+    ScanStats stats;
+    ScanRows(*tablets[0], 2, "id,a,b", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        int id = row;
+        ASSERT_EQ(id, Value<int32_t>(block, 0, i));
+        ASSERT_EQ(id < N ? 1 : 5, Value<int16_t>(block, 1, i)) << "id " << id;
+        ASSERT_EQ(id % 10 == 0, block.get_column(2).is_null(i)) << "id " << id;
+        if (!block.get_column(2).is_null(i)) {
+            ASSERT_EQ(id < N ? 2 : 6, Value<int64_t>(block, 2, i)) << "id " << id;
+        }
+    }, &stats);
+    EXPECT_EQ((size_t)(N + M), nrow);
+    EXPECT_EQ(0U, stats.delta_entries);
+}
+
+TEST(MemTablet, abort_across_sub_tablets) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int64 v", sc));
+    // tablets[1] is a twin to measure memory of the failing write
+    shared_ptr<MemTablet> tablets[2];
+    const int kMaxRows = 10000;
+    for (auto& tablet : tablets) {
+        unique_ptr<Schema> tsc(new Schema(*sc));
+        ASSERT_TRUE(MemTablet::create("", tsc, tablet));
+        tablet->set_sub_tablet_max_rows(kMaxRows);
+    }
+    vector<int32_t> ids;
+    for (int i = 0; i < kMaxRows * 2; i++) {
+        ids.push_back(i);
+    }
+    vector<int64_t> vs(ids.size(), 1);
+    for (auto& tablet : tablets) {
+        ASSERT_TRUE(WriteRows(*tablet, 1, {{"id", "v"}, ids.size(), {ids.data(), vs.data()}}, true));
+        ASSERT_EQ(2U, tablet->num_sub_tablets());
+    }
+    // a few updates in sub-tablet 0, many in sub-tablet 1
+    vector<int32_t> uids;
+    for (int i = 0; i < 100; i++) {
+        uids.push_back(i);
+    }
+    for (int i = kMaxRows; i < kMaxRows * 2; i++) {
+        uids.push_back(i);
+    }
+    vector<int64_t> uvs(uids.size(), 2);
+    TestRows updates{{"id", "v"}, uids.size(), {uids.data(), uvs.data()}};
+    int64_t used = tablets[0]->mem_tracker()->consumption();
+    ASSERT_TRUE(WriteRows(*tablets[1], 2, updates, true));
+    int64_t delta_size = tablets[1]->mem_tracker()->consumption() - used;
+    // sub-tablet 0 finalizes, sub-tablet 1 fails
+    tablets[0]->set_memory_limit(used + delta_size / 2);
+    Status st = WriteRows(*tablets[0], 2, updates, true);
+    ASSERT_TRUE(st.IsOOM()) << st.ToString();
+    tablets[0]->set_memory_limit(-1);
+    int32_t new_id = kMaxRows * 2;
+    int64_t new_v = 3;
+    ASSERT_TRUE(WriteRows(*tablets[0], 2, {{"id", "v"}, 1, {&new_id, &new_v}}, true));
+    size_t nrow = 0;
+    ScanRows(*tablets[0], 2, "id,v", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        int32_t id = Value<int32_t>(block, 0, i);
+        ASSERT_EQ(id == new_id ? 3 : 1, Value<int64_t>(block, 1, i)) << "id " << id;
+    });
+    EXPECT_EQ((size_t)kMaxRows * 2 + 1, nrow);
+}
+
+TEST(MemTablet, publish_across_sub_tablets) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int64 v", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const int kMaxRows = 1000;
+    const int kNumRows = kMaxRows * 3;
+    const int64_t kNumVersion = 200;
+    tablet->set_sub_tablet_max_rows(kMaxRows);
+    vector<int32_t> ids(kNumRows);
+    for (int i = 0; i < kNumRows; i++) {
+        ids[i] = i;
+    }
+    // every version sets v of all rows to the version
+    auto write = [&](int64_t version) {
+        vector<int64_t> vs(ids.size(), version);
+        EXPECT_TRUE(WriteRows(*tablet, version, {{"id", "v"}, ids.size(), {ids.data(), vs.data()}}, true));
+    };
+    write(1);
+    ASSERT_EQ(3U, tablet->num_sub_tablets());
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        for (int64_t version = 2; version <= kNumVersion; version++) {
+            write(version);
+        }
+        done = true;
+    });
+    // scans of the latest version see all sub-tablets of a commit or none
+    size_t nscan = 0;
+    while (!done && !HasFailure()) {
+        size_t nrow = 0;
+        int64_t version = 0;
+        ScanRows(*tablet, -1, "v", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+            if (row == 0) {
+                version = Value<int64_t>(block, 0, i);
+            }
+            ASSERT_EQ(version, Value<int64_t>(block, 0, i)) << "row " << row;
+        });
+        EXPECT_EQ((size_t)kNumRows, nrow);
+        nscan++;
+    }
+    writer.join();
+    LOG(INFO) << Format("%zu scans during %zd commits", nscan, kNumVersion - 1);
+}
+
+TEST(MemTablet, sub_tablets) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int64 id,int32 v null", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const size_t max_rows = 100000;
+    const int64_t N = 250000;
+    tablet->set_sub_tablet_max_rows(max_rows);
+    vector<int32_t> values(N);
+    vector<int64_t> wids;
+    vector<int32_t> wvs;
+    // rows [start, end) by step with new random values
+    auto rows = [&](int64_t start, int64_t end, int64_t step) {
+        wids.clear();
+        wvs.clear();
+        for (int64_t i = start; i < end; i += step) {
+            values[i] = rand();
+            wids.push_back(i);
+            wvs.push_back(values[i]);
+        }
+        return TestRows{{"id", "v"}, wids.size(), {wids.data(), wvs.data()}};
+    };
+    ASSERT_TRUE(WriteRows(*tablet, 1, rows(0, N / 2, 1)));
+    EXPECT_EQ(tablet->num_sub_tablets(), 2);
+    ASSERT_TRUE(WriteRows(*tablet, 2, rows(N / 2, N, 1)));
+    EXPECT_EQ(tablet->num_sub_tablets(), 3);
+    // updates go to sub-tablets holding the keys
+    ASSERT_TRUE(WriteRows(*tablet, 3, rows(0, N, 7)));
+    EXPECT_EQ(tablet->num_sub_tablets(), 3);
+
+    size_t nrow = 0;
+    ScanRows(*tablet, 3, "id,v", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        ASSERT_EQ((int64_t)row, Value<int64_t>(block, 0, i));
+        ASSERT_EQ(values[row], Value<int32_t>(block, 1, i));
+    });
+    EXPECT_EQ((size_t)N, nrow);
+    // get keys from different sub-tablets
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(3, "id,v", true, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(scanspec, scan));
+    vector<int64_t> keys = {N - 1, 3, N + 10, max_rows, 2 * max_rows + 5};
+    MemTabletScan::GetResult result;
+    ASSERT_TRUE(scan->get(result, keys.size(), keys.data()));
+    ASSERT_EQ(result.offsets.size(), keys.size());
+    EXPECT_EQ(result.offsets[2], -1);
+    ASSERT_TRUE(result.block);
+    EXPECT_EQ(result.block->num_rows(), keys.size() - 1);
+    for (size_t i=0;i<keys.size();i++) {
+        if (i == 2) {
+            continue;
+        }
+        int32_t offset = result.offsets[i];
+        ASSERT_GE(offset, 0);
+        EXPECT_EQ(((const int64_t*)result.block->get_column(0).data())[offset], keys[i]);
+        EXPECT_EQ(((const int32_t*)result.block->get_column(1).data())[offset], values[keys[i]]);
+    }
+    scan.reset();
+
+    // scan of old version doesn't see later sub-tablet
+    ScanRows(*tablet, 1, "id", nrow, nullptr);
+    EXPECT_EQ((size_t)N / 2, nrow);
+}
+
+// pv/uv counters incremented by events, duplicate keys in one WriteTx
+TEST(MemTablet, aggregate_columns) {
+    const int32_t N = 1000;
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int64 pv sum,int32 last max,int32 city null replace_if_not_null", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    vector<int64_t> pv(N, 0);
+    vector<int32_t> last(N, 0);
+    vector<int32_t> city(N, -1);
+    srand(1);
+    for (uint64_t version = 1; version <= 3; version++) {
+        vector<int32_t> ids(N * 5);
+        vector<int64_t> incs(N * 5, 1);
+        vector<int32_t> tss(N * 5);
+        vector<int32_t> cs(N * 5);
+        vector<uint8_t> c_nulls(BitmapSize64(N * 5), 0);
+        for (int32_t e = 0; e < N * 5; e++) {
+            int32_t id = rand() % N;
+            ids[e] = id;
+            tss[e] = rand();
+            cs[e] = rand() % 100;
+            bool has_city = rand() % 2 == 0;
+            if (!has_city) {
+                BitmapSet(c_nulls.data(), e);
+            }
+            pv[id] += incs[e];
+            last[id] = std::max(last[id], tss[e]);
+            if (has_city) {
+                city[id] = cs[e];
+            }
+        }
+        TestRows events{{"id", "pv", "last", "city"}, ids.size(), {ids.data(), incs.data(), tss.data(), cs.data()},
+                        {nullptr, nullptr, nullptr, c_nulls.data()}};
+        ASSERT_TRUE(WriteRows(*tablet, version, events));
+    }
+    size_t nrow = 0;
+    ScanRows(*tablet, 3, "id,pv,last,city", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        int32_t id = Value<int32_t>(block, 0, i);
+        ASSERT_EQ(pv[id], Value<int64_t>(block, 1, i)) << id;
+        ASSERT_EQ(last[id], Value<int32_t>(block, 2, i)) << id;
+        if (city[id] < 0) {
+            ASSERT_TRUE(block.get_column(3).is_null(i)) << id;
+        } else {
+            ASSERT_FALSE(block.get_column(3).is_null(i)) << id;
+            ASSERT_EQ(city[id], Value<int32_t>(block, 3, i)) << id;
+        }
+    });
+    EXPECT_EQ((size_t)N, nrow);
+}
+
+// prepared WriteTx collapses duplicate keys, result is the same as
+// applying rows one by one
+TEST(MemTablet, prepare_writetx) {
+    const int32_t N = 5000;
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int64 pv sum,int32 v null,int16 lo min,float64 score null replace_if_not_null", sc));
+    shared_ptr<MemTablet> tablets[2];
+    for (auto& tablet : tablets) {
+        unique_ptr<Schema> tsc(new Schema(*sc));
+        ASSERT_TRUE(MemTablet::create("", tsc, tablet));
+    }
+    srand(1);
+    for (uint64_t version = 1; version <= 3; version++) {
+        unique_ptr<WriteTx> wtxs[2];
+        for (int t = 0; t < 2; t++) {
+            ASSERT_TRUE(tablets[t]->create_writetx(wtxs[t]));
+        }
+        for (int32_t e = 0; e < N * 4; e++) {
+            int32_t id = rand() % N;
+            int64_t inc = rand() % 10;
+            int32_t v = rand();
+            int16_t lo = rand() % 1000;
+            double score = rand() / 7.0;
+            int mask = rand();
+            for (int t = 0; t < 2; t++) {
+                PartialRowWriter writer(wtxs[t]->schema());
+                PartialRowBatch* batch = wtxs[t]->batch_size() ? (PartialRowBatch*)wtxs[t]->get_batch(wtxs[t]->batch_size() - 1)
+                                                               : wtxs[t]->new_batch();
+                writer.start_row();
+                ASSERT_TRUE(writer.set("id", &id));
+                if (mask & 1) {
+                    ASSERT_TRUE(writer.set("pv", &inc));
+                }
+                if (mask & 2) {
+                    ASSERT_TRUE(writer.set("v", (mask & 4) ? nullptr : &v));
+                }
+                if (mask & 8) {
+                    ASSERT_TRUE(writer.set("lo", &lo));
+                }
+                if (mask & 16) {
+                    ASSERT_TRUE(writer.set("score", (mask & 32) ? nullptr : &score));
+                }
+                if (!writer.write_row_to_batch(*batch)) {
+                    batch = wtxs[t]->new_batch();
+                    ASSERT_TRUE(writer.write_row_to_batch(*batch));
+                }
+            }
+        }
+        ASSERT_TRUE(tablets[0]->prepare_writetx(wtxs[0]));
+        ASSERT_TRUE(wtxs[0]->prepared() != nullptr);
+        EXPECT_EQ((size_t)N * 4, wtxs[0]->prepared()->num_input_rows());
+        // at most 2 rows per key
+        EXPECT_LE(wtxs[0]->prepared()->size(), (size_t)N * 2);
+        for (int t = 0; t < 2; t++) {
+            ASSERT_TRUE(tablets[t]->commit(wtxs[t], version));
+        }
+    }
+    vector<size_t> esizes;
+    for (auto& cs : sc->columns()) {
+        esizes.push_back(TypeInfo::get(cs.type).size());
+    }
+    vector<vector<string>> rows;
+    size_t nrow = 0;
+    ScanRows(*tablets[0], 3, "id,pv,v,lo,score", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        rows.push_back(RowCells(block, i, esizes));
+    });
+    EXPECT_GT(nrow, 0U);
+    ScanRows(*tablets[1], 3, "id,pv,v,lo,score", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        ASSERT_LT(row, rows.size());
+        ASSERT_EQ(rows[row], RowCells(block, i, esizes)) << "row " << row;
+    });
+    EXPECT_EQ(rows.size(), nrow);
+
+
+    // same key 1000 times is applied once
+    unique_ptr<WriteTx> wtx;
+    ASSERT_TRUE(tablets[0]->create_writetx(wtx));
+    PartialRowWriter writer(wtx->schema());
+    PartialRowBatch* batch = wtx->new_batch();
+    int32_t id = 7;
+    int64_t inc = 1;
+    for (int i = 0; i < 1000; i++) {
+        writer.start_row();
+        ASSERT_TRUE(writer.set("id", &id));
+        ASSERT_TRUE(writer.set("pv", &inc));
+        ASSERT_TRUE(writer.write_row_to_batch(*batch));
+    }
+    ASSERT_TRUE(tablets[0]->prepare_writetx(wtx));
+    EXPECT_EQ(1U, wtx->prepared()->size());
+    ASSERT_TRUE(tablets[0]->commit(wtx, 4));
+    vector<int64_t> pvs;
+    for (uint64_t version : {3, 4}) {
+        unique_ptr<ScanSpec> scanspec;
+        ASSERT_TRUE(ScanSpec::create(version, "id,pv", true, scanspec));
+        unique_ptr<MemTabletScan> scan;
+        ASSERT_TRUE(tablets[0]->scan(scanspec, scan));
+        MemTabletScan::GetResult result;
+        ASSERT_TRUE(scan->get(result, 1, &id));
+        ASSERT_EQ(0, result.offsets[0]);
+        pvs.push_back(((const int64_t*)result.block->get_column(1).data())[0]);
+    }
+    EXPECT_EQ(pvs[0] + 1000, pvs[1]);
+}
+
+TEST(MemTablet, append_columns) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int64 id,int32 v null,float64 f,int64 region null dict", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const size_t max_rows = 100000;
+    const int64_t N = 250000;
+    tablet->set_sub_tablet_max_rows(max_rows);
+    srand(1);
+    vector<int64_t> ids(N);
+    vector<int32_t> vs(N);
+    vector<double> fs(N);
+    vector<int64_t> regions(N);
+    vector<uint8_t> v_nulls(BitmapSize64(N), 0);
+    vector<uint8_t> region_nulls(BitmapSize64(N), 0);
+    for (int64_t i = 0; i < N; i++) {
+        ids[i] = i;
+        // mostly narrow values, so pages are widened in the middle
+        vs[i] = i % 1000 == 999 ? rand() : rand() % 100;
+        fs[i] = i * 0.5;
+        regions[i] = rand() % 10;
+        if (i % 5 == 0) {
+            BitmapSet(v_nulls.data(), i);
+        }
+        if (i % 7 == 0) {
+            BitmapSet(region_nulls.data(), i);
+        }
+    }
+    // arrays of rows [start, end), nulls are offset by start bits
+    auto append = [&](int64_t start, int64_t end, uint64_t version) {
+        vector<uint8_t> vn(BitmapSize64(end - start), 0);
+        vector<uint8_t> rn(BitmapSize64(end - start), 0);
+        BitmapCopy(vn.data(), 0, v_nulls.data(), start, end - start);
+        BitmapCopy(rn.data(), 0, region_nulls.data(), start, end - start);
+        vector<ColumnArray> columns = {
+            ColumnArray("id", &ids[start]),
+            ColumnArray("v", &vs[start], vn.data()),
+            ColumnArray("f", &fs[start]),
+            ColumnArray("region", &regions[start], rn.data()),
+        };
+        return tablet->append_columns(end - start, columns, version);
+    };
+    ASSERT_TRUE(append(0, N / 2, 1));
+    EXPECT_EQ(2U, tablet->num_sub_tablets());
+    ASSERT_TRUE(append(N / 2, N, 2));
+    EXPECT_EQ(3U, tablet->num_sub_tablets());
+
+    // existing keys, in full and last sub-tablets, are rejected
+    for (int64_t key : {(int64_t)5, N - 1}) {
+        vector<int64_t> keys = {N + 1, key};
+        vector<ColumnArray> columns = {ColumnArray("id", keys.data())};
+        EXPECT_FALSE(tablet->append_columns(keys.size(), columns, 3));
+    }
+    // duplicate keys in arrays, and missing key column
+    vector<int64_t> dup_keys = {N + 1, N + 2, N + 1};
+    EXPECT_FALSE(tablet->append_columns(dup_keys.size(), {ColumnArray("id", dup_keys.data())}, 3));
+    EXPECT_FALSE(tablet->append_columns(N, {ColumnArray("v", vs.data())}, 3));
+
+    // row path updates appended rows
+    vector<int64_t> uids;
+    vector<int32_t> uvs;
+    for (int64_t i = 0; i < N; i += 7) {
+        vs[i] = -i;
+        BitmapClear(v_nulls.data(), i);
+        uids.push_back(i);
+        uvs.push_back(vs[i]);
+    }
+    ASSERT_TRUE(WriteRows(*tablet, 3, {{"id", "v"}, uids.size(), {uids.data(), uvs.data()}}));
+    EXPECT_EQ(3U, tablet->num_sub_tablets());
+
+    size_t nrow = 0;
+    ScanRows(*tablet, 3, "id,v,f,region", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        ASSERT_EQ(ids[row], Value<int64_t>(block, 0, i));
+        ASSERT_EQ(BitmapTest(v_nulls.data(), row), block.get_column(1).is_null(i));
+        if (!BitmapTest(v_nulls.data(), row)) {
+            ASSERT_EQ(vs[row], Value<int32_t>(block, 1, i));
+        }
+        ASSERT_EQ(fs[row], Value<double>(block, 2, i));
+        ASSERT_EQ(BitmapTest(region_nulls.data(), row), block.get_column(3).is_null(i));
+        if (!BitmapTest(region_nulls.data(), row)) {
+            ASSERT_EQ(regions[row], Value<int64_t>(block, 3, i));
+        }
+    });
+    EXPECT_EQ((size_t)N, nrow);
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(3, "id,v,f,region", true, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(scanspec, scan));
+    vector<int64_t> keys = {N - 1, 3, N + 1, (int64_t)max_rows};
+    MemTabletScan::GetResult result;
+    ASSERT_TRUE(scan->get(result, keys.size(), keys.data()));
+    EXPECT_EQ(-1, result.offsets[2]);
+    ASSERT_TRUE(result.block);
+    EXPECT_EQ(keys.size() - 1, result.block->num_rows());
 }
 
+TEST(MemTablet, append_columns_split) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int32 v", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    tablet->set_sub_tablet_max_rows(100);
+    auto append = [&](const vector<int32_t>& ids, uint64_t version) {
+        return tablet->append_columns(ids.size(), {ColumnArray("id", ids.data()), ColumnArray("v", ids.data())},
+                                      version);
+    };
+    vector<int32_t> ids;
+    for (int32_t i = 0; i < 80; i++) {
+        ids.push_back(i);
+    }
+    ASSERT_TRUE(append(ids, 1));
+    // rows after the 20th spill into a new sub-tablet in the same call,
+    // 50 exists in the old sub-tablet, 85 is duplicated across the split
+    for (int32_t dup : {50, 85}) {
+        ids.clear();
+        for (int32_t i = 80; i < 120; i++) {
+            ids.push_back(i);
+        }
+        ids.push_back(dup);
+        Status st = append(ids, 2);
+        EXPECT_TRUE(st.IsInvalidArgument()) << st.ToString();
+        EXPECT_EQ(1U, tablet->num_sub_tablets());
+    }
+    ids.pop_back();
+    ASSERT_TRUE(append(ids, 2));
+    EXPECT_EQ(2U, tablet->num_sub_tablets());
+    // keys spilled into the new sub-tablet are checked later too
+    ids = {130, 110};
+    EXPECT_FALSE(append(ids, 3));
+    size_t nrow = 0;
+    ScanRows(*tablet, 3, "id,v", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        ASSERT_EQ((int32_t)row, Value<int32_t>(block, 0, i));
+    });
+    EXPECT_EQ(120U, nrow);
+}
+
+TEST(MemTablet, plain_columns) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int64 id,int32 v plain,float64 f plain,int32 w,float64 g", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const size_t N = 70000;
+    vector<int64_t> ids(N);
+    vector<int32_t> vs(N);
+    vector<double> fs(N);
+    for (size_t i = 0; i < N; i++) {
+        ids[i] = i;
+        vs[i] = i % 100;
+        fs[i] = i * 0.5;
+    }
+    vector<ColumnArray> columns = {
+        ColumnArray("id", ids.data()),
+        ColumnArray("v", vs.data()),
+        ColumnArray("f", fs.data()),
+        ColumnArray("w", vs.data()),
+        ColumnArray("g", fs.data()),
+    };
+    ASSERT_TRUE(tablet->append_columns(N, columns, 1));
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(1, "v,f,w,g", false, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(scanspec, scan));
+    const RowBlock* block = nullptr;
+    ASSERT_TRUE(scan->next_scan_block(block));
+    ASSERT_TRUE(block != nullptr);
+    // first page is full: plain columns stay full width and uncompressed,
+    // others are narrow or packed and get decoded
+    EXPECT_TRUE(block->get_column(0).zero_copy());
+    EXPECT_TRUE(block->get_column(1).zero_copy());
+    EXPECT_FALSE(block->get_column(2).zero_copy());
+    EXPECT_FALSE(block->get_column(3).zero_copy());
+    for (size_t i = 0; i < block->num_rows(); i++) {
+        ASSERT_EQ(vs[i], ((const int32_t*)block->get_column(0).data())[i]);
+        ASSERT_EQ(vs[i], ((const int32_t*)block->get_column(2).data())[i]);
+        ASSERT_EQ(fs[i], ((const double*)block->get_column(1).data())[i]);
+        ASSERT_EQ(fs[i], ((const double*)block->get_column(3).data())[i]);
+    }
+}
+
+TEST(MemTablet, insert_only) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int64 id,int32 v null", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const int64_t N = 250000;
+    tablet->set_sub_tablet_max_rows(100000);
+    vector<int32_t> values(N + 10);
+    auto write = [&](int64_t start, int64_t end, int64_t step, WriteMode mode, uint64_t version) {
+        vector<int64_t> ids;
+        vector<int32_t> vs;
+        for (int64_t i = start; i < end; i += step) {
+            values[i] = rand();
+            ids.push_back(i);
+            vs.push_back(values[i]);
+        }
+        unique_ptr<WriteTx> wtx;
+        NewWriteTx(*tablet, {{"id", "v"}, ids.size(), {ids.data(), vs.data()}}, false, wtx);
+        if (HasFatalFailure()) {
+            return Status::InvalidArgument("failed to write test rows");
+        }
+        wtx->set_mode(mode);
+        EXPECT_TRUE(tablet->prepare_writetx(wtx));
+        // insert only rows are not prepared
+        EXPECT_EQ(mode == WriteUpsert, wtx->prepared() != nullptr);
+        return tablet->commit(wtx, version);
+    };
+    ASSERT_TRUE(write(0, N / 2, 1, WriteInsertOnly, 1));
+    ASSERT_TRUE(write(N / 2, N, 1, WriteInsertOnlyVerify, 2));
+    EXPECT_EQ(3U, tablet->num_sub_tablets());
+    // existing keys in full and last sub-tablets
+    vector<int32_t> saved = values;
+    EXPECT_FALSE(write(5, N + 5, N, WriteInsertOnlyVerify, 3));
+    EXPECT_FALSE(write(N - 1, N + 5, 5, WriteInsertOnlyVerify, 3));
+    values = saved;
+    // keys inserted without lookup are found by updates
+    ASSERT_TRUE(write(0, N, 7, WriteUpsert, 3));
+    EXPECT_EQ(3U, tablet->num_sub_tablets());
+
+    size_t nrow = 0;
+    ScanRows(*tablet, 3, "id,v", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        ASSERT_EQ((int64_t)row, Value<int64_t>(block, 0, i));
+        ASSERT_EQ(values[row], Value<int32_t>(block, 1, i));
+    });
+    EXPECT_EQ((size_t)N, nrow);
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(3, "id,v", true, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(scanspec, scan));
+    vector<int64_t> keys = {N - 1, 3, N + 1, 100000};
+    MemTabletScan::GetResult result;
+    ASSERT_TRUE(scan->get(result, keys.size(), keys.data()));
+    EXPECT_EQ(-1, result.offsets[2]);
+    ASSERT_TRUE(result.block);
+    EXPECT_EQ(keys.size() - 1, result.block->num_rows());
+}
+
+TEST(MemTablet, columnar_batch) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int64 id,int32 v null,int64 pv sum,int64 region null dict", sc));
+    // same writes to tablets[0] by rows and tablets[1] by columns
+    shared_ptr<MemTablet> tablets[2];
+    for (auto& tablet : tablets) {
+        unique_ptr<Schema> tsc(new Schema(*sc));
+        ASSERT_TRUE(MemTablet::create("", tsc, tablet));
+        tablet->set_sub_tablet_max_rows(50000);
+    }
+    srand(1);
+    const int64_t N = 120000;
+    // keys [start, end) by step, plus every 10th key again at the end
+    auto write = [&](int64_t start, int64_t end, int64_t step, uint64_t version) {
+        vector<int64_t> ids;
+        for (int64_t i = start; i < end; i += step) {
+            ids.push_back(i);
+        }
+        for (int64_t i = start; i < end; i += step * 10) {
+            ids.push_back(i);
+        }
+        size_t n = ids.size();
+        vector<int32_t> vs(n);
+        vector<int64_t> pvs(n);
+        vector<int64_t> regions(n);
+        vector<uint8_t> v_nulls(BitmapSize64(n), 0);
+        vector<uint8_t> region_nulls(BitmapSize64(n), 0);
+        for (size_t i = 0; i < n; i++) {
+            vs[i] = rand();
+            pvs[i] = rand() % 100;
+            regions[i] = rand() % 20;
+            if (rand() % 5 == 0) {
+                BitmapSet(v_nulls.data(), i);
+            }
+            if (rand() % 7 == 0) {
+                BitmapSet(region_nulls.data(), i);
+            }
+        }
+        // key is not the first column of the columnar batch
+        TestRows rows{{"region", "v", "id", "pv"}, n, {regions.data(), vs.data(), ids.data(), pvs.data()},
+                      {region_nulls.data(), v_nulls.data()}};
+        EXPECT_TRUE(WriteRows(*tablets[0], version, rows));
+        unique_ptr<WriteTx> wtx;
+        ASSERT_NO_FATAL_FAILURE(NewWriteTx(*tablets[1], rows, true, wtx));
+        EXPECT_TRUE(tablets[1]->prepare_writetx(wtx));
+        EXPECT_FALSE(wtx->prepared());
+        EXPECT_TRUE(tablets[1]->commit(wtx, version));
+    };
+    write(0, N / 2, 1, 1);
+    write(N / 2, N, 1, 2);
+    // updates of existing keys in all sub-tablets, and new keys
+    write(0, N + 1000, 3, 3);
+    EXPECT_EQ(3U, tablets[1]->num_sub_tablets());
+    EXPECT_EQ(tablets[0]->num_sub_tablets(), tablets[1]->num_sub_tablets());
+
+    vector<size_t> esizes = {8, 4, 8, 8};
+    for (uint64_t version = 1; version <= 3; version++) {
+        vector<vector<string>> rows;
+        size_t nrow = 0;
+        ScanRows(*tablets[0], version, "id,v,pv,region", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+            rows.push_back(RowCells(block, i, esizes));
+        });
+        EXPECT_GT(nrow, 0U);
+        ScanRows(*tablets[1], version, "id,v,pv,region", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+            ASSERT_LT(row, rows.size());
+            ASSERT_EQ(rows[row], RowCells(block, i, esizes)) << "row " << row;
+        });
+        EXPECT_EQ(rows.size(), nrow);
+    }
+
+    // insert only batches
+    vector<int64_t> keys = {N + 5000, 7};
+    Status st = WriteRows(*tablets[1], 4, {{"id"}, keys.size(), {keys.data()}}, true, WriteInsertOnlyVerify);
+    EXPECT_FALSE(st);
+    keys = {N + 5000, N + 5001};
+    ASSERT_TRUE(WriteRows(*tablets[1], 4, {{"id"}, keys.size(), {keys.data()}}, true, WriteInsertOnly));
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(4, "id", true, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablets[1]->scan(scanspec, scan));
+    MemTabletScan::GetResult result;
+    ASSERT_TRUE(scan->get(result, keys.size(), keys.data()));
+    ASSERT_TRUE(result.block);
+    EXPECT_EQ(2U, result.block->num_rows());
+}
+
+
+TEST(MemTablet, columnar_batch_string) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,string name null", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    vector<int32_t> ids = {1, 2};
+    vector<Slice> names = {Slice("a"), Slice("b")};
+    Status st = WriteRows(*tablet, 1, {{"id", "name"}, ids.size(), {ids.data(), names.data()}}, true);
+    EXPECT_TRUE(st.IsNotSupported()) << st.ToString();
+    // the tablet still takes batches without strings
+    ASSERT_TRUE(WriteRows(*tablet, 1, {{"id"}, ids.size(), {ids.data()}}, true));
+    size_t nrow = 0;
+    ScanRows(*tablet, 1, "id", nrow, [&](const RowBlock& block, size_t i, size_t row) {
+        ASSERT_EQ(ids[row], Value<int32_t>(block, 0, i));
+    });
+    EXPECT_EQ(2U, nrow);
+}
 }
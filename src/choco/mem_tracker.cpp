@@ -0,0 +1,101 @@
+#include "mem_tracker.h"
+
+namespace choco {
+
+MemTracker* MemTracker::process() {
+    static MemTracker* root = new MemTracker();
+    return root;
+}
+
+const char* MemTracker::kind_name(Kind kind) {
+    switch (kind) {
+    case kNull:
+        return "null";
+    case kData:
+        return "data";
+    case kIndex:
+        return "index";
+    case kPool:
+        return "pool";
+    default:
+        return "other";
+    }
+}
+
+MemTracker::MemTracker() :
+        _label("process"),
+        _consumption(0),
+        _peak(0),
+        _limit(-1) {
+    for (size_t i = 0; i < kNumKind; i++) {
+        _kinds[i] = 0;
+    }
+}
+
+MemTracker::MemTracker(const string& label, MemTracker* parent) :
+        _label(label),
+        _consumption(0),
+        _peak(0),
+        _limit(-1) {
+    for (size_t i = 0; i < kNumKind; i++) {
+        _kinds[i] = 0;
+    }
+    if (!parent) {
+        parent = process();
+    }
+    _parent = RefPtr<MemTracker>(parent);
+    std::lock_guard<mutex> lg(parent->_children_lock);
+    parent->_children.push_back(this);
+}
+
+MemTracker::~MemTracker() {
+    if (consumption() != 0) {
+        LOG(WARNING) << Format("MemTracker %s deleted with consumption %zd", _label.c_str(), consumption());
+        // keep ancestors consistent
+        for (size_t i = 0; i < kNumKind; i++) {
+            _parent->release(_kinds[i], (Kind)i);
+        }
+    }
+    if (_parent) {
+        std::lock_guard<mutex> lg(_parent->_children_lock);
+        auto& children = _parent->_children;
+        children.erase(std::remove(children.begin(), children.end(), this), children.end());
+    }
+}
+
+string MemTracker::to_string(size_t max_depth) const {
+    string ret;
+    to_string(0, max_depth, ret);
+    return ret;
+}
+
+void MemTracker::to_string(size_t depth, size_t max_depth, string& out) const {
+    out.append(depth * 2, ' ');
+    out.append(Format("%s: %.1lfM peak=%.1lfM",
+                      _label.c_str(),
+                      consumption() / 1000000.0,
+                      peak() / 1000000.0));
+    if (limit() >= 0) {
+        out.append(Format(" limit=%.1lfM", limit() / 1000000.0));
+    }
+    for (size_t i = 0; i < kNumKind; i++) {
+        int64_t v = consumption((Kind)i);
+        if (v != 0) {
+            out.append(Format(" %s=%.1lfM", kind_name((Kind)i), v / 1000000.0));
+        }
+    }
+    out.append("\n");
+    if (depth + 1 >= max_depth) {
+        return;
+    }
+    std::lock_guard<mutex> lg(_children_lock);
+    vector<MemTracker*> children(_children);
+    std::sort(children.begin(), children.end(), [](MemTracker* a, MemTracker* b) {
+        return a->consumption() > b->consumption();
+    });
+    for (auto child : children) {
+        child->to_string(depth + 1, max_depth, out);
+    }
+}
+
+} /* namespace choco */
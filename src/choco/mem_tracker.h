@@ -0,0 +1,137 @@
+#ifndef CHOCO_MEM_TRACKER_H_
+#define CHOCO_MEM_TRACKER_H_
+
+#include "common.h"
+
+namespace choco {
+
+/**
+ * Hierarchical memory usage tracker: process -> tablet -> column.
+ * Usage of each tracker is also broken down by buffer kind. consume and
+ * release update the tracker and all its ancestors, so totals of any
+ * level are available in O(1).
+ *
+ * Each tracker can have a limit, allocations check limits of the tracker
+ * and its ancestors with try_consume, and fail with Status::OOM instead
+ * of growing without bound. Checks are not atomic with concurrent
+ * consumers, so a limit can be slightly exceeded.
+ */
+class MemTracker : public RefCounted {
+public:
+    // buffer kinds, matches kind bits of BufferTag
+    enum Kind {
+        kOther = 0,
+        kNull = 1,
+        kData = 2,
+        kIndex = 3,
+        kPool = 4,
+        kNumKind = 5
+    };
+
+    // root tracker of process, never deleted
+    static MemTracker* process();
+
+    static const char* kind_name(Kind kind);
+
+    /**
+     * create a child tracker, parent is kept alive until this tracker is
+     * deleted, nullptr parent means process tracker
+     */
+    MemTracker(const string& label, MemTracker* parent);
+    ~MemTracker();
+
+    const string& label() const { return _label; }
+
+    MemTracker* parent() const { return _parent.get(); }
+
+    int64_t consumption() const {
+        return _consumption.load(std::memory_order_relaxed);
+    }
+
+    int64_t consumption(Kind kind) const {
+        return _kinds[kind].load(std::memory_order_relaxed);
+    }
+
+    int64_t peak() const {
+        return _peak.load(std::memory_order_relaxed);
+    }
+
+    // -1 means no limit
+    int64_t limit() const {
+        return _limit.load(std::memory_order_relaxed);
+    }
+
+    void set_limit(int64_t limit) {
+        _limit.store(limit, std::memory_order_relaxed);
+    }
+
+    /**
+     * return the first tracker(this, then ancestors) whose consumption
+     * would exceed its limit after consuming bytes, nullptr if none
+     */
+    const MemTracker* find_limit_exceeded(int64_t bytes = 0) const {
+        for (const MemTracker* t = this; t; t = t->_parent.get()) {
+            int64_t limit = t->limit();
+            if (limit >= 0 && t->consumption() + bytes > limit) {
+                return t;
+            }
+        }
+        return nullptr;
+    }
+
+    bool limit_exceeded() const {
+        return find_limit_exceeded() != nullptr;
+    }
+
+    // consume bytes only if no limit would be exceeded
+    bool try_consume(int64_t bytes, Kind kind = kOther) {
+        if (find_limit_exceeded(bytes)) {
+            return false;
+        }
+        consume(bytes, kind);
+        return true;
+    }
+
+    void consume(int64_t bytes, Kind kind = kOther) {
+        for (MemTracker* t = this; t; t = t->_parent.get()) {
+            t->_kinds[kind].fetch_add(bytes, std::memory_order_relaxed);
+            int64_t now = t->_consumption.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            if (bytes > 0) {
+                int64_t peak = t->_peak.load(std::memory_order_relaxed);
+                while (now > peak && !t->_peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+                }
+            }
+        }
+    }
+
+    void release(int64_t bytes, Kind kind = kOther) {
+        consume(-bytes, kind);
+    }
+
+    /**
+     * dump this tracker and its descendants, one line per tracker with
+     * usage by kind, children are sorted by consumption(largest first)
+     */
+    string to_string(size_t max_depth = 3) const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(MemTracker);
+
+    // process tracker
+    MemTracker();
+
+    void to_string(size_t depth, size_t max_depth, string& out) const;
+
+    string _label;
+    RefPtr<MemTracker> _parent;
+    std::atomic<int64_t> _consumption;
+    std::atomic<int64_t> _peak;
+    std::atomic<int64_t> _limit;
+    std::atomic<int64_t> _kinds[kNumKind];
+    mutable mutex _children_lock;
+    vector<MemTracker*> _children;
+};
+
+} /* namespace choco */
+
+#endif /* CHOCO_MEM_TRACKER_H_ */
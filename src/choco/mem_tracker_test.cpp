@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include "mem_tracker.h"
+#include "buffer.h"
+#include "column.h"
+#include "string_pool.h"
+#include "hash_index.h"
+
+namespace choco {
+
+TEST(MemTracker, hierarchy) {
+    int64_t process_base = MemTracker::process()->consumption();
+    RefPtr<MemTracker> tablet(new MemTracker("tablet", nullptr), false);
+    EXPECT_EQ(tablet->parent(), MemTracker::process());
+    RefPtr<MemTracker> c1(new MemTracker("c1", tablet.get()), false);
+    RefPtr<MemTracker> c2(new MemTracker("c2", tablet.get()), false);
+    {
+        Buffer b1;
+        Buffer b2;
+        Buffer b3;
+        ASSERT_TRUE(b1.alloc(1000, BufferTag::base(1, 0, c1.get()).data()));
+        ASSERT_TRUE(b2.alloc(100, BufferTag::base(1, 0, c1.get()).null()));
+        ASSERT_TRUE(b3.alloc(3000, BufferTag::delta(2, c2.get()).index()));
+        EXPECT_EQ(c1->consumption(), 1100);
+        EXPECT_EQ(c1->consumption(MemTracker::kData), 1000);
+        EXPECT_EQ(c1->consumption(MemTracker::kNull), 100);
+        EXPECT_EQ(c2->consumption(MemTracker::kIndex), 3000);
+        EXPECT_EQ(tablet->consumption(), 4100);
+        EXPECT_EQ(tablet->consumption(MemTracker::kData), 1000);
+        EXPECT_EQ(MemTracker::process()->consumption(), process_base + 4100);
+        string dump = tablet->to_string();
+        // largest child first
+        EXPECT_LT(dump.find("c2"), dump.find("c1"));
+        b3.clear();
+        EXPECT_EQ(c2->consumption(), 0);
+        EXPECT_EQ(c2->peak(), 3000);
+        EXPECT_EQ(tablet->consumption(), 1100);
+    }
+    EXPECT_EQ(tablet->consumption(), 0);
+    EXPECT_EQ(tablet->peak(), 4100);
+    EXPECT_EQ(MemTracker::process()->consumption(), process_base);
+}
+
+TEST(MemTracker, column_and_pool) {
+    RefPtr<MemTracker> tablet(new MemTracker("tablet", nullptr), false);
+    {
+        ColumnSchema cs("v", 1, Int32, true);
+        RefPtr<Column> c(new Column(cs, Int32, 1, tablet.get()), false);
+        unique_ptr<ColumnWriter> writer;
+        ASSERT_TRUE(c->write(writer));
+        for (uint32_t i=0;i<Column::BLOCK_SIZE+1;i++) {
+            int32_t v = i;
+            EXPECT_TRUE(writer->insert(i, i % 2 ? &v : nullptr));
+        }
+        ASSERT_TRUE(writer->finalize(2));
+        ASSERT_TRUE(writer->get_new_column(c));
+        writer.reset();
+        // 2 pages with null bitmaps
+        size_t page_size = Column::BLOCK_SIZE * 4 + Column::BLOCK_SIZE / 8;
+        EXPECT_EQ(c->memory(), page_size * 2);
+        EXPECT_EQ(tablet->consumption(), page_size * 2);
+        RefPtr<StringPool> pool;
+        ASSERT_TRUE(StringPool::create(pool, tablet.get()));
+        EXPECT_EQ(tablet->consumption(MemTracker::kPool), (int64_t)StringPool::kSegmentSize);
+    }
+    EXPECT_EQ(tablet->consumption(), 0);
+}
+
+TEST(MemTracker, limit) {
+    RefPtr<MemTracker> tablet(new MemTracker("tablet", nullptr), false);
+    RefPtr<MemTracker> c1(new MemTracker("c1", tablet.get()), false);
+    tablet->set_limit(10000);
+    EXPECT_EQ(tablet->limit(), 10000);
+    EXPECT_EQ(c1->limit(), -1);
+    Buffer b1;
+    ASSERT_TRUE(b1.alloc(8000, BufferTag::base(1, 0, c1.get()).data()));
+    EXPECT_FALSE(tablet->limit_exceeded());
+    EXPECT_EQ(c1->find_limit_exceeded(4000), tablet.get());
+    // limit of ancestor applies
+    Buffer b2;
+    Status st = b2.alloc(4000, BufferTag::base(1, 0, c1.get()).data());
+    EXPECT_TRUE(st.IsOOM());
+    EXPECT_FALSE(b2);
+    EXPECT_EQ(tablet->consumption(), 8000);
+    EXPECT_FALSE(c1->try_consume(4000));
+    EXPECT_TRUE(c1->try_consume(2000));
+    c1->release(2000);
+    // index allocation fails with capacity 0
+    HashIndex hi(1 << 16, c1.get());
+    EXPECT_EQ(hi.capacity(), 0);
+    tablet->set_limit(-1);
+    ASSERT_TRUE(b2.alloc(4000, BufferTag::base(1, 0, c1.get()).data()));
+    EXPECT_EQ(tablet->consumption(), 12000);
+}
+
+}
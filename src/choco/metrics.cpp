@@ -0,0 +1,301 @@
+#include "metrics.h"
+
+namespace choco {
+
+const size_t Histogram::kNumBuckets;
+const uint32_t CommitTiming::kSampleRows;
+
+Histogram::Histogram() {
+    reset();
+}
+
+size_t Histogram::bucket_index(uint64_t v) {
+    if (v < 8) {
+        return v;
+    }
+    size_t msb = 63 - __builtin_clzll(v);
+    return 8 + (msb - 3) * 4 + ((v >> (msb - 2)) & 3);
+}
+
+uint64_t Histogram::bucket_upper(size_t idx) {
+    if (idx < 8) {
+        return idx;
+    }
+    size_t msb = (idx - 8) / 4 + 3;
+    uint64_t sub = (idx - 8) % 4;
+    uint64_t lower = (4 + sub) << (msb - 2);
+    return lower + ((uint64_t)1 << (msb - 2)) - 1;
+}
+
+void Histogram::add(uint64_t v) {
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(v, std::memory_order_relaxed);
+    _buckets[bucket_index(v)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t cur = _min.load(std::memory_order_relaxed);
+    while (v < cur && !_min.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+    }
+    cur = _max.load(std::memory_order_relaxed);
+    while (v > cur && !_max.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t Histogram::min() const {
+    return count() == 0 ? 0 : _min.load(std::memory_order_relaxed);
+}
+
+double Histogram::mean() const {
+    uint64_t n = count();
+    return n == 0 ? 0.0 : (double)sum() / n;
+}
+
+uint64_t Histogram::percentile(double p) const {
+    uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max((uint64_t)1, (uint64_t)(p / 100.0 * n + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        seen += _buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucket_upper(i), max());
+        }
+    }
+    return max();
+}
+
+void Histogram::reset() {
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _min.store(UINT64_MAX, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        _buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+string Histogram::to_string() const {
+    return Format("count=%zu mean=%.1lf p50=%zu p99=%zu max=%zu", count(), mean(),
+                  percentile(50), percentile(99), max());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry* registry = new MetricsRegistry();
+    return *registry;
+}
+
+Histogram* MetricsRegistry::histogram(const string& name) {
+    std::lock_guard<mutex> lg(_lock);
+    auto& ret = _histograms[name];
+    if (!ret) {
+        ret.reset(new Histogram());
+    }
+    return ret.get();
+}
+
+const Histogram* MetricsRegistry::find(const string& name) const {
+    std::lock_guard<mutex> lg(_lock);
+    auto itr = _histograms.find(name);
+    return itr == _histograms.end() ? nullptr : itr->second.get();
+}
+
+void MetricsRegistry::list(vector<std::pair<string, const Histogram*>>& ret) const {
+    std::lock_guard<mutex> lg(_lock);
+    ret.clear();
+    for (auto& e : _histograms) {
+        ret.emplace_back(e.first, e.second.get());
+    }
+}
+
+void MetricsRegistry::reset() {
+    std::lock_guard<mutex> lg(_lock);
+    for (auto& e : _histograms) {
+        e.second->reset();
+    }
+}
+
+string MetricsRegistry::to_string() const {
+    vector<std::pair<string, const Histogram*>> all;
+    list(all);
+    string ret;
+    for (auto& e : all) {
+        ret += Format("%s %s\n", e.first.c_str(), e.second->to_string().c_str());
+    }
+    return ret;
+}
+
+// calibrate CycleClock against wall clock once, gutil's CyclesPerSecond
+// depends on dynamic annotations which are not built
+static double NanosPerCycle() {
+    double t0 = Time();
+    int64_t c0 = CycleClock::Now();
+    usleep(5000);
+    double t1 = Time();
+    int64_t c1 = CycleClock::Now();
+    return c1 > c0 ? (t1 - t0) * 1e9 / (c1 - c0) : 1.0;
+}
+
+uint64_t CyclesToNanos(int64_t cycles) {
+    if (cycles <= 0) {
+        return 0;
+    }
+    // calibrated on first conversion, processes which never read metrics
+    // don't pay for the sleep
+    static const double nanos_per_cycle = NanosPerCycle();
+    return (uint64_t)(cycles * nanos_per_cycle);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+const char* CommitPhaseName(CommitPhase phase) {
+    switch (phase) {
+    case CommitDecode:
+        return "decode";
+    case CommitHashProbe:
+        return "hash_probe";
+    case CommitKeyCompare:
+        return "key_compare";
+    case CommitColumnInsert:
+        return "column_insert";
+    case CommitDeltaFinalize:
+        return "delta_finalize";
+    case CommitIndexRehash:
+        return "index_rehash";
+    case CommitPublish:
+        return "publish";
+    default:
+        return "unknown";
+    }
+}
+
+// histograms of CommitTiming phases and total
+struct CommitHistograms {
+    explicit CommitHistograms(MetricsRegistry& registry) {
+        for (size_t i = 0; i < kNumCommitPhase; i++) {
+            phases[i] = registry.histogram(Format("commit.%s_ns", CommitPhaseName((CommitPhase)i)));
+        }
+        total = registry.histogram("commit.total_ns");
+    }
+
+    Histogram* phases[kNumCommitPhase];
+    Histogram* total;
+};
+
+void CommitTiming::record(MetricsRegistry& registry) const {
+    // every commit records to the global registry, look its histograms
+    // up once, they are never removed
+    static CommitHistograms global(MetricsRegistry::global());
+    const CommitHistograms* hs = &global;
+    unique_ptr<CommitHistograms> other;
+    if (&registry != &MetricsRegistry::global()) {
+        other.reset(new CommitHistograms(registry));
+        hs = other.get();
+    }
+    uint64_t total = 0;
+    for (size_t i = 0; i < kNumCommitPhase; i++) {
+        uint64_t ns = CyclesToNanos(cycles[i]);
+        total += ns;
+        hs->phases[i]->add(ns);
+    }
+    hs->total->add(total);
+}
+
+string CommitTiming::to_string() const {
+    string ret;
+    for (size_t i = 0; i < kNumCommitPhase; i++) {
+        ret += Format("%s%s=%.3lfms", i > 0 ? " " : "", CommitPhaseName((CommitPhase)i),
+                      CyclesToNanos(cycles[i]) / 1000000.0);
+    }
+    return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ScanStats::merge(const ScanStats& rhs) {
+    blocks += rhs.blocks;
+    rows += rhs.rows;
+    zero_copy_blocks += rhs.zero_copy_blocks;
+    copied_blocks += rhs.copied_blocks;
+    delta_entries += rhs.delta_entries;
+    pushdown_blocks += rhs.pushdown_blocks;
+    skipped_blocks += rhs.skipped_blocks;
+    get_keys += rhs.get_keys;
+    get_rows += rhs.get_rows;
+    hash_probes += rhs.hash_probes;
+    hash_entries += rhs.hash_entries;
+    tag_false_positives += rhs.tag_false_positives;
+    key_compares += rhs.key_compares;
+}
+
+// histograms of ScanStats counters, in the order of ScanStats::record
+struct ScanHistograms {
+    static const size_t kNumCounters = 13;
+
+    explicit ScanHistograms(MetricsRegistry& registry) {
+        static const char* names[kNumCounters] = {
+            "scan.blocks",
+            "scan.rows",
+            "scan.zero_copy_blocks",
+            "scan.copied_blocks",
+            "scan.delta_entries",
+            "scan.pushdown_blocks",
+            "scan.skipped_blocks",
+            "scan.get_keys",
+            "scan.get_rows",
+            "scan.hash_probes",
+            "scan.hash_entries",
+            "scan.tag_false_positives",
+            "scan.key_compares",
+        };
+        for (size_t i = 0; i < kNumCounters; i++) {
+            histograms[i] = registry.histogram(names[i]);
+        }
+    }
+
+    Histogram* histograms[kNumCounters];
+};
+
+void ScanStats::record(MetricsRegistry& registry) const {
+    const size_t counters[] = {
+        blocks,
+        rows,
+        zero_copy_blocks,
+        copied_blocks,
+        delta_entries,
+        pushdown_blocks,
+        skipped_blocks,
+        get_keys,
+        get_rows,
+        hash_probes,
+        hash_entries,
+        tag_false_positives,
+        key_compares,
+    };
+    static_assert(sizeof(counters) / sizeof(counters[0]) == ScanHistograms::kNumCounters,
+                  "ScanHistograms doesn't match counters");
+    // every scan records to the global registry, look its histograms up
+    // once, they are never removed
+    static ScanHistograms global(MetricsRegistry::global());
+    const ScanHistograms* hs = &global;
+    unique_ptr<ScanHistograms> other;
+    if (&registry != &MetricsRegistry::global()) {
+        other.reset(new ScanHistograms(registry));
+        hs = other.get();
+    }
+    for (size_t i = 0; i < ScanHistograms::kNumCounters; i++) {
+        hs->histograms[i]->add(counters[i]);
+    }
+}
+
+string ScanStats::to_string() const {
+    return Format("blocks=%zu rows=%zu zero_copy=%zu copied=%zu delta_entries=%zu "
+                  "pushdown=%zu skipped=%zu get_keys=%zu get_rows=%zu hash_probes=%zu hash_entries=%zu "
+                  "tag_false_positives=%zu key_compares=%zu",
+                  blocks, rows, zero_copy_blocks, copied_blocks, delta_entries,
+                  pushdown_blocks, skipped_blocks, get_keys, get_rows, hash_probes, hash_entries,
+                  tag_false_positives, key_compares);
+}
+
+} /* namespace choco */
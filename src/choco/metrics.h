@@ -0,0 +1,197 @@
+#ifndef CHOCO_METRICS_H_
+#define CHOCO_METRICS_H_
+
+#include <map>
+#include "common.h"
+#include "gutil/walltime.h"
+
+namespace choco {
+
+/**
+ * Histogram of non-negative integer samples(e.g. nanoseconds), safe for
+ * concurrent add. Buckets are log-linear: exact below 8, then 4 buckets
+ * per power of two, so percentiles are within 25% of the real value.
+ */
+class Histogram {
+public:
+    static const size_t kNumBuckets = 8 + 61 * 4;
+
+    Histogram();
+
+    void add(uint64_t v);
+
+    uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+    // 0 if empty
+    uint64_t min() const;
+    uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    /**
+     * value at percentile p(0~100), upper bound of the bucket containing
+     * it, capped by max, 0 if empty
+     */
+    uint64_t percentile(double p) const;
+
+    void reset();
+
+    // count/mean/p50/p99/max
+    string to_string() const;
+
+    static size_t bucket_index(uint64_t v);
+    // largest value of bucket idx
+    static uint64_t bucket_upper(size_t idx);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Histogram);
+
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum;
+    std::atomic<uint64_t> _min;
+    std::atomic<uint64_t> _max;
+    std::atomic<uint64_t> _buckets[kNumBuckets];
+};
+
+/**
+ * Named histograms of a process, created on first use and never removed,
+ * so callers can cache the returned pointers.
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& global();
+
+    MetricsRegistry() = default;
+
+    // get or create histogram name
+    Histogram* histogram(const string& name);
+
+    // nullptr if not exists
+    const Histogram* find(const string& name) const;
+
+    // all histograms, ordered by name
+    void list(vector<std::pair<string, const Histogram*>>& ret) const;
+
+    // reset all histograms
+    void reset();
+
+    // one line per histogram
+    string to_string() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(MetricsRegistry);
+
+    mutable mutex _lock;
+    std::map<string, unique_ptr<Histogram>> _histograms;
+};
+
+// convert CycleClock cycles to nanoseconds, calibrated on first call
+uint64_t CyclesToNanos(int64_t cycles);
+
+enum CommitPhase {
+    // read rows from WriteTx batches
+    CommitDecode = 0,
+    // hash key and find hash index entries
+    CommitHashProbe,
+    // compare key with candidate rows
+    CommitKeyCompare,
+    // insert/update cells with column writers
+    CommitColumnInsert,
+    // finalize column writers into new pages and deltas
+    CommitDeltaFinalize,
+    // rebuild hash index when it's full
+    CommitIndexRehash,
+    // make new columns, index and sub-tablets visible
+    CommitPublish,
+    kNumCommitPhase,
+};
+
+const char* CommitPhaseName(CommitPhase phase);
+
+/**
+ * CycleClock cycles spent in each phase of a commit. Per-row phases
+ * (decode, hash probe, key compare, column insert) are timed on one of
+ * every kSampleRows rows and scaled, reading the clock for every row
+ * costs as much as the work being measured.
+ */
+struct CommitTiming {
+    static const uint32_t kSampleRows = 32;
+
+    static bool sample_row(size_t row) {
+        return row % kSampleRows == 0;
+    }
+
+    // add cycles of a sampled row
+    void add_sampled(CommitPhase phase, int64_t c) {
+        cycles[phase] += c * kSampleRows;
+    }
+
+    int64_t cycles[kNumCommitPhase] = {};
+
+    void add(CommitPhase phase, int64_t c) {
+        cycles[phase] += c;
+    }
+
+    void merge(const CommitTiming& rhs) {
+        for (size_t i = 0; i < kNumCommitPhase; i++) {
+            cycles[i] += rhs.cycles[i];
+        }
+    }
+
+    void clear() {
+        for (size_t i = 0; i < kNumCommitPhase; i++) {
+            cycles[i] = 0;
+        }
+    }
+
+    /**
+     * add nanoseconds of each phase to histogram "commit.<phase>_ns", and
+     * total to "commit.total_ns"
+     */
+    void record(MetricsRegistry& registry) const;
+
+    // milliseconds of each phase
+    string to_string() const;
+};
+
+/**
+ * Work done by a MemTabletScan, counted by the scan itself so concurrent
+ * scans don't share counters.
+ */
+struct ScanStats {
+    // full scan: row blocks returned(or aggregated) and their rows
+    size_t blocks = 0;
+    size_t rows = 0;
+    // full scan: column blocks referencing pages directly or copied
+    // (because of deltas, narrow storage or encoding)
+    size_t zero_copy_blocks = 0;
+    size_t copied_blocks = 0;
+    // full scan: delta entries applied to copied column blocks
+    size_t delta_entries = 0;
+    // full scan: column blocks filtered or aggregated on stored data
+    // without decoding, and blocks skipped because no row passed the filter
+    size_t pushdown_blocks = 0;
+    size_t skipped_blocks = 0;
+    // get: keys looked up and rows found
+    size_t get_keys = 0;
+    size_t get_rows = 0;
+    // get: hash index chunks visited, entries returned, entries
+    // dropped by full hash, and row keys compared
+    size_t hash_probes = 0;
+    size_t hash_entries = 0;
+    size_t tag_false_positives = 0;
+    size_t key_compares = 0;
+
+    void merge(const ScanStats& rhs);
+
+    /**
+     * add each counter to histogram "scan.<name>", so sum is the
+     * process wide total, and percentiles are per scan
+     */
+    void record(MetricsRegistry& registry) const;
+
+    string to_string() const;
+};
+
+} /* namespace choco */
+
+#endif /* CHOCO_METRICS_H_ */
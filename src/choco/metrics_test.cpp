@@ -0,0 +1,171 @@
+#include "gtest/gtest.h"
+#include "metrics.h"
+#include "mem_tablet.h"
+#include "mem_tablet_scan.h"
+#include "column.h"
+
+namespace choco {
+
+TEST(Metrics, histogram) {
+    Histogram h;
+    EXPECT_EQ(0U, h.count());
+    EXPECT_EQ(0U, h.percentile(50));
+    EXPECT_EQ(0U, h.min());
+    for (uint64_t v = 1; v <= 1000; v++) {
+        h.add(v);
+    }
+    EXPECT_EQ(1000U, h.count());
+    EXPECT_EQ(500500U, h.sum());
+    EXPECT_EQ(1U, h.min());
+    EXPECT_EQ(1000U, h.max());
+    EXPECT_DOUBLE_EQ(500.5, h.mean());
+    // bucket upper bounds are within 25% of real value
+    uint64_t p50 = h.percentile(50);
+    EXPECT_GE(p50, 500U);
+    EXPECT_LE(p50, 625U);
+    uint64_t p99 = h.percentile(99);
+    EXPECT_GE(p99, 990U);
+    EXPECT_LE(p99, 1000U);
+    EXPECT_EQ(1U, h.percentile(0));
+    LOG(INFO) << h.to_string();
+    h.reset();
+    EXPECT_EQ(0U, h.count());
+    EXPECT_EQ(0U, h.max());
+}
+
+TEST(Metrics, buckets) {
+    for (uint64_t v : {0ULL, 1ULL, 7ULL, 8ULL, 9ULL, 100ULL, 12345ULL, 1ULL << 40, ~0ULL}) {
+        size_t idx = Histogram::bucket_index(v);
+        ASSERT_LT(idx, Histogram::kNumBuckets);
+        EXPECT_GE(Histogram::bucket_upper(idx), v);
+        if (idx > 0) {
+            EXPECT_LT(Histogram::bucket_upper(idx - 1), v);
+        }
+    }
+}
+
+TEST(Metrics, commit_timing) {
+    MetricsRegistry& registry = MetricsRegistry::global();
+    uint64_t ncommit = registry.histogram("commit.total_ns")->count();
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int32 v", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    for (int version = 1; version <= 3; version++) {
+        unique_ptr<WriteTx> wtx;
+        ASSERT_TRUE(tablet->create_writetx(wtx));
+        PartialRowWriter writer(wtx->schema());
+        PartialRowBatch* batch = wtx->new_batch();
+        for (int32_t i = 0; i < 100000; i++) {
+            writer.start_row();
+            ASSERT_TRUE(writer.set("id", &i));
+            ASSERT_TRUE(writer.set("v", &version));
+            if (!writer.write_row_to_batch(*batch)) {
+                batch = wtx->new_batch();
+                ASSERT_TRUE(writer.write_row_to_batch(*batch));
+            }
+        }
+        ASSERT_TRUE(tablet->prepare_writetx(wtx));
+        ASSERT_TRUE(tablet->commit(wtx, version));
+    }
+    EXPECT_EQ(ncommit + 3, registry.histogram("commit.total_ns")->count());
+    for (size_t i = 0; i < kNumCommitPhase; i++) {
+        const Histogram* h = registry.find(Format("commit.%s_ns", CommitPhaseName((CommitPhase)i)));
+        ASSERT_TRUE(h != nullptr);
+        EXPECT_EQ(ncommit + 3, h->count());
+    }
+    EXPECT_GT(registry.find("commit.hash_probe_ns")->sum(), 0U);
+    EXPECT_GT(registry.find("commit.column_insert_ns")->sum(), 0U);
+    LOG(INFO) << "metrics:\n" << registry.to_string();
+}
+
+TEST(Metrics, commit_timing_registry) {
+    // histograms of the global registry are cached, others are looked up
+    MetricsRegistry registry;
+    CommitTiming timing;
+    timing.add(CommitDecode, 1000000);
+    timing.record(registry);
+    timing.record(registry);
+    EXPECT_EQ(2U, registry.find("commit.decode_ns")->count());
+    EXPECT_EQ(2U, registry.find("commit.publish_ns")->count());
+    EXPECT_EQ(registry.find("commit.decode_ns")->sum(), registry.find("commit.total_ns")->sum());
+    EXPECT_GT(registry.find("commit.total_ns")->sum(), 0U);
+}
+
+TEST(Metrics, scan_stats) {
+    MetricsRegistry& registry = MetricsRegistry::global();
+    uint64_t nrows = registry.histogram("scan.rows")->sum();
+    uint64_t nkeys = registry.histogram("scan.get_keys")->sum();
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int32 id,int32 v", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const int32_t N = 100000;
+    // version 1 inserts all rows, version 2 updates every 10th row
+    for (int version = 1; version <= 2; version++) {
+        unique_ptr<WriteTx> wtx;
+        ASSERT_TRUE(tablet->create_writetx(wtx));
+        PartialRowWriter writer(wtx->schema());
+        PartialRowBatch* batch = wtx->new_batch();
+        for (int32_t i = 0; i < N; i += (version == 1 ? 1 : 10)) {
+            writer.start_row();
+            ASSERT_TRUE(writer.set("id", &i));
+            ASSERT_TRUE(writer.set("v", &version));
+            if (!writer.write_row_to_batch(*batch)) {
+                batch = wtx->new_batch();
+                ASSERT_TRUE(writer.write_row_to_batch(*batch));
+            }
+        }
+        ASSERT_TRUE(tablet->prepare_writetx(wtx));
+        ASSERT_TRUE(tablet->commit(wtx, version));
+    }
+    size_t nblock = NBlock(N, Column::BLOCK_SIZE);
+    for (uint64_t version = 1; version <= 2; version++) {
+        unique_ptr<ScanSpec> spec;
+        ASSERT_TRUE(ScanSpec::create(version, "id,v", true, spec));
+        unique_ptr<MemTabletScan> scan;
+        ASSERT_TRUE(tablet->scan(spec, scan));
+        const RowBlock* rblock = nullptr;
+        do {
+            ASSERT_TRUE(scan->next_scan_block(rblock));
+        } while (rblock);
+        const ScanStats& stats = scan->stats();
+        EXPECT_EQ(nblock, stats.blocks);
+        EXPECT_EQ((size_t)N, stats.rows);
+        EXPECT_EQ(nblock * 2, stats.zero_copy_blocks + stats.copied_blocks);
+        if (version == 1) {
+            EXPECT_EQ(0U, stats.delta_entries);
+        } else {
+            // v of updated rows in every block
+            EXPECT_GE(stats.copied_blocks, nblock);
+            EXPECT_EQ((size_t)N / 10, stats.delta_entries);
+        }
+        vector<int32_t> keys = {0, 5, N + 1};
+        MemTabletScan::GetResult result;
+        ASSERT_TRUE(scan->get(result, keys.size(), keys.data()));
+        EXPECT_EQ(3U, stats.get_keys);
+        EXPECT_EQ(2U, stats.get_rows);
+        EXPECT_GE(stats.hash_probes, 3U);
+        EXPECT_GE(stats.hash_entries, 2U);
+        EXPECT_GE(stats.key_compares, 2U);
+        LOG(INFO) << Format("scan stats version=%zu: %s", version, stats.to_string().c_str());
+    }
+    // destroyed scans are aggregated globally
+    EXPECT_EQ(nrows + 2 * N, registry.histogram("scan.rows")->sum());
+    EXPECT_EQ(nkeys + 6, registry.histogram("scan.get_keys")->sum());
+}
+
+TEST(Metrics, scan_stats_registry) {
+    // histograms of the global registry are cached, others are looked up
+    MetricsRegistry registry;
+    ScanStats stats;
+    stats.rows = 5;
+    stats.key_compares = 7;
+    stats.record(registry);
+    stats.record(registry);
+    EXPECT_EQ(10U, registry.find("scan.rows")->sum());
+    EXPECT_EQ(14U, registry.find("scan.key_compares")->sum());
+    EXPECT_EQ(2U, registry.find("scan.blocks")->count());
+}
+
+} /* namespace choco */
@@ -0,0 +1,245 @@
+#include <sys/mman.h>
+#include "page_pool.h"
+
+namespace choco {
+
+// 0: not created, 1: alive, 2: destroyed(thread exiting)
+static thread_local int tls_page_cache_state = 0;
+
+struct PageThreadCache {
+    PageThreadCache() {
+        tls_page_cache_state = 1;
+    }
+
+    ~PageThreadCache() {
+        tls_page_cache_state = 2;
+        for (size_t cls = 0; cls < PagePool::kNumClass; cls++) {
+            if (!pages[cls].empty()) {
+                PagePool::global().push_global(cls, pages[cls].data(), pages[cls].size());
+                pages[cls].clear();
+            }
+        }
+    }
+
+    static size_t capacity(size_t cls) {
+        return std::max((size_t)1, PagePool::kThreadCacheBytes >> (cls + PagePool::kMinClassBits));
+    }
+
+    // dirty pages, most recently freed last
+    vector<void*> pages[PagePool::kNumClass];
+};
+
+static thread_local PageThreadCache tls_page_cache;
+
+// nullptr if called by destructors after the thread's cache is destroyed
+static PageThreadCache* ThreadCache() {
+    if (tls_page_cache_state == 2) {
+        return nullptr;
+    }
+    return &tls_page_cache;
+}
+
+PagePool& PagePool::global() {
+    static PagePool* pool = new PagePool();
+    return *pool;
+}
+
+int PagePool::size_class(size_t size) {
+    if (size < ((size_t)1 << kMinClassBits) || size > ((size_t)1 << kMaxClassBits) ||
+        (size & (size - 1)) != 0) {
+        return -1;
+    }
+    return __builtin_ctzll(size) - kMinClassBits;
+}
+
+PagePool::PagePool() :
+        _cached_bytes(0),
+        _max_cached_bytes(256 << 20),
+        _use_huge_page(false),
+        _alloc(0),
+        _thread_hit(0),
+        _global_hit(0),
+        _mmap(0),
+        _munmap(0),
+        _hugetlb(0),
+        _thp(0) {
+}
+
+size_t PagePool::map_size(size_t size) {
+    size_t align = size >= kHugePageSize ? kHugePageSize : 4096;
+    return (size + align - 1) & ~(align - 1);
+}
+
+void* PagePool::map(size_t size) {
+    size_t msize = map_size(size);
+    bool huge = msize >= kHugePageSize && use_huge_page();
+    if (huge) {
+        void* ret = mmap(nullptr, msize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ret != MAP_FAILED) {
+            _mmap.fetch_add(1, std::memory_order_relaxed);
+            _hugetlb.fetch_add(1, std::memory_order_relaxed);
+            return ret;
+        }
+        // no reserved huge pages, map 2M aligned range for transparent huge pages
+        uint8_t* raw = (uint8_t*)mmap(nullptr, msize + kHugePageSize, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            return nullptr;
+        }
+        uint8_t* aligned = (uint8_t*)(((uintptr_t)raw + kHugePageSize - 1) & ~(kHugePageSize - 1));
+        if (aligned > raw) {
+            munmap(raw, aligned - raw);
+        }
+        size_t tail = raw + msize + kHugePageSize - (aligned + msize);
+        if (tail > 0) {
+            munmap(aligned + msize, tail);
+        }
+        _mmap.fetch_add(1, std::memory_order_relaxed);
+        if (madvise(aligned, msize, MADV_HUGEPAGE) == 0) {
+            _thp.fetch_add(1, std::memory_order_relaxed);
+        }
+        return aligned;
+    }
+    void* ret = mmap(nullptr, msize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ret == MAP_FAILED) {
+        return nullptr;
+    }
+    _mmap.fetch_add(1, std::memory_order_relaxed);
+    return ret;
+}
+
+void PagePool::unmap(void* ptr, size_t size) {
+    munmap(ptr, map_size(size));
+    _munmap.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* PagePool::pop_global(size_t cls) {
+    if (_cached_bytes.load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+    }
+    std::lock_guard<mutex> lg(_lock);
+    if (_free[cls].empty()) {
+        return nullptr;
+    }
+    void* page = _free[cls].back();
+    _free[cls].pop_back();
+    _cached_bytes.fetch_sub((size_t)1 << (cls + kMinClassBits), std::memory_order_relaxed);
+    return page;
+}
+
+void PagePool::push_global(size_t cls, void** pages, size_t n) {
+    size_t page_size = (size_t)1 << (cls + kMinClassBits);
+    size_t max_cached = _max_cached_bytes.load(std::memory_order_relaxed);
+    size_t nzeroed = 0;
+    for (size_t i = 0; i < n; i++) {
+        // drop physical memory, page reads as zero on next touch. It fails
+        // (EINVAL) on MAP_HUGETLB mappings before linux 5.18, pop_global
+        // callers expect zeroed pages, so such pages are unmapped instead
+        if (madvise(pages[i], page_size, MADV_DONTNEED) == 0) {
+            pages[nzeroed++] = pages[i];
+        } else {
+            unmap(pages[i], page_size);
+        }
+    }
+    size_t i = 0;
+    {
+        std::lock_guard<mutex> lg(_lock);
+        for (; i < nzeroed && _cached_bytes.load(std::memory_order_relaxed) + page_size <= max_cached; i++) {
+            _free[cls].push_back(pages[i]);
+            _cached_bytes.fetch_add(page_size, std::memory_order_relaxed);
+        }
+    }
+    for (; i < nzeroed; i++) {
+        unmap(pages[i], page_size);
+    }
+}
+
+void* PagePool::alloc(size_t size, bool zero) {
+    if (size > ((size_t)1 << kMaxClassBits)) {
+        // fresh mappings are zeroed
+        return map(size);
+    }
+    int cls = size_class(size);
+    if (cls < 0) {
+        void* ret = aligned_malloc(size, size >= 4096 ? 4096 : 64);
+        if (ret && zero) {
+            memset(ret, 0, size);
+        }
+        return ret;
+    }
+    _alloc.fetch_add(1, std::memory_order_relaxed);
+    PageThreadCache* tc = ThreadCache();
+    if (tc && !tc->pages[cls].empty()) {
+        void* page = tc->pages[cls].back();
+        tc->pages[cls].pop_back();
+        _thread_hit.fetch_add(1, std::memory_order_relaxed);
+        if (zero) {
+            memset(page, 0, size);
+        }
+        return page;
+    }
+    void* page = pop_global(cls);
+    if (page) {
+        _global_hit.fetch_add(1, std::memory_order_relaxed);
+        return page;
+    }
+    return map(size);
+}
+
+void PagePool::free(void* ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+    if (size > ((size_t)1 << kMaxClassBits)) {
+        unmap(ptr, size);
+        return;
+    }
+    int cls = size_class(size);
+    if (cls < 0) {
+        aligned_free(ptr);
+        return;
+    }
+    PageThreadCache* tc = ThreadCache();
+    if (!tc) {
+        push_global(cls, &ptr, 1);
+        return;
+    }
+    auto& cache = tc->pages[cls];
+    size_t cap = PageThreadCache::capacity(cls);
+    if (cache.size() >= cap) {
+        // move older half to global free lists
+        size_t n = std::max((size_t)1, cap / 2);
+        push_global(cls, cache.data(), n);
+        cache.erase(cache.begin(), cache.begin() + n);
+    }
+    cache.push_back(ptr);
+}
+
+void PagePool::purge() {
+    for (size_t cls = 0; cls < kNumClass; cls++) {
+        vector<void*> pages;
+        {
+            std::lock_guard<mutex> lg(_lock);
+            pages.swap(_free[cls]);
+            _cached_bytes.fetch_sub(pages.size() << (cls + kMinClassBits), std::memory_order_relaxed);
+        }
+        for (auto page : pages) {
+            unmap(page, (size_t)1 << (cls + kMinClassBits));
+        }
+    }
+}
+
+PagePool::Stats PagePool::stats() const {
+    Stats ret;
+    ret.alloc = _alloc.load(std::memory_order_relaxed);
+    ret.thread_hit = _thread_hit.load(std::memory_order_relaxed);
+    ret.global_hit = _global_hit.load(std::memory_order_relaxed);
+    ret.mmap = _mmap.load(std::memory_order_relaxed);
+    ret.munmap = _munmap.load(std::memory_order_relaxed);
+    ret.hugetlb = _hugetlb.load(std::memory_order_relaxed);
+    ret.thp = _thp.load(std::memory_order_relaxed);
+    return ret;
+}
+
+} /* namespace choco */
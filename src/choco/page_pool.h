@@ -0,0 +1,116 @@
+#ifndef CHOCO_PAGE_POOL_H_
+#define CHOCO_PAGE_POOL_H_
+
+#include "common.h"
+
+namespace choco {
+
+/**
+ * Size-classed allocator for page sized buffers: column pages, null
+ * bitmaps, column blocks and string pool segments.
+ *
+ * Power of two sizes in [4K, 4M] are served from size classes, other
+ * sizes fall back to aligned_malloc. Freed pages go to a per-thread
+ * cache first(hot, reused without syscalls), when a thread cache is full
+ * half of it is moved to the global free lists. Pages in global free
+ * lists are madvise(MADV_DONTNEED)ed, so their memory is returned to OS
+ * and they read as zero when reused, zeroed allocations can take them
+ * without memset, pages madvise fails on are unmapped. Sizes above 4M(e.g. hash index chunks) are mapped
+ * directly without caching.
+ *
+ * With use_huge_page, mappings of 2M or more are backed by huge pages to
+ * reduce TLB misses of randomly accessed memory: MAP_HUGETLB if the
+ * system has reserved huge pages, otherwise 2M aligned mappings with
+ * madvise(MADV_HUGEPAGE) for transparent huge pages.
+ */
+class PagePool {
+public:
+    static const size_t kMinClassBits = 12; // 4K
+    static const size_t kMaxClassBits = 22; // 4M
+    static const size_t kNumClass = kMaxClassBits - kMinClassBits + 1;
+    // max bytes of each size class cached by a thread
+    static const size_t kThreadCacheBytes = 4 << 20;
+    static const size_t kHugePageSize = 2 << 20;
+
+    struct Stats {
+        size_t alloc = 0;
+        size_t thread_hit = 0;
+        size_t global_hit = 0;
+        size_t mmap = 0;
+        size_t munmap = 0;
+        // mappings backed by MAP_HUGETLB or advised with MADV_HUGEPAGE
+        size_t hugetlb = 0;
+        size_t thp = 0;
+    };
+
+    static PagePool& global();
+
+    // size class of size, -1 if size is not served by the pool
+    static int size_class(size_t size);
+
+    /**
+     * allocate size bytes aligned to 4096(64 if size < 4096), memory is
+     * zeroed if zero is true, return nullptr if allocation failed
+     */
+    void* alloc(size_t size, bool zero = false);
+
+    // free memory from alloc, size should be the same as allocated
+    void free(void* ptr, size_t size);
+
+    // bytes of pages in global free lists
+    size_t cached_bytes() const {
+        return _cached_bytes.load(std::memory_order_relaxed);
+    }
+
+    // global free lists keep at most max_cached_bytes, extra pages are unmapped
+    void set_max_cached_bytes(size_t bytes) {
+        _max_cached_bytes.store(bytes, std::memory_order_relaxed);
+    }
+
+    bool use_huge_page() const {
+        return _use_huge_page.load(std::memory_order_relaxed);
+    }
+
+    // only affects later allocations
+    void set_use_huge_page(bool use) {
+        _use_huge_page.store(use, std::memory_order_relaxed);
+    }
+
+    // unmap all pages in global free lists
+    void purge();
+
+    Stats stats() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(PagePool);
+    friend struct PageThreadCache;
+
+    PagePool();
+
+    // mapped size of size, multiple of 2M if size >= 2M
+    static size_t map_size(size_t size);
+    void* map(size_t size);
+    void unmap(void* ptr, size_t size);
+    // take a zeroed page from global free list, nullptr if empty
+    void* pop_global(size_t cls);
+    // give dirty pages back to global free list, pages[0, n) is reused
+    // as scratch space
+    void push_global(size_t cls, void** pages, size_t n);
+
+    mutable mutex _lock;
+    vector<void*> _free[kNumClass];
+    std::atomic<size_t> _cached_bytes;
+    std::atomic<size_t> _max_cached_bytes;
+    std::atomic<bool> _use_huge_page;
+    std::atomic<size_t> _alloc;
+    std::atomic<size_t> _thread_hit;
+    std::atomic<size_t> _global_hit;
+    std::atomic<size_t> _mmap;
+    std::atomic<size_t> _munmap;
+    std::atomic<size_t> _hugetlb;
+    std::atomic<size_t> _thp;
+};
+
+} /* namespace choco */
+
+#endif /* CHOCO_PAGE_POOL_H_ */
@@ -0,0 +1,74 @@
+#include <thread>
+#include "gtest/gtest.h"
+#include "page_pool.h"
+
+namespace choco {
+
+TEST(PagePool, size_class) {
+    EXPECT_EQ(PagePool::size_class(4096), 0);
+    EXPECT_EQ(PagePool::size_class(65536), 4);
+    EXPECT_EQ(PagePool::size_class(4 << 20), (int)PagePool::kNumClass - 1);
+    EXPECT_EQ(PagePool::size_class(2048), -1);
+    EXPECT_EQ(PagePool::size_class(65536 * 3), -1);
+    EXPECT_EQ(PagePool::size_class(8 << 20), -1);
+}
+
+TEST(PagePool, recycle) {
+    PagePool& pool = PagePool::global();
+    const size_t size = 1 << 17;
+    uint8_t* p1 = (uint8_t*)pool.alloc(size);
+    ASSERT_TRUE(p1);
+    EXPECT_EQ((uintptr_t)p1 % 4096, 0);
+    memset(p1, 0xab, size);
+    pool.free(p1, size);
+    // reused from thread cache, zeroed on request
+    PagePool::Stats s0 = pool.stats();
+    uint8_t* p2 = (uint8_t*)pool.alloc(size, true);
+    EXPECT_EQ(p2, p1);
+    EXPECT_EQ(pool.stats().thread_hit, s0.thread_hit + 1);
+    for (size_t i = 0; i < size; i++) {
+        ASSERT_EQ(p2[i], 0);
+    }
+    pool.free(p2, size);
+    // sizes without size class
+    uint8_t* p3 = (uint8_t*)pool.alloc(3000, true);
+    ASSERT_TRUE(p3);
+    EXPECT_EQ(p3[2999], 0);
+    pool.free(p3, 3000);
+}
+
+TEST(PagePool, global_free_list) {
+    PagePool& pool = PagePool::global();
+    const size_t size = 1 << 16;
+    // more than a thread cache can hold, so pages spill to global free lists
+    const size_t n = PagePool::kThreadCacheBytes / size * 2;
+    vector<uint8_t*> pages;
+    std::thread t([&]() {
+        for (size_t i = 0; i < n; i++) {
+            uint8_t* p = (uint8_t*)pool.alloc(size);
+            ASSERT_TRUE(p);
+            memset(p, 0xcd, size);
+            pages.push_back(p);
+        }
+        for (auto p : pages) {
+            pool.free(p, size);
+        }
+        // thread cache is given back to global free lists when thread exits
+    });
+    t.join();
+    EXPECT_GE(pool.cached_bytes(), n * size);
+    PagePool::Stats s0 = pool.stats();
+    uint8_t* p = (uint8_t*)pool.alloc(size, true);
+    ASSERT_TRUE(p);
+    for (size_t i = 0; i < size; i++) {
+        ASSERT_EQ(p[i], 0);
+    }
+    pool.free(p, size);
+    PagePool::Stats s1 = pool.stats();
+    EXPECT_EQ(s1.mmap, s0.mmap);
+    pool.purge();
+    EXPECT_EQ(pool.cached_bytes(), 0);
+    EXPECT_GT(pool.stats().munmap, s1.munmap);
+}
+
+}
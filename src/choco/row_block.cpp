@@ -1,23 +1,26 @@
 #include "row_block.h"
+#include "encoding.h"
+#include "page_pool.h"
 
 namespace choco {
 
 Status ColumnBlock::alloc(size_t size, size_t esize) {
-    if (_owned_size == size) {
+    if (_owned_size == size && _owned_esize == esize) {
         return Status::OK();
     }
     clear();
-    _data = (uint8_t*)aligned_malloc(size*esize, size*esize>=4096?4096:64);
+    _data = (uint8_t*)PagePool::global().alloc(size*esize);
     if (!_data) {
         return Status::OOM("OOM when allocating column block");
     }
-    _nulls = (uint8_t*)aligned_malloc(size, size>=4096?4096:64);
+    _nulls = (uint8_t*)PagePool::global().alloc(BitmapSize64(size));
     if (!_nulls) {
-        aligned_free(_data);
+        PagePool::global().free(_data, size*esize);
         _data = nullptr;
         return Status::OOM("OOM when allocating column block");
     }
     _owned_size = size;
+    _owned_esize = esize;
     return Status::OK();
 }
 
@@ -25,9 +28,46 @@ Status ColumnBlock::copy_from(size_t size, size_t esize, Buffer& data, Buffer& n
     RETURN_NOT_OK(alloc(size, esize));
     memcpy(_data, data.data(), size*esize);
     if (nulls) {
-        memcpy(_nulls, nulls.data(), size);
+        memcpy(_nulls, nulls.data(), BitmapSize64(size));
     } else {
-        memset(_nulls, 0, size);
+        memset(_nulls, 0, BitmapSize64(size));
+    }
+    return Status::OK();
+}
+
+Status ColumnBlock::widen_from(size_t size, size_t esize, size_t src_esize, Buffer& data, Buffer& nulls) {
+    RETURN_NOT_OK(alloc(size, esize));
+    ConvertIntWidth(_data, esize, data.data(), src_esize, size);
+    if (nulls) {
+        memcpy(_nulls, nulls.data(), BitmapSize64(size));
+    } else {
+        memset(_nulls, 0, BitmapSize64(size));
+    }
+    return Status::OK();
+}
+
+Status ColumnBlock::decode_from(size_t size, size_t esize, const ForEncoding& encoding, Buffer& data, Buffer& nulls) {
+    RETURN_NOT_OK(alloc(size, esize));
+    encoding.decode(data.data(), size, _data, esize);
+    if (nulls) {
+        memcpy(_nulls, nulls.data(), BitmapSize64(size));
+    } else {
+        memset(_nulls, 0, BitmapSize64(size));
+    }
+    return Status::OK();
+}
+
+Status ColumnBlock::decode_from(size_t size, size_t esize, const AlpEncoding& encoding, Buffer& data, Buffer& nulls) {
+    RETURN_NOT_OK(alloc(size, esize));
+    if (esize == sizeof(float)) {
+        encoding.decode(data.data(), size, (float*)_data);
+    } else {
+        encoding.decode(data.data(), size, (double*)_data);
+    }
+    if (nulls) {
+        memcpy(_nulls, nulls.data(), BitmapSize64(size));
+    } else {
+        memset(_nulls, 0, BitmapSize64(size));
     }
     return Status::OK();
 }
@@ -35,15 +75,17 @@ Status ColumnBlock::copy_from(size_t size, size_t esize, Buffer& data, Buffer& n
 void ColumnBlock::clear() {
     if (_owned_size > 0) {
         if (_data) {
-            aligned_free(_data);
+            PagePool::global().free(_data, _owned_size*_owned_esize);
             _data = nullptr;
         }
         if (_nulls) {
-            aligned_free(_nulls);
+            PagePool::global().free(_nulls, BitmapSize64(_owned_size));
             _nulls = nullptr;
         }
     }
     _owned_size = 0;
+    _owned_esize = 0;
+    _page.reset();
 }
 
 ColumnBlock::~ColumnBlock() {
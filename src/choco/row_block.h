@@ -4,9 +4,14 @@
 #include "common.h"
 #include "schema.h"
 #include "buffer.h"
+#include "bitmap.h"
+#include "column.h"
 
 namespace choco {
 
+struct ForEncoding;
+struct AlpEncoding;
+
 class ColumnBlock {
 public:
     ColumnBlock() = default;
@@ -14,22 +19,60 @@ public:
     void clear();
     Status alloc(size_t size, size_t esize);
     Status copy_from(size_t size, size_t esize, Buffer& data, Buffer& nulls);
+    // copy from signed integers stored in narrower width src_esize
+    Status widen_from(size_t size, size_t esize, size_t src_esize, Buffer& data, Buffer& nulls);
+    // copy from FOR + bit-packed signed integers
+    Status decode_from(size_t size, size_t esize, const ForEncoding& encoding, Buffer& data, Buffer& nulls);
+    // copy from ALP encoded float(esize 4) or double(esize 8)
+    Status decode_from(size_t size, size_t esize, const AlpEncoding& encoding, Buffer& data, Buffer& nulls);
 
     const uint8_t* data() const {
         return _data;
     }
+    /**
+     * null bitmap, 1 bit per row, padded to 64-bit words,
+     * nullptr if column block doesn't have null
+     */
     const uint8_t* nulls() const {
         return _nulls;
     }
 
+    // true if data references column pages instead of an owned copy
+    bool zero_copy() const {
+        return _owned_size == 0;
+    }
+
+    // page referenced by zero-copy data, holding it keeps data valid
+    const RefPtr<ColumnPage>& page() const {
+        return _page;
+    }
+
+    bool is_null(size_t idx) const {
+        return _nulls && BitmapTest(_nulls, idx);
+    }
+
+    /**
+     * clear bits of null rows in selection bitmap, 64 rows at a time
+     */
+    void filter_not_null(uint8_t* selection, size_t nrows) const {
+        if (_nulls) {
+            BitmapMergeAndNot(selection, _nulls, nrows);
+        }
+    }
+
 private:
     friend class RowBlock;
+    friend class MemTabletScan;
+    friend class Expr;
     template <class, bool, class> friend class TypedColumnReader;
+    template <class, bool> friend class DictColumnReader;
 
     const ColumnSchema* _cs = nullptr;
     uint8_t* _data = nullptr;
     uint8_t* _nulls = nullptr;
     size_t _owned_size = 0;
+    size_t _owned_esize = 0;
+    RefPtr<ColumnPage> _page;
 };
 
 class RowBlock {
@@ -44,12 +87,21 @@ public:
         return _columns[idx];
     }
 
+    /**
+     * rows passing the scan filter, 1 bit per row, padded to 64-bit words,
+     * nullptr if scan doesn't have filter(all rows selected)
+     */
+    const uint8_t* selection() const {
+        return _selection.empty() ? nullptr : _selection.data();
+    }
+
 private:
     friend class MemTabletScan;
     RowBlock() = default;
 
     size_t _nrows = 0;
     vector<ColumnBlock> _columns;
+    vector<uint8_t> _selection;
 };
 
 } /* namespace choco */
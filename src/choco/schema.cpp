@@ -2,13 +2,33 @@
 
 namespace choco {
 
+const char* AggregationTypeName(AggregationType agg) {
+    switch (agg) {
+    case AggReplace:
+        return "replace";
+    case AggReplaceIfNotNull:
+        return "replace_if_not_null";
+    case AggSum:
+        return "sum";
+    case AggMax:
+        return "max";
+    case AggMin:
+        return "min";
+    default:
+        return "unknown";
+    }
+}
+
 string ColumnSchema::to_string() const {
-    return Format("Column(%s cid=%u %s%s)", name.c_str(), cid, TypeInfo::get(type).name().c_str(), nullable?" null":"");
+    return Format("Column(%s cid=%u %s%s%s%s%s%s)", name.c_str(), cid, TypeInfo::get(type).name().c_str(),
+            nullable?" null":"", dict?" dict":"", plain?" plain":"",
+            aggregation != AggReplace ? " " : "",
+            aggregation != AggReplace ? AggregationTypeName(aggregation) : "");
 }
 
 Status ColumnSchema::create(uint32_t cid, const Slice& desc, unique_ptr<ColumnSchema>& cs) {
 	//DLOG(INFO) << "check column: " << desc.ToString();
-	// name type null
+	// type name [null] [dict|plain] [replace|replace_if_not_null|sum|max|min]
 	vector<Slice> fds = desc.split(' ', true);
 	if (fds.size() < 2) {
 		return Status::InvalidArgument("bad column desc");
@@ -28,7 +48,7 @@ Status ColumnSchema::create(uint32_t cid, const Slice& desc, unique_ptr<ColumnSc
 		type = Int128;
 	} else if (stype == "float32") {
 		type = Float32;
-	} else if (stype == "flat64") {
+	} else if (stype == "float64") {
 		type = Float64;
 	} else if (stype == "string") {
 		type = String;
@@ -36,14 +56,37 @@ Status ColumnSchema::create(uint32_t cid, const Slice& desc, unique_ptr<ColumnSc
 		return Status::InvalidArgument("bad column desc");
 	}
 	bool nullable = false;
-	if (fds.size() >= 3) {
-		if (fds[2] == "null") {
+	bool dict = false;
+	bool plain = false;
+	AggregationType agg = AggReplace;
+	for (size_t i=2;i<fds.size();i++) {
+		if (fds[i] == "null") {
 			nullable = true;
+		} else if (fds[i] == "dict") {
+			dict = true;
+		} else if (fds[i] == "plain") {
+			plain = true;
+		} else if (fds[i] == "replace") {
+			agg = AggReplace;
+		} else if (fds[i] == "replace_if_not_null") {
+			agg = AggReplaceIfNotNull;
+		} else if (fds[i] == "sum") {
+			agg = AggSum;
+		} else if (fds[i] == "max") {
+			agg = AggMax;
+		} else if (fds[i] == "min") {
+			agg = AggMin;
 		} else {
 			return Status::InvalidArgument("bad column desc");
 		}
 	}
-	cs.reset(new ColumnSchema(sname.ToString(), cid, type, nullable));
+	if (agg > AggReplaceIfNotNull && (dict || type == String)) {
+		return Status::InvalidArgument("sum/max/min only supports numeric non-dict column");
+	}
+	if (dict && plain) {
+		return Status::InvalidArgument("dict column can't be plain");
+	}
+	cs.reset(new ColumnSchema(sname.ToString(), cid, type, nullable, dict, agg, plain));
 	return Status::OK();
 }
 
@@ -98,6 +141,9 @@ Status Schema::create(const Slice& desc, unique_ptr<Schema>& schema) {
 	for (size_t i=0;i<colstrs.size();i++) {
 		RETURN_NOT_OK(ColumnSchema::create(i+1, colstrs[i], css[i]));
 	}
+	if (css[0]->aggregation != AggReplace) {
+		return Status::InvalidArgument("key column can't have aggregation type");
+	}
 	vector<ColumnSchema> cs;
 	cs.reserve(css.size());
 	for (size_t i=0;i<css.size();i++) {
@@ -6,25 +6,72 @@
 
 namespace choco {
 
+/**
+ * How an update combines with the current value of a non-key column
+ */
+enum AggregationType {
+    // update replaces current value, null included
+    AggReplace = 0,
+    // update replaces current value, null update is ignored
+    AggReplaceIfNotNull,
+    // current value op update, null update is ignored, null current value
+    // is replaced, numeric non-dict columns only
+    AggSum,
+    AggMax,
+    AggMin,
+};
+
+const char* AggregationTypeName(AggregationType agg);
+
+// combine an update with current value of a sum/max/min column
+template <class T>
+inline T AggregateValue(AggregationType agg, const T& cur, const T& v) {
+    switch (agg) {
+    case AggSum:
+        return (T)(cur + v);
+    case AggMax:
+        return std::max(cur, v);
+    case AggMin:
+        return std::min(cur, v);
+    default:
+        return v;
+    }
+}
+
 struct ColumnSchema {
     string name;
     // column id, must starts with 1 (0 is special id reserved for delete flag column)
     uint32_t cid;
     Type type;
     bool nullable;
+    // dictionary encoded, for low cardinality columns
+    bool dict;
+    AggregationType aggregation;
+    /**
+     * stored at full width without compression, so scan blocks and
+     * ColumnReader::get reference pages directly
+     */
+    bool plain;
     unique_ptr<Variant> default_value;
 
-    ColumnSchema(const string& name, uint32_t cid, Type type, bool nullable=false) :
+    ColumnSchema(const string& name, uint32_t cid, Type type, bool nullable=false, bool dict=false,
+            AggregationType aggregation=AggReplace, bool plain=false) :
         name(name),
         cid(cid),
         type(type),
-        nullable(nullable) {}
+        nullable(nullable),
+        dict(dict),
+        aggregation(aggregation),
+        plain(plain) {}
 
     ColumnSchema(const ColumnSchema& rhs) {
         name = rhs.name;
         cid = rhs.cid;
         type = rhs.type;
         nullable = rhs.nullable;
+        dict = rhs.dict;
+        aggregation = rhs.aggregation;
+        plain = rhs.plain;
         if (rhs.default_value) {
             default_value.reset(new Variant(*rhs.default_value));
         }
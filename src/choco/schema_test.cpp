@@ -10,6 +10,30 @@ TEST(Schema, create) {
 	EXPECT_EQ(sc->get(2)->type, Type::Int32);
 	EXPECT_EQ(sc->get(3)->type, Type::Int32);
 	EXPECT_EQ(sc->get(4)->type, Type::Int8);
+	ASSERT_TRUE(Schema::create("int32 id,int64 city dict,int32 region null dict", sc));
+	EXPECT_FALSE(sc->get(1)->dict);
+	EXPECT_TRUE(sc->get(2)->dict);
+	EXPECT_FALSE(sc->get(2)->nullable);
+	EXPECT_TRUE(sc->get(3)->dict);
+	EXPECT_TRUE(sc->get(3)->nullable);
+	ASSERT_TRUE(Schema::create("int32 id,int64 pv sum,int32 last max,float64 lo null min,int8 tag dict replace_if_not_null", sc));
+	EXPECT_EQ(sc->get(1)->aggregation, AggReplace);
+	EXPECT_EQ(sc->get(2)->aggregation, AggSum);
+	EXPECT_EQ(sc->get(3)->aggregation, AggMax);
+	EXPECT_EQ(sc->get(4)->aggregation, AggMin);
+	EXPECT_TRUE(sc->get(4)->nullable);
+	EXPECT_EQ(sc->get(5)->aggregation, AggReplaceIfNotNull);
+	EXPECT_EQ(sc->get(2)->to_string(), "Column(pv cid=2 Int64 sum)");
+	// key column, dict and string columns can't be aggregated
+	EXPECT_FALSE(Schema::create("int32 id sum,int64 pv", sc));
+	EXPECT_FALSE(Schema::create("int32 id,int64 pv dict sum", sc));
+	EXPECT_FALSE(Schema::create("int32 id,string s max", sc));
+	ASSERT_TRUE(Schema::create("int32 id,int64 pv plain sum,float64 lo null plain", sc));
+	EXPECT_FALSE(sc->get(1)->plain);
+	EXPECT_TRUE(sc->get(2)->plain);
+	EXPECT_TRUE(sc->get(3)->plain);
+	EXPECT_EQ(sc->get(2)->to_string(), "Column(pv cid=2 Int64 plain sum)");
+	EXPECT_FALSE(Schema::create("int32 id,int64 city dict plain", sc));
 }
 
 }
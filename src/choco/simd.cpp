@@ -0,0 +1,367 @@
+#include "simd.h"
+#include "bitmap.h"
+#include "encoding.h"
+#include "gutil/cpu.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace choco {
+
+// below this many values lower_bound16 scans linearly instead of bisecting
+static const size_t kLinearSearchSize = 64;
+
+// bits of rows to skip in the 64 rows starting at word, 1 = skip
+static inline uint64_t SkipWord(const uint8_t* nulls, const uint8_t* selection, size_t word) {
+    uint64_t skip = 0;
+    if (nulls) {
+        skip |= ((const uint64_t*)nulls)[word];
+    }
+    if (selection) {
+        skip |= ~((const uint64_t*)selection)[word];
+    }
+    return skip;
+}
+
+static inline void AggregateOne(double v, FloatAggregate& agg) {
+    agg.count++;
+    agg.sum += v;
+    agg.min = std::min(agg.min, v);
+    agg.max = std::max(agg.max, v);
+}
+
+// aggregate rows of [start, start+cnt) not set in skip one by one
+static inline void AggregateSparse(const double* values, size_t start, size_t cnt, uint64_t skip,
+                                   FloatAggregate& agg) {
+    for (size_t i = 0; i < cnt; i++) {
+        if (!(skip & (1ULL << i))) {
+            AggregateOne(values[start + i], agg);
+        }
+    }
+}
+
+// narrow [begin, end) by bisecting until it's small enough to scan
+static inline void NarrowRange(const uint16_t*& begin, const uint16_t*& end, uint16_t value) {
+    while ((size_t)(end - begin) > kLinearSearchSize) {
+        const uint16_t* mid = begin + (end - begin) / 2;
+        if (*mid < value) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// scalar
+
+static const uint16_t* LowerBound16Scalar(const uint16_t* begin, const uint16_t* end, uint16_t value) {
+    return std::lower_bound(begin, end, value);
+}
+
+static void Int8ToBitmapScalar(const int8_t* values, size_t n, uint8_t* bitmap) {
+    memset(bitmap, 0, BitmapSize64(n));
+    for (size_t i = 0; i < n; i++) {
+        if (values[i]) {
+            BitmapSet(bitmap, i);
+        }
+    }
+}
+
+static void AggregateF64Scalar(const double* values, size_t n, const uint8_t* nulls,
+                               const uint8_t* selection, FloatAggregate& agg) {
+    for (size_t start = 0; start < n; start += 64) {
+        size_t cnt = std::min((size_t)64, n - start);
+        AggregateSparse(values, start, cnt, SkipWord(nulls, selection, start / 64), agg);
+    }
+}
+
+static const SimdKernels kScalarKernels = {
+    SimdScalar,
+    LowerBound16Scalar,
+    Int8ToBitmapScalar,
+    AggregateF64Scalar,
+};
+
+#if defined(__x86_64__)
+
+//////////////////////////////////////////////////////////////////////////////
+// SSE2, baseline of x86-64
+
+static const uint16_t* LowerBound16SSE2(const uint16_t* begin, const uint16_t* end, uint16_t value) {
+    NarrowRange(begin, end, value);
+    // values are sorted, so lower bound = begin + count of values < value,
+    // flip sign bit for signed 16-bit compare
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    const __m128i v = _mm_xor_si128(_mm_set1_epi16((short)value), bias);
+    size_t n = end - begin;
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(begin + i)), bias);
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi16(x, v))) / 2;
+    }
+    for (; i < n; i++) {
+        count += begin[i] < value;
+    }
+    return begin + count;
+}
+
+static void Int8ToBitmapSSE2(const int8_t* values, size_t n, uint8_t* bitmap) {
+    const __m128i zero = _mm_setzero_si128();
+    uint16_t* out = (uint16_t*)bitmap;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(values + i));
+        out[i / 16] = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero));
+    }
+    memset(bitmap + i / 8, 0, BitmapSize64(n) - i / 8);
+    for (; i < n; i++) {
+        if (values[i]) {
+            BitmapSet(bitmap, i);
+        }
+    }
+}
+
+static void AggregateF64SSE2(const double* values, size_t n, const uint8_t* nulls,
+                             const uint8_t* selection, FloatAggregate& agg) {
+    __m128d sum = _mm_setzero_pd();
+    __m128d mn = _mm_set1_pd(agg.min);
+    __m128d mx = _mm_set1_pd(agg.max);
+    for (size_t start = 0; start < n; start += 64) {
+        size_t cnt = std::min((size_t)64, n - start);
+        uint64_t skip = SkipWord(nulls, selection, start / 64);
+        if (cnt < 64 || skip != 0) {
+            AggregateSparse(values, start, cnt, skip, agg);
+            continue;
+        }
+        // all 64 rows are aggregated
+        for (size_t i = start; i < start + 64; i += 2) {
+            __m128d x = _mm_loadu_pd(values + i);
+            sum = _mm_add_pd(sum, x);
+            mn = _mm_min_pd(x, mn);
+            mx = _mm_max_pd(x, mx);
+        }
+        agg.count += 64;
+    }
+    double s[2], a[2], b[2];
+    _mm_storeu_pd(s, sum);
+    _mm_storeu_pd(a, mn);
+    _mm_storeu_pd(b, mx);
+    agg.sum += s[0] + s[1];
+    agg.min = std::min(agg.min, std::min(a[0], a[1]));
+    agg.max = std::max(agg.max, std::max(b[0], b[1]));
+}
+
+static const SimdKernels kSSE2Kernels = {
+    SimdSSE2,
+    LowerBound16SSE2,
+    Int8ToBitmapSSE2,
+    AggregateF64SSE2,
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// AVX2
+
+#define CHOCO_TARGET_AVX2 __attribute__((target("avx2")))
+
+CHOCO_TARGET_AVX2 static const uint16_t* LowerBound16AVX2(const uint16_t* begin, const uint16_t* end,
+                                                          uint16_t value) {
+    NarrowRange(begin, end, value);
+    const __m256i bias = _mm256_set1_epi16((short)0x8000);
+    const __m256i v = _mm256_xor_si256(_mm256_set1_epi16((short)value), bias);
+    size_t n = end - begin;
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(begin + i)), bias);
+        count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi16(v, x))) / 2;
+    }
+    for (; i < n; i++) {
+        count += begin[i] < value;
+    }
+    return begin + count;
+}
+
+CHOCO_TARGET_AVX2 static void Int8ToBitmapAVX2(const int8_t* values, size_t n, uint8_t* bitmap) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t* out = (uint32_t*)bitmap;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(values + i));
+        out[i / 32] = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, zero));
+    }
+    memset(bitmap + i / 8, 0, BitmapSize64(n) - i / 8);
+    for (; i < n; i++) {
+        if (values[i]) {
+            BitmapSet(bitmap, i);
+        }
+    }
+}
+
+CHOCO_TARGET_AVX2 static void AggregateF64AVX2(const double* values, size_t n, const uint8_t* nulls,
+                                               const uint8_t* selection, FloatAggregate& agg) {
+    __m256d sum = _mm256_setzero_pd();
+    __m256d mn = _mm256_set1_pd(agg.min);
+    __m256d mx = _mm256_set1_pd(agg.max);
+    for (size_t start = 0; start < n; start += 64) {
+        size_t cnt = std::min((size_t)64, n - start);
+        uint64_t skip = SkipWord(nulls, selection, start / 64);
+        if (cnt < 64 || skip != 0) {
+            AggregateSparse(values, start, cnt, skip, agg);
+            continue;
+        }
+        for (size_t i = start; i < start + 64; i += 4) {
+            __m256d x = _mm256_loadu_pd(values + i);
+            sum = _mm256_add_pd(sum, x);
+            mn = _mm256_min_pd(x, mn);
+            mx = _mm256_max_pd(x, mx);
+        }
+        agg.count += 64;
+    }
+    double s[4], a[4], b[4];
+    _mm256_storeu_pd(s, sum);
+    _mm256_storeu_pd(a, mn);
+    _mm256_storeu_pd(b, mx);
+    agg.sum += (s[0] + s[1]) + (s[2] + s[3]);
+    for (int i = 0; i < 4; i++) {
+        agg.min = std::min(agg.min, a[i]);
+        agg.max = std::max(agg.max, b[i]);
+    }
+}
+
+static const SimdKernels kAVX2Kernels = {
+    SimdAVX2,
+    LowerBound16AVX2,
+    Int8ToBitmapAVX2,
+    AggregateF64AVX2,
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// AVX-512
+
+#define CHOCO_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl")))
+
+CHOCO_TARGET_AVX512 static const uint16_t* LowerBound16AVX512(const uint16_t* begin, const uint16_t* end,
+                                                              uint16_t value) {
+    NarrowRange(begin, end, value);
+    const __m512i v = _mm512_set1_epi16((short)value);
+    size_t n = end - begin;
+    size_t count = 0;
+    for (size_t i = 0; i < n; i += 32) {
+        // masked load, never reads past end
+        __mmask32 valid = n - i >= 32 ? 0xffffffffu : (1u << (n - i)) - 1;
+        __m512i x = _mm512_maskz_loadu_epi16(valid, begin + i);
+        count += __builtin_popcount(_mm512_mask_cmplt_epu16_mask(valid, x, v));
+    }
+    return begin + count;
+}
+
+CHOCO_TARGET_AVX512 static void Int8ToBitmapAVX512(const int8_t* values, size_t n, uint8_t* bitmap) {
+    uint64_t* out = (uint64_t*)bitmap;
+    for (size_t i = 0; i < n; i += 64) {
+        __mmask64 valid = n - i >= 64 ? ~0ULL : (1ULL << (n - i)) - 1;
+        __m512i x = _mm512_maskz_loadu_epi8(valid, values + i);
+        out[i / 64] = _mm512_test_epi8_mask(x, x);
+    }
+}
+
+CHOCO_TARGET_AVX512 static void AggregateF64AVX512(const double* values, size_t n, const uint8_t* nulls,
+                                                   const uint8_t* selection, FloatAggregate& agg) {
+    __m512d sum = _mm512_setzero_pd();
+    __m512d mn = _mm512_set1_pd(agg.min);
+    __m512d mx = _mm512_set1_pd(agg.max);
+    size_t count = 0;
+    for (size_t start = 0; start < n; start += 64) {
+        size_t cnt = std::min((size_t)64, n - start);
+        uint64_t take = ~SkipWord(nulls, selection, start / 64);
+        if (cnt < 64) {
+            take &= (1ULL << cnt) - 1;
+        }
+        count += __builtin_popcountll(take);
+        for (size_t i = 0; i < cnt && (take >> i); i += 8) {
+            // skipped rows are masked out of both load and arithmetic
+            __mmask8 m = (__mmask8)(take >> i);
+            __m512d x = _mm512_maskz_loadu_pd(m, values + start + i);
+            sum = _mm512_mask_add_pd(sum, m, sum, x);
+            mn = _mm512_mask_min_pd(mn, m, x, mn);
+            mx = _mm512_mask_max_pd(mx, m, x, mx);
+        }
+    }
+    agg.count += count;
+    agg.sum += _mm512_reduce_add_pd(sum);
+    agg.min = std::min(agg.min, _mm512_reduce_min_pd(mn));
+    agg.max = std::max(agg.max, _mm512_reduce_max_pd(mx));
+}
+
+static const SimdKernels kAVX512Kernels = {
+    SimdAVX512,
+    LowerBound16AVX512,
+    Int8ToBitmapAVX512,
+    AggregateF64AVX512,
+};
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+
+static SimdLevel DetectLevel() {
+#if defined(__x86_64__)
+    base::CPU cpu;
+    if (cpu.has_avx512f() && cpu.has_avx512bw() && cpu.has_avx512vl()) {
+        return SimdAVX512;
+    }
+    if (cpu.has_avx2()) {
+        return SimdAVX2;
+    }
+    return SimdSSE2;
+#else
+    return SimdScalar;
+#endif
+}
+
+static const SimdKernels* KernelsOf(SimdLevel level) {
+    switch (level) {
+#if defined(__x86_64__)
+    case SimdSSE2:
+        return &kSSE2Kernels;
+    case SimdAVX2:
+        return &kAVX2Kernels;
+    case SimdAVX512:
+        return &kAVX512Kernels;
+#endif
+    default:
+        return &kScalarKernels;
+    }
+}
+
+// scalar until detection runs, so kernels are usable during static init
+std::atomic<const SimdKernels*> g_simd_kernels(&kScalarKernels);
+
+SimdLevel SimdDetectedLevel() {
+    static SimdLevel level = DetectLevel();
+    return level;
+}
+
+SimdLevel SimdSetLevel(SimdLevel level) {
+    level = std::min(level, SimdDetectedLevel());
+    g_simd_kernels.store(KernelsOf(level), std::memory_order_relaxed);
+    return level;
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdSSE2:
+        return "sse2";
+    case SimdAVX2:
+        return "avx2";
+    case SimdAVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+static SimdLevel init_simd_level = SimdSetLevel(SimdDetectedLevel());
+
+} /* namespace choco */
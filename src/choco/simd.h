@@ -0,0 +1,89 @@
+#ifndef CHOCO_SIMD_H_
+#define CHOCO_SIMD_H_
+
+#include "common.h"
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+namespace choco {
+
+struct FloatAggregate;
+
+enum SimdLevel {
+    SimdScalar = 0,
+    SimdSSE2,
+    SimdAVX2,
+    // AVX-512 F + BW + VL
+    SimdAVX512,
+};
+
+/**
+ * Kernels with one implementation per SimdLevel, the best level the CPU
+ * supports is selected at startup(using gutil CPU detection), hot paths
+ * call them through Simd(). Implementations are compiled with per-function
+ * target attributes, so the library itself needs no -mavx2/-mavx512 flags
+ * and runs on any x86-64 CPU.
+ */
+struct SimdKernels {
+    SimdLevel level;
+
+    // first position in sorted [begin, end) whose value >= value
+    const uint16_t* (*lower_bound16)(const uint16_t* begin, const uint16_t* end, uint16_t value);
+
+    /**
+     * bit i of bitmap is set if values[i] != 0, bitmap should be allocated
+     * with BitmapSize64(n) bytes
+     */
+    void (*int8_to_bitmap)(const int8_t* values, size_t n, uint8_t* bitmap);
+
+    /**
+     * aggregate values which are not null(bit set in nulls) and selected
+     * (bit set in selection), nulls/selection may be nullptr
+     */
+    void (*aggregate_f64)(const double* values, size_t n, const uint8_t* nulls,
+                          const uint8_t* selection, FloatAggregate& agg);
+};
+
+// best level supported by this CPU
+SimdLevel SimdDetectedLevel();
+
+/**
+ * switch kernels to level, clamped to SimdDetectedLevel(), return the
+ * level in effect, mainly for tests and benchmarks
+ */
+SimdLevel SimdSetLevel(SimdLevel level);
+
+const char* SimdLevelName(SimdLevel level);
+
+extern std::atomic<const SimdKernels*> g_simd_kernels;
+
+// kernels of current level
+inline const SimdKernels& Simd() {
+    return *g_simd_kernels.load(std::memory_order_relaxed);
+}
+
+/**
+ * bit i of result is set if tags[i] == tag, for i in [0, 16), tags
+ * should be 16 bytes aligned(HashIndex chunk tag vector). A chunk has 12
+ * tags followed by its 4-byte size, so callers mask the result with
+ * 0xfff. One 16-byte compare covers it, wider vectors don't help and
+ * SSE2(x86-64 baseline) is inlined into probe loops instead of being
+ * dispatched
+ */
+inline uint32_t MatchTag16(const uint8_t* tags, uint8_t tag) {
+#if defined(__x86_64__)
+    auto eqs = _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)tags), _mm_set1_epi8(tag));
+    return _mm_movemask_epi8(eqs);
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        mask |= (uint32_t)(tags[i] == tag) << i;
+    }
+    return mask;
+#endif
+}
+
+} /* namespace choco */
+
+#endif /* CHOCO_SIMD_H_ */
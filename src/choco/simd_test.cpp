@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include "simd.h"
+#include "bitmap.h"
+#include "encoding.h"
+#include "hash_index.h"
+
+namespace choco {
+
+// run f at every level supported by this CPU, restore detected level after
+template <class F>
+static void ForEachLevel(F f) {
+    for (int level = SimdScalar; level <= SimdDetectedLevel(); level++) {
+        ASSERT_EQ(level, SimdSetLevel((SimdLevel)level));
+        ASSERT_EQ(level, Simd().level);
+        SCOPED_TRACE(SimdLevelName((SimdLevel)level));
+        f();
+    }
+    SimdSetLevel(SimdDetectedLevel());
+}
+
+TEST(Simd, level) {
+    LOG(INFO) << "detected simd level: " << SimdLevelName(SimdDetectedLevel());
+    EXPECT_EQ(SimdDetectedLevel(), Simd().level);
+    // can't go above detected level
+    EXPECT_EQ(SimdDetectedLevel(), SimdSetLevel(SimdAVX512));
+}
+
+TEST(Simd, match_tag16) {
+    alignas(16) uint8_t tags[16];
+    srand(1);
+    for (int t = 0; t < 1000; t++) {
+        uint32_t expect = 0;
+        for (int i = 0; i < 16; i++) {
+            tags[i] = rand() % 4;
+            expect |= (uint32_t)(tags[i] == 2) << i;
+        }
+        ASSERT_EQ(expect, MatchTag16(tags, 2));
+    }
+}
+
+TEST(Simd, lower_bound16) {
+    srand(1);
+    for (size_t n : {0, 1, 7, 31, 64, 65, 100, 1000, 40000}) {
+        vector<uint16_t> values(n);
+        for (auto& v : values) {
+            v = rand() % 65536;
+        }
+        std::sort(values.begin(), values.end());
+        ForEachLevel([&]() {
+            const uint16_t* b = values.data();
+            const uint16_t* e = b + n;
+            for (uint32_t v : {0, 1, 32767, 32768, 65535}) {
+                ASSERT_EQ(std::lower_bound(b, e, v), Simd().lower_bound16(b, e, v));
+            }
+            for (size_t i = 0; i < std::min(n, (size_t)200); i++) {
+                uint16_t v = values[rand() % n];
+                ASSERT_EQ(std::lower_bound(b, e, v), Simd().lower_bound16(b, e, v));
+                ASSERT_EQ(std::lower_bound(b, e, (uint16_t)(v + 1)),
+                          Simd().lower_bound16(b, e, v + 1));
+            }
+        });
+    }
+}
+
+TEST(Simd, int8_to_bitmap) {
+    srand(1);
+    for (size_t n : {1, 15, 64, 100, 1000, 65536}) {
+        vector<int8_t> values(n);
+        for (auto& v : values) {
+            v = rand() % 3 - 1;
+        }
+        ForEachLevel([&]() {
+            vector<uint8_t> bitmap(BitmapSize64(n), 0xff);
+            Simd().int8_to_bitmap(values.data(), n, bitmap.data());
+            for (size_t i = 0; i < n; i++) {
+                ASSERT_EQ(values[i] != 0, BitmapTest(bitmap.data(), i));
+            }
+            // padding bits are cleared
+            ASSERT_EQ(BitmapCountSet(bitmap.data(), n), BitmapCountSet(bitmap.data(), bitmap.size() * 8));
+        });
+    }
+}
+
+TEST(Simd, aggregate_f64) {
+    srand(1);
+    for (size_t n : {1, 63, 64, 200, 10000}) {
+        vector<double> values(n);
+        for (auto& v : values) {
+            // integer values, sums are exact in any order
+            v = rand() % 20001 - 10000;
+        }
+        vector<uint8_t> nulls(BitmapSize64(n), 0);
+        vector<uint8_t> selection(BitmapSize64(n), 0xff);
+        for (size_t i = 0; i < n; i++) {
+            if (rand() % 5 == 0) {
+                BitmapSet(nulls.data(), i);
+            }
+            if (i >= 64 && i < 128) {
+                // a fully selected word
+                continue;
+            }
+            if (rand() % 3 == 0) {
+                BitmapClear(selection.data(), i);
+            }
+        }
+        FloatAggregate expect_all;
+        FloatAggregate expect;
+        for (size_t i = 0; i < n; i++) {
+            expect_all.count++;
+            expect_all.sum += values[i];
+            expect_all.min = std::min(expect_all.min, values[i]);
+            expect_all.max = std::max(expect_all.max, values[i]);
+            if (BitmapTest(nulls.data(), i) || !BitmapTest(selection.data(), i)) {
+                continue;
+            }
+            expect.count++;
+            expect.sum += values[i];
+            expect.min = std::min(expect.min, values[i]);
+            expect.max = std::max(expect.max, values[i]);
+        }
+        ForEachLevel([&]() {
+            FloatAggregate all;
+            Simd().aggregate_f64(values.data(), n, nullptr, nullptr, all);
+            EXPECT_EQ(expect_all.count, all.count);
+            EXPECT_EQ(expect_all.sum, all.sum);
+            EXPECT_EQ(expect_all.min, all.min);
+            EXPECT_EQ(expect_all.max, all.max);
+            FloatAggregate agg;
+            Simd().aggregate_f64(values.data(), n, nulls.data(), selection.data(), agg);
+            EXPECT_EQ(expect.count, agg.count);
+            EXPECT_EQ(expect.sum, agg.sum);
+            EXPECT_EQ(expect.min, agg.min);
+            EXPECT_EQ(expect.max, agg.max);
+        });
+    }
+}
+
+TEST(Simd, hash_index) {
+    const size_t sz = 100000;
+    ForEachLevel([&]() {
+        HashIndex hi(sz);
+        std::vector<HashIndex::Entry> entries;
+        for (size_t i = 0; i < sz; i++) {
+            uint64_t keyHash = HashCode(i);
+            entries.clear();
+            uint32_t slot = hi.find(keyHash, entries);
+            ASSERT_NE((uint32_t)HashIndex::NOSLOT, slot);
+            hi.set(slot, keyHash, i);
+        }
+        for (size_t i = 0; i < sz; i++) {
+            entries.clear();
+            hi.find(HashCode(i), entries);
+            bool found = false;
+            for (auto& e : entries) {
+                found |= e.value == i;
+            }
+            ASSERT_TRUE(found);
+        }
+    });
+}
+
+} /* namespace choco */
@@ -58,6 +58,9 @@ std::string Status::CodeAsString() const {
     case kIllegalState:
       type = "Illegal state";
       break;
+    case kOOM:
+      type = "Out of memory";
+      break;
     default:
       LOG(FATAL) << "unreachable";
   }
@@ -49,7 +49,7 @@ public:
 
     static Status OOM(const Slice& msg, const Slice& msg2 = Slice(),
                            int16_t posix_code = -1) {
-      return Status(kIOError, msg, msg2, posix_code);
+      return Status(kOOM, msg, msg2, posix_code);
     }
 
     static Status IOError(const Slice& msg, const Slice& msg2 = Slice(),
@@ -57,6 +57,11 @@ public:
       return Status(kIOError, msg, msg2, posix_code);
     }
 
+    static Status RuntimeError(const Slice& msg, const Slice& msg2 = Slice(),
+                           int16_t posix_code = -1) {
+      return Status(kRuntimeError, msg, msg2, posix_code);
+    }
+
     /// @return @c true iff the status indicates a NotFound error.
     bool IsNotFound() const { return code() == kNotFound; }
 
@@ -69,6 +74,9 @@ public:
     /// @return @c true iff the status indicates an InvalidArgument error.
     bool IsInvalidArgument() const { return code() == kInvalidArgument; }
 
+    /// @return @c true iff the status indicates a memory limit is exceeded.
+    bool IsOOM() const { return code() == kOOM; }
+
     std::string CodeAsString() const;
 
     /// This is similar to ToString, except that it does not include
@@ -1,4 +1,5 @@
 #include "string_pool.h"
+#include "page_pool.h"
 
 namespace choco {
 
@@ -22,17 +23,37 @@ MString* MString::create(const Slice& str) {
     return ret;
 }
 
-MString::~MString() {
-    aligned_free(this);
+void MString::operator delete(void* ptr) {
+    aligned_free(ptr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-Status PoolSegment::init(size_t size) {
-    buff = (uint8_t*)aligned_malloc(size, 4096);
+PoolSegment::~PoolSegment() {
+    if (buff) {
+        PagePool::global().free(buff, size);
+        buff = nullptr;
+        if (tracker) {
+            tracker->release(size, MemTracker::kPool);
+        }
+    }
+}
+
+Status PoolSegment::init(size_t size, MemTracker* tracker) {
+    if (tracker && !tracker->try_consume(size, MemTracker::kPool)) {
+        return Status::OOM("allocate StringPool segment exceeds memory limit");
+    }
+    buff = (uint8_t*)PagePool::global().alloc(size);
     if (!buff) {
+        if (tracker) {
+            tracker->release(size, MemTracker::kPool);
+        }
         return Status::OOM("allocate StringPool segment");
     }
+    this->size = size;
+    if (tracker) {
+        this->tracker = RefPtr<MemTracker>(tracker);
+    }
     return Status::OK();
 }
 
@@ -44,10 +65,11 @@ const SString* PoolSegment::get(size_t offset) const {
 
 //////////////////////////////////////////////////////////////////////////////
 
-Status StringPool::create(RefPtr<StringPool>& pool) {
+Status StringPool::create(RefPtr<StringPool>& pool, MemTracker* tracker) {
     RefPtr<PoolSegment> seg = RefPtr<PoolSegment>::create();
-    RETURN_NOT_OK(seg->init(kSegmentSize));
+    RETURN_NOT_OK(seg->init(kSegmentSize, tracker));
     RefPtr<StringPool> ret(new StringPool(), false);
+    ret->_tracker = RefPtr<MemTracker>(tracker);
     ret->_segments.reserve(8);
     ret->_segments.emplace_back(std::move(seg));
     ret->_cur_seg_base = ret->_segments[0]->buff;
@@ -74,7 +96,7 @@ const SString* StringPool::get(uint32_t sid) const {
 Status StringPool::add_segment() {
     CHECK_LT(_segments.size(), _segments.capacity());
     RefPtr<PoolSegment> seg = RefPtr<PoolSegment>::create();
-    RETURN_NOT_OK(seg->init(kSegmentSize));
+    RETURN_NOT_OK(seg->init(kSegmentSize, _tracker.get()));
     _cur_seg_idx++;
     _cur_seg_base = seg->buff;
     _cur_len = 0;
@@ -128,6 +150,7 @@ Status StringPool::expand(RefPtr<StringPool>& cow_pool, size_t new_capacity) {
     DCHECK_EQ(_segments.size(), _segments.capacity());
     DCHECK(_segments.capacity() < new_capacity);
     RefPtr<StringPool> ret(new StringPool(), false);
+    ret->_tracker = _tracker;
     ret->_segments.reserve(new_capacity);
     ret->_segments.resize(_segments.size());
     for (size_t i=0;i<_segments.size();i++) {
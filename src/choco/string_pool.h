@@ -4,6 +4,7 @@
 #include <endian.h>
 #include "common.h"
 #include "buffer.h"
+#include "mem_tracker.h"
 
 namespace choco {
 
@@ -82,7 +83,8 @@ struct alignas(8) SString {
 class MString : public SString {
 public:
     static MString* create(const Slice& str);
-    ~MString();
+    // memory is from aligned_malloc in create
+    static void operator delete(void* ptr);
 private:
     MString() = default;
 };
@@ -97,14 +99,17 @@ struct alignas(32) LString {
 class PoolSegment : public RefCounted {
 public:
     PoolSegment() = default;
-    ~PoolSegment() { aligned_free(buff); buff = nullptr; }
+    ~PoolSegment();
 
-    Status init(size_t size);
+    // charged to tracker as pool memory if not nullptr
+    Status init(size_t size, MemTracker* tracker=nullptr);
 
     const SString* get(size_t offset) const;
 
     uint64_t pid = 0;
     uint8_t * buff = nullptr;
+    size_t size = 0;
+    RefPtr<MemTracker> tracker;
 };
 
 /**
@@ -117,7 +122,8 @@ public:
     static const uint32_t NullId = 0;
     static const uint32_t EmptyId = 1;
 
-    static Status create(RefPtr<StringPool>& pool);
+    // segments are charged to tracker if not nullptr
+    static Status create(RefPtr<StringPool>& pool, MemTracker* tracker=nullptr);
 
     // get SString by sid
     const SString* get(uint32_t sid) const;
@@ -145,6 +151,7 @@ private:
 
     Status add_unsafe(const Slice& slice, size_t storage_size, uint32_t& sid);
 
+    RefPtr<MemTracker> _tracker;
     vector<RefPtr<PoolSegment>> _segments;
     size_t _cur_seg_idx = 0;
     uint8_t* _cur_seg_base = nullptr;
@@ -0,0 +1,95 @@
+#include "thread_pool.h"
+
+namespace choco {
+
+struct ThreadPool::Job {
+    Job(const std::function<void(size_t)>& task, size_t n) : task(task), n(n) {}
+    const std::function<void(size_t)>& task;
+    const size_t n;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    // number of pool threads working on this job, protected by ThreadPool::_lock
+    size_t nworker = 0;
+};
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    _threads.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+        _threads.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<mutex> lg(_lock);
+        _stop = true;
+    }
+    _cond.notify_all();
+    for (auto& t : _threads) {
+        t.join();
+    }
+}
+
+ThreadPool& ThreadPool::global() {
+    // calling thread also runs tasks, so one less thread is needed
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+void ThreadPool::run_job(Job* job) {
+    while (true) {
+        size_t i = job->next.fetch_add(1);
+        if (i >= job->n) {
+            break;
+        }
+        job->task(i);
+        job->done.fetch_add(1);
+    }
+}
+
+void ThreadPool::worker_loop() {
+    std::unique_lock<mutex> lk(_lock);
+    while (true) {
+        _cond.wait(lk, [this] { return _stop || !_jobs.empty(); });
+        if (_jobs.empty()) {
+            // stopped
+            return;
+        }
+        Job* job = _jobs.front();
+        job->nworker++;
+        lk.unlock();
+        run_job(job);
+        lk.lock();
+        // all tasks are taken, so no other worker needs to join this job
+        if (!_jobs.empty() && _jobs.front() == job) {
+            _jobs.pop_front();
+        }
+        job->nworker--;
+        _cond.notify_all();
+    }
+}
+
+void ThreadPool::parallel_for(size_t n, const std::function<void(size_t)>& task) {
+    if (n <= 1 || _threads.empty()) {
+        for (size_t i = 0; i < n; i++) {
+            task(i);
+        }
+        return;
+    }
+    Job job(task, n);
+    {
+        std::lock_guard<mutex> lg(_lock);
+        _jobs.push_back(&job);
+    }
+    _cond.notify_all();
+    run_job(&job);
+    std::unique_lock<mutex> lk(_lock);
+    auto itr = std::find(_jobs.begin(), _jobs.end(), &job);
+    if (itr != _jobs.end()) {
+        _jobs.erase(itr);
+    }
+    // barrier: wait for tasks still running on pool threads
+    _cond.wait(lk, [&job] { return job.done == job.n && job.nworker == 0; });
+}
+
+} /* namespace choco */
@@ -0,0 +1,51 @@
+#ifndef CHOCO_THREAD_POOL_H_
+#define CHOCO_THREAD_POOL_H_
+
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include "common.h"
+
+namespace choco {
+
+/**
+ * Fixed size thread pool for running short, independent tasks in parallel,
+ * e.g. finalizing column writers of a wide table during commit
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    /**
+     * shared process wide pool, sized to hardware concurrency
+     */
+    static ThreadPool& global();
+
+    size_t num_threads() const { return _threads.size(); }
+
+    /**
+     * run task(0), task(1) ... task(n-1) using pool threads and the calling thread,
+     * returns after all tasks are finished (barrier)
+     */
+    void parallel_for(size_t n, const std::function<void(size_t)>& task);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+
+    struct Job;
+
+    void worker_loop();
+    void run_job(Job* job);
+
+    mutex _lock;
+    std::condition_variable _cond;
+    std::deque<Job*> _jobs;
+    bool _stop = false;
+    vector<std::thread> _threads;
+};
+
+} /* namespace choco */
+
+#endif /* CHOCO_THREAD_POOL_H_ */
@@ -0,0 +1,48 @@
+#include "gtest/gtest.h"
+#include "thread_pool.h"
+
+namespace choco {
+
+TEST(ThreadPool, parallel_for) {
+    ThreadPool pool(4);
+    const size_t N = 1000;
+    vector<uint32_t> hits(N, 0);
+    for (int round=0;round<10;round++) {
+        pool.parallel_for(N, [&](size_t i) {
+            hits[i]++;
+        });
+    }
+    for (size_t i=0;i<N;i++) {
+        EXPECT_EQ(hits[i], 10);
+    }
+}
+
+TEST(ThreadPool, concurrent_callers) {
+    ThreadPool pool(2);
+    std::atomic<size_t> sum(0);
+    vector<std::thread> callers;
+    for (int t=0;t<4;t++) {
+        callers.emplace_back([&]() {
+            for (int round=0;round<100;round++) {
+                pool.parallel_for(16, [&](size_t i) {
+                    sum += i;
+                });
+            }
+        });
+    }
+    for (auto& t : callers) {
+        t.join();
+    }
+    EXPECT_EQ(sum.load(), 4 * 100 * (15 * 16 / 2));
+}
+
+TEST(ThreadPool, no_threads) {
+    ThreadPool pool(0);
+    size_t sum = 0;
+    pool.parallel_for(10, [&](size_t i) {
+        sum += i;
+    });
+    EXPECT_EQ(sum, 45);
+}
+
+}
@@ -0,0 +1,179 @@
+#include "wire.h"
+#include "mem_tablet_scan.h"
+
+namespace choco {
+
+typedef flatbuffers::Offset<flatbuffers::Vector<uint8_t>> ByteVector;
+
+static ByteVector CreateAlignedVector(flatbuffers::FlatBufferBuilder& fbb, const uint8_t* data,
+                                      size_t size) {
+    fbb.ForceVectorAlignment(size, sizeof(uint8_t), kWireAlignment);
+    return fbb.CreateVector(data, size);
+}
+
+/**
+ * encode a column of nrows, data is in ColumnarBatch layout(uint32
+ * offsets into bytes for strings), nulls can be nullptr
+ */
+static flatbuffers::Offset<wire::Column> EncodeColumn(flatbuffers::FlatBufferBuilder& fbb,
+                                                      const string& name, Type type, size_t nrows,
+                                                      const uint8_t* data, const uint8_t* nulls,
+                                                      const uint8_t* bytes) {
+    auto fname = fbb.CreateString(name);
+    ByteVector fdata;
+    ByteVector fbytes;
+    if (type == String) {
+        const uint32_t* offsets = (const uint32_t*)data;
+        fdata = CreateAlignedVector(fbb, data, (nrows + 1) * sizeof(uint32_t));
+        fbytes = fbb.CreateVector(bytes, offsets[nrows]);
+    } else {
+        fdata = CreateAlignedVector(fbb, data, nrows * TypeInfo::get(type).size());
+    }
+    ByteVector fnulls;
+    if (nulls) {
+        fnulls = CreateAlignedVector(fbb, nulls, BitmapSize64(nrows));
+    }
+    return wire::CreateColumn(fbb, fname, (wire::ColumnType)type, fdata, fnulls, fbytes);
+}
+
+Status EncodeWriteRequest(const WriteTx& wtx, flatbuffers::FlatBufferBuilder& fbb) {
+    if (wtx.batch_size() > 0) {
+        return Status::NotSupported("encode row batches not supported");
+    }
+    vector<flatbuffers::Offset<wire::WriteBatch>> batches;
+    for (size_t i = 0; i < wtx.columnar_batch_size(); i++) {
+        const ColumnarBatch& batch = *wtx.get_columnar_batch(i);
+        vector<flatbuffers::Offset<wire::Column>> columns;
+        for (size_t c = 0; c < batch.num_columns(); c++) {
+            const ColumnSchema* cs = batch.column_schema(c);
+            columns.push_back(EncodeColumn(fbb, cs->name, cs->type, batch.row_size(),
+                                           (const uint8_t*)batch.column_data(c), batch.column_nulls(c),
+                                           batch.string_data(c)));
+        }
+        batches.push_back(wire::CreateWriteBatch(fbb, batch.row_size(), fbb.CreateVector(columns)));
+    }
+    auto request = wire::CreateWriteRequest(fbb, (wire::WriteMode)wtx.mode(), fbb.CreateVector(batches));
+    wire::FinishWriteRequestBuffer(fbb, request);
+    return Status::OK();
+}
+
+// check arrays of column against its schema, nrows and alignment
+static Status CheckColumn(const wire::Column* column, const ColumnSchema* cs, size_t nrows) {
+    if ((Type)column->type() != cs->type) {
+        return Status::InvalidArgument(Format("wire column %s type mismatch", cs->name.c_str()));
+    }
+    const flatbuffers::Vector<uint8_t>* data = column->data();
+    if (!data) {
+        return Status::InvalidArgument(Format("wire column %s without data", cs->name.c_str()));
+    }
+    size_t esize = cs->type == String ? sizeof(uint32_t) : TypeInfo::get(cs->type).size();
+    size_t dsize = cs->type == String ? (nrows + 1) * esize : nrows * esize;
+    if (data->size() != dsize) {
+        return Status::InvalidArgument(Format("wire column %s data size %u, expect %zu",
+                                              cs->name.c_str(), data->size(), dsize));
+    }
+    if ((uintptr_t)data->data() % std::min(esize, kWireAlignment) != 0) {
+        return Status::InvalidArgument(Format("wire column %s data not aligned", cs->name.c_str()));
+    }
+    if (column->nulls() && column->nulls()->size() < BitmapSize64(nrows)) {
+        return Status::InvalidArgument(Format("wire column %s nulls too small", cs->name.c_str()));
+    }
+    if (cs->type == String) {
+        // offsets are read without checks later
+        const uint32_t* offsets = (const uint32_t*)data->data();
+        size_t nbytes = column->bytes() ? column->bytes()->size() : 0;
+        if (offsets[0] != 0 || offsets[nrows] > nbytes) {
+            return Status::InvalidArgument(Format("wire column %s bad string offsets", cs->name.c_str()));
+        }
+        for (size_t i = 0; i < nrows; i++) {
+            if (offsets[i] > offsets[i + 1]) {
+                return Status::InvalidArgument(Format("wire column %s bad string offsets", cs->name.c_str()));
+            }
+        }
+    }
+    return Status::OK();
+}
+
+Status DecodeWriteRequest(const uint8_t* buf, size_t size, WriteTx& wtx) {
+    flatbuffers::Verifier verifier(buf, size);
+    if (!wire::VerifyWriteRequestBuffer(verifier)) {
+        return Status::InvalidArgument("invalid wire WriteRequest");
+    }
+    const wire::WriteRequest* request = wire::GetWriteRequest(buf);
+    if (request->mode() < wire::WriteMode_MIN || request->mode() > wire::WriteMode_MAX) {
+        return Status::InvalidArgument(Format("invalid wire write mode %d", (int)request->mode()));
+    }
+    // decode all batches before changing wtx
+    vector<unique_ptr<ColumnarBatch>> batches;
+    size_t nbatch = request->batches() ? request->batches()->size() : 0;
+    for (size_t i = 0; i < nbatch; i++) {
+        const wire::WriteBatch* wb = request->batches()->Get(i);
+        size_t ncolumn = wb->columns() ? wb->columns()->size() : 0;
+        vector<string> names;
+        vector<const void*> data;
+        vector<const uint8_t*> nulls;
+        vector<const uint8_t*> bytes;
+        for (size_t c = 0; c < ncolumn; c++) {
+            const wire::Column* column = wb->columns()->Get(c);
+            const ColumnSchema* cs = column->name() ? wtx.schema().get(column->name()->str()) : nullptr;
+            if (!cs) {
+                return Status::NotFound("wire column not found");
+            }
+            RETURN_NOT_OK(CheckColumn(column, cs, wb->num_rows()));
+            names.push_back(cs->name);
+            data.push_back(column->data()->data());
+            nulls.push_back(column->nulls() ? column->nulls()->data() : nullptr);
+            bytes.push_back(column->bytes() ? column->bytes()->data() : nullptr);
+            if (cs->type == String && !bytes.back()) {
+                // all empty strings
+                bytes.back() = column->data()->data();
+            }
+        }
+        unique_ptr<ColumnarBatch> batch;
+        RETURN_NOT_OK(ColumnarBatch::wrap(wtx.schema(), names, wb->num_rows(), data, nulls, bytes, batch));
+        batches.emplace_back(std::move(batch));
+    }
+    wtx.set_mode((WriteMode)request->mode());
+    for (auto& batch : batches) {
+        RETURN_NOT_OK(wtx.add_columnar_batch(batch));
+    }
+    return Status::OK();
+}
+
+Status EncodeScanBlock(const MemTabletScan& scan, const RowBlock& block,
+                       flatbuffers::FlatBufferBuilder& fbb) {
+    vector<std::pair<string, Type>> schema;
+    scan.block_schema(schema);
+    DCHECK_EQ(schema.size(), block.num_columns());
+    size_t nrows = block.num_rows();
+    vector<flatbuffers::Offset<wire::Column>> columns;
+    for (size_t c = 0; c < block.num_columns(); c++) {
+        const ColumnBlock& cb = block.get_column(c);
+        if (schema[c].second != String) {
+            columns.push_back(EncodeColumn(fbb, schema[c].first, schema[c].second, nrows, cb.data(),
+                                           cb.nulls(), nullptr));
+            continue;
+        }
+        // strings are Slices in column blocks, gather them into offsets and bytes
+        const Slice* ss = (const Slice*)cb.data();
+        vector<uint32_t> offsets(nrows + 1, 0);
+        string bytes;
+        for (size_t i = 0; i < nrows; i++) {
+            if (!cb.is_null(i)) {
+                bytes.append((const char*)ss[i].data(), ss[i].size());
+            }
+            offsets[i + 1] = bytes.size();
+        }
+        columns.push_back(EncodeColumn(fbb, schema[c].first, String, nrows, (const uint8_t*)offsets.data(),
+                                       cb.nulls(), (const uint8_t*)bytes.data()));
+    }
+    ByteVector fselection;
+    if (block.selection()) {
+        fselection = CreateAlignedVector(fbb, block.selection(), BitmapSize64(nrows));
+    }
+    auto sb = wire::CreateScanBlock(fbb, nrows, fbb.CreateVector(columns), fselection);
+    fbb.Finish(sb);
+    return Status::OK();
+}
+
+} /* namespace choco */
@@ -0,0 +1,44 @@
+#ifndef CHOCO_WIRE_H_
+#define CHOCO_WIRE_H_
+
+#include "common.h"
+#include "flatbuffers/flatbuffers.h"
+#include "wire_generated.h"
+#include "write_tx.h"
+#include "row_block.h"
+
+namespace choco {
+
+class MemTabletScan;
+
+/**
+ * Flatbuffers wire format(wire.fbs) of write batches and scan results.
+ * Columns are sent in their in memory layout: encoding copies whole
+ * column arrays, and decoded write batches reference the request buffer
+ * directly, so no cell is serialized or parsed.
+ *
+ * Column arrays are aligned to kWireAlignment inside a buffer, create
+ * FlatBufferBuilder with buffer_minalign kWireAlignment, and keep
+ * received buffers kWireAlignment aligned.
+ */
+static const size_t kWireAlignment = 16;
+
+/**
+ * encode columnar batches and mode of wtx as a WriteRequest, row batches
+ * are not supported
+ */
+Status EncodeWriteRequest(const WriteTx& wtx, flatbuffers::FlatBufferBuilder& fbb);
+
+/**
+ * verify WriteRequest buf and add its batches to wtx(mode included),
+ * batches reference buf, which must be valid until wtx is committed
+ */
+Status DecodeWriteRequest(const uint8_t* buf, size_t size, WriteTx& wtx);
+
+// encode block returned by scan as a ScanBlock
+Status EncodeScanBlock(const MemTabletScan& scan, const RowBlock& block,
+                       flatbuffers::FlatBufferBuilder& fbb);
+
+} /* namespace choco */
+
+#endif /* CHOCO_WIRE_H_ */
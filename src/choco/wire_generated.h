@@ -0,0 +1,434 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+
+#ifndef FLATBUFFERS_GENERATED_WIRE_CHOCO_WIRE_H_
+#define FLATBUFFERS_GENERATED_WIRE_CHOCO_WIRE_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace choco {
+namespace wire {
+
+struct Column;
+
+struct WriteBatch;
+
+struct WriteRequest;
+
+struct ScanBlock;
+
+enum ColumnType {
+  ColumnType_Nothing = 0,
+  ColumnType_Int8 = 1,
+  ColumnType_Int16 = 2,
+  ColumnType_Int32 = 3,
+  ColumnType_Int64 = 4,
+  ColumnType_Int128 = 5,
+  ColumnType_Float32 = 6,
+  ColumnType_Float64 = 7,
+  ColumnType_String = 8,
+  ColumnType_MIN = ColumnType_Nothing,
+  ColumnType_MAX = ColumnType_String
+};
+
+inline const ColumnType (&EnumValuesColumnType())[9] {
+  static const ColumnType values[] = {
+    ColumnType_Nothing,
+    ColumnType_Int8,
+    ColumnType_Int16,
+    ColumnType_Int32,
+    ColumnType_Int64,
+    ColumnType_Int128,
+    ColumnType_Float32,
+    ColumnType_Float64,
+    ColumnType_String
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesColumnType() {
+  static const char * const names[] = {
+    "Nothing",
+    "Int8",
+    "Int16",
+    "Int32",
+    "Int64",
+    "Int128",
+    "Float32",
+    "Float64",
+    "String",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameColumnType(ColumnType e) {
+  const size_t index = static_cast<int>(e);
+  return EnumNamesColumnType()[index];
+}
+
+enum WriteMode {
+  WriteMode_Upsert = 0,
+  WriteMode_InsertOnly = 1,
+  WriteMode_InsertOnlyVerify = 2,
+  WriteMode_MIN = WriteMode_Upsert,
+  WriteMode_MAX = WriteMode_InsertOnlyVerify
+};
+
+inline const WriteMode (&EnumValuesWriteMode())[3] {
+  static const WriteMode values[] = {
+    WriteMode_Upsert,
+    WriteMode_InsertOnly,
+    WriteMode_InsertOnlyVerify
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesWriteMode() {
+  static const char * const names[] = {
+    "Upsert",
+    "InsertOnly",
+    "InsertOnlyVerify",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameWriteMode(WriteMode e) {
+  const size_t index = static_cast<int>(e);
+  return EnumNamesWriteMode()[index];
+}
+
+struct Column FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  enum {
+    VT_NAME = 4,
+    VT_TYPE = 6,
+    VT_DATA = 8,
+    VT_NULLS = 10,
+    VT_BYTES = 12
+  };
+  const flatbuffers::String *name() const {
+    return GetPointer<const flatbuffers::String *>(VT_NAME);
+  }
+  ColumnType type() const {
+    return static_cast<ColumnType>(GetField<int8_t>(VT_TYPE, 0));
+  }
+  const flatbuffers::Vector<uint8_t> *data() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_DATA);
+  }
+  const flatbuffers::Vector<uint8_t> *nulls() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_NULLS);
+  }
+  const flatbuffers::Vector<uint8_t> *bytes() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_BYTES);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_NAME) &&
+           verifier.VerifyString(name()) &&
+           VerifyField<int8_t>(verifier, VT_TYPE) &&
+           VerifyOffset(verifier, VT_DATA) &&
+           verifier.VerifyVector(data()) &&
+           VerifyOffset(verifier, VT_NULLS) &&
+           verifier.VerifyVector(nulls()) &&
+           VerifyOffset(verifier, VT_BYTES) &&
+           verifier.VerifyVector(bytes()) &&
+           verifier.EndTable();
+  }
+};
+
+struct ColumnBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_name(flatbuffers::Offset<flatbuffers::String> name) {
+    fbb_.AddOffset(Column::VT_NAME, name);
+  }
+  void add_type(ColumnType type) {
+    fbb_.AddElement<int8_t>(Column::VT_TYPE, static_cast<int8_t>(type), 0);
+  }
+  void add_data(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> data) {
+    fbb_.AddOffset(Column::VT_DATA, data);
+  }
+  void add_nulls(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> nulls) {
+    fbb_.AddOffset(Column::VT_NULLS, nulls);
+  }
+  void add_bytes(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> bytes) {
+    fbb_.AddOffset(Column::VT_BYTES, bytes);
+  }
+  explicit ColumnBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ColumnBuilder &operator=(const ColumnBuilder &);
+  flatbuffers::Offset<Column> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<Column>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Column> CreateColumn(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    flatbuffers::Offset<flatbuffers::String> name = 0,
+    ColumnType type = ColumnType_Nothing,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> data = 0,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> nulls = 0,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> bytes = 0) {
+  ColumnBuilder builder_(_fbb);
+  builder_.add_bytes(bytes);
+  builder_.add_nulls(nulls);
+  builder_.add_data(data);
+  builder_.add_name(name);
+  builder_.add_type(type);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<Column> CreateColumnDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    const char *name = nullptr,
+    ColumnType type = ColumnType_Nothing,
+    const std::vector<uint8_t> *data = nullptr,
+    const std::vector<uint8_t> *nulls = nullptr,
+    const std::vector<uint8_t> *bytes = nullptr) {
+  return choco::wire::CreateColumn(
+      _fbb,
+      name ? _fbb.CreateString(name) : 0,
+      type,
+      data ? _fbb.CreateVector<uint8_t>(*data) : 0,
+      nulls ? _fbb.CreateVector<uint8_t>(*nulls) : 0,
+      bytes ? _fbb.CreateVector<uint8_t>(*bytes) : 0);
+}
+
+struct WriteBatch FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  enum {
+    VT_NUM_ROWS = 4,
+    VT_COLUMNS = 6
+  };
+  uint32_t num_rows() const {
+    return GetField<uint32_t>(VT_NUM_ROWS, 0);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Column>> *columns() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Column>> *>(VT_COLUMNS);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<uint32_t>(verifier, VT_NUM_ROWS) &&
+           VerifyOffset(verifier, VT_COLUMNS) &&
+           verifier.VerifyVector(columns()) &&
+           verifier.VerifyVectorOfTables(columns()) &&
+           verifier.EndTable();
+  }
+};
+
+struct WriteBatchBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_num_rows(uint32_t num_rows) {
+    fbb_.AddElement<uint32_t>(WriteBatch::VT_NUM_ROWS, num_rows, 0);
+  }
+  void add_columns(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Column>>> columns) {
+    fbb_.AddOffset(WriteBatch::VT_COLUMNS, columns);
+  }
+  explicit WriteBatchBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  WriteBatchBuilder &operator=(const WriteBatchBuilder &);
+  flatbuffers::Offset<WriteBatch> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<WriteBatch>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<WriteBatch> CreateWriteBatch(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    uint32_t num_rows = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Column>>> columns = 0) {
+  WriteBatchBuilder builder_(_fbb);
+  builder_.add_columns(columns);
+  builder_.add_num_rows(num_rows);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<WriteBatch> CreateWriteBatchDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    uint32_t num_rows = 0,
+    const std::vector<flatbuffers::Offset<Column>> *columns = nullptr) {
+  return choco::wire::CreateWriteBatch(
+      _fbb,
+      num_rows,
+      columns ? _fbb.CreateVector<flatbuffers::Offset<Column>>(*columns) : 0);
+}
+
+struct WriteRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  enum {
+    VT_MODE = 4,
+    VT_BATCHES = 6
+  };
+  WriteMode mode() const {
+    return static_cast<WriteMode>(GetField<int8_t>(VT_MODE, 0));
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<WriteBatch>> *batches() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<WriteBatch>> *>(VT_BATCHES);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int8_t>(verifier, VT_MODE) &&
+           VerifyOffset(verifier, VT_BATCHES) &&
+           verifier.VerifyVector(batches()) &&
+           verifier.VerifyVectorOfTables(batches()) &&
+           verifier.EndTable();
+  }
+};
+
+struct WriteRequestBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_mode(WriteMode mode) {
+    fbb_.AddElement<int8_t>(WriteRequest::VT_MODE, static_cast<int8_t>(mode), 0);
+  }
+  void add_batches(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<WriteBatch>>> batches) {
+    fbb_.AddOffset(WriteRequest::VT_BATCHES, batches);
+  }
+  explicit WriteRequestBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  WriteRequestBuilder &operator=(const WriteRequestBuilder &);
+  flatbuffers::Offset<WriteRequest> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<WriteRequest>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<WriteRequest> CreateWriteRequest(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    WriteMode mode = WriteMode_Upsert,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<WriteBatch>>> batches = 0) {
+  WriteRequestBuilder builder_(_fbb);
+  builder_.add_batches(batches);
+  builder_.add_mode(mode);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<WriteRequest> CreateWriteRequestDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    WriteMode mode = WriteMode_Upsert,
+    const std::vector<flatbuffers::Offset<WriteBatch>> *batches = nullptr) {
+  return choco::wire::CreateWriteRequest(
+      _fbb,
+      mode,
+      batches ? _fbb.CreateVector<flatbuffers::Offset<WriteBatch>>(*batches) : 0);
+}
+
+struct ScanBlock FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  enum {
+    VT_NUM_ROWS = 4,
+    VT_COLUMNS = 6,
+    VT_SELECTION = 8
+  };
+  uint32_t num_rows() const {
+    return GetField<uint32_t>(VT_NUM_ROWS, 0);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<Column>> *columns() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Column>> *>(VT_COLUMNS);
+  }
+  const flatbuffers::Vector<uint8_t> *selection() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_SELECTION);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<uint32_t>(verifier, VT_NUM_ROWS) &&
+           VerifyOffset(verifier, VT_COLUMNS) &&
+           verifier.VerifyVector(columns()) &&
+           verifier.VerifyVectorOfTables(columns()) &&
+           VerifyOffset(verifier, VT_SELECTION) &&
+           verifier.VerifyVector(selection()) &&
+           verifier.EndTable();
+  }
+};
+
+struct ScanBlockBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_num_rows(uint32_t num_rows) {
+    fbb_.AddElement<uint32_t>(ScanBlock::VT_NUM_ROWS, num_rows, 0);
+  }
+  void add_columns(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Column>>> columns) {
+    fbb_.AddOffset(ScanBlock::VT_COLUMNS, columns);
+  }
+  void add_selection(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> selection) {
+    fbb_.AddOffset(ScanBlock::VT_SELECTION, selection);
+  }
+  explicit ScanBlockBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ScanBlockBuilder &operator=(const ScanBlockBuilder &);
+  flatbuffers::Offset<ScanBlock> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<ScanBlock>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<ScanBlock> CreateScanBlock(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    uint32_t num_rows = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Column>>> columns = 0,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> selection = 0) {
+  ScanBlockBuilder builder_(_fbb);
+  builder_.add_selection(selection);
+  builder_.add_columns(columns);
+  builder_.add_num_rows(num_rows);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<ScanBlock> CreateScanBlockDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    uint32_t num_rows = 0,
+    const std::vector<flatbuffers::Offset<Column>> *columns = nullptr,
+    const std::vector<uint8_t> *selection = nullptr) {
+  return choco::wire::CreateScanBlock(
+      _fbb,
+      num_rows,
+      columns ? _fbb.CreateVector<flatbuffers::Offset<Column>>(*columns) : 0,
+      selection ? _fbb.CreateVector<uint8_t>(*selection) : 0);
+}
+
+inline const choco::wire::WriteRequest *GetWriteRequest(const void *buf) {
+  return flatbuffers::GetRoot<choco::wire::WriteRequest>(buf);
+}
+
+inline const choco::wire::WriteRequest *GetSizePrefixedWriteRequest(const void *buf) {
+  return flatbuffers::GetSizePrefixedRoot<choco::wire::WriteRequest>(buf);
+}
+
+inline bool VerifyWriteRequestBuffer(
+    flatbuffers::Verifier &verifier) {
+  return verifier.VerifyBuffer<choco::wire::WriteRequest>(nullptr);
+}
+
+inline bool VerifySizePrefixedWriteRequestBuffer(
+    flatbuffers::Verifier &verifier) {
+  return verifier.VerifySizePrefixedBuffer<choco::wire::WriteRequest>(nullptr);
+}
+
+inline void FinishWriteRequestBuffer(
+    flatbuffers::FlatBufferBuilder &fbb,
+    flatbuffers::Offset<choco::wire::WriteRequest> root) {
+  fbb.Finish(root);
+}
+
+inline void FinishSizePrefixedWriteRequestBuffer(
+    flatbuffers::FlatBufferBuilder &fbb,
+    flatbuffers::Offset<choco::wire::WriteRequest> root) {
+  fbb.FinishSizePrefixed(root);
+}
+
+}  // namespace wire
+}  // namespace choco
+
+#endif  // FLATBUFFERS_GENERATED_WIRE_CHOCO_WIRE_H_
@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+#include "wire.h"
+#include "mem_tablet.h"
+#include "mem_tablet_scan.h"
+
+namespace choco {
+
+// copy of a finished buffer, kWireAlignment aligned like a received one
+static vector<uint64_t> CopyBuffer(const flatbuffers::FlatBufferBuilder& fbb) {
+    vector<uint64_t> buf((fbb.GetSize() + 7) / 8 + 1);
+    memcpy(buf.data(), fbb.GetBufferPointer(), fbb.GetSize());
+    return buf;
+}
+
+TEST(Wire, write_request) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int64 id,int32 v null,int8 city,float64 score null", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    const size_t N = 5000;
+    vector<int64_t> ids(N);
+    vector<int32_t> vs(N);
+    vector<int8_t> cities(N);
+    vector<double> scores(N);
+    vector<uint8_t> v_nulls(BitmapSize64(N), 0);
+    srand(1);
+    for (size_t i = 0; i < N; i++) {
+        ids[i] = i * 3;
+        vs[i] = rand();
+        cities[i] = rand() % 100;
+        scores[i] = rand() / 7.0;
+        if (i % 5 == 0) {
+            BitmapSet(v_nulls.data(), i);
+        }
+    }
+    unique_ptr<WriteTx> wtx;
+    ASSERT_TRUE(tablet->create_writetx(wtx));
+    wtx->set_mode(WriteInsertOnly);
+    ColumnarBatch* cbatch = nullptr;
+    ASSERT_TRUE(wtx->new_columnar_batch({"v", "id", "city", "score"}, cbatch));
+    ASSERT_TRUE(cbatch->append(N, {ids.data(), vs.data(), cities.data(), scores.data()},
+                               {nullptr, v_nulls.data(), nullptr, nullptr}));
+    flatbuffers::FlatBufferBuilder fbb(1024, nullptr, false, kWireAlignment);
+    ASSERT_TRUE(EncodeWriteRequest(*wtx, fbb));
+    vector<uint64_t> buf = CopyBuffer(fbb);
+
+    // commit request decoded in another writetx
+    unique_ptr<WriteTx> rwtx;
+    ASSERT_TRUE(tablet->create_writetx(rwtx));
+    ASSERT_TRUE(DecodeWriteRequest((const uint8_t*)buf.data(), fbb.GetSize(), *rwtx));
+    EXPECT_EQ(WriteInsertOnly, rwtx->mode());
+    ASSERT_EQ(1U, rwtx->columnar_batch_size());
+    const ColumnarBatch* rbatch = rwtx->get_columnar_batch(0);
+    ASSERT_EQ(N, rbatch->row_size());
+    // arrays reference the buffer
+    const uint8_t* begin = (const uint8_t*)buf.data();
+    EXPECT_TRUE((const uint8_t*)rbatch->column_data(0) > begin &&
+                (const uint8_t*)rbatch->column_data(0) < begin + fbb.GetSize());
+    ASSERT_TRUE(tablet->commit(rwtx, 1));
+
+    unique_ptr<ScanSpec> scanspec;
+    ASSERT_TRUE(ScanSpec::create(1, "id,v,city,score", true, scanspec));
+    unique_ptr<MemTabletScan> scan;
+    ASSERT_TRUE(tablet->scan(scanspec, scan));
+    size_t nrow = 0;
+    while (true) {
+        const RowBlock* block = nullptr;
+        ASSERT_TRUE(scan->next_scan_block(block));
+        if (!block) {
+            break;
+        }
+        flatbuffers::FlatBufferBuilder sfbb(1024, nullptr, false, kWireAlignment);
+        ASSERT_TRUE(EncodeScanBlock(*scan, *block, sfbb));
+        vector<uint64_t> sbuf = CopyBuffer(sfbb);
+        flatbuffers::Verifier verifier((const uint8_t*)sbuf.data(), sfbb.GetSize());
+        ASSERT_TRUE(verifier.VerifyBuffer<wire::ScanBlock>(nullptr));
+        const wire::ScanBlock* sb = flatbuffers::GetRoot<wire::ScanBlock>(sbuf.data());
+        ASSERT_EQ(block->num_rows(), sb->num_rows());
+        ASSERT_EQ(4U, sb->columns()->size());
+        EXPECT_TRUE(sb->selection() == nullptr);
+        EXPECT_EQ("v", sb->columns()->Get(1)->name()->str());
+        EXPECT_EQ(wire::ColumnType_Float64, sb->columns()->Get(3)->type());
+        const flatbuffers::Vector<uint8_t>* sid_nulls = sb->columns()->Get(0)->nulls();
+        EXPECT_TRUE(!sid_nulls || BitmapIsAllZero(sid_nulls->data(), 0, sb->num_rows()));
+        const int64_t* sids = (const int64_t*)sb->columns()->Get(0)->data()->data();
+        const int32_t* svs = (const int32_t*)sb->columns()->Get(1)->data()->data();
+        const uint8_t* sv_nulls = sb->columns()->Get(1)->nulls()->data();
+        const int8_t* scities = (const int8_t*)sb->columns()->Get(2)->data()->data();
+        const double* sscores = (const double*)sb->columns()->Get(3)->data()->data();
+        for (size_t i = 0; i < sb->num_rows(); i++) {
+            // keys are inserted in order
+            size_t row = sids[i] / 3;
+            ASSERT_EQ(ids[row], sids[i]);
+            ASSERT_EQ(BitmapTest(v_nulls.data(), row), BitmapTest(sv_nulls, i));
+            if (!BitmapTest(sv_nulls, i)) {
+                ASSERT_EQ(vs[row], svs[i]);
+            }
+            ASSERT_EQ(cities[row], scities[i]);
+            ASSERT_EQ(scores[row], sscores[i]);
+        }
+        nrow += sb->num_rows();
+    }
+    EXPECT_EQ(N, nrow);
+}
+
+TEST(Wire, reject) {
+    unique_ptr<Schema> sc;
+    ASSERT_TRUE(Schema::create("int64 id,int32 v null", sc));
+    shared_ptr<MemTablet> tablet;
+    ASSERT_TRUE(MemTablet::create("", sc, tablet));
+    vector<int64_t> ids = {1, 2, 3};
+    vector<int32_t> vs = {4, 5, 6};
+    auto encode = [&](const vector<flatbuffers::Offset<wire::Column>>& columns,
+                      flatbuffers::FlatBufferBuilder& fbb) {
+        auto batch = wire::CreateWriteBatch(fbb, ids.size(), fbb.CreateVector(columns));
+        vector<flatbuffers::Offset<wire::WriteBatch>> batches = {batch};
+        wire::FinishWriteRequestBuffer(fbb, wire::CreateWriteRequest(fbb, wire::WriteMode_Upsert,
+                                                                     fbb.CreateVector(batches)));
+    };
+    auto column = [&](flatbuffers::FlatBufferBuilder& fbb, const char* name, wire::ColumnType type,
+                      const void* data, size_t size) {
+        auto fname = fbb.CreateString(name);
+        fbb.ForceVectorAlignment(size, 1, kWireAlignment);
+        auto fdata = fbb.CreateVector((const uint8_t*)data, size);
+        return wire::CreateColumn(fbb, fname, type, fdata);
+    };
+    unique_ptr<WriteTx> wtx;
+    ASSERT_TRUE(tablet->create_writetx(wtx));
+    {
+        flatbuffers::FlatBufferBuilder fbb(1024, nullptr, false, kWireAlignment);
+        encode({column(fbb, "id", wire::ColumnType_Int64, ids.data(), 24),
+                column(fbb, "v", wire::ColumnType_Int32, vs.data(), 12)}, fbb);
+        vector<uint64_t> buf = CopyBuffer(fbb);
+        // truncated buffer
+        EXPECT_FALSE(DecodeWriteRequest((const uint8_t*)buf.data(), fbb.GetSize() / 2, *wtx));
+        EXPECT_TRUE(DecodeWriteRequest((const uint8_t*)buf.data(), fbb.GetSize(), *wtx));
+    }
+    {
+        // type mismatch
+        flatbuffers::FlatBufferBuilder fbb(1024, nullptr, false, kWireAlignment);
+        encode({column(fbb, "id", wire::ColumnType_Int64, ids.data(), 24),
+                column(fbb, "v", wire::ColumnType_Int64, ids.data(), 24)}, fbb);
+        vector<uint64_t> buf = CopyBuffer(fbb);
+        EXPECT_FALSE(DecodeWriteRequest((const uint8_t*)buf.data(), fbb.GetSize(), *wtx));
+    }
+    {
+        // short data, unknown column, missing key
+        flatbuffers::FlatBufferBuilder fbb(1024, nullptr, false, kWireAlignment);
+        encode({column(fbb, "id", wire::ColumnType_Int64, ids.data(), 16)}, fbb);
+        vector<uint64_t> buf = CopyBuffer(fbb);
+        EXPECT_FALSE(DecodeWriteRequest((const uint8_t*)buf.data(), fbb.GetSize(), *wtx));
+        flatbuffers::FlatBufferBuilder fbb2(1024, nullptr, false, kWireAlignment);
+        encode({column(fbb2, "id", wire::ColumnType_Int64, ids.data(), 24),
+                column(fbb2, "w", wire::ColumnType_Int32, vs.data(), 12)}, fbb2);
+        buf = CopyBuffer(fbb2);
+        EXPECT_FALSE(DecodeWriteRequest((const uint8_t*)buf.data(), fbb2.GetSize(), *wtx));
+        flatbuffers::FlatBufferBuilder fbb3(1024, nullptr, false, kWireAlignment);
+        encode({column(fbb3, "v", wire::ColumnType_Int32, vs.data(), 12)}, fbb3);
+        buf = CopyBuffer(fbb3);
+        EXPECT_FALSE(DecodeWriteRequest((const uint8_t*)buf.data(), fbb3.GetSize(), *wtx));
+    }
+    // only the valid request is added
+    EXPECT_EQ(1U, wtx->columnar_batch_size());
+}
+
+} /* namespace choco */
@@ -1,7 +1,173 @@
 #include "write_tx.h"
+#include "hash_index.h"
+#include "hashcode.h"
 
 namespace choco {
 
+template <class T>
+struct CellOps {
+    // same as key column writer's hashcode
+    static uint64_t hashcode(const void* key) {
+        T v;
+        memcpy(&v, key, sizeof(T));
+        return HashCode(v);
+    }
+
+    static void aggregate(AggregationType agg, uint8_t* cur, const void* value) {
+        T c;
+        T v;
+        memcpy(&c, cur, sizeof(T));
+        memcpy(&v, value, sizeof(T));
+        c = AggregateValue<T>(agg, c, v);
+        memcpy(cur, &c, sizeof(T));
+    }
+};
+
+typedef uint64_t (*HashCodeFunc)(const void* key);
+typedef void (*AggregateFunc)(AggregationType agg, uint8_t* cur, const void* value);
+
+static void GetCellOps(Type type, HashCodeFunc& hash, AggregateFunc& aggregate) {
+    switch (type) {
+    case Int8:
+        hash = CellOps<int8_t>::hashcode;
+        aggregate = CellOps<int8_t>::aggregate;
+        break;
+    case Int16:
+        hash = CellOps<int16_t>::hashcode;
+        aggregate = CellOps<int16_t>::aggregate;
+        break;
+    case Int32:
+        hash = CellOps<int32_t>::hashcode;
+        aggregate = CellOps<int32_t>::aggregate;
+        break;
+    case Int64:
+        hash = CellOps<int64_t>::hashcode;
+        aggregate = CellOps<int64_t>::aggregate;
+        break;
+    case Int128:
+        hash = CellOps<int128_t>::hashcode;
+        aggregate = CellOps<int128_t>::aggregate;
+        break;
+    case Float32:
+        hash = CellOps<float>::hashcode;
+        aggregate = CellOps<float>::aggregate;
+        break;
+    case Float64:
+        hash = CellOps<double>::hashcode;
+        aggregate = CellOps<double>::aggregate;
+        break;
+    default:
+        hash = nullptr;
+        aggregate = nullptr;
+    }
+}
+
+PreparedRows::PreparedRows(const Schema& schema, size_t capacity) : _schema(schema) {
+    _hashcodes.reserve(capacity);
+    _tails.reserve(capacity);
+    _columns.resize(schema.cid_size());
+    for (auto& cs : schema.columns()) {
+        ColumnCells& cells = _columns[cs.cid];
+        cells.cs = &cs;
+        cells.esize = TypeInfo::get(cs.type).size();
+        cells.data.reserve(capacity * cells.esize);
+        cells.states.reserve(capacity);
+        HashCodeFunc hash;
+        GetCellOps(cs.type, hash, cells.aggregate);
+    }
+}
+
+size_t PreparedRows::add_row(uint64_t hashcode, const void* key) {
+    size_t row = _hashcodes.size();
+    _hashcodes.push_back(hashcode);
+    _tails.push_back(-1);
+    for (auto& cells : _columns) {
+        if (cells.cs) {
+            cells.data.resize(cells.data.size() + cells.esize);
+            cells.states.push_back(CellUnset);
+        }
+    }
+    ColumnCells& keys = _columns[1];
+    memcpy(&keys.data[row * keys.esize], key, keys.esize);
+    keys.states[row] = CellValue;
+    return row;
+}
+
+bool PreparedRows::key_equals(size_t row, const void* key) const {
+    const ColumnCells& keys = _columns[1];
+    return memcmp(&keys.data[row * keys.esize], key, keys.esize) == 0;
+}
+
+size_t PreparedRows::merge_target(size_t row, const ColumnSchema& cs) {
+    if (cs.aggregation < AggSum || _columns[cs.cid].states[row] != CellUnset) {
+        return row;
+    }
+    if (_tails[row] == (uint32_t)-1) {
+        ColumnCells& keys = _columns[1];
+        // copy key, add_row may reallocate keys.data
+        vector<uint8_t> key(&keys.data[row * keys.esize], &keys.data[(row + 1) * keys.esize]);
+        _tails[row] = add_row(_hashcodes[row], key.data());
+    }
+    return _tails[row];
+}
+
+void PreparedRows::merge_cell(size_t row, const ColumnSchema& cs, const void* data, bool first) {
+    ColumnCells& cells = _columns[cs.cid];
+    CellState& state = cells.states[row];
+    uint8_t* cur = &cells.data[row * cells.esize];
+    if (!data) {
+        // null update only changes replace columns, null insert sets null
+        if (cs.aggregation == AggReplace || first) {
+            state = CellNull;
+        }
+        return;
+    }
+    if (state == CellValue && cs.aggregation >= AggSum) {
+        cells.aggregate(cs.aggregation, cur, data);
+    } else {
+        memcpy(cur, data, cells.esize);
+        state = CellValue;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+PreparedRowReader::PreparedRowReader(const PreparedRows& rows) : _rows(rows) {
+    _cells.reserve(rows._columns.size());
+}
+
+Status PreparedRowReader::read(size_t idx) {
+    if (idx >= _rows.size()) {
+        return Status::InvalidArgument("idx out of range");
+    }
+    _idx = idx;
+    _cells.clear();
+    // key column(cid 1) first
+    for (auto& cells : _rows._columns) {
+        if (!cells.cs) {
+            continue;
+        }
+        auto state = cells.states[idx];
+        if (state == PreparedRows::CellValue) {
+            _cells.emplace_back(cells.cs, &cells.data[idx * cells.esize]);
+        } else if (state == PreparedRows::CellNull) {
+            _cells.emplace_back(cells.cs, nullptr);
+        }
+    }
+    return Status::OK();
+}
+
+Status PreparedRowReader::get_cell(size_t idx, const ColumnSchema*& cs, const void*& data) const {
+    if (idx >= _cells.size()) {
+        return Status::InvalidArgument("idx exceed size");
+    }
+    cs = _cells[idx].first;
+    data = _cells[idx].second;
+    return Status::OK();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 WriteTx::WriteTx(const Schema& schema) : _schema(schema) {
 }
 
@@ -9,12 +175,99 @@ WriteTx::~WriteTx() {
 }
 
 PartialRowBatch* WriteTx::new_batch() {
+    _prepared.reset();
     _batches.emplace_back(new PartialRowBatch(_schema, 1000000, 1<<15));
     return _batches.back().get();
 }
 
+Status WriteTx::new_columnar_batch(const vector<string>& columns, ColumnarBatch*& batch) {
+    _prepared.reset();
+    unique_ptr<ColumnarBatch> cb;
+    RETURN_NOT_OK(ColumnarBatch::create(_schema, columns, cb));
+    batch = cb.get();
+    _columnar_batches.emplace_back(std::move(cb));
+    return Status::OK();
+}
+
+Status WriteTx::add_columnar_batch(unique_ptr<ColumnarBatch>& batch) {
+    const vector<ColumnSchema>& columns = batch->schema().columns();
+    bool same = columns.size() == _schema.columns().size();
+    for (size_t i = 0; same && i < columns.size(); i++) {
+        same = columns[i].to_string() == _schema.columns()[i].to_string();
+    }
+    if (!same) {
+        return Status::InvalidArgument("columnar batch of another schema");
+    }
+    _prepared.reset();
+    _columnar_batches.emplace_back(std::move(batch));
+    return Status::OK();
+}
+
 const PartialRowBatch * WriteTx::get_batch(size_t idx) const {
     return _batches[idx].get();
 }
 
+Status WriteTx::prepare() {
+    _prepared.reset();
+    if (_mode != WriteUpsert || !_columnar_batches.empty()) {
+        // keys are distinct, or rows are already by column
+        return Status::OK();
+    }
+    for (auto& cs : _schema.columns()) {
+        if (cs.type == String) {
+            return Status::OK();
+        }
+    }
+    double t0 = Time();
+    size_t nrow = 0;
+    for (auto& batch : _batches) {
+        nrow += batch->row_size();
+    }
+    unique_ptr<PreparedRows> prepared(new PreparedRows(_schema, nrow));
+    prepared->_num_input_rows = nrow;
+    HashCodeFunc hash;
+    AggregateFunc aggregate;
+    GetCellOps(_schema.get(1)->type, hash, aggregate);
+    // key hash -> prepared row
+    HashIndex index(nrow);
+    std::vector<HashIndex::Entry> entries;
+    for (auto& batch : _batches) {
+        PartialRowReader reader(*batch);
+        for (size_t i = 0; i < reader.size(); i++) {
+            RETURN_NOT_OK(reader.read(i));
+            const ColumnSchema* cs;
+            const void* key;
+            RETURN_NOT_OK(reader.get_cell(0, cs, key));
+            if (cs->cid != 1 || !key) {
+                return Status::InvalidArgument("row without key");
+            }
+            uint64_t hashcode = hash(key);
+            entries.clear();
+            uint32_t slot = index.find(hashcode, entries);
+            size_t row = -1;
+            for (auto& e : entries) {
+                if (prepared->key_equals(e.value, key)) {
+                    row = e.value;
+                    break;
+                }
+            }
+            bool first = row == (size_t)-1;
+            if (first) {
+                DCHECK_NE(slot, (uint32_t)HashIndex::NOSLOT);
+                row = prepared->add_row(hashcode, key);
+                index.set(slot, hashcode, row);
+            }
+            for (size_t c = 1; c < reader.cell_size(); c++) {
+                const void* data;
+                RETURN_NOT_OK(reader.get_cell(c, cs, data));
+                size_t target = first ? row : prepared->merge_target(row, *cs);
+                prepared->merge_cell(target, *cs, data, first);
+            }
+        }
+    }
+    DLOG(INFO) << Format("prepare writetx rows=%zu keys=%zu %.3lfs", nrow, prepared->size(), Time() - t0);
+    _prepared.swap(prepared);
+    return Status::OK();
+}
+
 } /* namespace choco */
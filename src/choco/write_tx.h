@@ -3,9 +3,111 @@
 
 #include "common.h"
 #include "partial_row_batch.h"
+#include "columnar_batch.h"
 
 namespace choco {
 
+/**
+ * Values of one column for MemTablet::append_columns: data is an array
+ * of the column's type(string columns are not supported), row i is null
+ * if bit i of nulls is set, nulls can be nullptr if there is no null.
+ */
+struct ColumnArray {
+    ColumnArray(const string& name, const void* data, const uint8_t* nulls = nullptr) :
+        name(name), data(data), nulls(nulls) {
+    }
+    string name;
+    const void* data = nullptr;
+    const uint8_t* nulls = nullptr;
+};
+
+/**
+ * Rows of a WriteTx grouped by key, one row per distinct key in order of
+ * first appearance, cells of duplicate keys collapsed by their column's
+ * AggregationType(last write wins for replace). Cells are stored by
+ * column and key hashes are computed, so commit probes the hash index
+ * once per key without decoding rows.
+ *
+ * A sum/max/min cell not set by the first row of its key is folded into
+ * a second row of the key instead, applied after the first, because if
+ * the first row inserts the key the cell starts from the inserted value.
+ */
+class PreparedRows {
+public:
+    // rows, 1 or 2 per distinct key
+    size_t size() const { return _hashcodes.size(); }
+    // rows of WriteTx before collapsing
+    size_t num_input_rows() const { return _num_input_rows; }
+    uint64_t hashcode(size_t idx) const { return _hashcodes[idx]; }
+
+private:
+    friend class WriteTx;
+    friend class PreparedRowReader;
+
+    enum CellState : uint8_t {
+        CellUnset = 0,
+        CellNull,
+        CellValue,
+    };
+    struct ColumnCells {
+        const ColumnSchema* cs = nullptr;
+        size_t esize = 0;
+        // typed sum/max/min of cur and value
+        void (*aggregate)(AggregationType agg, uint8_t* cur, const void* value) = nullptr;
+        vector<uint8_t> data;
+        vector<CellState> states;
+    };
+
+    PreparedRows(const Schema& schema, size_t capacity);
+    // append a new row with only key set, return its index
+    size_t add_row(uint64_t hashcode, const void* key);
+    // first is true for cells of the first row of a key
+    void merge_cell(size_t row, const ColumnSchema& cs, const void* data, bool first);
+    // row of cell (row, cs) of a key's non-first row, row or its tail
+    size_t merge_target(size_t row, const ColumnSchema& cs);
+    bool key_equals(size_t row, const void* key) const;
+
+    const Schema& _schema;
+    size_t _num_input_rows = 0;
+    vector<uint64_t> _hashcodes;
+    // second row of a key's first row, -1 if not exists
+    vector<uint32_t> _tails;
+    // cid -> cells
+    vector<ColumnCells> _columns;
+};
+
+/**
+ * Read rows of PreparedRows with the same interface as PartialRowReader
+ */
+class PreparedRowReader {
+public:
+    PreparedRowReader(const PreparedRows& rows);
+    size_t size() const { return _rows.size(); }
+    Status read(size_t idx);
+    uint64_t hashcode() const { return _rows.hashcode(_idx); }
+    size_t cell_size() const { return _cells.size(); }
+    Status get_cell(size_t idx, const ColumnSchema*& cs, const void*& data) const;
+
+private:
+    const PreparedRows& _rows;
+    size_t _idx = 0;
+    vector<std::pair<const ColumnSchema*, const void*>> _cells;
+};
+
+enum WriteMode {
+    // update rows whose key exists, insert the others
+    WriteUpsert = 0,
+    /**
+     * caller guarantees keys are new to the tablet and distinct in the
+     * WriteTx(e.g. event logs), rows are added to the index without
+     * looking up their keys, breaking the guarantee leaves duplicate
+     * keys in the tablet
+     */
+    WriteInsertOnly,
+    // insert only, but look up keys and fail commit if any exists
+    WriteInsertOnlyVerify,
+};
+
 class WriteTx {
 public:
     WriteTx(const Schema& schema);
@@ -17,11 +119,45 @@ public:
 
     const PartialRowBatch * get_batch(size_t idx) const;
 
+    // discards prepared rows
     PartialRowBatch* new_batch();
 
+    /**
+     * add a batch whose rows all set columns, applied after row batches,
+     * discards prepared rows
+     */
+    Status new_columnar_batch(const vector<string>& columns, ColumnarBatch*& batch);
+
+    // add a columnar batch created for schema(), e.g. wrapping a request buffer
+    Status add_columnar_batch(unique_ptr<ColumnarBatch>& batch);
+
+    size_t columnar_batch_size() const { return _columnar_batches.size(); }
+
+    const ColumnarBatch* get_columnar_batch(size_t idx) const { return _columnar_batches[idx].get(); }
+
+    /**
+     * group rows of all batches by key into prepared(), no-op for schemas
+     * with string columns, in insert only modes or with columnar batches
+     */
+    Status prepare();
+
+    // WriteUpsert by default
+    WriteMode mode() const { return _mode; }
+    // discards prepared rows
+    void set_mode(WriteMode mode) {
+        _mode = mode;
+        _prepared.reset();
+    }
+
+    // nullptr if not prepared
+    const PreparedRows* prepared() const { return _prepared.get(); }
+
 private:
     Schema _schema;
     vector<unique_ptr<PartialRowBatch>> _batches;
+    vector<unique_ptr<ColumnarBatch>> _columnar_batches;
+    unique_ptr<PreparedRows> _prepared;
+    WriteMode _mode = WriteUpsert;
 };
 
 } /* namespace choco */
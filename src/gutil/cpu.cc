@@ -72,6 +72,9 @@ CPU::CPU()
     has_popcnt_(false),
     has_avx_(false),
     has_avx2_(false),
+    has_avx512f_(false),
+    has_avx512bw_(false),
+    has_avx512vl_(false),
     has_aesni_(false),
     has_non_stop_time_stamp_counter_(false),
     is_running_in_vm_(false),
@@ -208,6 +211,12 @@ void CPU::Initialize() {
         (xgetbv(0) & 6) == 6 /* XSAVE enabled by kernel */;
     has_aesni_ = (cpu_info[2] & 0x02000000) != 0;
     has_avx2_ = has_avx_ && (cpu_info7[1] & 0x00000020) != 0;
+    // AVX-512 also needs the kernel to save opmask and upper ZMM state
+    // (XCR0 bits 5-7) besides the AVX state.
+    bool avx512_enabled = has_avx_ && (xgetbv(0) & 0xe6) == 0xe6;
+    has_avx512f_ = avx512_enabled && (cpu_info7[1] & 0x00010000) != 0;
+    has_avx512bw_ = has_avx512f_ && (cpu_info7[1] & 0x40000000) != 0;
+    has_avx512vl_ = has_avx512f_ && (cpu_info7[1] & 0x80000000) != 0;
   }
   // Get the brand string of the cpu.
   __cpuid(cpu_info, 0x80000000);
@@ -260,6 +269,7 @@ void CPU::Initialize() {
 #endif
 }
 CPU::IntelMicroArchitecture CPU::GetIntelMicroArchitecture() const {
+  if (has_avx512f()) return AVX512;
   if (has_avx2()) return AVX2;
   if (has_avx()) return AVX;
   if (has_sse42()) return SSE42;
@@ -62,6 +62,7 @@ class CPU final {
     SSE42,
     AVX,
     AVX2,
+    AVX512,
     MAX_INTEL_MICRO_ARCHITECTURE
   };
   // Accessors for CPU information.
@@ -83,6 +84,9 @@ class CPU final {
   bool has_popcnt() const { return has_popcnt_; }
   bool has_avx() const { return has_avx_; }
   bool has_avx2() const { return has_avx2_; }
+  bool has_avx512f() const { return has_avx512f_; }
+  bool has_avx512bw() const { return has_avx512bw_; }
+  bool has_avx512vl() const { return has_avx512vl_; }
   bool has_aesni() const { return has_aesni_; }
   bool has_non_stop_time_stamp_counter() const {
     return has_non_stop_time_stamp_counter_;
@@ -110,6 +114,9 @@ class CPU final {
   bool has_popcnt_;
   bool has_avx_;
   bool has_avx2_;
+  bool has_avx512f_;
+  bool has_avx512bw_;
+  bool has_avx512vl_;
   bool has_aesni_;
   bool has_non_stop_time_stamp_counter_;
   bool is_running_in_vm_;